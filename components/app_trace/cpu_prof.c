@@ -0,0 +1,617 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Sampling CPU profiler.
+ *
+ * The sampler runs in the tick interrupt of every core. It reads the context of
+ * the interrupted task from its task snapshot, walks a few frames of its stack
+ * and pushes the result into a per-core ring buffer. Each ring has exactly one
+ * producer (the tick interrupt of its core) and one consumer (the drain task),
+ * so no lock is taken in the interrupt. Task names are kept in a per-core table
+ * which is also only written by the sampler of that core.
+ *
+ * The drain task empties the rings periodically and either aggregates the
+ * samples into a table of distinct stacks (printed as folded stacks) or streams
+ * them to the host via application level tracing.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/task_snapshot.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_cpu.h"
+#include "esp_freertos_hooks.h"
+#include "esp_cpu_prof.h"
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+#include "freertos/xtensa_context.h"
+#include "esp_cpu_utils.h"
+#include "esp_debug_helpers.h"
+#else
+#include "riscv/rvruntime-frames.h"
+#endif
+#if CONFIG_APPTRACE_ENABLE
+#include "esp_app_trace.h"
+#endif
+
+#define CPU_PROF_MAX_DEPTH      CONFIG_APPTRACE_CPU_PROF_MAX_DEPTH
+#define CPU_PROF_RING_SAMPLES   CONFIG_APPTRACE_CPU_PROF_BUF_SAMPLES
+#define CPU_PROF_MAX_TASKS      CONFIG_APPTRACE_CPU_PROF_MAX_TASKS
+#define CPU_PROF_SLOT_WORDS     (1 + CPU_PROF_MAX_DEPTH)
+
+/* Pseudo task indexes */
+#define CPU_PROF_TASK_ISR       0xFF    /* The tick interrupted another interrupt */
+#define CPU_PROF_TASK_OTHER     0xFE    /* The task table of the core is full */
+
+/* The first word of a sample: task index and number of PCs which follow */
+#define CPU_PROF_HDR(task, depth)   (((uint32_t)(task) << 8) | (depth))
+#define CPU_PROF_HDR_TASK(hdr)      (((hdr) >> 8) & 0xFF)
+#define CPU_PROF_HDR_DEPTH(hdr)     ((hdr) & 0xFF)
+
+/* Records streamed to the host. Every record starts with a little endian word
+ * {type, core, task index, length} followed by the payload. See
+ * tools/esp_app_trace/cpuprof_proc.py for the host side. */
+#define CPU_PROF_REC_START      0   /* payload: "CPRF", length is the format version */
+#define CPU_PROF_REC_TASK       1   /* payload: task name, length is the name length */
+#define CPU_PROF_REC_SAMPLE     2   /* payload: PCs from the innermost frame, length is the number of PCs */
+#define CPU_PROF_REC_VERSION    1
+#define CPU_PROF_REC_HDR(type, core, task, len) \
+    ((type) | ((uint32_t)(core) << 8) | ((uint32_t)(task) << 16) | ((uint32_t)(len) << 24))
+
+/* Timeout of a single write to the trace buffer, us */
+#define CPU_PROF_APPTRACE_TMO   100000
+
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+/* Interrupt nesting level of every core, maintained by the port. The tick
+ * interrupt itself counts as one level. */
+extern unsigned port_interruptNesting[portNUM_PROCESSORS];
+#define CPU_PROF_NESTED_ISR(core)   (port_interruptNesting[core] > 1)
+#else
+extern UBaseType_t uxInterruptNesting;
+#define CPU_PROF_NESTED_ISR(core)   (uxInterruptNesting > 1)
+#endif
+
+typedef struct {
+    TaskHandle_t handle;
+    char name[configMAX_TASK_NAME_LEN];
+} cpu_prof_task_t;
+
+typedef struct {
+    /* Ring of CPU_PROF_RING_SAMPLES slots of CPU_PROF_SLOT_WORDS words */
+    uint32_t *ring;
+    atomic_uint head;           /* written by the sampler */
+    atomic_uint tail;           /* written by the drain task */
+    /* Task table, entries below task_count are never modified */
+    cpu_prof_task_t *tasks;
+    atomic_uint task_count;
+    uint32_t tasks_announced;   /* drain task: task records already streamed */
+    uint32_t last_task;
+    uint32_t countdown;
+    /* Statistics, written by the sampler only */
+    uint32_t samples;
+    uint32_t isr_samples;
+    uint32_t dropped;
+    uint32_t max_cycles;
+    uint64_t cycles;
+} cpu_prof_core_t;
+
+typedef struct {
+    uint32_t count;
+    uint8_t core;
+    uint8_t task;
+    uint8_t depth;
+    uint32_t pcs[CPU_PROF_MAX_DEPTH];
+} cpu_prof_stack_t;
+
+typedef struct {
+    esp_cpu_prof_config_t config;
+    volatile bool running;
+    bool exit;
+    TaskHandle_t drain_task;
+    SemaphoreHandle_t drain_done;
+    SemaphoreHandle_t lock;     /* protects the stack table */
+    /* Stack table, open addressing over bucket indexes into stacks */
+    cpu_prof_stack_t *stacks;
+    uint16_t *buckets;
+    uint32_t bucket_mask;
+    uint32_t stack_count;
+    uint32_t stacks_dropped;
+    uint32_t stream_dropped;
+} cpu_prof_t;
+
+static const char *TAG = "cpu_prof";
+static DRAM_ATTR cpu_prof_core_t s_cores[portNUM_PROCESSORS];
+static cpu_prof_t *s_prof;
+
+/* Compare a task name without calling into the C library from the interrupt */
+static inline IRAM_ATTR bool task_name_equal(const char *a, const char *b)
+{
+    for (int i = 0; i < configMAX_TASK_NAME_LEN; i++) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+        if (a[i] == '\0') {
+            break;
+        }
+    }
+    return true;
+}
+
+static IRAM_ATTR uint32_t task_index(cpu_prof_core_t *core, TaskHandle_t handle)
+{
+    const char *name = pcTaskGetName(handle);
+    uint32_t count = atomic_load_explicit(&core->task_count, memory_order_relaxed);
+    cpu_prof_task_t *task;
+
+    /* Most samples hit the same task as the last one on this core */
+    if (core->last_task < count) {
+        task = &core->tasks[core->last_task];
+        if (task->handle == handle && task_name_equal(task->name, name)) {
+            return core->last_task;
+        }
+    }
+    /* The name is compared too, a TCB may be reused by a different task */
+    for (uint32_t i = 0; i < count; i++) {
+        task = &core->tasks[i];
+        if (task->handle == handle && task_name_equal(task->name, name)) {
+            core->last_task = i;
+            return i;
+        }
+    }
+    if (count == CPU_PROF_MAX_TASKS) {
+        return CPU_PROF_TASK_OTHER;
+    }
+    task = &core->tasks[count];
+    task->handle = handle;
+    for (int i = 0; i < configMAX_TASK_NAME_LEN; i++) {
+        task->name[i] = name[i];
+        if (name[i] == '\0') {
+            break;
+        }
+    }
+    task->name[configMAX_TASK_NAME_LEN - 1] = '\0';
+    /* Publish the entry before any sample refers to it */
+    atomic_store_explicit(&core->task_count, count + 1, memory_order_release);
+    core->last_task = count;
+    return count;
+}
+
+/* Record the PCs of the interrupted task, innermost first */
+static IRAM_ATTR uint32_t task_backtrace(TaskHandle_t handle, uint32_t *pcs, uint32_t depth)
+{
+    TaskSnapshot_t snapshot;
+
+    vTaskGetSnapshot(handle, &snapshot);
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+    /* On interrupt entry the port has saved the interrupted context at the top of
+     * the task stack and spilled all register windows to the stack, so the frame
+     * can be walked the same way as the panic handler does. */
+    const XtExcFrame *xt_frame = (const XtExcFrame *)snapshot.pxTopOfStack;
+    const uint32_t stack_low = (uint32_t)snapshot.pxTopOfStack;
+    const uint32_t stack_high = (uint32_t)snapshot.pxEndOfStack;
+    esp_backtrace_frame_t frame = {
+        .pc = xt_frame->pc,
+        .sp = xt_frame->a1,
+        .next_pc = xt_frame->a0,
+        .exc_frame = xt_frame,
+    };
+    uint32_t n = 0;
+
+    pcs[n++] = frame.pc;
+    while (n < depth && frame.next_pc != 0) {
+        uint32_t sp = frame.sp;
+        /* Stay within the stack of the task, frames only ever move up */
+        if (sp <= stack_low || sp > stack_high) {
+            break;
+        }
+        if (!esp_backtrace_get_next_frame(&frame) || frame.sp <= sp) {
+            break;
+        }
+        pcs[n++] = esp_cpu_process_stack_pc(frame.pc);
+    }
+    return n;
+#else
+    /* Unwinding needs the eh_frame tables on RISC-V, only the PC is recorded */
+    const RvExcFrame *rv_frame = (const RvExcFrame *)snapshot.pxTopOfStack;
+
+    pcs[0] = rv_frame->mepc;
+    return 1;
+#endif
+}
+
+static IRAM_ATTR void cpu_prof_tick_hook(void)
+{
+    const int core_id = xPortGetCoreID();
+    cpu_prof_core_t *core = &s_cores[core_id];
+
+    if (!s_prof->running || --core->countdown != 0) {
+        return;
+    }
+    core->countdown = s_prof->config.period_ticks;
+
+    const esp_cpu_ccount_t start = esp_cpu_get_ccount();
+    const uint32_t head = atomic_load_explicit(&core->head, memory_order_relaxed);
+    const uint32_t next = (head + 1 == CPU_PROF_RING_SAMPLES) ? 0 : head + 1;
+
+    core->samples++;
+    if (next == atomic_load_explicit(&core->tail, memory_order_acquire)) {
+        core->dropped++;
+        return;
+    }
+    uint32_t *slot = &core->ring[head * CPU_PROF_SLOT_WORDS];
+    if (CPU_PROF_NESTED_ISR(core_id)) {
+        /* The context of the interrupted ISR is not in the task snapshot */
+        core->isr_samples++;
+        slot[0] = CPU_PROF_HDR(CPU_PROF_TASK_ISR, 0);
+    } else {
+        TaskHandle_t handle = xTaskGetCurrentTaskHandleForCPU(core_id);
+        uint32_t depth = task_backtrace(handle, &slot[1], s_prof->config.depth);
+        slot[0] = CPU_PROF_HDR(task_index(core, handle), depth);
+    }
+    atomic_store_explicit(&core->head, next, memory_order_release);
+
+    const uint32_t cycles = esp_cpu_get_ccount() - start;
+    core->cycles += cycles;
+    if (cycles > core->max_cycles) {
+        core->max_cycles = cycles;
+    }
+}
+
+static const char *task_name(int core, uint32_t task)
+{
+    if (task == CPU_PROF_TASK_ISR) {
+        return "(isr)";
+    }
+    if (task == CPU_PROF_TASK_OTHER) {
+        return "(other)";
+    }
+    return s_cores[core].tasks[task].name;
+}
+
+static uint32_t stack_hash(int core, uint32_t hdr, const uint32_t *pcs)
+{
+    /* FNV-1a over the words of the sample */
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ (uint32_t)core) * 16777619u;
+    hash = (hash ^ hdr) * 16777619u;
+    for (uint32_t i = 0; i < CPU_PROF_HDR_DEPTH(hdr); i++) {
+        hash = (hash ^ pcs[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void stack_add(int core, uint32_t hdr, const uint32_t *pcs)
+{
+    const uint32_t task = CPU_PROF_HDR_TASK(hdr);
+    const uint32_t depth = CPU_PROF_HDR_DEPTH(hdr);
+    uint32_t bucket = stack_hash(core, hdr, pcs) & s_prof->bucket_mask;
+
+    while (s_prof->buckets[bucket] != UINT16_MAX) {
+        cpu_prof_stack_t *stack = &s_prof->stacks[s_prof->buckets[bucket]];
+        if (stack->core == core && stack->task == task && stack->depth == depth &&
+                memcmp(stack->pcs, pcs, depth * sizeof(uint32_t)) == 0) {
+            stack->count++;
+            return;
+        }
+        bucket = (bucket + 1) & s_prof->bucket_mask;
+    }
+    if (s_prof->stack_count == s_prof->config.max_stacks) {
+        s_prof->stacks_dropped++;
+        return;
+    }
+    cpu_prof_stack_t *stack = &s_prof->stacks[s_prof->stack_count];
+    stack->count = 1;
+    stack->core = core;
+    stack->task = task;
+    stack->depth = depth;
+    memcpy(stack->pcs, pcs, depth * sizeof(uint32_t));
+    s_prof->buckets[bucket] = s_prof->stack_count++;
+}
+
+#if CONFIG_APPTRACE_ENABLE
+static void stream_write(const void *data, uint32_t size)
+{
+    if (esp_apptrace_write(ESP_APPTRACE_DEST_JTAG, data, size, CPU_PROF_APPTRACE_TMO) != ESP_OK) {
+        s_prof->stream_dropped++;
+    }
+}
+
+static void stream_tasks(int core_id)
+{
+    cpu_prof_core_t *core = &s_cores[core_id];
+    uint32_t count = atomic_load_explicit(&core->task_count, memory_order_acquire);
+
+    for (; core->tasks_announced < count; core->tasks_announced++) {
+        struct {
+            uint32_t hdr;
+            char name[configMAX_TASK_NAME_LEN];
+        } rec;
+        uint32_t len = strlen(core->tasks[core->tasks_announced].name);
+        rec.hdr = CPU_PROF_REC_HDR(CPU_PROF_REC_TASK, core_id, core->tasks_announced, len);
+        memcpy(rec.name, core->tasks[core->tasks_announced].name, len);
+        stream_write(&rec, sizeof(rec.hdr) + len);
+    }
+}
+
+static void stream_sample(int core, uint32_t hdr, const uint32_t *pcs)
+{
+    uint32_t rec[1 + CPU_PROF_MAX_DEPTH];
+    const uint32_t depth = CPU_PROF_HDR_DEPTH(hdr);
+
+    rec[0] = CPU_PROF_REC_HDR(CPU_PROF_REC_SAMPLE, core, CPU_PROF_HDR_TASK(hdr), depth);
+    memcpy(&rec[1], pcs, depth * sizeof(uint32_t));
+    stream_write(rec, (1 + depth) * sizeof(uint32_t));
+}
+#endif /* CONFIG_APPTRACE_ENABLE */
+
+static void drain_samples(void)
+{
+    for (int core_id = 0; core_id < portNUM_PROCESSORS; core_id++) {
+        cpu_prof_core_t *core = &s_cores[core_id];
+        /* Task entries are published before the samples which refer to them,
+         * so the ring head has to be read first */
+        const uint32_t head = atomic_load_explicit(&core->head, memory_order_acquire);
+        uint32_t tail = atomic_load_explicit(&core->tail, memory_order_relaxed);
+
+        if (head == tail) {
+            continue;
+        }
+#if CONFIG_APPTRACE_ENABLE
+        if (s_prof->config.output == ESP_CPU_PROF_OUTPUT_APPTRACE) {
+            stream_tasks(core_id);
+        }
+#endif
+        xSemaphoreTake(s_prof->lock, portMAX_DELAY);
+        while (tail != head) {
+            const uint32_t *slot = &core->ring[tail * CPU_PROF_SLOT_WORDS];
+#if CONFIG_APPTRACE_ENABLE
+            if (s_prof->config.output == ESP_CPU_PROF_OUTPUT_APPTRACE) {
+                stream_sample(core_id, slot[0], &slot[1]);
+            } else
+#endif
+            {
+                stack_add(core_id, slot[0], &slot[1]);
+            }
+            tail = (tail + 1 == CPU_PROF_RING_SAMPLES) ? 0 : tail + 1;
+            /* Hand the slot back as soon as possible */
+            atomic_store_explicit(&core->tail, tail, memory_order_release);
+        }
+        xSemaphoreGive(s_prof->lock);
+    }
+}
+
+static void drain_task(void *arg)
+{
+    while (!s_prof->exit) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(s_prof->config.drain_period_ms));
+        drain_samples();
+    }
+#if CONFIG_APPTRACE_ENABLE
+    if (s_prof->config.output == ESP_CPU_PROF_OUTPUT_APPTRACE) {
+        esp_apptrace_flush(ESP_APPTRACE_DEST_JTAG, CPU_PROF_APPTRACE_TMO);
+    }
+#endif
+    xSemaphoreGive(s_prof->drain_done);
+    vTaskDelete(NULL);
+}
+
+static void cpu_prof_free(void)
+{
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        free(s_cores[i].ring);
+        free(s_cores[i].tasks);
+        memset(&s_cores[i], 0, sizeof(s_cores[i]));
+    }
+    if (s_prof->lock) {
+        vSemaphoreDelete(s_prof->lock);
+    }
+    if (s_prof->drain_done) {
+        vSemaphoreDelete(s_prof->drain_done);
+    }
+    free(s_prof->stacks);
+    free(s_prof->buckets);
+    free(s_prof);
+    s_prof = NULL;
+}
+
+static esp_err_t cpu_prof_alloc(const esp_cpu_prof_config_t *config)
+{
+    /* Everything the sampler touches must stay accessible with the cache disabled */
+    const uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+
+    s_prof = heap_caps_calloc(1, sizeof(cpu_prof_t), caps);
+    if (s_prof == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_prof->config = *config;
+    s_prof->lock = xSemaphoreCreateMutex();
+    s_prof->drain_done = xSemaphoreCreateBinary();
+    if (s_prof->lock == NULL || s_prof->drain_done == NULL) {
+        goto err;
+    }
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        s_cores[i].ring = heap_caps_calloc(CPU_PROF_RING_SAMPLES * CPU_PROF_SLOT_WORDS, sizeof(uint32_t), caps);
+        s_cores[i].tasks = heap_caps_calloc(CPU_PROF_MAX_TASKS, sizeof(cpu_prof_task_t), caps);
+        if (s_cores[i].ring == NULL || s_cores[i].tasks == NULL) {
+            goto err;
+        }
+    }
+    if (config->output == ESP_CPU_PROF_OUTPUT_FOLDED) {
+        /* Keep the bucket array at most half full */
+        uint32_t buckets = 1;
+        while (buckets < 2 * config->max_stacks) {
+            buckets <<= 1;
+        }
+        s_prof->bucket_mask = buckets - 1;
+        s_prof->stacks = calloc(config->max_stacks, sizeof(cpu_prof_stack_t));
+        s_prof->buckets = malloc(buckets * sizeof(uint16_t));
+        if (s_prof->stacks == NULL || s_prof->buckets == NULL) {
+            goto err;
+        }
+        memset(s_prof->buckets, 0xFF, buckets * sizeof(uint16_t));
+    }
+    return ESP_OK;
+
+err:
+    cpu_prof_free();
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_cpu_prof_start(const esp_cpu_prof_config_t *config)
+{
+    esp_err_t ret;
+
+    if (config == NULL || config->period_ticks == 0 || config->drain_period_ms == 0 ||
+            config->depth == 0 || config->depth > CPU_PROF_MAX_DEPTH ||
+            (config->output == ESP_CPU_PROF_OUTPUT_FOLDED &&
+             (config->max_stacks == 0 || config->max_stacks >= UINT16_MAX))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if !CONFIG_APPTRACE_ENABLE
+    if (config->output == ESP_CPU_PROF_OUTPUT_APPTRACE) {
+        ESP_LOGE(TAG, "Streaming needs application level tracing to be enabled");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#endif
+    if (s_prof != NULL) {
+        if (s_prof->running) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        if (s_prof->config.output != config->output || s_prof->config.max_stacks != config->max_stacks) {
+            ESP_LOGE(TAG, "Output can't be changed without esp_cpu_prof_deinit()");
+            return ESP_ERR_INVALID_STATE;
+        }
+        s_prof->config = *config;
+    } else {
+        ret = cpu_prof_alloc(config);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+#if CONFIG_APPTRACE_ENABLE
+    if (config->output == ESP_CPU_PROF_OUTPUT_APPTRACE) {
+        uint32_t rec[2] = { CPU_PROF_REC_HDR(CPU_PROF_REC_START, 0, 0, CPU_PROF_REC_VERSION) };
+        memcpy(&rec[1], "CPRF", 4);
+        esp_apptrace_write(ESP_APPTRACE_DEST_JTAG, rec, sizeof(rec), CPU_PROF_APPTRACE_TMO);
+        /* Task indexes are announced again after the start record */
+        for (int i = 0; i < portNUM_PROCESSORS; i++) {
+            s_cores[i].tasks_announced = 0;
+        }
+    }
+#endif
+
+    s_prof->exit = false;
+    if (xTaskCreate(drain_task, "cpu_prof", 3072, NULL, config->task_priority, &s_prof->drain_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        s_cores[i].countdown = config->period_ticks;
+    }
+    s_prof->running = true;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        ret = esp_register_freertos_tick_hook_for_cpu(cpu_prof_tick_hook, i);
+        if (ret != ESP_OK) {
+            esp_cpu_prof_stop();
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_cpu_prof_stop(void)
+{
+    if (s_prof == NULL || !s_prof->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_prof->running = false;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        esp_deregister_freertos_tick_hook_for_cpu(cpu_prof_tick_hook, i);
+    }
+    /* A sampler may still be running on the other core, it is done by the next tick */
+    vTaskDelay(2);
+
+    s_prof->exit = true;
+    xTaskNotifyGive(s_prof->drain_task);
+    xSemaphoreTake(s_prof->drain_done, portMAX_DELAY);
+    s_prof->drain_task = NULL;
+    return ESP_OK;
+}
+
+static int stack_count_cmp(const void *a, const void *b)
+{
+    const cpu_prof_stack_t *sa = *(const cpu_prof_stack_t **)a;
+    const cpu_prof_stack_t *sb = *(const cpu_prof_stack_t **)b;
+    return (sa->count < sb->count) - (sa->count > sb->count);
+}
+
+esp_err_t esp_cpu_prof_dump_folded(FILE *stream)
+{
+    if (s_prof == NULL || s_prof->config.output != ESP_CPU_PROF_OUTPUT_FOLDED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_prof->lock, portMAX_DELAY);
+    /* Most frequent stacks first, the order doesn't matter for flamegraph.pl */
+    const cpu_prof_stack_t **sorted = malloc(s_prof->stack_count * sizeof(cpu_prof_stack_t *));
+    if (sorted != NULL) {
+        for (uint32_t i = 0; i < s_prof->stack_count; i++) {
+            sorted[i] = &s_prof->stacks[i];
+        }
+        qsort(sorted, s_prof->stack_count, sizeof(cpu_prof_stack_t *), stack_count_cmp);
+    }
+    for (uint32_t i = 0; i < s_prof->stack_count; i++) {
+        const cpu_prof_stack_t *stack = sorted ? sorted[i] : &s_prof->stacks[i];
+        fprintf(stream, "%s", task_name(stack->core, stack->task));
+        for (int d = stack->depth - 1; d >= 0; d--) {
+            fprintf(stream, ";0x%08x", stack->pcs[d]);
+        }
+        fprintf(stream, " %u\n", stack->count);
+    }
+    xSemaphoreGive(s_prof->lock);
+    free(sorted);
+    return ESP_OK;
+}
+
+esp_err_t esp_cpu_prof_get_stats(esp_cpu_prof_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_prof == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        stats->samples += s_cores[i].samples;
+        stats->isr_samples += s_cores[i].isr_samples;
+        stats->dropped += s_cores[i].dropped;
+        stats->sampler_cycles += s_cores[i].cycles;
+        if (s_cores[i].max_cycles > stats->sampler_max_cycles) {
+            stats->sampler_max_cycles = s_cores[i].max_cycles;
+        }
+    }
+    stats->dropped += s_prof->stacks_dropped + s_prof->stream_dropped;
+    return ESP_OK;
+}
+
+esp_err_t esp_cpu_prof_deinit(void)
+{
+    if (s_prof == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_prof->running) {
+        esp_cpu_prof_stop();
+    }
+    cpu_prof_free();
+    return ESP_OK;
+}
@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef ESP_CPU_PROF_H_
+#define ESP_CPU_PROF_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Where the collected samples go
+ */
+typedef enum {
+    ESP_CPU_PROF_OUTPUT_FOLDED,     /*!< Aggregate samples in RAM, print them with esp_cpu_prof_dump_folded() */
+    ESP_CPU_PROF_OUTPUT_APPTRACE,   /*!< Stream every sample to the host via application level tracing */
+} esp_cpu_prof_output_t;
+
+/**
+ * @brief Sampling CPU profiler configuration
+ */
+typedef struct {
+    uint32_t period_ticks;          /*!< Take a sample every this many RTOS ticks on every core */
+    uint32_t depth;                 /*!< Number of PCs recorded per sample, 1 records the interrupted PC only.
+                                         Limited by CONFIG_APPTRACE_CPU_PROF_MAX_DEPTH. */
+    esp_cpu_prof_output_t output;   /*!< Where the samples go */
+    uint32_t max_stacks;            /*!< Number of distinct stacks kept for ESP_CPU_PROF_OUTPUT_FOLDED */
+    uint32_t drain_period_ms;       /*!< How often the sample buffers are drained */
+    uint32_t task_priority;         /*!< Priority of the task draining the sample buffers */
+} esp_cpu_prof_config_t;
+
+/**
+ * @brief Default profiler configuration: sample every tick, aggregate in RAM
+ */
+#define ESP_CPU_PROF_DEFAULT_CONFIG() { \
+    .period_ticks = 1, \
+    .depth = CONFIG_APPTRACE_CPU_PROF_MAX_DEPTH, \
+    .output = ESP_CPU_PROF_OUTPUT_FOLDED, \
+    .max_stacks = 256, \
+    .drain_period_ms = 50, \
+    .task_priority = 20, \
+}
+
+/**
+ * @brief Profiler statistics, summed over all cores
+ */
+typedef struct {
+    uint32_t samples;               /*!< Number of samples taken, including dropped ones */
+    uint32_t isr_samples;           /*!< Number of samples which interrupted another ISR */
+    uint32_t dropped;               /*!< Samples lost because a sample buffer or the stack table was full */
+    uint64_t sampler_cycles;        /*!< CPU cycles spent in the sampler */
+    uint32_t sampler_max_cycles;    /*!< Longest time spent taking one sample, in CPU cycles */
+} esp_cpu_prof_stats_t;
+
+/**
+ * @brief Start the sampling CPU profiler
+ *
+ * Allocates the sample buffers on the first call and registers the sampler as
+ * a tick hook on every core. Samples are taken in the tick interrupt and record
+ * the core, the interrupted task and the interrupted PC followed by up to
+ * depth - 1 return addresses. Restarting after esp_cpu_prof_stop() continues
+ * adding to the collected data, the output and max_stacks can only be changed
+ * after esp_cpu_prof_deinit().
+ *
+ * @note On RISC-V targets only the interrupted PC is recorded.
+ *
+ * @param config  Profiler configuration
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the configuration is invalid
+ *      - ESP_ERR_INVALID_STATE if the profiler is already running or the output changed
+ *      - ESP_ERR_NOT_SUPPORTED if streaming is requested without application level tracing
+ *      - ESP_ERR_NO_MEM if the buffers could not be allocated
+ */
+esp_err_t esp_cpu_prof_start(const esp_cpu_prof_config_t *config);
+
+/**
+ * @brief Stop the sampling CPU profiler
+ *
+ * Stops sampling and drains the remaining samples. The collected data is kept.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the profiler is not running
+ */
+esp_err_t esp_cpu_prof_stop(void);
+
+/**
+ * @brief Print the samples aggregated so far as folded stacks
+ *
+ * Prints one line per distinct stack, in the format used by flamegraph.pl:
+ * "<task>;<outermost PC>;...;<innermost PC> <count>". The PCs are printed as hex
+ * numbers, tools/esp_app_trace/cpuprof_proc.py translates them to function names.
+ *
+ * @param stream  Output stream, for example stdout
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the profiler does not aggregate samples
+ */
+esp_err_t esp_cpu_prof_dump_folded(FILE *stream);
+
+/**
+ * @brief Get profiler statistics
+ *
+ * @param[out] stats  Statistics of the current profiler session
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if stats is NULL
+ *      - ESP_ERR_INVALID_STATE if the profiler has not been started
+ */
+esp_err_t esp_cpu_prof_get_stats(esp_cpu_prof_stats_t *stats);
+
+/**
+ * @brief Stop the profiler if it is running and free all collected data
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the profiler has not been started
+ */
+esp_err_t esp_cpu_prof_deinit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESP_CPU_PROF_H_ */
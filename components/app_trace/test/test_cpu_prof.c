@@ -0,0 +1,121 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_cpu.h"
+#include "test_utils.h"
+
+#if CONFIG_APPTRACE_CPU_PROF_ENABLE
+#include "esp_cpu_prof.h"
+
+static volatile bool s_busy_stop;
+static volatile uint32_t s_busy_counter;
+
+static void __attribute__((noinline)) prof_busy_loop(void)
+{
+    for (int i = 0; i < 1000; i++) {
+        s_busy_counter++;
+    }
+}
+
+static void prof_busy_task(void *arg)
+{
+    while (!s_busy_stop) {
+        prof_busy_loop();
+    }
+    xSemaphoreGive((SemaphoreHandle_t)arg);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("cpu profiler API checks its arguments and state", "[app_trace][cpu_prof]")
+{
+    esp_cpu_prof_config_t config = ESP_CPU_PROF_DEFAULT_CONFIG();
+    esp_cpu_prof_stats_t stats;
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_cpu_prof_get_stats(&stats));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_cpu_prof_stop());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_cpu_prof_dump_folded(stdout));
+    config.depth = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_cpu_prof_start(&config));
+    config.depth = CONFIG_APPTRACE_CPU_PROF_MAX_DEPTH + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_cpu_prof_start(&config));
+    config.depth = 1;
+    config.period_ticks = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_cpu_prof_start(&config));
+#if !CONFIG_APPTRACE_ENABLE
+    config.period_ticks = 1;
+    config.output = ESP_CPU_PROF_OUTPUT_APPTRACE;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, esp_cpu_prof_start(&config));
+#endif
+
+    config = (esp_cpu_prof_config_t)ESP_CPU_PROF_DEFAULT_CONFIG();
+    TEST_ASSERT_EQUAL(ESP_OK, esp_cpu_prof_start(&config));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_cpu_prof_start(&config));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_cpu_prof_stop());
+    TEST_ASSERT_EQUAL(ESP_OK, esp_cpu_prof_deinit());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_cpu_prof_deinit());
+}
+
+TEST_CASE("cpu profiler samples running tasks", "[app_trace][cpu_prof]")
+{
+    const int period_ms = 1000;
+    esp_cpu_prof_config_t config = ESP_CPU_PROF_DEFAULT_CONFIG();
+    esp_cpu_prof_stats_t stats;
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(portNUM_PROCESSORS, 0);
+    TEST_ASSERT_NOT_NULL(done);
+
+    s_busy_stop = false;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        xTaskCreatePinnedToCore(prof_busy_task, "prof_busy", 2048, done, UNITY_FREERTOS_PRIORITY - 1, NULL, i);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, esp_cpu_prof_start(&config));
+    esp_cpu_ccount_t start = esp_cpu_get_ccount();
+    vTaskDelay(pdMS_TO_TICKS(period_ms));
+    uint32_t elapsed_cycles = esp_cpu_get_ccount() - start;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_cpu_prof_stop());
+    s_busy_stop = true;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(done, pdMS_TO_TICKS(1000)));
+    }
+    vSemaphoreDelete(done);
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_cpu_prof_get_stats(&stats));
+    TEST_ASSERT_GREATER_OR_EQUAL(pdMS_TO_TICKS(period_ms) * portNUM_PROCESSORS * 9 / 10, stats.samples);
+    TEST_ASSERT_EQUAL(0, stats.dropped);
+    IDF_LOG_PERFORMANCE("CPU profiler sampler cycles per sample", "%u, max %u",
+                        (uint32_t)(stats.sampler_cycles / stats.samples), stats.sampler_max_cycles);
+    IDF_LOG_PERFORMANCE("CPU profiler sampler share of CPU time", "%.3f%%",
+                        100.0 * stats.sampler_cycles / ((double)elapsed_cycles * portNUM_PROCESSORS));
+
+    char *folded = calloc(1, 8192);
+    TEST_ASSERT_NOT_NULL(folded);
+    FILE *stream = fmemopen(folded, 8192 - 1, "w");
+    TEST_ASSERT_NOT_NULL(stream);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_cpu_prof_dump_folded(stream));
+    fclose(stream);
+
+    /* The busy tasks had the CPUs most of the time, the stack with most samples is one of theirs */
+    TEST_ASSERT_EQUAL_MESSAGE(0, strncmp(folded, "prof_busy;", strlen("prof_busy;")), folded);
+#if CONFIG_IDF_TARGET_ARCH_XTENSA && CONFIG_APPTRACE_CPU_PROF_MAX_DEPTH > 1
+    /* Most samples are taken in prof_busy_loop, so the backtrace includes prof_busy_task */
+    const char *line_end = strchr(folded, '\n');
+    int frames = 0;
+    for (const char *c = folded; c < line_end; c++) {
+        frames += (*c == ';');
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(2, frames, folded);
+#endif
+    free(folded);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_cpu_prof_deinit());
+}
+
+#endif /* CONFIG_APPTRACE_CPU_PROF_ENABLE */
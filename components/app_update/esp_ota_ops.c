@@ -38,6 +38,7 @@ typedef struct ota_ops_entry_ {
     uint32_t handle;
     const esp_partition_t *part;
     bool need_erase;
+    uint32_t erased_size;
     uint32_t wrote_size;
     uint8_t partial_bytes;
     WORD_ALIGNED_ATTR uint8_t partial_data[16];
@@ -170,6 +171,20 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
     return ESP_OK;
 }
 
+/* Erase the partition of a sequential write OTA up to end (rounded up to a sector), skipping what is already erased */
+static esp_err_t ota_erase_until(ota_ops_entry_t *it, uint32_t end)
+{
+    end = MIN((end + SPI_FLASH_SEC_SIZE - 1) & ~(SPI_FLASH_SEC_SIZE - 1), it->part->size);
+    if (end <= it->erased_size) {
+        return ESP_OK;
+    }
+    esp_err_t ret = esp_partition_erase_range(it->part, it->erased_size, end - it->erased_size);
+    if (ret == ESP_OK) {
+        it->erased_size = end;
+    }
+    return ret;
+}
+
 esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
 {
     const uint8_t *data_bytes = (const uint8_t *)data;
@@ -185,16 +200,8 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
     for (it = LIST_FIRST(&s_ota_ops_entries_head); it != NULL; it = LIST_NEXT(it, entries)) {
         if (it->handle == handle) {
             if (it->need_erase) {
-                // must erase the partition before writing to it
-                uint32_t first_sector = it->wrote_size / SPI_FLASH_SEC_SIZE;
-                uint32_t last_sector = (it->wrote_size + size) / SPI_FLASH_SEC_SIZE;
-
-                ret = ESP_OK;
-                if ((it->wrote_size % SPI_FLASH_SEC_SIZE) == 0) {
-                    ret = esp_partition_erase_range(it->part, it->wrote_size, ((last_sector - first_sector) + 1) * SPI_FLASH_SEC_SIZE);
-                } else if (first_sector != last_sector) {
-                    ret = esp_partition_erase_range(it->part, (first_sector + 1) * SPI_FLASH_SEC_SIZE, (last_sector - first_sector) * SPI_FLASH_SEC_SIZE);
-                }
+                // must erase the partition before writing to it, unless esp_ota_erase_ahead() already did
+                ret = ota_erase_until(it, it->wrote_size + it->partial_bytes + size);
                 if (ret != ESP_OK) {
                     return ret;
                 }
@@ -298,6 +305,20 @@ static ota_ops_entry_t *get_ota_ops_entry(esp_ota_handle_t handle)
    return it;
 }
 
+esp_err_t esp_ota_erase_ahead(esp_ota_handle_t handle, size_t offset)
+{
+    ota_ops_entry_t *it = get_ota_ops_entry(handle);
+    if (it == NULL) {
+        ESP_LOGE(TAG, "OTA handle not found");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!it->need_erase) {
+        // the partition was already erased by esp_ota_begin()
+        return ESP_OK;
+    }
+    return ota_erase_until(it, offset);
+}
+
 esp_err_t esp_ota_abort(esp_ota_handle_t handle)
 {
     ota_ops_entry_t *it = get_ota_ops_entry(handle);
@@ -134,6 +134,25 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
  */
 esp_err_t esp_ota_write_with_offset(esp_ota_handle_t handle, const void *data, size_t size, uint32_t offset);
 
+/**
+ * @brief   Erase the OTA partition ahead of the written data
+ *
+ * When the update was started with OTA_WITH_SEQUENTIAL_WRITES, esp_ota_write() erases the sectors
+ * it is about to program. This function erases them in advance, e.g. from a task which would otherwise
+ * wait for more data to arrive, so that the following esp_ota_write() calls only need to program flash.
+ * Sectors which are already erased are not erased again. For other updates this function does nothing.
+ *
+ * @param handle  Handle obtained from esp_ota_begin
+ * @param offset  Offset in the partition up to which it is erased, rounded up to the sector size and
+ *                limited to the partition size
+ *
+ * @return
+ *    - ESP_OK: Partition is erased up to offset.
+ *    - ESP_ERR_INVALID_ARG: handle is invalid.
+ *    - ESP_ERR_FLASH_OP_TIMEOUT or ESP_ERR_FLASH_OP_FAIL: Flash erase failed.
+ */
+esp_err_t esp_ota_erase_ahead(esp_ota_handle_t handle, size_t offset);
+
 /**
  * @brief Finish OTA update and validate newly written app image.
  *
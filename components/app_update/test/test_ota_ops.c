@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/param.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
@@ -13,6 +14,7 @@
 #include <unity.h>
 #include <test_utils.h>
 #include <esp_ota_ops.h>
+#include <esp_spi_flash.h>
 #include "bootloader_common.h"
 
 /* These OTA tests currently don't assume an OTA partition exists
@@ -112,3 +114,114 @@ TEST_CASE("esp_ota_get_partition_description", "[ota]")
     };
     TEST_ESP_ERR(ESP_ERR_NOT_FOUND, bootloader_common_get_partition_description(&not_app_pos, &app_desc1));
 }
+
+/* Byte of the test image at offset pos, starting with the image magic byte */
+static uint8_t test_image_byte(size_t pos)
+{
+    return (pos == 0) ? ESP_IMAGE_HEADER_MAGIC : (uint8_t)(pos * 7 + (pos >> 8));
+}
+
+/* Fill the first sectors of the passive OTA partition with zeroes, so that sectors left unerased are noticed */
+static const esp_partition_t *prepare_ota_partition(size_t dirty_sectors)
+{
+    const esp_partition_t *part = esp_ota_get_next_update_partition(NULL);
+    TEST_ASSERT_NOT_NULL(part);
+    uint8_t *zeroes = calloc(1, SPI_FLASH_SEC_SIZE);
+    TEST_ASSERT_NOT_NULL(zeroes);
+    TEST_ESP_OK(esp_partition_erase_range(part, 0, dirty_sectors * SPI_FLASH_SEC_SIZE));
+    for (size_t i = 0; i < dirty_sectors; i++) {
+        TEST_ESP_OK(esp_partition_write(part, i * SPI_FLASH_SEC_SIZE, zeroes, SPI_FLASH_SEC_SIZE));
+    }
+    free(zeroes);
+    return part;
+}
+
+static void write_test_image(esp_ota_handle_t handle, size_t offset, size_t size)
+{
+    uint8_t *buf = malloc(size);
+    TEST_ASSERT_NOT_NULL(buf);
+    for (size_t i = 0; i < size; i++) {
+        buf[i] = test_image_byte(offset + i);
+    }
+    TEST_ESP_OK(esp_ota_write(handle, buf, size));
+    free(buf);
+}
+
+/* Check that [offset, offset + size) holds the test image, or fill if the image isn't expected there */
+static void check_partition(const esp_partition_t *part, size_t offset, size_t size, bool image, uint8_t fill)
+{
+    uint8_t buf[256];
+    for (size_t done = 0; done < size; done += sizeof(buf)) {
+        size_t len = MIN(sizeof(buf), size - done);
+        TEST_ESP_OK(esp_partition_read(part, offset + done, buf, len));
+        for (size_t i = 0; i < len; i++) {
+            uint8_t expected = image ? test_image_byte(offset + done + i) : fill;
+            if (buf[i] != expected) {
+                printf("Mismatch at offset 0x%x: 0x%02x != 0x%02x\n", offset + done + i, buf[i], expected);
+                TEST_FAIL();
+            }
+        }
+    }
+}
+
+TEST_CASE("esp_ota_write() with sequential writes erases the sectors it crosses", "[ota]")
+{
+    const size_t sizes[] = { 1, 15, 4000, SPI_FLASH_SEC_SIZE, 100, 5000, 7 };
+    const esp_partition_t *part = prepare_ota_partition(5);
+    esp_ota_handle_t handle;
+    TEST_ESP_OK(esp_ota_begin(part, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+
+    size_t written = 0;
+    for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        write_test_image(handle, written, sizes[i]);
+        written += sizes[i];
+    }
+    TEST_ASSERT_LESS_THAN(4 * SPI_FLASH_SEC_SIZE, written);
+    TEST_ASSERT_GREATER_THAN(3 * SPI_FLASH_SEC_SIZE, written);
+
+    /* Data written earlier into a sector is not erased again by the following writes */
+    check_partition(part, 0, written, true, 0);
+    /* Only the sectors the data needed are erased */
+    check_partition(part, written, 4 * SPI_FLASH_SEC_SIZE - written, false, 0xFF);
+    check_partition(part, 4 * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE, false, 0);
+    TEST_ESP_OK(esp_ota_abort(handle));
+}
+
+TEST_CASE("esp_ota_erase_ahead() erases in advance of esp_ota_write()", "[ota]")
+{
+    const uint8_t marker[4] = { 0xA5, 0x5A, 0xA5, 0x5A };
+    const esp_partition_t *part = prepare_ota_partition(4);
+    esp_ota_handle_t handle;
+    TEST_ESP_OK(esp_ota_begin(part, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+
+    TEST_ESP_ERR(ESP_ERR_INVALID_ARG, esp_ota_erase_ahead(0, SPI_FLASH_SEC_SIZE));
+    /* The offset is rounded up to a whole sector */
+    TEST_ESP_OK(esp_ota_erase_ahead(handle, 2 * SPI_FLASH_SEC_SIZE + 1));
+    check_partition(part, 0, 3 * SPI_FLASH_SEC_SIZE, false, 0xFF);
+    check_partition(part, 3 * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE, false, 0);
+    /* Erasing less than what is already erased does nothing */
+    TEST_ESP_OK(esp_ota_erase_ahead(handle, SPI_FLASH_SEC_SIZE));
+
+    /* Sectors erased ahead are not erased again by the writes, the marker has to survive */
+    TEST_ESP_OK(esp_partition_write(part, 3 * SPI_FLASH_SEC_SIZE - sizeof(marker), marker, sizeof(marker)));
+    write_test_image(handle, 0, SPI_FLASH_SEC_SIZE + 10);
+    write_test_image(handle, SPI_FLASH_SEC_SIZE + 10, SPI_FLASH_SEC_SIZE + 90);
+    check_partition(part, 0, 2 * SPI_FLASH_SEC_SIZE + 100, true, 0);
+    uint8_t buf[sizeof(marker)];
+    TEST_ESP_OK(esp_partition_read(part, 3 * SPI_FLASH_SEC_SIZE - sizeof(marker), buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(marker, buf, sizeof(marker));
+    check_partition(part, 3 * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE, false, 0);
+
+    /* Writing past the erased area erases the next sector */
+    write_test_image(handle, 2 * SPI_FLASH_SEC_SIZE + 100, SPI_FLASH_SEC_SIZE - 100 - sizeof(marker));
+    TEST_ESP_OK(esp_ota_write(handle, marker, sizeof(marker))); // same bits as already programmed there
+    write_test_image(handle, 3 * SPI_FLASH_SEC_SIZE, 10);
+    check_partition(part, 3 * SPI_FLASH_SEC_SIZE, 10, true, 0);
+    check_partition(part, 3 * SPI_FLASH_SEC_SIZE + 10, SPI_FLASH_SEC_SIZE - 10, false, 0xFF);
+    TEST_ESP_OK(esp_ota_abort(handle));
+
+    /* Updates which erase the partition in esp_ota_begin() ignore it */
+    TEST_ESP_OK(esp_ota_begin(part, SPI_FLASH_SEC_SIZE, &handle));
+    TEST_ESP_OK(esp_ota_erase_ahead(handle, part->size));
+    TEST_ESP_OK(esp_ota_abort(handle));
+}
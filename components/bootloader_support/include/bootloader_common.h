@@ -227,7 +227,7 @@ esp_err_t bootloader_common_check_chip_validity(const esp_image_header_t* img_hd
  */
 void bootloader_common_vddsdio_configure(void);
 
-#if defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP ) || defined( CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC )
+#if defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP ) || defined( CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC ) || defined( CONFIG_BOOTLOADER_VALIDATED_IMAGE_CACHE )
 /**
  * @brief Returns partition from rtc_retain_mem
  *
@@ -277,6 +277,26 @@ void bootloader_common_reset_rtc_retain_mem(void);
  */
 uint16_t bootloader_common_get_rtc_retain_mem_reboot_counter(void);
 
+#ifdef CONFIG_BOOTLOADER_VALIDATED_IMAGE_CACHE
+/**
+ * @brief Check if an app image was already validated since power on.
+ *
+ * @param[in] offset Offset of the app image in flash.
+ * @param[in] tag    CRC32 of the image headers and the appended SHA-256 digest.
+ *
+ * @return true if rtc_retain_mem is valid and holds the same offset and tag.
+ */
+bool bootloader_common_get_rtc_retain_mem_validated_image(uint32_t offset, uint32_t tag);
+
+/**
+ * @brief Record in rtc_retain_mem that an app image was fully validated.
+ *
+ * @param[in] offset Offset of the app image in flash.
+ * @param[in] tag    CRC32 of the image headers and the appended SHA-256 digest.
+ */
+void bootloader_common_update_rtc_retain_mem_validated_image(uint32_t offset, uint32_t tag);
+#endif // CONFIG_BOOTLOADER_VALIDATED_IMAGE_CACHE
+
 /**
  * @brief Returns rtc_retain_mem
  *
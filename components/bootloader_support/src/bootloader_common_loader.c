@@ -130,7 +130,7 @@ esp_err_t bootloader_common_get_partition_description(const esp_partition_pos_t
     return ESP_OK;
 }
 
-#if defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP ) || defined( CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC )
+#if defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP ) || defined( CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC ) || defined( CONFIG_BOOTLOADER_VALIDATED_IMAGE_CACHE )
 
 #define RTC_RETAIN_MEM_ADDR (SOC_RTC_DRAM_HIGH - sizeof(rtc_retain_mem_t))
 
@@ -198,8 +198,25 @@ void bootloader_common_update_rtc_retain_mem(esp_partition_pos_t* partition, boo
     update_rtc_retain_mem_crc();
 }
 
+#ifdef CONFIG_BOOTLOADER_VALIDATED_IMAGE_CACHE
+bool bootloader_common_get_rtc_retain_mem_validated_image(uint32_t offset, uint32_t tag)
+{
+    return check_rtc_retain_mem() && rtc_retain_mem->validated_offset == offset && rtc_retain_mem->validated_tag == tag;
+}
+
+void bootloader_common_update_rtc_retain_mem_validated_image(uint32_t offset, uint32_t tag)
+{
+    if (!check_rtc_retain_mem()) {
+        bootloader_common_reset_rtc_retain_mem();
+    }
+    rtc_retain_mem->validated_offset = offset;
+    rtc_retain_mem->validated_tag = tag;
+    update_rtc_retain_mem_crc();
+}
+#endif // CONFIG_BOOTLOADER_VALIDATED_IMAGE_CACHE
+
 rtc_retain_mem_t* bootloader_common_get_rtc_retain_mem(void)
 {
     return rtc_retain_mem;
 }
-#endif // defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP ) || defined( CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC )
+#endif // defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP ) || defined( CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC ) || defined( CONFIG_BOOTLOADER_VALIDATED_IMAGE_CACHE )
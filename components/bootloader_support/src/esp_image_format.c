@@ -18,6 +18,7 @@
 #include "bootloader_util.h"
 #include "bootloader_common.h"
 #include "esp_rom_sys.h"
+#include "esp_rom_crc.h"
 #include "soc/soc_memory_types.h"
 #include "soc/soc_caps.h"
 #if CONFIG_IDF_TARGET_ESP32
@@ -244,6 +245,40 @@ err:
     return err;
 }
 
+#if defined(BOOTLOADER_BUILD) && defined(CONFIG_BOOTLOADER_VALIDATED_IMAGE_CACHE)
+/* Tag identifying the image contents without reading them: any rewrite of the image changes its appended SHA-256 */
+static uint32_t validated_image_tag(const esp_image_metadata_t *data)
+{
+    uint32_t tag = esp_rom_crc32_le(UINT32_MAX, (const uint8_t *)&data->image, sizeof(esp_image_header_t));
+    tag = esp_rom_crc32_le(tag, (const uint8_t *)data->segments, data->image.segment_count * sizeof(esp_image_segment_header_t));
+    return esp_rom_crc32_le(tag, data->image_digest, HASH_LEN);
+}
+
+/* Load the image, skipping the validation if the same image was already validated since power on */
+static esp_err_t load_image_validated_cache(const esp_partition_pos_t *part, esp_image_metadata_t *data)
+{
+    esp_err_t err;
+    esp_image_metadata_t metadata;
+    /* The tag is not a secret, so it must never replace the verification done for Secure Boot */
+    if (esp_secure_boot_enabled()) {
+        return image_load(ESP_IMAGE_LOAD, part, data);
+    }
+    if (esp_image_get_metadata(part, &metadata) != ESP_OK || !metadata.image.hash_appended) {
+        return image_load(ESP_IMAGE_LOAD, part, data);
+    }
+    const uint32_t tag = validated_image_tag(&metadata);
+    if (bootloader_common_get_rtc_retain_mem_validated_image(part->offset, tag)) {
+        ESP_LOGI(TAG, "image at 0x%x already validated since power on", part->offset);
+        return image_load(ESP_IMAGE_LOAD_NO_VALIDATE, part, data);
+    }
+    err = image_load(ESP_IMAGE_LOAD, part, data);
+    if (err == ESP_OK) {
+        bootloader_common_update_rtc_retain_mem_validated_image(part->offset, validated_image_tag(data));
+    }
+    return err;
+}
+#endif // BOOTLOADER_BUILD && CONFIG_BOOTLOADER_VALIDATED_IMAGE_CACHE
+
 esp_err_t bootloader_load_image(const esp_partition_pos_t *part, esp_image_metadata_t *data)
 {
 #if !defined(BOOTLOADER_BUILD)
@@ -260,6 +295,11 @@ esp_err_t bootloader_load_image(const esp_partition_pos_t *part, esp_image_metad
         mode = ESP_IMAGE_LOAD_NO_VALIDATE;
     }
 #endif // CONFIG_BOOTLOADER_SKIP_...
+#if CONFIG_BOOTLOADER_VALIDATED_IMAGE_CACHE
+    if (mode == ESP_IMAGE_LOAD) {
+        return load_image_validated_cache(part, data);
+    }
+#endif
 #endif // CONFIG_SECURE_BOOT
 
  return image_load(mode, part, data);
@@ -8,6 +8,7 @@
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_pm.h"
+#include "esp_rom_sys.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
@@ -472,6 +473,16 @@ static bool wait_for_busy_cleared(uint32_t timeout_ms)
      * can only generate Busy Clear Interrupt for data write commands, and waiting
      * for busy clear is mostly needed for other commands such as MMC_SWITCH.
      */
+    /* Busy periods after writes are often much shorter than one tick, so first
+     * poll a few times with short, doubling delays (70 us in total) before
+     * yielding to the scheduler.
+     */
+    for (uint32_t delay_us = 10; delay_us <= 40; delay_us *= 2) {
+        if (!sdmmc_host_card_busy()) {
+            return true;
+        }
+        esp_rom_delay_us(delay_us);
+    }
     uint32_t timeout_ticks = (timeout_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
     while (timeout_ticks-- > 0) {
         if (!sdmmc_host_card_busy()) {
@@ -20,6 +20,9 @@ static const char *TAG = "esp-tls";
 
 #ifdef CONFIG_ESP_TLS_USING_MBEDTLS
 #include "esp_tls_mbedtls.h"
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_CACHE
+#include "esp_tls_client_session_cache.h"
+#endif
 #elif CONFIG_ESP_TLS_USING_WOLFSSL
 #include "esp_tls_wolfssl.h"
 #endif
@@ -345,6 +348,22 @@ err:
     return ret;
 }
 
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_CACHE
+static bool esp_tls_use_session_cache(const esp_tls_cfg_t *cfg)
+{
+    if (cfg == NULL) {
+        return false;
+    }
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    if (cfg->client_session != NULL) {
+        return false;
+    }
+#endif
+    /* Only sessions of connections which authenticated the server are worth resuming */
+    return cfg->cacert_buf != NULL || cfg->use_global_ca_store == true || cfg->crt_bundle_attach != NULL;
+}
+#endif /* CONFIG_ESP_TLS_CLIENT_SESSION_CACHE */
+
 static int esp_tls_low_level_conn(const char *hostname, int hostlen, int port, const esp_tls_cfg_t *cfg, esp_tls_t *tls)
 {
     if (!tls) {
@@ -412,12 +431,28 @@ static int esp_tls_low_level_conn(const char *hostname, int hostlen, int port, c
             tls->conn_state = ESP_TLS_FAIL;
             return -1;
         }
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_CACHE
+        if (esp_tls_use_session_cache(cfg)) {
+            esp_tls_client_session_cache_apply(tls, cfg, hostname, hostlen, port);
+        }
+#endif
         tls->read = _esp_tls_read;
         tls->write = _esp_tls_write;
         tls->conn_state = ESP_TLS_HANDSHAKE;
     /* falls through */
     case ESP_TLS_HANDSHAKE:
         ESP_LOGD(TAG, "handshake in progress...");
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_CACHE
+        if (esp_tls_use_session_cache(cfg)) {
+            int ret = esp_tls_handshake(tls, cfg);
+            if (ret == 1) {
+                esp_tls_client_session_cache_update(tls, cfg, hostname, hostlen, port);
+            } else if (ret == -1) {
+                esp_tls_client_session_cache_invalidate(cfg, hostname, hostlen, port);
+            }
+            return ret;
+        }
+#endif
         return esp_tls_handshake(tls, cfg);
         break;
     case ESP_TLS_FAIL:
@@ -346,6 +346,13 @@ typedef struct esp_tls {
 
     esp_tls_error_handle_t error_handle;                                        /*!< handle to error descriptor */
 
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_CACHE) && defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+    unsigned char *exported_session;                                            /*!< Serialized session taken from the ssl context by the
+                                                                                     client session cache, returned by
+                                                                                     esp_tls_get_client_session() */
+
+    size_t exported_session_len;                                                /*!< Length of exported_session */
+#endif
 } esp_tls_t;
 
 
@@ -687,6 +694,50 @@ esp_err_t esp_tls_plain_tcp_connect(const char *host, int hostlen, int port, con
  */
 esp_tls_client_session_t *esp_tls_get_client_session(esp_tls_t *tls);
 #endif /* CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS */
+
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_CACHE
+/**
+ * @brief Statistics of the client session cache
+ */
+typedef struct esp_tls_client_session_cache_stats {
+    uint32_t hits;          /*!< Connections that offered a cached session to the server */
+    uint32_t misses;        /*!< Connections for which no valid cached session was found */
+    uint32_t resumed;       /*!< Connections on which the server accepted the offered session */
+    uint32_t evictions;     /*!< Sessions dropped to make room for a new host */
+} esp_tls_client_session_cache_stats_t;
+
+/**
+ * @brief Remove all sessions from the client session cache
+ *
+ * The following connections to any server perform a full handshake. This can be used
+ * e.g. after changing the trusted CA certificates.
+ */
+void esp_tls_client_session_cache_clear(void);
+
+/**
+ * @brief Get the statistics of the client session cache
+ *
+ * @param[out] stats  Statistics counted since boot
+ * @return
+ *             ESP_OK on success
+ *             ESP_ERR_INVALID_ARG if stats is NULL
+ */
+esp_err_t esp_tls_client_session_cache_get_stats(esp_tls_client_session_cache_stats_t *stats);
+
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_CACHE_NVS
+/**
+ * @brief Store the sessions of the client session cache in NVS
+ *
+ * The stored sessions are restored automatically on the first client connection after reboot
+ * which finds NVS initialized. NVS must be initialized before calling this function.
+ *
+ * @return
+ *             ESP_OK on success
+ *             Error codes from the NVS API on failure
+ */
+esp_err_t esp_tls_client_session_cache_save(void);
+#endif /* CONFIG_ESP_TLS_CLIENT_SESSION_CACHE_NVS */
+#endif /* CONFIG_ESP_TLS_CLIENT_SESSION_CACHE */
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,468 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/lock.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_tls.h"
+#include "esp_tls_client_session_cache.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/sha256.h"
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_CACHE_NVS
+#include "nvs.h"
+#endif
+
+static const char *TAG = "esp-tls-sess-cache";
+
+#define SESSION_CACHE_SIZE      CONFIG_ESP_TLS_CLIENT_SESSION_CACHE_SIZE
+#define SESSION_LIFETIME_TICKS  pdMS_TO_TICKS((uint64_t)CONFIG_ESP_TLS_CLIENT_SESSION_CACHE_LIFETIME * 1000)
+#define SESSION_CFG_DIGEST_LEN  32
+
+typedef struct {
+    char *host;                 /*!< Hostname the session was negotiated with, NULL if the slot is free */
+    int port;                   /*!< Port the session was negotiated with */
+    uint8_t cfg_digest[SESSION_CFG_DIGEST_LEN]; /*!< Digest of the authentication settings of the connection, see cfg_digest() */
+    unsigned char *session;     /*!< Session serialized with mbedtls_ssl_session_save() */
+    size_t session_len;         /*!< Length of the serialized session */
+    TickType_t expires_at;      /*!< Tick count after which the session is no longer offered */
+    uint32_t lru_counter;       /*!< Value of the global use counter when the entry was last used */
+} session_cache_entry_t;
+
+static session_cache_entry_t s_cache[SESSION_CACHE_SIZE];
+static esp_tls_client_session_cache_stats_t s_stats;
+static uint32_t s_lru_counter;
+static _lock_t s_cache_lock;
+
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_CACHE_NVS
+#define SESSION_CACHE_NVS_NAMESPACE "esp_tls_sess"
+
+/* Layout of the NVS blob stored for each entry, followed by the host name and the session */
+typedef struct {
+    uint16_t port;
+    uint16_t host_len;
+    uint32_t remaining_s;
+    uint32_t session_len;
+    uint8_t cfg_digest[SESSION_CFG_DIGEST_LEN];
+} session_cache_nvs_hdr_t;
+
+static bool s_nvs_loaded;
+static void session_cache_load_from_nvs(void);
+#endif
+
+static int cfg_digest_add(mbedtls_sha256_context *ctx, uint8_t tag, const void *data, size_t len)
+{
+    /* Tag and length make the digest unambiguous when fields are absent or differ in length */
+    uint8_t hdr[5] = { tag, len & 0xFF, (len >> 8) & 0xFF, (len >> 16) & 0xFF, (len >> 24) & 0xFF };
+    int ret = mbedtls_sha256_update(ctx, hdr, sizeof(hdr));
+    if (ret == 0 && len > 0) {
+        ret = mbedtls_sha256_update(ctx, data, len);
+    }
+    return ret;
+}
+
+/*
+ * Digest of the settings of cfg which decide how the server is authenticated and how the client authenticates
+ * itself. Resuming a session skips the certificate verification, so a session is only offered to connections
+ * with the same settings as the connection which negotiated it.
+ */
+static int cfg_digest(const esp_tls_cfg_t *cfg, uint8_t digest[SESSION_CFG_DIGEST_LEN])
+{
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    int ret = mbedtls_sha256_starts(&ctx, 0);
+    if (ret == 0 && cfg->crt_bundle_attach != NULL) {
+        ret = cfg_digest_add(&ctx, 'B', &cfg->crt_bundle_attach, sizeof(cfg->crt_bundle_attach));
+    }
+    if (ret == 0 && cfg->use_global_ca_store) {
+        ret = cfg_digest_add(&ctx, 'G', NULL, 0);
+        for (const mbedtls_x509_crt *crt = esp_tls_get_global_ca_store(); ret == 0 && crt && crt->raw.p; crt = crt->next) {
+            ret = cfg_digest_add(&ctx, 'g', crt->raw.p, crt->raw.len);
+        }
+    }
+    if (ret == 0 && cfg->cacert_buf != NULL) {
+        ret = cfg_digest_add(&ctx, 'C', cfg->cacert_buf, cfg->cacert_bytes);
+    }
+    if (ret == 0 && cfg->clientcert_buf != NULL) {
+        ret = cfg_digest_add(&ctx, 'c', cfg->clientcert_buf, cfg->clientcert_bytes);
+    }
+    if (ret == 0 && cfg->clientkey_buf != NULL) {
+        ret = cfg_digest_add(&ctx, 'k', cfg->clientkey_buf, cfg->clientkey_bytes);
+    }
+    if (ret == 0 && cfg->use_secure_element) {
+        ret = cfg_digest_add(&ctx, 'S', NULL, 0);
+    }
+    if (ret == 0 && cfg->ds_data != NULL) {
+        ret = cfg_digest_add(&ctx, 'D', &cfg->ds_data, sizeof(cfg->ds_data));
+    }
+    if (ret == 0 && cfg->common_name != NULL) {
+        ret = cfg_digest_add(&ctx, 'N', cfg->common_name, strlen(cfg->common_name));
+    }
+    if (ret == 0 && cfg->skip_common_name) {
+        ret = cfg_digest_add(&ctx, 'n', NULL, 0);
+    }
+    if (ret == 0) {
+        ret = mbedtls_sha256_finish(&ctx, digest);
+    }
+    mbedtls_sha256_free(&ctx);
+    if (ret != 0) {
+        ESP_LOGD(TAG, "failed to compute the configuration digest, returned -0x%04X", -ret);
+    }
+    return ret;
+}
+
+static void entry_free(session_cache_entry_t *entry)
+{
+    if (entry->session) {
+        mbedtls_platform_zeroize(entry->session, entry->session_len);
+        free(entry->session);
+    }
+    free(entry->host);
+    memset(entry, 0, sizeof(*entry));
+}
+
+static bool entry_expired(const session_cache_entry_t *entry, TickType_t now)
+{
+    return (int32_t)(now - entry->expires_at) >= 0;
+}
+
+/* Must be called with s_cache_lock held */
+static session_cache_entry_t *entry_find(const char *hostname, size_t hostlen, int port, const uint8_t *digest)
+{
+    for (int i = 0; i < SESSION_CACHE_SIZE; i++) {
+        session_cache_entry_t *entry = &s_cache[i];
+        if (entry->host && entry->port == port &&
+                strlen(entry->host) == hostlen && memcmp(entry->host, hostname, hostlen) == 0 &&
+                memcmp(entry->cfg_digest, digest, SESSION_CFG_DIGEST_LEN) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* Must be called with s_cache_lock held. Returns a free slot, evicting the least recently used entry if needed */
+static session_cache_entry_t *entry_alloc(void)
+{
+    session_cache_entry_t *lru = &s_cache[0];
+    for (int i = 0; i < SESSION_CACHE_SIZE; i++) {
+        if (s_cache[i].host == NULL) {
+            return &s_cache[i];
+        }
+        if (s_cache[i].lru_counter < lru->lru_counter) {
+            lru = &s_cache[i];
+        }
+    }
+    ESP_LOGD(TAG, "evicting session for %s:%d", lru->host, lru->port);
+    entry_free(lru);
+    s_stats.evictions++;
+    return lru;
+}
+
+/* Must be called with s_cache_lock held. Restores the sessions stored in NVS, until NVS can be opened */
+static void session_cache_restore(void)
+{
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_CACHE_NVS
+    if (!s_nvs_loaded) {
+        session_cache_load_from_nvs();
+    }
+#endif
+}
+
+void esp_tls_client_session_cache_apply(esp_tls_t *tls, const esp_tls_cfg_t *cfg, const char *hostname, size_t hostlen, int port)
+{
+    uint8_t digest[SESSION_CFG_DIGEST_LEN];
+    if (cfg_digest(cfg, digest) != 0) {
+        return;
+    }
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+
+    _lock_acquire(&s_cache_lock);
+    session_cache_restore();
+    session_cache_entry_t *entry = entry_find(hostname, hostlen, port, digest);
+    if (entry && entry_expired(entry, xTaskGetTickCount())) {
+        ESP_LOGD(TAG, "cached session for %s:%d expired", entry->host, port);
+        entry_free(entry);
+        entry = NULL;
+    }
+    if (entry == NULL) {
+        s_stats.misses++;
+        _lock_release(&s_cache_lock);
+        return;
+    }
+    entry->lru_counter = ++s_lru_counter;
+    s_stats.hits++;
+    int ret = mbedtls_ssl_session_load(&session, entry->session, entry->session_len);
+    if (ret != 0) {
+        /* Serialized with a different mbedTLS configuration (e.g. restored from NVS after an update) */
+        ESP_LOGD(TAG, "mbedtls_ssl_session_load returned -0x%04X", -ret);
+        entry_free(entry);
+    }
+    _lock_release(&s_cache_lock);
+
+    if (ret == 0) {
+        ret = mbedtls_ssl_set_session(&tls->ssl, &session);
+        if (ret != 0) {
+            ESP_LOGD(TAG, "mbedtls_ssl_set_session returned -0x%04X", -ret);
+        } else {
+            ESP_LOGD(TAG, "offering cached session for %.*s:%d", (int)hostlen, hostname, port);
+        }
+    }
+    mbedtls_ssl_session_free(&session);
+}
+
+/* Compare the master secret of the new session with the cached one: they only match if the server resumed it */
+static bool session_was_resumed(const mbedtls_ssl_session *current, const session_cache_entry_t *entry)
+{
+    bool resumed = false;
+#if defined(MBEDTLS_SSL_PROTO_TLS1_2)
+    mbedtls_ssl_session cached;
+    mbedtls_ssl_session_init(&cached);
+    if (mbedtls_ssl_session_load(&cached, entry->session, entry->session_len) == 0) {
+        resumed = memcmp(cached.MBEDTLS_PRIVATE(master), current->MBEDTLS_PRIVATE(master),
+                         sizeof(cached.MBEDTLS_PRIVATE(master))) == 0;
+    }
+    mbedtls_ssl_session_free(&cached);
+#endif
+    return resumed;
+}
+
+void esp_tls_client_session_cache_update(esp_tls_t *tls, const esp_tls_cfg_t *cfg, const char *hostname, size_t hostlen, int port)
+{
+    uint8_t digest[SESSION_CFG_DIGEST_LEN];
+    if (cfg_digest(cfg, digest) != 0) {
+        return;
+    }
+    mbedtls_ssl_session current;
+    mbedtls_ssl_session_init(&current);
+    unsigned char *session = NULL;
+    char *host = NULL;
+    size_t session_len = 0;
+    int ret = mbedtls_ssl_get_session(&tls->ssl, &current);
+    if (ret != 0) {
+        ESP_LOGD(TAG, "mbedtls_ssl_get_session returned -0x%04X", -ret);
+        goto exit;
+    }
+    ret = mbedtls_ssl_session_save(&current, NULL, 0, &session_len);
+    if (ret != MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL || session_len == 0) {
+        ESP_LOGD(TAG, "mbedtls_ssl_session_save returned -0x%04X", -ret);
+        goto exit;
+    }
+    session = malloc(session_len);
+    host = strndup(hostname, hostlen);
+    if (session == NULL || host == NULL) {
+        ESP_LOGD(TAG, "failed to allocate memory for session cache entry");
+        goto exit;
+    }
+    ret = mbedtls_ssl_session_save(&current, session, session_len, &session_len);
+    if (ret != 0) {
+        ESP_LOGD(TAG, "mbedtls_ssl_session_save returned -0x%04X", -ret);
+        goto exit;
+    }
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    /* mbedtls_ssl_get_session() can only be called once per connection, keep a copy for esp_tls_get_client_session() */
+    free(tls->exported_session);
+    tls->exported_session = malloc(session_len);
+    if (tls->exported_session) {
+        memcpy(tls->exported_session, session, session_len);
+        tls->exported_session_len = session_len;
+    }
+#endif
+
+    _lock_acquire(&s_cache_lock);
+    session_cache_restore();
+    session_cache_entry_t *entry = entry_find(hostname, hostlen, port, digest);
+    if (entry) {
+        if (session_was_resumed(&current, entry)) {
+            s_stats.resumed++;
+        }
+        entry_free(entry);
+    } else {
+        entry = entry_alloc();
+    }
+    entry->host = host;
+    entry->port = port;
+    memcpy(entry->cfg_digest, digest, SESSION_CFG_DIGEST_LEN);
+    entry->session = session;
+    entry->session_len = session_len;
+    entry->expires_at = xTaskGetTickCount() + SESSION_LIFETIME_TICKS;
+    entry->lru_counter = ++s_lru_counter;
+    _lock_release(&s_cache_lock);
+    session = NULL;
+    host = NULL;
+
+exit:
+    if (session) {
+        mbedtls_platform_zeroize(session, session_len);
+        free(session);
+    }
+    free(host);
+    mbedtls_ssl_session_free(&current);
+}
+
+void esp_tls_client_session_cache_invalidate(const esp_tls_cfg_t *cfg, const char *hostname, size_t hostlen, int port)
+{
+    uint8_t digest[SESSION_CFG_DIGEST_LEN];
+    if (cfg_digest(cfg, digest) != 0) {
+        return;
+    }
+    _lock_acquire(&s_cache_lock);
+    session_cache_restore();
+    session_cache_entry_t *entry = entry_find(hostname, hostlen, port, digest);
+    if (entry) {
+        ESP_LOGD(TAG, "dropping cached session for %s:%d", entry->host, port);
+        entry_free(entry);
+    }
+    _lock_release(&s_cache_lock);
+}
+
+void esp_tls_client_session_cache_clear(void)
+{
+    _lock_acquire(&s_cache_lock);
+    for (int i = 0; i < SESSION_CACHE_SIZE; i++) {
+        entry_free(&s_cache[i]);
+    }
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_CACHE_NVS
+    /* Do not bring back the sessions stored in NVS */
+    s_nvs_loaded = true;
+#endif
+    _lock_release(&s_cache_lock);
+}
+
+esp_err_t esp_tls_client_session_cache_get_stats(esp_tls_client_session_cache_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    _lock_acquire(&s_cache_lock);
+    *stats = s_stats;
+    _lock_release(&s_cache_lock);
+    return ESP_OK;
+}
+
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_CACHE_NVS
+/* Must be called with s_cache_lock held */
+static void session_cache_load_from_nvs(void)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(SESSION_CACHE_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        /* Nothing was ever stored */
+        s_nvs_loaded = true;
+        return;
+    } else if (err != ESP_OK) {
+        /* NVS is probably not initialized yet, try again on the next connection */
+        ESP_LOGD(TAG, "nvs_open returned %s, sessions not restored", esp_err_to_name(err));
+        return;
+    }
+    s_nvs_loaded = true;
+    TickType_t now = xTaskGetTickCount();
+    int loaded = 0;
+    for (int i = 0; i < SESSION_CACHE_SIZE; i++) {
+        char key[NVS_KEY_NAME_MAX_SIZE];
+        snprintf(key, sizeof(key), "sess%d", i);
+        size_t len = 0;
+        if (nvs_get_blob(handle, key, NULL, &len) != ESP_OK || len < sizeof(session_cache_nvs_hdr_t)) {
+            continue;
+        }
+        uint8_t *blob = malloc(len);
+        if (blob == NULL) {
+            break;
+        }
+        session_cache_nvs_hdr_t hdr = { 0 };
+        if (nvs_get_blob(handle, key, blob, &len) == ESP_OK) {
+            memcpy(&hdr, blob, sizeof(hdr));
+        }
+        const char *host = (const char *)blob + sizeof(hdr);
+        session_cache_entry_t *entry = NULL;
+        if (sizeof(hdr) + hdr.host_len + hdr.session_len == len && hdr.session_len > 0 && hdr.remaining_s > 0 &&
+                entry_find(host, hdr.host_len, hdr.port, hdr.cfg_digest) == NULL) {
+            /* Sessions negotiated before NVS was available are newer, only fill the free slots */
+            for (int j = 0; j < SESSION_CACHE_SIZE && entry == NULL; j++) {
+                if (s_cache[j].host == NULL) {
+                    entry = &s_cache[j];
+                }
+            }
+        }
+        if (entry) {
+            entry->host = strndup(host, hdr.host_len);
+            entry->session = malloc(hdr.session_len);
+            if (entry->host && entry->session) {
+                memcpy(entry->session, blob + sizeof(hdr) + hdr.host_len, hdr.session_len);
+                memcpy(entry->cfg_digest, hdr.cfg_digest, SESSION_CFG_DIGEST_LEN);
+                entry->port = hdr.port;
+                entry->session_len = hdr.session_len;
+                /* Time spent powered off is unknown, the remaining lifetime restarts counting from now */
+                entry->expires_at = now + pdMS_TO_TICKS((uint64_t)hdr.remaining_s * 1000);
+                loaded++;
+            } else {
+                entry_free(entry);
+            }
+        }
+        mbedtls_platform_zeroize(blob, len);
+        free(blob);
+    }
+    nvs_close(handle);
+    ESP_LOGD(TAG, "restored %d sessions from NVS", loaded);
+}
+
+esp_err_t esp_tls_client_session_cache_save(void)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(SESSION_CACHE_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace %s, returned %s", SESSION_CACHE_NVS_NAMESPACE, esp_err_to_name(err));
+        return err;
+    }
+    err = nvs_erase_all(handle);
+
+    _lock_acquire(&s_cache_lock);
+    TickType_t now = xTaskGetTickCount();
+    int slot = 0;
+    for (int i = 0; i < SESSION_CACHE_SIZE && err == ESP_OK; i++) {
+        session_cache_entry_t *entry = &s_cache[i];
+        if (entry->host == NULL || entry_expired(entry, now)) {
+            continue;
+        }
+        session_cache_nvs_hdr_t hdr = {
+            .port = entry->port,
+            .host_len = strlen(entry->host),
+            .remaining_s = (entry->expires_at - now) / configTICK_RATE_HZ,
+            .session_len = entry->session_len,
+        };
+        memcpy(hdr.cfg_digest, entry->cfg_digest, SESSION_CFG_DIGEST_LEN);
+        size_t len = sizeof(hdr) + hdr.host_len + hdr.session_len;
+        uint8_t *blob = malloc(len);
+        if (blob == NULL) {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+        memcpy(blob, &hdr, sizeof(hdr));
+        memcpy(blob + sizeof(hdr), entry->host, hdr.host_len);
+        memcpy(blob + sizeof(hdr) + hdr.host_len, entry->session, hdr.session_len);
+        char key[NVS_KEY_NAME_MAX_SIZE];
+        snprintf(key, sizeof(key), "sess%d", slot++);
+        err = nvs_set_blob(handle, key, blob, len);
+        mbedtls_platform_zeroize(blob, len);
+        free(blob);
+    }
+    _lock_release(&s_cache_lock);
+
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store sessions in NVS, returned %s", esp_err_to_name(err));
+    }
+    return err;
+}
+#endif /* CONFIG_ESP_TLS_CLIENT_SESSION_CACHE_NVS */
@@ -22,6 +22,10 @@
 #include "esp_crt_bundle.h"
 #endif
 
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_CACHE) && defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+#include "mbedtls/platform_util.h"
+#endif
+
 #ifdef CONFIG_ESP_TLS_USE_SECURE_ELEMENT
 
 #define ATECC608A_TNG_SLAVE_ADDR        0x6A
@@ -153,7 +157,16 @@ esp_tls_client_session_t *esp_mbedtls_get_client_session(esp_tls_t *tls)
         return NULL;
     }
 
-    int ret = mbedtls_ssl_get_session(&tls->ssl, &(client_session->saved_session));
+    int ret;
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_CACHE
+    if (tls->exported_session != NULL) {
+        /* The session was already taken from the ssl context by the client session cache */
+        ret = mbedtls_ssl_session_load(&(client_session->saved_session), tls->exported_session, tls->exported_session_len);
+    } else
+#endif
+    {
+        ret = mbedtls_ssl_get_session(&tls->ssl, &(client_session->saved_session));
+    }
     if (ret != 0) {
         ESP_LOGE(TAG, "Error in obtaining the client ssl session");
         mbedtls_print_error_msg(ret);
@@ -311,6 +324,13 @@ void esp_mbedtls_cleanup(esp_tls_t *tls)
     mbedtls_ssl_config_free(&tls->conf);
     mbedtls_ctr_drbg_free(&tls->ctr_drbg);
     mbedtls_ssl_free(&tls->ssl);
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_CACHE) && defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+    if (tls->exported_session) {
+        mbedtls_platform_zeroize(tls->exported_session, tls->exported_session_len);
+        free(tls->exported_session);
+        tls->exported_session = NULL;
+    }
+#endif
 #ifdef CONFIG_ESP_TLS_USE_SECURE_ELEMENT
     atcab_release();
 #endif
@@ -610,6 +630,11 @@ esp_err_t set_client_config(const char *hostname, size_t hostlen, esp_tls_cfg_t
 
 #endif /* CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS */
 
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_CACHE) && defined(CONFIG_MBEDTLS_CLIENT_SSL_SESSION_TICKETS)
+    /* Let servers which do not keep a session cache resume the cached sessions through tickets */
+    mbedtls_ssl_conf_session_tickets(&tls->conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
     if (cfg->crt_bundle_attach != NULL) {
 #ifdef CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
         ESP_LOGD(TAG, "Use certificate bundle");
@@ -0,0 +1,25 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include "esp_tls.h"
+
+/**
+ * Internal API to offer the cached session for hostname:port (if any) to a client
+ * connection whose ssl context is set up but which has not started the handshake yet.
+ * Only sessions negotiated with the same certificate related settings of cfg are offered.
+ */
+void esp_tls_client_session_cache_apply(esp_tls_t *tls, const esp_tls_cfg_t *cfg, const char *hostname, size_t hostlen, int port);
+
+/**
+ * Internal API to store the session of a client connection after a successful handshake
+ */
+void esp_tls_client_session_cache_update(esp_tls_t *tls, const esp_tls_cfg_t *cfg, const char *hostname, size_t hostlen, int port);
+
+/**
+ * Internal API to drop the cached session for hostname:port and cfg, e.g. after a failed handshake
+ */
+void esp_tls_client_session_cache_invalidate(const esp_tls_cfg_t *cfg, const char *hostname, size_t hostlen, int port);
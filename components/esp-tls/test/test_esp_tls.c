@@ -119,3 +119,172 @@ TEST_CASE("esp_tls_server session create delete", "[esp-tls][leaks=0]")
     esp_tls_server_session_delete(tls);
 }
 #endif
+
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_CACHE) && defined(CONFIG_ESP_TLS_SERVER_SESSION_TICKETS)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "esp_timer.h"
+#include "test_utils.h"
+
+#define SESSION_CACHE_TEST_PORT         8443
+
+typedef struct {
+    esp_tls_cfg_server_t cfg;
+    int connections;
+    SemaphoreHandle_t ready;
+    SemaphoreHandle_t done;
+    volatile int errors;
+} session_cache_test_server_t;
+
+/* Runs outside of the Unity task, so failures are counted in server->errors and checked by the test */
+static void session_cache_test_server_task(void *arg)
+{
+    session_cache_test_server_t *server = arg;
+    int listen_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    int opt = 1;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(SESSION_CACHE_TEST_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (listen_fd < 0 || setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) != 0 ||
+            bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 1) != 0) {
+        server->errors++;
+        server->connections = 0;
+    }
+    xSemaphoreGive(server->ready);
+
+    for (int i = 0; i < server->connections; i++) {
+        int fd = accept(listen_fd, NULL, NULL);
+        esp_tls_t *tls = esp_tls_init();
+        if (fd < 0 || tls == NULL || esp_tls_server_session_create(&server->cfg, fd, tls) != 0) {
+            server->errors++;
+        }
+        if (tls) {
+            esp_tls_server_session_delete(tls);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    if (listen_fd >= 0) {
+        close(listen_fd);
+    }
+    xSemaphoreGive(server->done);
+    vTaskDelete(NULL);
+}
+
+static void session_cache_test_server_start(session_cache_test_server_t *server, int connections)
+{
+    *server = (session_cache_test_server_t) {
+        .cfg = {
+            .servercert_buf = (const unsigned char *)test_cert_pem,
+            .servercert_bytes = strlen(test_cert_pem) + 1,
+            .serverkey_buf = (const unsigned char *)test_key_pem,
+            .serverkey_bytes = strlen(test_key_pem) + 1,
+        },
+        .connections = connections,
+        .ready = xSemaphoreCreateBinary(),
+        .done = xSemaphoreCreateBinary(),
+    };
+    TEST_ASSERT_NOT_NULL(server->ready);
+    TEST_ASSERT_NOT_NULL(server->done);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_tls_cfg_server_session_tickets_init(&server->cfg));
+    esp_tls_client_session_cache_clear();
+    xTaskCreate(session_cache_test_server_task, "tls_server", 8192, server, 5, NULL);
+    TEST_ASSERT(xSemaphoreTake(server->ready, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(0, server->errors);
+}
+
+static void session_cache_test_server_stop(session_cache_test_server_t *server)
+{
+    TEST_ASSERT(xSemaphoreTake(server->done, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(0, server->errors);
+    esp_tls_client_session_cache_clear();
+    esp_tls_cfg_server_session_tickets_free(&server->cfg);
+    vSemaphoreDelete(server->ready);
+    vSemaphoreDelete(server->done);
+}
+
+static int64_t session_cache_test_connect(const esp_tls_cfg_t *cfg)
+{
+    esp_tls_t *tls = esp_tls_init();
+    TEST_ASSERT_NOT_NULL(tls);
+    int64_t start = esp_timer_get_time();
+    TEST_ASSERT_EQUAL(1, esp_tls_conn_new_sync("127.0.0.1", strlen("127.0.0.1"), SESSION_CACHE_TEST_PORT, cfg, tls));
+    int64_t handshake_us = esp_timer_get_time() - start;
+    esp_tls_conn_destroy(tls);
+    return handshake_us;
+}
+
+TEST_CASE("esp-tls client session cache resumes sessions on reconnect", "[esp-tls]")
+{
+    session_cache_test_server_t server;
+    session_cache_test_server_start(&server, 2);
+
+    esp_tls_cfg_t cfg = {
+        .cacert_buf = (const unsigned char *)test_cert_pem,
+        .cacert_bytes = strlen(test_cert_pem) + 1,
+        .common_name = "ESP-TLS Tests",
+        .timeout_ms = 10000,
+    };
+    esp_tls_client_session_cache_stats_t stats_before, stats_after;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_tls_client_session_cache_get_stats(&stats_before));
+    int64_t full_handshake_us = session_cache_test_connect(&cfg);
+    int64_t resumed_handshake_us = session_cache_test_connect(&cfg);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_tls_client_session_cache_get_stats(&stats_after));
+    session_cache_test_server_stop(&server);
+
+    /* The first connection performs a full handshake, the second one resumes its session */
+    TEST_ASSERT_EQUAL(stats_before.misses + 1, stats_after.misses);
+    TEST_ASSERT_EQUAL(stats_before.hits + 1, stats_after.hits);
+    TEST_ASSERT_EQUAL(stats_before.resumed + 1, stats_after.resumed);
+    IDF_LOG_PERFORMANCE("tls_full_handshake", "%lld us", full_handshake_us);
+    IDF_LOG_PERFORMANCE("tls_resumed_handshake", "%lld us", resumed_handshake_us);
+}
+
+TEST_CASE("esp-tls client session cache does not resume sessions of other configurations", "[esp-tls]")
+{
+    session_cache_test_server_t server;
+    session_cache_test_server_start(&server, 4);
+
+    esp_tls_cfg_t cfg = {
+        .cacert_buf = (const unsigned char *)test_cert_pem,
+        .cacert_bytes = strlen(test_cert_pem) + 1,
+        .common_name = "ESP-TLS Tests",
+        .timeout_ms = 10000,
+    };
+    esp_tls_cfg_t cfg_skip_cn = cfg;
+    cfg_skip_cn.common_name = NULL;
+    cfg_skip_cn.skip_common_name = true;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_tls_init_global_ca_store());
+    TEST_ASSERT_EQUAL(ESP_OK, esp_tls_set_global_ca_store((const unsigned char *)test_cert_pem, strlen(test_cert_pem) + 1));
+    esp_tls_cfg_t cfg_global_ca = {
+        .use_global_ca_store = true,
+        .common_name = "ESP-TLS Tests",
+        .timeout_ms = 10000,
+    };
+
+    esp_tls_client_session_cache_stats_t stats_before, stats_after;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_tls_client_session_cache_get_stats(&stats_before));
+    session_cache_test_connect(&cfg);
+    /* Same server, but the certificate is verified differently: full handshakes */
+    session_cache_test_connect(&cfg_skip_cn);
+    session_cache_test_connect(&cfg_global_ca);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_tls_client_session_cache_get_stats(&stats_after));
+    TEST_ASSERT_EQUAL(stats_before.misses + 3, stats_after.misses);
+    TEST_ASSERT_EQUAL(stats_before.hits, stats_after.hits);
+    TEST_ASSERT_EQUAL(stats_before.resumed, stats_after.resumed);
+
+    /* The session of the first configuration is still cached */
+    session_cache_test_connect(&cfg);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_tls_client_session_cache_get_stats(&stats_after));
+    TEST_ASSERT_EQUAL(stats_before.hits + 1, stats_after.hits);
+    TEST_ASSERT_EQUAL(stats_before.resumed + 1, stats_after.resumed);
+
+    session_cache_test_server_stop(&server);
+    esp_tls_free_global_ca_store();
+}
+#endif
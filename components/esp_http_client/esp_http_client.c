@@ -119,6 +119,10 @@ struct esp_http_client {
     esp_transport_keep_alive_t  keep_alive_cfg;
     struct ifreq                *if_name;
     unsigned                    cache_data_in_fetch_hdr: 1;
+#ifdef CONFIG_ESP_TRANSPORT_POOL
+    char                        *conn_host;     /*!< Host of the current connection, used as the pool key */
+    int                         conn_port;      /*!< Port of the current connection, used as the pool key */
+#endif
 };
 
 typedef struct esp_http_client esp_http_client_t;
@@ -793,6 +797,9 @@ esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
     free(client->current_header_key);
     free(client->location);
     free(client->auth_header);
+#ifdef CONFIG_ESP_TRANSPORT_POOL
+    free(client->conn_host);
+#endif
     free(client);
     return ESP_OK;
 }
@@ -1243,6 +1250,11 @@ static esp_err_t esp_http_client_connect(esp_http_client_handle_t client)
 #endif
             return ESP_ERR_HTTP_INVALID_TRANSPORT;
         }
+#ifdef CONFIG_ESP_TRANSPORT_POOL
+        if (esp_transport_pool_acquire(client->transport, client->connection_info.host, client->connection_info.port) == ESP_OK) {
+            ESP_LOGD(TAG, "Reusing pooled connection");
+        } else
+#endif
         if (!client->is_async) {
             if (esp_transport_connect(client->transport, client->connection_info.host, client->connection_info.port, client->timeout_ms) < 0) {
                 ESP_LOGE(TAG, "Connection failed, sock < 0");
@@ -1262,6 +1274,11 @@ static esp_err_t esp_http_client_connect(esp_http_client_handle_t client)
                 return ESP_ERR_HTTP_CONNECTING;
             }
         }
+#ifdef CONFIG_ESP_TRANSPORT_POOL
+        /* Remember where we're connected, the URL may change before the connection is released */
+        http_utils_assign_string(&client->conn_host, client->connection_info.host, -1);
+        client->conn_port = client->connection_info.port;
+#endif
         client->state = HTTP_STATE_CONNECTED;
         http_dispatch_event(client, HTTP_EVENT_ON_CONNECTED, NULL, 0);
     }
@@ -1430,11 +1447,36 @@ int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, i
     return widx;
 }
 
+#ifdef CONFIG_ESP_TRANSPORT_POOL
+/* A connection may only be handed over to another client if no request or
+ * response is in flight on it, and the server agreed to keep it open */
+static bool http_client_is_poolable(esp_http_client_handle_t client)
+{
+    if (client->transport == NULL || client->conn_host == NULL) {
+        return false;
+    }
+    if (client->state == HTTP_STATE_CONNECTED) {
+        return !client->first_line_prepared;
+    }
+    return client->state >= HTTP_STATE_RES_ON_DATA_START &&
+           esp_http_client_is_complete_data_received(client) &&
+           http_should_keep_alive(client->parser);
+}
+#endif
+
 esp_err_t esp_http_client_close(esp_http_client_handle_t client)
 {
     if (client->state >= HTTP_STATE_INIT) {
         http_dispatch_event(client, HTTP_EVENT_DISCONNECTED, esp_transport_get_error_handle(client->transport), 0);
+#ifdef CONFIG_ESP_TRANSPORT_POOL
+        bool poolable = http_client_is_poolable(client);
         client->state = HTTP_STATE_INIT;
+        if (poolable && esp_transport_pool_release(client->transport, client->conn_host, client->conn_port) == ESP_OK) {
+            return ESP_OK;
+        }
+#else
+        client->state = HTTP_STATE_INIT;
+#endif
         return esp_transport_close(client->transport);
     }
     return ESP_OK;
@@ -1611,6 +1611,18 @@ typedef struct httpd_ws_frame {
  */
 typedef void (*transfer_complete_cb)(esp_err_t err, int socket, void *arg);
 
+/**
+ * @brief Broadcast recipient filter
+ *
+ * Called from the server task for each active WebSocket client.
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] fd      Socket descriptor of the client
+ * @param[in] arg     User data passed to httpd_ws_broadcast()
+ * @return true if the frame should be sent to this client
+ */
+typedef bool (*httpd_ws_broadcast_filter_t)(httpd_handle_t hd, int fd, void *arg);
+
 /**
  * @brief Receive and parse a WebSocket frame
  *
@@ -1700,6 +1712,32 @@ esp_err_t httpd_ws_send_data(httpd_handle_t handle, int socket, httpd_ws_frame_t
 esp_err_t httpd_ws_send_data_async(httpd_handle_t handle, int socket, httpd_ws_frame_t *frame,
                                    transfer_complete_cb callback, void *arg);
 
+/**
+ * @brief Sends the same frame to all (or a filtered subset of) active websocket clients
+ *
+ * The frame is encoded once, together with a copy of its payload, and sent to
+ * all recipients in a single pass of the server task. Unlike calling
+ * httpd_ws_send_data_async() for each client, this needs only one work item
+ * on the control socket regardless of the number of clients, and the payload
+ * buffer may be released by the caller as soon as this function returns.
+ *
+ * @note    Send failures on individual clients are not reported. A client the
+ *          frame could not be sent to completely is disconnected, so that it
+ *          never sees a truncated frame.
+ *
+ * @param[in] handle      Server instance data
+ * @param[in] filter      Recipient filter, NULL to send to all websocket clients
+ * @param[in] filter_arg  User data passed to the filter
+ * @param[in] frame       Websocket frame
+ * @return
+ *  - ESP_OK                    : On successfully queuing the broadcast
+ *  - ESP_FAIL                  : Failure to queue work
+ *  - ESP_ERR_NO_MEM            : Unable to allocate memory
+ *  - ESP_ERR_INVALID_ARG       : Null arguments
+ */
+esp_err_t httpd_ws_broadcast(httpd_handle_t handle, httpd_ws_broadcast_filter_t filter, void *filter_arg,
+                             httpd_ws_frame_t *frame);
+
 #endif /* CONFIG_HTTPD_WS_SUPPORT */
 /** End of WebSocket related stuff
  * @}
@@ -62,6 +62,7 @@ struct sock_db {
     httpd_pending_func_t pending_fn;        /*!< Pending function for this socket */
     uint64_t lru_counter;                   /*!< LRU Counter indicating when the socket was last used */
     bool lru_socket;                        /*!< Flag indicating LRU socket */
+    bool close_pending;                     /*!< Closing has been queued, data of this socket is not processed anymore */
     char pending_data[PARSER_BLOCK_SIZE];   /*!< Buffer for pending data to be received */
     size_t pending_len;                     /*!< Length of pending data to be received */
 #ifdef CONFIG_HTTPD_WS_SUPPORT
@@ -111,6 +112,11 @@ struct httpd_data {
     struct thread_data hd_td;               /*!< Information for the HTTPD thread */
     struct sock_db *hd_sd;                  /*!< The socket database */
     int hd_sd_active_count;                 /*!< The number of the active sockets */
+    fd_set hd_sd_fds;                       /*!< Descriptors of all active sessions, updated on session open/close */
+    int hd_sd_max_fd;                       /*!< Highest descriptor in hd_sd_fds (-1 if none) */
+    fd_set hd_sd_pending_fds;               /*!< Sessions with data buffered above the socket layer */
+    int hd_sd_pending_count;                /*!< The number of descriptors in hd_sd_pending_fds */
+    struct sock_db *hd_sd_by_fd[FD_SETSIZE]; /*!< Session lookup table indexed by socket descriptor */
     httpd_uri_t **hd_calls;                 /*!< Registered URI handlers */
     struct httpd_req hd_req;                /*!< The current HTTPD request */
     struct httpd_req_aux hd_req_aux;        /*!< Additional data about the HTTPD request kept unexposed */
@@ -216,15 +222,18 @@ void httpd_sess_delete(struct httpd_data *hd, struct sock_db *session);
 void httpd_sess_free_ctx(void **ctx, httpd_free_ctx_fn_t free_fn);
 
 /**
- * @brief   Add descriptors present in the socket database to an fdset and
- *          update the value of maxfd which are needed by the select function
- *          for looking through all available sockets for incoming data.
+ * @brief   Processes all sessions which are ready for reading
  *
- * @param[in]  hd    Server instance data
- * @param[out] fdset File descriptor set to be updated.
- * @param[out] maxfd Maximum value among all file descriptors.
+ * Only the descriptors marked in the ready set, plus the sessions which
+ * have data pending above the socket layer, are visited. The cost of this
+ * is therefore proportional to the number of ready sessions and not to
+ * the number of open sessions.
+ *
+ * @param[in] hd        Server instance data
+ * @param[in] ready     Descriptor set as returned by select()
+ * @param[in] ready_cnt Number of session descriptors set in ready
  */
-void httpd_sess_set_descriptors(struct httpd_data *hd, fd_set *fdset, int *maxfd);
+void httpd_sess_process_ready(struct httpd_data *hd, const fd_set *ready, int ready_cnt);
 
 /**
  * @brief   Checks if session can accept another connection from new client.
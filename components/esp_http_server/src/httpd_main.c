@@ -16,11 +16,6 @@
 #include "esp_httpd_priv.h"
 #include "ctrl_sock.h"
 
-typedef struct {
-    fd_set *fdset;
-    struct httpd_data *hd;
-} process_session_context_t;
-
 static const char *TAG = "httpd";
 
 static esp_err_t httpd_accept_conn(struct httpd_data *hd, int listen_fd)
@@ -159,34 +154,12 @@ static void httpd_process_ctrl_msg(struct httpd_data *hd)
     }
 }
 
-// Called for each session from httpd_server
-static int httpd_process_session(struct sock_db *session, void *context)
-{
-    if ((!session) || (!context)) {
-        return 0;
-    }
-
-    if (session->fd < 0) {
-        return 1;
-    }
-
-    process_session_context_t *ctx = (process_session_context_t *)context;
-    int fd = session->fd;
-
-    if (FD_ISSET(fd, ctx->fdset) || httpd_sess_pending(ctx->hd, session)) {
-        ESP_LOGD(TAG, LOG_FMT("processing socket %d"), fd);
-        if (httpd_sess_process(ctx->hd, session) != ESP_OK) {
-            httpd_sess_delete(ctx->hd, session); // Delete session
-        }
-    }
-    return 1;
-}
-
 /* Manage in-coming connection or data requests */
 static esp_err_t httpd_server(struct httpd_data *hd)
 {
-    fd_set read_set;
-    FD_ZERO(&read_set);
+    /* Session descriptors are tracked incrementally as sessions are opened
+     * and closed, so there is no need to walk the socket database here */
+    fd_set read_set = hd->hd_sd_fds;
     if (hd->config.lru_purge_enable || httpd_is_sess_available(hd)) {
         /* Only listen for new connections if server has capacity to
          * handle more (or when LRU purge is enabled, in which case
@@ -194,23 +167,26 @@ static esp_err_t httpd_server(struct httpd_data *hd)
         FD_SET(hd->listen_fd, &read_set);
     }
     FD_SET(hd->ctrl_fd, &read_set);
+    int maxfd = MAX(hd->listen_fd, hd->ctrl_fd);
+    maxfd = MAX(maxfd, hd->hd_sd_max_fd);
 
-    int tmp_max_fd;
-    httpd_sess_set_descriptors(hd, &read_set, &tmp_max_fd);
-    int maxfd = MAX(hd->listen_fd, tmp_max_fd);
-    tmp_max_fd = maxfd;
-    maxfd = MAX(hd->ctrl_fd, tmp_max_fd);
+    /* Don't block if some session still has data buffered above the
+     * socket layer, as select() won't report it */
+    struct timeval no_wait = { 0 };
+    struct timeval *timeout = hd->hd_sd_pending_count ? &no_wait : NULL;
 
     ESP_LOGD(TAG, LOG_FMT("doing select maxfd+1 = %d"), maxfd + 1);
-    int active_cnt = select(maxfd + 1, &read_set, NULL, NULL, NULL);
+    int active_cnt = select(maxfd + 1, &read_set, NULL, NULL, timeout);
     if (active_cnt < 0) {
         ESP_LOGE(TAG, LOG_FMT("error in select (%d)"), errno);
         httpd_sess_delete_invalid(hd);
         return ESP_OK;
     }
+    int sess_cnt = active_cnt;
 
     /* Case0: Do we have a control message? */
     if (FD_ISSET(hd->ctrl_fd, &read_set)) {
+        sess_cnt--;
         ESP_LOGD(TAG, LOG_FMT("processing ctrl message"));
         httpd_process_ctrl_msg(hd);
         if (hd->hd_td.status == THREAD_STOPPING) {
@@ -219,13 +195,13 @@ static esp_err_t httpd_server(struct httpd_data *hd)
         }
     }
 
+    if (FD_ISSET(hd->listen_fd, &read_set)) {
+        sess_cnt--;
+    }
+
     /* Case1: Do we have any activity on the current data
-     * sessions? */
-    process_session_context_t context = {
-        .fdset = &read_set,
-        .hd = hd
-    };
-    httpd_sess_enum(hd, httpd_process_session, &context);
+     * sessions? Only the ready ones are visited */
+    httpd_sess_process_ready(hd, &read_set, sess_cnt);
 
     /* Case2: Do we have any incoming connection requests to
      * process? */
@@ -21,7 +21,6 @@ typedef enum {
     HTTPD_TASK_GET_ACTIVE,      // Get active session (fd!=-1)
     HTTPD_TASK_GET_FREE,        // Get free session slot (fd<0)
     HTTPD_TASK_FIND_FD,         // Find session with specific fd
-    HTTPD_TASK_SET_DESCRIPTOR,  // Set descriptor
     HTTPD_TASK_DELETE_INVALID,  // Delete invalid session
     HTTPD_TASK_FIND_LOWEST_LRU, // Find session with lowest lru
     HTTPD_TASK_CLOSE            // Close session
@@ -30,8 +29,6 @@ typedef enum {
 typedef struct {
     task_t task;
     int fd;
-    fd_set *fdset;
-    int max_fd;
     struct httpd_data *hd;
     uint64_t lru_counter;
     struct sock_db    *session;
@@ -60,6 +57,49 @@ static int fd_is_valid(int fd)
     return fcntl(fd, F_GETFD) != -1 || errno != EBADF;
 }
 
+// Add session descriptor to the set watched by the server loop
+static void sess_fd_register(struct httpd_data *hd, struct sock_db *session)
+{
+    int fd = session->fd;
+    FD_SET(fd, &hd->hd_sd_fds);
+    hd->hd_sd_by_fd[fd] = session;
+    if (fd > hd->hd_sd_max_fd) {
+        hd->hd_sd_max_fd = fd;
+    }
+}
+
+// Mark or unmark a session as having data buffered above the socket layer
+static void sess_fd_set_pending(struct httpd_data *hd, int fd, bool pending)
+{
+    if (pending == (FD_ISSET(fd, &hd->hd_sd_pending_fds) != 0)) {
+        return;
+    }
+    if (pending) {
+        FD_SET(fd, &hd->hd_sd_pending_fds);
+        hd->hd_sd_pending_count++;
+    } else {
+        FD_CLR(fd, &hd->hd_sd_pending_fds);
+        hd->hd_sd_pending_count--;
+    }
+}
+
+// Remove session descriptor from the set watched by the server loop
+static void sess_fd_unregister(struct httpd_data *hd, struct sock_db *session)
+{
+    int fd = session->fd;
+    if (hd->hd_sd_by_fd[fd] != session) {
+        return;
+    }
+    sess_fd_set_pending(hd, fd, false);
+    FD_CLR(fd, &hd->hd_sd_fds);
+    hd->hd_sd_by_fd[fd] = NULL;
+    if (fd == hd->hd_sd_max_fd) {
+        while (hd->hd_sd_max_fd >= 0 && !FD_ISSET(hd->hd_sd_max_fd, &hd->hd_sd_fds)) {
+            hd->hd_sd_max_fd--;
+        }
+    }
+}
+
 static int enum_function(struct sock_db *session, void *context)
 {
     if ((!session) || (!context)) {
@@ -85,15 +125,6 @@ static int enum_function(struct sock_db *session, void *context)
     case HTTPD_TASK_FIND_FD:
         found = (session->fd == ctx->fd);
         break;
-    // Set descriptor
-    case HTTPD_TASK_SET_DESCRIPTOR:
-        if (session->fd != -1) {
-            FD_SET(session->fd, ctx->fdset);
-            if (session->fd > ctx->max_fd) {
-                ctx->max_fd = session->fd;
-            }
-        }
-        break;
     // Delete invalid session
     case HTTPD_TASK_DELETE_INVALID:
         if (!fd_is_valid(session->fd)) {
@@ -138,6 +169,7 @@ static void httpd_sess_close(void *arg)
 
     if (!sock_db->lru_counter && !sock_db->lru_socket) {
         ESP_LOGD(TAG, "Skipping session close for %d as it seems to be a race condition", sock_db->fd);
+        sock_db->close_pending = false;
         return;
     }
     sock_db->lru_socket = false;
@@ -159,7 +191,7 @@ struct sock_db *httpd_sess_get_free(struct httpd_data *hd)
 
 bool httpd_is_sess_available(struct httpd_data *hd)
 {
-    return httpd_sess_get_free(hd) ? true : false;
+    return hd->hd_sd_active_count < hd->config.max_open_sockets;
 }
 
 struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd)
@@ -174,18 +206,21 @@ struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd)
         return hd->hd_req_aux.sd;
     }
 
-    enum_context_t context = {
-        .task = HTTPD_TASK_FIND_FD,
-        .fd = sockfd
-    };
-    httpd_sess_enum(hd, enum_function, &context);
-    return context.session;
+    if ((sockfd < 0) || (sockfd >= FD_SETSIZE)) {
+        return NULL;
+    }
+    return hd->hd_sd_by_fd[sockfd];
 }
 
 esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd)
 {
     ESP_LOGD(TAG, LOG_FMT("fd = %d"), newfd);
 
+    if ((newfd < 0) || (newfd >= FD_SETSIZE)) {
+        ESP_LOGE(TAG, LOG_FMT("fd = %d out of range for select()"), newfd);
+        return ESP_FAIL;
+    }
+
     if (httpd_sess_get(hd, newfd)) {
         ESP_LOGE(TAG, LOG_FMT("session already exists with fd = %d"), newfd);
         return ESP_FAIL;
@@ -203,6 +238,12 @@ esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd)
     session->handle = (httpd_handle_t) hd;
     session->send_fn = httpd_default_send;
     session->recv_fn = httpd_default_recv;
+    sess_fd_register(hd, session);
+
+    // increment number of sessions
+    // (done before open_fn, as httpd_sess_delete() on failure decrements it)
+    hd->hd_sd_active_count++;
+    ESP_LOGD(TAG, LOG_FMT("active sockets: %d"), hd->hd_sd_active_count);
 
     // Call user-defined session opening function
     if (hd->config.open_fn) {
@@ -214,10 +255,6 @@ esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd)
         }
     }
 
-    // increment number of sessions
-    hd->hd_sd_active_count++;
-    ESP_LOGD(TAG, LOG_FMT("active sockets: %d"), hd->hd_sd_active_count);
-
     return ESP_OK;
 }
 
@@ -324,19 +361,6 @@ void httpd_sess_set_transport_ctx(httpd_handle_t handle, int sockfd, void *ctx,
     session->free_transport_ctx = free_fn;
 }
 
-void httpd_sess_set_descriptors(struct httpd_data *hd, fd_set *fdset, int *maxfd)
-{
-    enum_context_t context = {
-        .task = HTTPD_TASK_SET_DESCRIPTOR,
-        .max_fd = -1,
-        .fdset = fdset
-    };
-    httpd_sess_enum(hd, enum_function, &context);
-    if (maxfd) {
-        *maxfd = context.max_fd;
-    }
-}
-
 void httpd_sess_delete_invalid(struct httpd_data *hd)
 {
     enum_context_t context = {
@@ -364,7 +388,8 @@ void httpd_sess_delete(struct httpd_data *hd, struct sock_db *session)
     // clear all contexts
     httpd_sess_clear_ctx(session);
 
-    // mark session slot as available
+    // stop watching the descriptor and mark session slot as available
+    sess_fd_unregister(hd, session);
     session->fd = -1;
 
     // decrement number of sessions
@@ -377,6 +402,12 @@ void httpd_sess_delete(struct httpd_data *hd, struct sock_db *session)
 
 void httpd_sess_init(struct httpd_data *hd)
 {
+    FD_ZERO(&hd->hd_sd_fds);
+    FD_ZERO(&hd->hd_sd_pending_fds);
+    hd->hd_sd_max_fd = -1;
+    hd->hd_sd_pending_count = 0;
+    memset(hd->hd_sd_by_fd, 0, sizeof(hd->hd_sd_by_fd));
+
     enum_context_t context = {
         .task = HTTPD_TASK_INIT
     };
@@ -418,9 +449,46 @@ esp_err_t httpd_sess_process(struct httpd_data *hd, struct sock_db *session)
     }
     ESP_LOGD(TAG, LOG_FMT("success"));
     session->lru_counter = ++hd->lru_counter;
+
+    // Data left buffered above the socket layer will not wake up select(),
+    // so remember the session for the next iteration of the server loop,
+    // unless the handler has already queued closing the session
+    sess_fd_set_pending(hd, session->fd, !session->close_pending && httpd_sess_pending(hd, session));
     return ESP_OK;
 }
 
+void httpd_sess_process_ready(struct httpd_data *hd, const fd_set *ready, int ready_cnt)
+{
+    // Both counts shrink as sessions are visited, so stop as soon as
+    // every ready or pending session has been handled
+    int pending_cnt = hd->hd_sd_pending_count;
+    for (int fd = 0; fd <= hd->hd_sd_max_fd && (ready_cnt > 0 || pending_cnt > 0); fd++) {
+        bool is_ready = FD_ISSET(fd, ready);
+        bool is_pending = FD_ISSET(fd, &hd->hd_sd_pending_fds);
+        if (!is_ready && !is_pending) {
+            continue;
+        }
+        ready_cnt -= is_ready;
+        pending_cnt -= is_pending;
+
+        // Session may have been closed by a control message in the meantime
+        struct sock_db *session = hd->hd_sd_by_fd[fd];
+        if (!session) {
+            continue;
+        }
+        // Closing was queued from another context, don't serve any more
+        // requests and stop waking up for the data buffered so far
+        if (session->close_pending) {
+            sess_fd_set_pending(hd, fd, false);
+            continue;
+        }
+        ESP_LOGD(TAG, LOG_FMT("processing socket %d"), fd);
+        if (httpd_sess_process(hd, session) != ESP_OK) {
+            httpd_sess_delete(hd, session); // Delete session
+        }
+    }
+}
+
 esp_err_t httpd_sess_update_lru_counter(httpd_handle_t handle, int sockfd)
 {
     if (handle == NULL) {
@@ -429,13 +497,9 @@ esp_err_t httpd_sess_update_lru_counter(httpd_handle_t handle, int sockfd)
 
     struct httpd_data *hd = (struct httpd_data *) handle;
 
-    enum_context_t context = {
-        .task = HTTPD_TASK_FIND_FD,
-        .fd = sockfd
-    };
-    httpd_sess_enum(hd, enum_function, &context);
-    if (context.session) {
-        context.session->lru_counter = ++hd->lru_counter;
+    struct sock_db *session = httpd_sess_get(hd, sockfd);
+    if (session) {
+        session->lru_counter = ++hd->lru_counter;
         return ESP_OK;
     }
     return ESP_ERR_NOT_FOUND;
@@ -462,7 +526,12 @@ esp_err_t httpd_sess_trigger_close_(httpd_handle_t handle, struct sock_db *sessi
     if (!session) {
         return ESP_ERR_NOT_FOUND;
     }
-    return httpd_queue_work(handle, httpd_sess_close, session);
+    session->close_pending = true;
+    esp_err_t ret = httpd_queue_work(handle, httpd_sess_close, session);
+    if (ret != ESP_OK) {
+        session->close_pending = false;
+    }
+    return ret;
 }
 
 esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
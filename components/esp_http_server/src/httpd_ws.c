@@ -33,6 +33,15 @@ typedef struct {
     EventGroupHandle_t transfer_done;
 } async_transfer_t;
 
+typedef struct {
+    httpd_handle_t handle;
+    httpd_ws_broadcast_filter_t filter;
+    void *filter_arg;
+    size_t tx_len;              /* Length of the encoded frame in tx_buf */
+    uint8_t *tx_buf;            /* Frame header immediately followed by the payload */
+    uint8_t data[];             /* Storage for the encoded frame */
+} broadcast_transfer_t;
+
 static const char *TAG="httpd_ws";
 
 /*
@@ -45,6 +54,9 @@ static const char *TAG="httpd_ws";
 #define HTTPD_WS_MASK_BIT       0x80U
 #define HTTPD_WS_LENGTH_BITS    0x7fU
 
+/* Maximum length of an unmasked frame header: 2 bytes header, 8 bytes length */
+#define HTTPD_WS_MAX_HEADER_LEN 10
+
 /*
  * The magic GUID string used for handshake
  * Please refer to RFC6455 Section 1.3 for more details.
@@ -363,25 +375,16 @@ esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t
     return ESP_OK;
 }
 
-esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *frame)
-{
-    esp_err_t ret = httpd_ws_check_req(req);
-    if (ret != ESP_OK) {
-        return ret;
-    }
-    return httpd_ws_send_frame_async(req->handle, httpd_req_to_sockfd(req), frame);
-}
-
-esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+/**
+ * @brief Encodes the header of an outgoing (unmasked) WebSocket frame
+ *
+ * @param frame[in]         Frame to be sent
+ * @param header_buf[out]   Buffer of at least HTTPD_WS_MAX_HEADER_LEN bytes
+ * @return Length of the encoded header
+ */
+static uint8_t httpd_ws_build_header(const httpd_ws_frame_t *frame, uint8_t *header_buf)
 {
-    if (!frame) {
-        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    /* Prepare Tx buffer - maximum length is 14, which includes 2 bytes header, 8 bytes length, 4 bytes mask key */
     uint8_t tx_len = 0;
-    uint8_t header_buf[10] = {0 };
     /* Set the `FIN` bit by default if message is not fragmented. Else, set it as per the `final` field */
     header_buf[0] |= (!frame->fragmented) ? HTTPD_WS_FIN_BIT : (frame->final? HTTPD_WS_FIN_BIT: HTTPD_WS_CONTINUE);
     header_buf[0] |= frame->type; /* Type (opcode): 4 bits */
@@ -409,6 +412,28 @@ esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t
 
     /* WebSocket server does not required to mask response payload, so leave the MASK bit as 0. */
     header_buf[1] &= (~HTTPD_WS_MASK_BIT);
+    return tx_len;
+}
+
+esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *frame)
+{
+    esp_err_t ret = httpd_ws_check_req(req);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return httpd_ws_send_frame_async(req->handle, httpd_req_to_sockfd(req), frame);
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    if (!frame) {
+        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Prepare Tx buffer - maximum length is 14, which includes 2 bytes header, 8 bytes length, 4 bytes mask key */
+    uint8_t header_buf[HTTPD_WS_MAX_HEADER_LEN] = { 0 };
+    uint8_t tx_len = httpd_ws_build_header(frame, header_buf);
 
     struct sock_db *sess = httpd_sess_get(hd, fd);
     if (!sess) {
@@ -571,4 +596,75 @@ esp_err_t httpd_ws_send_data_async(httpd_handle_t handle, int socket, httpd_ws_f
     return ESP_OK;
 }
 
+static void httpd_ws_broadcast_cb(void *arg)
+{
+    broadcast_transfer_t *trans = arg;
+    struct httpd_data *hd = (struct httpd_data *) trans->handle;
+
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        struct sock_db *sess = &hd->hd_sd[i];
+        if (sess->fd < 0 || !sess->ws_handshake_done || sess->ws_close) {
+            continue;
+        }
+        if (trans->filter && !trans->filter(trans->handle, sess->fd, trans->filter_arg)) {
+            continue;
+        }
+        /* Header and payload are contiguous, send_fn may still take only a part of them at a time */
+        const char *buf = (const char *)trans->tx_buf;
+        size_t len = trans->tx_len;
+        while (len > 0) {
+            int ret = sess->send_fn(hd, sess->fd, buf, len, 0);
+            if (ret <= 0) {
+                break;
+            }
+            buf += ret;
+            len -= ret;
+        }
+        if (len > 0) {
+            /* The client may have got a part of the frame, the stream can't be continued */
+            ESP_LOGD(TAG, LOG_FMT("Failed to broadcast to fd %d, closing"), sess->fd);
+            sess->ws_close = true;
+            httpd_sess_trigger_close_(hd, sess);
+        }
+    }
+
+    free(trans);
+}
+
+esp_err_t httpd_ws_broadcast(httpd_handle_t handle, httpd_ws_broadcast_filter_t filter, void *filter_arg,
+                             httpd_ws_frame_t *frame)
+{
+    if (handle == NULL || frame == NULL || (frame->len > 0 && frame->payload == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Encode the frame once, it's shared by all the recipients */
+    broadcast_transfer_t *transfer = malloc(sizeof(broadcast_transfer_t) + HTTPD_WS_MAX_HEADER_LEN + frame->len);
+    if (transfer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint8_t header_buf[HTTPD_WS_MAX_HEADER_LEN] = { 0 };
+    uint8_t header_len = httpd_ws_build_header(frame, header_buf);
+    /* Place the header right before the payload */
+    transfer->tx_buf = transfer->data + HTTPD_WS_MAX_HEADER_LEN - header_len;
+    transfer->tx_len = header_len + frame->len;
+    memcpy(transfer->tx_buf, header_buf, header_len);
+    if (frame->len > 0) {
+        memcpy(transfer->data + HTTPD_WS_MAX_HEADER_LEN, frame->payload, frame->len);
+    }
+
+    transfer->handle = handle;
+    transfer->filter = filter;
+    transfer->filter_arg = filter_arg;
+
+    esp_err_t err = httpd_queue_work(handle, httpd_ws_broadcast_cb, transfer);
+    if (err != ESP_OK) {
+        free(transfer);
+        return err;
+    }
+
+    return ESP_OK;
+}
+
 #endif /* CONFIG_HTTPD_WS_SUPPORT */
@@ -6,8 +6,12 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <sys/param.h>
 #include <esp_system.h>
+#include <esp_timer.h>
 #include <esp_http_server.h>
+#include "lwip/sockets.h"
 
 #include "unity.h"
 #include "test_utils.h"
@@ -243,3 +247,398 @@ TEST_CASE("Max Allowed Sockets Test", "[HTTP SERVER]")
     config.max_open_sockets += 1;
     TEST_ASSERT(httpd_start(&hd, &config) != ESP_OK);
 }
+
+/* Request latency on one keep-alive connection, while other connections
+ * stay open but idle. The cost of waking up for a ready session should
+ * not depend on the number of idle sessions: a server loop that walks all
+ * sessions on every wake-up gets slower with each idle one, so the latency
+ * with the maximum number of idle sessions is compared to the latency of
+ * the active connection alone. */
+#define SCALING_TEST_REQUESTS   200
+/* Client and server side of each loopback connection both consume an
+ * LWIP socket, server itself needs 3 */
+#define SCALING_TEST_MAX_CONNS  ((CONFIG_LWIP_MAX_SOCKETS - 3) / 2)
+
+static esp_err_t scaling_get_handler(httpd_req_t *req)
+{
+    return httpd_resp_send(req, "ok", HTTPD_RESP_USE_STRLEN);
+}
+
+static int scaling_connect(uint16_t port)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    TEST_ASSERT(fd >= 0);
+    TEST_ASSERT_EQUAL(0, connect(fd, (struct sockaddr *)&addr, sizeof(addr)));
+    return fd;
+}
+
+static int64_t scaling_measure_us(int fd)
+{
+    static const char request[] = "GET /scaling HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    char resp[128];
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < SCALING_TEST_REQUESTS; i++) {
+        TEST_ASSERT_EQUAL(sizeof(request) - 1, send(fd, request, sizeof(request) - 1, 0));
+        /* Response is small enough to arrive in one segment over loopback */
+        TEST_ASSERT(recv(fd, resp, sizeof(resp), 0) > 0);
+    }
+    return (esp_timer_get_time() - start) / SCALING_TEST_REQUESTS;
+}
+
+TEST_CASE("Session scaling with idle connections", "[HTTP SERVER]")
+{
+    test_case_uses_tcpip();
+
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.max_open_sockets = SCALING_TEST_MAX_CONNS;
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+
+    httpd_uri_t uri = {
+        .uri      = "/scaling",
+        .method   = HTTP_GET,
+        .handler  = scaling_get_handler,
+    };
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+
+    int active_fd = scaling_connect(config.server_port);
+    int64_t us_alone = scaling_measure_us(active_fd);
+
+    int idle_fds[SCALING_TEST_MAX_CONNS];
+    int idle_cnt = SCALING_TEST_MAX_CONNS - 1;
+    for (int i = 0; i < idle_cnt; i++) {
+        idle_fds[i] = scaling_connect(config.server_port);
+    }
+    int64_t us_with_idle = scaling_measure_us(active_fd);
+
+    IDF_LOG_PERFORMANCE("HTTPD request latency, 1 connection", "%d us", (int)us_alone);
+    IDF_LOG_PERFORMANCE("HTTPD request latency, with idle connections", "%d us, idle: %d",
+                        (int)us_with_idle, idle_cnt);
+    int increase_percent = (int)((us_with_idle - us_alone) * 100 / us_alone);
+    TEST_PERFORMANCE_LESS_THAN(HTTPD_IDLE_SESSIONS_LATENCY_INCREASE_PERCENT, "%d%%", increase_percent);
+
+    for (int i = 0; i < idle_cnt; i++) {
+        close(idle_fds[i]);
+    }
+    close(active_fd);
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+
+/* The handler closes its session, the second of two requests received in one
+ * segment is left buffered in the session and must not be served anymore */
+static volatile int close_handler_calls;
+
+static esp_err_t close_get_handler(httpd_req_t *req)
+{
+    close_handler_calls++;
+    httpd_sess_trigger_close(req->handle, httpd_req_to_sockfd(req));
+    return httpd_resp_send(req, "ok", HTTPD_RESP_USE_STRLEN);
+}
+
+TEST_CASE("Closed session doesn't serve buffered requests", "[HTTP SERVER]")
+{
+    test_case_uses_tcpip();
+
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+
+    httpd_uri_t uri = {
+        .uri      = "/close",
+        .method   = HTTP_GET,
+        .handler  = close_get_handler,
+    };
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+
+    static const char requests[] = "GET /close HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                                   "GET /close HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    close_handler_calls = 0;
+    int fd = scaling_connect(config.server_port);
+    TEST_ASSERT_EQUAL(sizeof(requests) - 1, send(fd, requests, sizeof(requests) - 1, 0));
+
+    /* Read until the server closes the connection */
+    struct timeval timeout = { .tv_sec = 5 };
+    TEST_ASSERT_EQUAL(0, setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)));
+    char resp[128];
+    int ret;
+    while ((ret = recv(fd, resp, sizeof(resp), 0)) > 0) {
+    }
+    TEST_ASSERT_EQUAL(0, ret);
+    TEST_ASSERT_EQUAL(1, close_handler_calls);
+
+    close(fd);
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+
+#if CONFIG_HTTPD_WS_SUPPORT
+/* Sends of the WebSocket test session are split into pieces of at most this size */
+#define WS_TEST_SEND_CHUNK  7
+
+/* Bytes the WebSocket test session may still send before sends fail, -1 for no limit */
+static volatile int ws_send_limit;
+
+static int ws_short_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags)
+{
+    size_t len = MIN(buf_len, WS_TEST_SEND_CHUNK);
+    if (ws_send_limit >= 0) {
+        len = MIN(len, ws_send_limit);
+    }
+    if (len == 0) {
+        return HTTPD_SOCK_ERR_FAIL;
+    }
+    int ret = send(sockfd, buf, len, flags);
+    if (ret < 0) {
+        return HTTPD_SOCK_ERR_FAIL;
+    }
+    if (ws_send_limit >= 0) {
+        ws_send_limit -= ret;
+    }
+    return ret;
+}
+
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        /* Handshake is done, the following frames are sent in short pieces */
+        return httpd_sess_set_send_override(req->handle, httpd_req_to_sockfd(req), ws_short_send);
+    }
+    return ESP_OK;
+}
+
+static int ws_connect(uint16_t port)
+{
+    static const char request[] = "GET /ws HTTP/1.1\r\nHost: localhost\r\n"
+                                  "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                                  "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    int fd = scaling_connect(port);
+    struct timeval timeout = { .tv_sec = 5 };
+    TEST_ASSERT_EQUAL(0, setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)));
+    TEST_ASSERT_EQUAL(sizeof(request) - 1, send(fd, request, sizeof(request) - 1, 0));
+
+    /* Read the response byte by byte, so that no frame data following it is consumed */
+    char resp[256];
+    size_t len = 0;
+    while (len < 4 || memcmp(resp + len - 4, "\r\n\r\n", 4) != 0) {
+        TEST_ASSERT(len < sizeof(resp));
+        TEST_ASSERT_EQUAL(1, recv(fd, resp + len, 1, 0));
+        len++;
+    }
+    TEST_ASSERT_EQUAL(0, strncmp(resp, "HTTP/1.1 101", strlen("HTTP/1.1 101")));
+    return fd;
+}
+
+TEST_CASE("WebSocket broadcast sends complete frames", "[HTTP SERVER]")
+{
+    test_case_uses_tcpip();
+
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    httpd_uri_t uri = {
+        .uri          = "/ws",
+        .method       = HTTP_GET,
+        .handler      = ws_handler,
+        .is_websocket = true,
+    };
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+
+    ws_send_limit = -1;
+    int fd = ws_connect(config.server_port);
+
+    uint8_t payload[200];
+    for (int i = 0; i < sizeof(payload); i++) {
+        payload[i] = i;
+    }
+    httpd_ws_frame_t frame = {
+        .type    = HTTPD_WS_TYPE_BINARY,
+        .payload = payload,
+        .len     = sizeof(payload),
+    };
+
+    /* The frame is sent in pieces, the client gets all of it */
+    TEST_ASSERT(httpd_ws_broadcast(hd, NULL, NULL, &frame) == ESP_OK);
+    uint8_t rx[4 + sizeof(payload)];
+    size_t received = 0;
+    while (received < sizeof(rx)) {
+        int ret = recv(fd, rx + received, sizeof(rx) - received, 0);
+        TEST_ASSERT(ret > 0);
+        received += ret;
+    }
+    const uint8_t header[4] = { 0x80 | HTTPD_WS_TYPE_BINARY, 126, 0, sizeof(payload) };
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(header, rx, sizeof(header));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(payload, rx + sizeof(header), sizeof(payload));
+
+    /* A client the frame can't be sent to completely is disconnected after the part it got */
+    ws_send_limit = 50;
+    TEST_ASSERT(httpd_ws_broadcast(hd, NULL, NULL, &frame) == ESP_OK);
+    received = 0;
+    int ret;
+    while ((ret = recv(fd, rx, sizeof(rx), 0)) > 0) {
+        received += ret;
+    }
+    TEST_ASSERT_EQUAL(0, ret);
+    TEST_ASSERT_EQUAL(50, received);
+
+    close(fd);
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+
+/* Client and server side of each connection both consume an LWIP socket */
+#define WS_TEST_CLIENTS         4
+#define WS_TEST_PAYLOAD_LEN     100
+#define WS_TEST_ROUNDS          50
+
+static esp_err_t ws_plain_handler(httpd_req_t *req)
+{
+    return ESP_OK;
+}
+
+static int ws_filter_calls;
+
+/* Lets every second session through */
+static bool ws_filter_every_second(httpd_handle_t hd, int fd, void *arg)
+{
+    return (ws_filter_calls++ % 2) == 0;
+}
+
+/* Receives len bytes, returns the number of bytes received before the timeout */
+static size_t ws_recv_all(int fd, uint8_t *buf, size_t len)
+{
+    size_t received = 0;
+    while (received < len) {
+        int ret = recv(fd, buf + received, len - received, 0);
+        if (ret <= 0) {
+            break;
+        }
+        received += ret;
+    }
+    return received;
+}
+
+TEST_CASE("WebSocket broadcast skips sessions rejected by the filter", "[HTTP SERVER]")
+{
+    test_case_uses_tcpip();
+
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    httpd_uri_t uri = {
+        .uri          = "/ws",
+        .method       = HTTP_GET,
+        .handler      = ws_plain_handler,
+        .is_websocket = true,
+    };
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+
+    int fds[WS_TEST_CLIENTS];
+    for (int i = 0; i < WS_TEST_CLIENTS; i++) {
+        fds[i] = ws_connect(config.server_port);
+        struct timeval timeout = { .tv_usec = 200000 };
+        TEST_ASSERT_EQUAL(0, setsockopt(fds[i], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)));
+    }
+
+    uint8_t payload[WS_TEST_PAYLOAD_LEN];
+    memset(payload, 0xa5, sizeof(payload));
+    httpd_ws_frame_t frame = {
+        .type    = HTTPD_WS_TYPE_BINARY,
+        .payload = payload,
+        .len     = sizeof(payload),
+    };
+    ws_filter_calls = 0;
+    TEST_ASSERT(httpd_ws_broadcast(hd, ws_filter_every_second, NULL, &frame) == ESP_OK);
+
+    /* Every session is offered to the filter, the accepted ones get the whole frame, the others nothing */
+    uint8_t rx[2 + WS_TEST_PAYLOAD_LEN];
+    int clients_received = 0;
+    for (int i = 0; i < WS_TEST_CLIENTS; i++) {
+        size_t received = ws_recv_all(fds[i], rx, sizeof(rx));
+        if (received > 0) {
+            TEST_ASSERT_EQUAL(sizeof(rx), received);
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(payload, rx + 2, sizeof(payload));
+            clients_received++;
+        }
+    }
+    TEST_ASSERT_EQUAL(WS_TEST_CLIENTS, ws_filter_calls);
+    TEST_ASSERT_EQUAL((WS_TEST_CLIENTS + 1) / 2, clients_received);
+
+    for (int i = 0; i < WS_TEST_CLIENTS; i++) {
+        close(fds[i]);
+    }
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+
+static bool ws_filter_all(httpd_handle_t hd, int fd, void *arg)
+{
+    int *server_fds = arg;
+    server_fds[ws_filter_calls++] = fd;
+    return true;
+}
+
+/* Time to deliver a frame to all clients, once sent by a single broadcast and
+ * once by a work item per client as before httpd_ws_broadcast() existed */
+TEST_CASE("WebSocket broadcast performance", "[HTTP SERVER]")
+{
+    test_case_uses_tcpip();
+
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    httpd_uri_t uri = {
+        .uri          = "/ws",
+        .method       = HTTP_GET,
+        .handler      = ws_plain_handler,
+        .is_websocket = true,
+    };
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+
+    int fds[WS_TEST_CLIENTS];
+    for (int i = 0; i < WS_TEST_CLIENTS; i++) {
+        fds[i] = ws_connect(config.server_port);
+    }
+
+    uint8_t payload[WS_TEST_PAYLOAD_LEN] = { 0 };
+    httpd_ws_frame_t frame = {
+        .type    = HTTPD_WS_TYPE_BINARY,
+        .payload = payload,
+        .len     = sizeof(payload),
+    };
+    uint8_t rx[2 + WS_TEST_PAYLOAD_LEN];
+
+    int server_fds[WS_TEST_CLIENTS];
+    ws_filter_calls = 0;
+    int64_t start = esp_timer_get_time();
+    for (int round = 0; round < WS_TEST_ROUNDS; round++) {
+        TEST_ASSERT(httpd_ws_broadcast(hd, ws_filter_all, server_fds, &frame) == ESP_OK);
+        for (int i = 0; i < WS_TEST_CLIENTS; i++) {
+            TEST_ASSERT_EQUAL(sizeof(rx), ws_recv_all(fds[i], rx, sizeof(rx)));
+        }
+        ws_filter_calls = 0;
+    }
+    int broadcast_us = (esp_timer_get_time() - start) / WS_TEST_ROUNDS;
+
+    start = esp_timer_get_time();
+    for (int round = 0; round < WS_TEST_ROUNDS; round++) {
+        for (int i = 0; i < WS_TEST_CLIENTS; i++) {
+            TEST_ASSERT(httpd_ws_send_data_async(hd, server_fds[i], &frame, NULL, NULL) == ESP_OK);
+        }
+        for (int i = 0; i < WS_TEST_CLIENTS; i++) {
+            TEST_ASSERT_EQUAL(sizeof(rx), ws_recv_all(fds[i], rx, sizeof(rx)));
+        }
+    }
+    int async_us = (esp_timer_get_time() - start) / WS_TEST_ROUNDS;
+
+    IDF_LOG_PERFORMANCE("HTTPD WS broadcast to all clients", "%d us, clients: %d", broadcast_us, WS_TEST_CLIENTS);
+    IDF_LOG_PERFORMANCE("HTTPD WS async send to each client", "%d us, clients: %d", async_us, WS_TEST_CLIENTS);
+    TEST_PERFORMANCE_LESS_THAN(HTTPD_WS_BROADCAST_TIME_PERCENT_OF_ASYNC_SENDS, "%d%%", broadcast_us * 100 / async_us);
+
+    for (int i = 0; i < WS_TEST_CLIENTS; i++) {
+        close(fds[i]);
+    }
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+#endif /* CONFIG_HTTPD_WS_SUPPORT */
@@ -41,8 +41,15 @@ typedef struct {
     decrypt_cb_t decrypt_cb;                       /*!< Callback for external decryption layer */
     void *decrypt_user_ctx;                        /*!< User context for external decryption layer */
 #endif
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+    int pipeline_depth;                            /*!< Number of download buffers handed over to the flash writer task, so that flash erase and write overlap with the download. Default (0) is 2, 1 writes synchronously from esp_https_ota_perform, at most ESP_HTTPS_OTA_PIPELINE_MAX_DEPTH */
+#endif
 } esp_https_ota_config_t;
 
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+#define ESP_HTTPS_OTA_PIPELINE_MAX_DEPTH  (8)  /*!< Maximum value of pipeline_depth in esp_https_ota_config_t */
+#endif
+
 #define ESP_ERR_HTTPS_OTA_BASE            (0x9000)
 #define ESP_ERR_HTTPS_OTA_IN_PROGRESS     (ESP_ERR_HTTPS_OTA_BASE + 1)  /* OTA operation in progress */
 
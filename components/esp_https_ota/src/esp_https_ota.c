@@ -12,6 +12,13 @@
 #include <esp_ota_ops.h>
 #include <errno.h>
 #include <sys/param.h>
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <esp_spi_flash.h>
+#endif
 
 #define IMAGE_HEADER_SIZE (1024)
 
@@ -22,6 +29,31 @@
 _Static_assert(DEFAULT_OTA_BUF_SIZE > (sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t) + 1), "OTA data buffer too small");
 
 #define DEFAULT_REQUEST_SIZE (64 * 1024)
+
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+#define DEFAULT_PIPELINE_DEPTH (2)
+/* How far the writer task erases ahead of the written data while it is waiting for the download */
+#define PIPELINE_ERASE_AHEAD_SIZE (16 * SPI_FLASH_SEC_SIZE)
+
+typedef struct {
+    char *buf;              /*!< Download buffer, handed back to the reader once written */
+    const void *data;       /*!< Data to write, differs from buf if it was decrypted */
+    int len;                /*!< Length of data, 0 stops the writer task */
+} ota_pipeline_item_t;
+
+typedef struct {
+    QueueHandle_t free_bufs;        /*!< Download buffers the reader can fill */
+    QueueHandle_t write_queue;      /*!< Filled buffers waiting for the writer task */
+    SemaphoreHandle_t writer_done;
+    char **bufs;
+    int depth;
+    esp_ota_handle_t update_handle;
+    size_t erase_limit;             /*!< End of the area the writer may erase ahead, 0 if already erased */
+    size_t written;
+    volatile esp_err_t write_err;
+    volatile bool discard;
+} ota_pipeline_t;
+#endif
 static const char *TAG = "esp_https_ota";
 
 typedef enum {
@@ -47,6 +79,10 @@ struct esp_https_ota_handle {
     decrypt_cb_t decrypt_cb;
     void *decrypt_user_ctx;
 #endif
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+    int pipeline_depth;
+    ota_pipeline_t *pipeline;
+#endif
 };
 
 typedef struct esp_https_ota_handle esp_https_ota_t;
@@ -191,6 +227,137 @@ static esp_err_t _ota_write(esp_https_ota_t *https_ota_handle, const void *buffe
     return err;
 }
 
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+static void ota_pipeline_writer_task(void *arg)
+{
+    ota_pipeline_t *pipeline = (ota_pipeline_t *)arg;
+    size_t erased = pipeline->written;
+    ota_pipeline_item_t item;
+
+    while (1) {
+        const bool erase_ahead = pipeline->write_err == ESP_OK &&
+                                 erased < MIN(pipeline->erase_limit, pipeline->written + PIPELINE_ERASE_AHEAD_SIZE);
+        if (xQueueReceive(pipeline->write_queue, &item, erase_ahead ? 0 : portMAX_DELAY) != pdTRUE) {
+            /* Nothing to program yet, erase the next sector the download is going to need */
+            erased = MAX(erased, pipeline->written) + SPI_FLASH_SEC_SIZE;
+            esp_err_t err = esp_ota_erase_ahead(pipeline->update_handle, erased);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Error: esp_ota_erase_ahead failed! err=0x%x", err);
+                pipeline->write_err = err;
+            }
+            continue;
+        }
+        if (item.len == 0) {
+            break;
+        }
+        if (pipeline->write_err == ESP_OK && !pipeline->discard) {
+            esp_err_t err = esp_ota_write(pipeline->update_handle, item.data, item.len);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Error: esp_ota_write failed! err=0x%x", err);
+                pipeline->write_err = err;
+            } else {
+                pipeline->written += item.len;
+            }
+        }
+#if CONFIG_ESP_HTTPS_OTA_DECRYPT_CB
+        if (item.data != item.buf) {
+            esp_https_ota_decrypt_cb_free_buf((void *) item.data);
+        }
+#endif
+        xQueueSend(pipeline->free_bufs, &item.buf, portMAX_DELAY);
+    }
+    xSemaphoreGive(pipeline->writer_done);
+    vTaskDelete(NULL);
+}
+
+static void ota_pipeline_free(ota_pipeline_t *pipeline)
+{
+    if (pipeline->bufs) {
+        for (int i = 0; i < pipeline->depth; i++) {
+            free(pipeline->bufs[i]);
+        }
+        free(pipeline->bufs);
+    }
+    if (pipeline->free_bufs) {
+        vQueueDelete(pipeline->free_bufs);
+    }
+    if (pipeline->write_queue) {
+        vQueueDelete(pipeline->write_queue);
+    }
+    if (pipeline->writer_done) {
+        vSemaphoreDelete(pipeline->writer_done);
+    }
+    free(pipeline);
+}
+
+/* Hand the OTA handle over to a writer task which programs flash while the next buffers are downloaded */
+static esp_err_t ota_pipeline_start(esp_https_ota_t *handle)
+{
+    ota_pipeline_t *pipeline = calloc(1, sizeof(ota_pipeline_t));
+    if (pipeline == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    pipeline->depth = handle->pipeline_depth;
+    pipeline->update_handle = handle->update_handle;
+    pipeline->written = handle->binary_file_len;
+    if (!handle->bulk_flash_erase) {
+        pipeline->erase_limit = (handle->image_length > 0) ? handle->image_length : handle->update_partition->size;
+    }
+    pipeline->bufs = calloc(pipeline->depth, sizeof(char *));
+    pipeline->free_bufs = xQueueCreate(pipeline->depth, sizeof(char *));
+    pipeline->write_queue = xQueueCreate(pipeline->depth + 1, sizeof(ota_pipeline_item_t));
+    pipeline->writer_done = xSemaphoreCreateBinary();
+    if (!pipeline->bufs || !pipeline->free_bufs || !pipeline->write_queue || !pipeline->writer_done) {
+        goto no_mem;
+    }
+    for (int i = 0; i < pipeline->depth; i++) {
+        pipeline->bufs[i] = malloc(handle->ota_upgrade_buf_size);
+        if (pipeline->bufs[i] == NULL) {
+            goto no_mem;
+        }
+        xQueueSend(pipeline->free_bufs, &pipeline->bufs[i], 0);
+    }
+    if (xTaskCreate(ota_pipeline_writer_task, "ota_writer", CONFIG_ESP_HTTPS_OTA_PIPELINE_TASK_STACK_SIZE,
+                    pipeline, CONFIG_ESP_HTTPS_OTA_PIPELINE_TASK_PRIORITY, NULL) != pdPASS) {
+        goto no_mem;
+    }
+    handle->pipeline = pipeline;
+    return ESP_OK;
+
+no_mem:
+    ESP_LOGE(TAG, "Couldn't allocate memory for OTA write pipeline");
+    ota_pipeline_free(pipeline);
+    return ESP_ERR_NO_MEM;
+}
+
+/* Wait until the writer task has written (or, with discard, dropped) all queued data and release the pipeline */
+static esp_err_t ota_pipeline_stop(esp_https_ota_t *handle, bool discard)
+{
+    ota_pipeline_t *pipeline = handle->pipeline;
+    ota_pipeline_item_t stop = { 0 };
+    pipeline->discard = discard;
+    xQueueSend(pipeline->write_queue, &stop, portMAX_DELAY);
+    xSemaphoreTake(pipeline->writer_done, portMAX_DELAY);
+    esp_err_t err = pipeline->write_err;
+    ota_pipeline_free(pipeline);
+    handle->pipeline = NULL;
+    return err;
+}
+
+static esp_err_t ota_pipeline_write(esp_https_ota_t *handle, char *buf, const void *data, int len)
+{
+    ota_pipeline_item_t item = {
+        .buf = buf,
+        .data = data,
+        .len = len,
+    };
+    xQueueSend(handle->pipeline->write_queue, &item, portMAX_DELAY);
+    handle->binary_file_len += len;
+    ESP_LOGD(TAG, "Queued image length %d", handle->binary_file_len);
+    return ESP_ERR_HTTPS_OTA_IN_PROGRESS;
+}
+#endif // CONFIG_ESP_HTTPS_OTA_PIPELINE
+
 static bool is_server_verification_enabled(const esp_https_ota_config_t *ota_config) {
     return  (ota_config->http_config->cert_pem
             || ota_config->http_config->use_global_ca_store
@@ -219,6 +386,14 @@ esp_err_t esp_https_ota_begin(const esp_https_ota_config_t *ota_config, esp_http
 #endif
     }
 
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+    if (ota_config->pipeline_depth < 0 || ota_config->pipeline_depth > ESP_HTTPS_OTA_PIPELINE_MAX_DEPTH) {
+        ESP_LOGE(TAG, "pipeline_depth must be between 0 and %d", ESP_HTTPS_OTA_PIPELINE_MAX_DEPTH);
+        *handle = NULL;
+        return ESP_ERR_INVALID_ARG;
+    }
+#endif
+
     esp_https_ota_t *https_ota_handle = calloc(1, sizeof(esp_https_ota_t));
     if (!https_ota_handle) {
         ESP_LOGE(TAG, "Couldn't allocate memory to upgrade data buffer");
@@ -315,6 +490,9 @@ esp_err_t esp_https_ota_begin(const esp_https_ota_config_t *ota_config, esp_http
 #endif
     https_ota_handle->ota_upgrade_buf_size = alloc_size;
     https_ota_handle->bulk_flash_erase = ota_config->bulk_flash_erase;
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+    https_ota_handle->pipeline_depth = (ota_config->pipeline_depth == 0) ? DEFAULT_PIPELINE_DEPTH : ota_config->pipeline_depth;
+#endif
     https_ota_handle->binary_file_len = 0;
     *handle = (esp_https_ota_handle_t)https_ota_handle;
     https_ota_handle->state = ESP_HTTPS_OTA_BEGIN;
@@ -458,11 +636,35 @@ esp_err_t esp_https_ota_perform(esp_https_ota_handle_t https_ota_handle)
             if (err != ESP_OK) {
                 return err;
             }
-            return _ota_write(handle, data_buf, binary_file_len);
-        case ESP_HTTPS_OTA_IN_PROGRESS:
+            err = _ota_write(handle, data_buf, binary_file_len);
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+            if (err == ESP_ERR_HTTPS_OTA_IN_PROGRESS && handle->pipeline_depth > 1) {
+                esp_err_t ret = ota_pipeline_start(handle);
+                if (ret != ESP_OK) {
+                    return ret;
+                }
+            }
+#endif
+            return err;
+        case ESP_HTTPS_OTA_IN_PROGRESS: {
+            char *read_buf = handle->ota_upgrade_buf;
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+            if (handle->pipeline) {
+                if (handle->pipeline->write_err != ESP_OK) {
+                    return handle->pipeline->write_err;
+                }
+                /* Blocks only while all buffers are waiting to be written */
+                xQueueReceive(handle->pipeline->free_bufs, &read_buf, portMAX_DELAY);
+            }
+#endif
             data_read = esp_http_client_read(handle->http_client,
-                                             handle->ota_upgrade_buf,
+                                             read_buf,
                                              handle->ota_upgrade_buf_size);
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+            if (handle->pipeline && data_read <= 0) {
+                xQueueSend(handle->pipeline->free_bufs, &read_buf, 0);
+            }
+#endif
             if (data_read == 0) {
                 /*
                  *  esp_http_client_is_complete_data_received is added to check whether
@@ -484,20 +686,30 @@ esp_err_t esp_https_ota_perform(esp_https_ota_handle_t https_ota_handle)
                 }
                 ESP_LOGD(TAG, "Connection closed");
             } else if (data_read > 0) {
-                const void *data_buf = (const void *) handle->ota_upgrade_buf;
+                const void *data_buf = (const void *) read_buf;
                 int data_len = data_read;
 #if CONFIG_ESP_HTTPS_OTA_DECRYPT_CB
                 decrypt_cb_arg_t args = {};
-                args.data_in = handle->ota_upgrade_buf;
+                args.data_in = read_buf;
                 args.data_in_len = data_read;
                 err = esp_https_ota_decrypt_cb(handle, &args);
                 if (err == ESP_OK) {
                     data_buf = args.data_out;
                     data_len = args.data_out_len;
                 } else {
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+                    if (handle->pipeline) {
+                        xQueueSend(handle->pipeline->free_bufs, &read_buf, 0);
+                    }
+#endif
                     return err;
                 }
 #endif // CONFIG_ESP_HTTPS_OTA_DECRYPT_CB
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+                if (handle->pipeline) {
+                    return ota_pipeline_write(handle, read_buf, data_buf, data_len);
+                }
+#endif
                 return _ota_write(handle, data_buf, data_len);
             } else {
                 ESP_LOGE(TAG, "data read %d, errno %d", data_read, errno);
@@ -507,6 +719,7 @@ esp_err_t esp_https_ota_perform(esp_https_ota_handle_t https_ota_handle)
                 handle->state = ESP_HTTPS_OTA_SUCCESS;
             }
             break;
+        }
          default:
             ESP_LOGE(TAG, "Invalid ESP HTTPS OTA State");
             return ESP_FAIL;
@@ -536,6 +749,12 @@ esp_err_t esp_https_ota_perform(esp_https_ota_handle_t https_ota_handle)
             return ESP_ERR_HTTPS_OTA_IN_PROGRESS;
         }
     }
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+    if (handle->pipeline) {
+        /* Image is downloaded completely, wait for the last buffers to be written */
+        return ota_pipeline_stop(handle, false);
+    }
+#endif
     return ESP_OK;
 }
 
@@ -562,10 +781,19 @@ esp_err_t esp_https_ota_finish(esp_https_ota_handle_t https_ota_handle)
     }
 
     esp_err_t err = ESP_OK;
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+    if (handle->pipeline) {
+        err = ota_pipeline_stop(handle, false);
+    }
+#endif
     switch (handle->state) {
         case ESP_HTTPS_OTA_SUCCESS:
         case ESP_HTTPS_OTA_IN_PROGRESS:
-            err = esp_ota_end(handle->update_handle);
+            if (err == ESP_OK) {
+                err = esp_ota_end(handle->update_handle);
+            } else {
+                esp_ota_abort(handle->update_handle);
+            }
             /* falls through */
         case ESP_HTTPS_OTA_BEGIN:
             if (handle->ota_upgrade_buf) {
@@ -602,6 +830,11 @@ esp_err_t esp_https_ota_abort(esp_https_ota_handle_t https_ota_handle)
     }
 
     esp_err_t err = ESP_OK;
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE
+    if (handle->pipeline) {
+        ota_pipeline_stop(handle, true);
+    }
+#endif
     switch (handle->state) {
         case ESP_HTTPS_OTA_SUCCESS:
         case ESP_HTTPS_OTA_IN_PROGRESS:
@@ -0,0 +1,200 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_https_ota.h"
+#include "esp_http_server.h"
+#include "esp_ota_ops.h"
+#include "unity.h"
+#include "test_utils.h"
+
+#if CONFIG_ESP_HTTPS_OTA_PIPELINE && CONFIG_ESP_HTTPS_OTA_ALLOW_HTTP
+
+#define TEST_OTA_PORT           8070
+#define TEST_OTA_CHUNK_SIZE     1024
+#define TEST_OTA_IMAGE_SIZE     (48 * 1024)
+
+/* Byte of the served image at offset pos: a minimal image header followed by a pattern */
+static uint8_t test_image_byte(size_t pos)
+{
+    const esp_image_header_t hdr = {
+        .magic = ESP_IMAGE_HEADER_MAGIC,
+        .chip_id = CONFIG_IDF_FIRMWARE_CHIP_ID,
+    };
+    if (pos < sizeof(hdr)) {
+        return ((const uint8_t *)&hdr)[pos];
+    }
+    return (uint8_t)(pos * 7 + (pos >> 8));
+}
+
+/* Serves user_ctx bytes of the test image with chunked encoding, so the image size isn't known in advance */
+static esp_err_t image_get_handler(httpd_req_t *req)
+{
+    const size_t size = (size_t)req->user_ctx;
+    char *buf = malloc(TEST_OTA_CHUNK_SIZE);
+    if (buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = ESP_OK;
+    for (size_t offset = 0; offset < size && err == ESP_OK; offset += TEST_OTA_CHUNK_SIZE) {
+        size_t len = MIN(TEST_OTA_CHUNK_SIZE, size - offset);
+        for (size_t i = 0; i < len; i++) {
+            buf[i] = test_image_byte(offset + i);
+        }
+        err = httpd_resp_send_chunk(req, buf, len);
+    }
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    free(buf);
+    return err;
+}
+
+static httpd_handle_t start_image_server(void)
+{
+    const esp_partition_t *part = esp_ota_get_next_update_partition(NULL);
+    TEST_ASSERT_NOT_NULL(part);
+    TEST_ASSERT_GREATER_OR_EQUAL(TEST_OTA_IMAGE_SIZE, part->size);
+    const httpd_uri_t uris[] = {
+        { .uri = "/image", .method = HTTP_GET, .handler = image_get_handler, .user_ctx = (void *)TEST_OTA_IMAGE_SIZE },
+        { .uri = "/too_big", .method = HTTP_GET, .handler = image_get_handler, .user_ctx = (void *)(part->size + 32 * 1024) },
+    };
+    httpd_handle_t server;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = TEST_OTA_PORT;
+    TEST_ESP_OK(httpd_start(&server, &config));
+    for (int i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        TEST_ESP_OK(httpd_register_uri_handler(server, &uris[i]));
+    }
+    return server;
+}
+
+static esp_https_ota_handle_t begin_ota(const char *path, int pipeline_depth)
+{
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d%s", TEST_OTA_PORT, path);
+    esp_http_client_config_t http_config = {
+        .url = url,
+        .timeout_ms = 5000,
+    };
+    esp_https_ota_config_t ota_config = {
+        .http_config = &http_config,
+        .pipeline_depth = pipeline_depth,
+    };
+    esp_https_ota_handle_t handle = NULL;
+    TEST_ESP_OK(esp_https_ota_begin(&ota_config, &handle));
+    TEST_ASSERT_NOT_NULL(handle);
+    return handle;
+}
+
+/* Waits for the deleted writer task to be cleaned up, returns the number of tasks */
+static UBaseType_t settled_task_count(void)
+{
+    vTaskDelay(pdMS_TO_TICKS(50));
+    return uxTaskGetNumberOfTasks();
+}
+
+TEST_CASE("esp_https_ota_begin rejects invalid pipeline depths", "[esp_https_ota]")
+{
+    esp_http_client_config_t http_config = {
+        .url = "http://127.0.0.1/image",
+    };
+    esp_https_ota_config_t ota_config = {
+        .http_config = &http_config,
+    };
+    const int invalid_depths[] = { -1, INT_MIN, ESP_HTTPS_OTA_PIPELINE_MAX_DEPTH + 1 };
+    for (int i = 0; i < sizeof(invalid_depths) / sizeof(invalid_depths[0]); i++) {
+        esp_https_ota_handle_t handle = (esp_https_ota_handle_t)1;
+        ota_config.pipeline_depth = invalid_depths[i];
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_https_ota_begin(&ota_config, &handle));
+        TEST_ASSERT_NULL(handle);
+    }
+}
+
+TEST_CASE("esp_https_ota pipeline writes the downloaded image", "[esp_https_ota]")
+{
+    test_case_uses_tcpip();
+    httpd_handle_t server = start_image_server();
+    const UBaseType_t tasks = settled_task_count();
+
+    for (int depth = 1; depth <= 3; depth++) {
+        esp_https_ota_handle_t handle = begin_ota("/image", depth);
+        esp_err_t err;
+        while ((err = esp_https_ota_perform(handle)) == ESP_ERR_HTTPS_OTA_IN_PROGRESS) {
+        }
+        TEST_ESP_OK(err);
+        TEST_ASSERT_TRUE(esp_https_ota_is_complete_data_received(handle));
+        TEST_ASSERT_EQUAL(TEST_OTA_IMAGE_SIZE, esp_https_ota_get_image_len_read(handle));
+
+        /* All data is in flash once perform() returns ESP_OK */
+        const esp_partition_t *part = esp_ota_get_next_update_partition(NULL);
+        TEST_ASSERT_NOT_NULL(part);
+        uint8_t buf[256];
+        for (size_t offset = 0; offset < TEST_OTA_IMAGE_SIZE; offset += sizeof(buf)) {
+            TEST_ESP_OK(esp_partition_read(part, offset, buf, sizeof(buf)));
+            for (size_t i = 0; i < sizeof(buf); i++) {
+                TEST_ASSERT_EQUAL_HEX8(test_image_byte(offset + i), buf[i]);
+            }
+        }
+        /* The served image isn't a valid app, so it can't be finished */
+        TEST_ESP_OK(esp_https_ota_abort(handle));
+        TEST_ASSERT_EQUAL(tasks, settled_task_count());
+    }
+    TEST_ESP_OK(httpd_stop(server));
+}
+
+TEST_CASE("esp_https_ota pipeline reports write errors", "[esp_https_ota]")
+{
+    test_case_uses_tcpip();
+    httpd_handle_t server = start_image_server();
+    const UBaseType_t tasks = settled_task_count();
+
+    /* The writer task fails once the image doesn't fit the partition anymore */
+    esp_https_ota_handle_t handle = begin_ota("/too_big", 2);
+    esp_err_t err;
+    while ((err = esp_https_ota_perform(handle)) == ESP_ERR_HTTPS_OTA_IN_PROGRESS) {
+    }
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, err);
+    /* The error sticks, the download doesn't continue */
+    TEST_ASSERT_EQUAL(err, esp_https_ota_perform(handle));
+    TEST_ESP_OK(esp_https_ota_abort(handle));
+    TEST_ASSERT_EQUAL(tasks, settled_task_count());
+
+    /* finish() reports the error as well and doesn't validate the partial image */
+    handle = begin_ota("/too_big", 2);
+    while ((err = esp_https_ota_perform(handle)) == ESP_ERR_HTTPS_OTA_IN_PROGRESS) {
+    }
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, esp_https_ota_finish(handle));
+    TEST_ASSERT_EQUAL(tasks, settled_task_count());
+    TEST_ESP_OK(httpd_stop(server));
+}
+
+TEST_CASE("esp_https_ota pipeline can be aborted during the download", "[esp_https_ota]")
+{
+    test_case_uses_tcpip();
+    httpd_handle_t server = start_image_server();
+    const UBaseType_t tasks = settled_task_count();
+
+    for (int performs = 1; performs <= 8; performs *= 2) {
+        esp_https_ota_handle_t handle = begin_ota("/image", 3);
+        for (int i = 0; i < performs; i++) {
+            TEST_ASSERT_EQUAL(ESP_ERR_HTTPS_OTA_IN_PROGRESS, esp_https_ota_perform(handle));
+        }
+        /* Queued buffers are dropped, the writer task is stopped and all buffers are freed */
+        TEST_ESP_OK(esp_https_ota_abort(handle));
+        TEST_ASSERT_EQUAL(tasks, settled_task_count());
+    }
+    TEST_ESP_OK(httpd_stop(server));
+}
+
+#endif // CONFIG_ESP_HTTPS_OTA_PIPELINE && CONFIG_ESP_HTTPS_OTA_ALLOW_HTTP
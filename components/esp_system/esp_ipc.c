@@ -5,9 +5,12 @@
  */
 
 #include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <sys/param.h>
 #include "esp_err.h"
 #include "esp_ipc.h"
 #include "esp_private/esp_ipc_isr.h"
@@ -19,68 +22,107 @@
 
 #if !defined(CONFIG_FREERTOS_UNICORE) || defined(CONFIG_APPTRACE_GCOV_ENABLE)
 
-static DRAM_ATTR StaticSemaphore_t s_ipc_mutex_buffer[portNUM_PROCESSORS];
-static DRAM_ATTR StaticSemaphore_t s_ipc_sem_buffer[portNUM_PROCESSORS];
-static DRAM_ATTR StaticSemaphore_t s_ipc_ack_buffer[portNUM_PROCESSORS];
-
-static TaskHandle_t s_ipc_task_handle[portNUM_PROCESSORS];
-static SemaphoreHandle_t s_ipc_mutex[portNUM_PROCESSORS];    // This mutex is used as a global lock for esp_ipc_* APIs
-static SemaphoreHandle_t s_ipc_sem[portNUM_PROCESSORS];      // Two semaphores used to wake each of ipc tasks
-static SemaphoreHandle_t s_ipc_ack[portNUM_PROCESSORS];      // Semaphore used to acknowledge that task was woken up,
-                                                             // or function has finished running
-static volatile esp_ipc_func_t s_func[portNUM_PROCESSORS];   // Function which should be called by high priority task
-static void * volatile s_func_arg[portNUM_PROCESSORS];       // Argument to pass into s_func
 typedef enum {
     IPC_WAIT_FOR_START,
-    IPC_WAIT_FOR_END
+    IPC_WAIT_FOR_END,
+    IPC_NO_WAIT,
 } esp_ipc_wait_t;
 
-static volatile esp_ipc_wait_t s_ipc_wait[portNUM_PROCESSORS];// This variable tells high priority task when it should give
-                                                             //   s_ipc_ack semaphore: before s_func is called, or
-                                                             //   after it returns
+/* A pending call. Callers which wait for the call keep the ack semaphore on their own stack,
+   so any number of them can have calls queued for the same CPU at the same time. */
+typedef struct {
+    esp_ipc_func_t func;
+    void *arg;
+    esp_ipc_wait_t wait_for;
+    SemaphoreHandle_t ack;                                   // Given when the call starts or ends, NULL for IPC_NO_WAIT
+#ifdef CONFIG_ESP_IPC_USES_CALLERS_PRIORITY
+    UBaseType_t priority;                                    // Priority of the caller's task
+#endif
+} ipc_call_t;
+
+/* Ring of pending calls for one CPU. Any task or ISR can add calls, only the CPU's IPC task takes them. */
+typedef struct {
+    portMUX_TYPE lock;
+    ipc_call_t calls[CONFIG_ESP_IPC_QUEUE_LENGTH];
+    uint32_t head;                                           // Index of the oldest pending call
+    uint32_t count;                                          // Number of pending calls
+    uint32_t space_waiters;                                  // Number of callers waiting for a free slot
+    bool idle;                                               // IPC task is blocked waiting for calls
+} ipc_queue_t;
 
-#if CONFIG_APPTRACE_GCOV_ENABLE
-static volatile esp_ipc_func_t s_gcov_func = NULL;           // Gcov dump starter function which should be called by high priority task
-static void * volatile s_gcov_func_arg;                      // Argument to pass into s_gcov_func
+static DRAM_ATTR ipc_queue_t s_ipc_queue[portNUM_PROCESSORS];
+static DRAM_ATTR StaticSemaphore_t s_ipc_space_buffer[portNUM_PROCESSORS];
+static DRAM_ATTR StaticSemaphore_t s_ipc_wake_buffer[portNUM_PROCESSORS];
+
+static TaskHandle_t s_ipc_task_handle[portNUM_PROCESSORS];
+static SemaphoreHandle_t s_ipc_space[portNUM_PROCESSORS];    // Given to the callers waiting for a free slot in a full queue
+static SemaphoreHandle_t s_ipc_wake[portNUM_PROCESSORS];     // Wakes up an idle IPC task. Not a task notification, so that
+                                                             // IPC functions can use task notifications themselves.
+
+#ifdef CONFIG_ESP_IPC_USES_CALLERS_PRIORITY
+/* Highest priority of the running call and of the pending calls. Called with queue->lock held. */
+static UBaseType_t IRAM_ATTR ipc_queue_max_priority(const ipc_queue_t *queue, UBaseType_t running_priority)
+{
+    UBaseType_t priority = running_priority;
+    for (uint32_t i = 0; i < queue->count; i++) {
+        priority = MAX(priority, queue->calls[(queue->head + i) % CONFIG_ESP_IPC_QUEUE_LENGTH].priority);
+    }
+    return priority;
+}
 #endif
 
 static void IRAM_ATTR ipc_task(void* arg)
 {
     const int cpuid = (int) arg;
+    ipc_queue_t *queue = &s_ipc_queue[cpuid];
     assert(cpuid == xPortGetCoreID());
 #ifdef CONFIG_ESP_IPC_ISR_ENABLE
     esp_ipc_isr_init();
 #endif
     while (true) {
-        // Wait for IPC to be initiated.
-        // This will be indicated by giving the semaphore corresponding to
-        // this CPU.
-        if (xSemaphoreTake(s_ipc_sem[cpuid], portMAX_DELAY) != pdTRUE) {
-            // TODO: when can this happen?
-            abort();
-        }
-
-#if CONFIG_APPTRACE_GCOV_ENABLE
-        if (s_gcov_func) {
-            (*s_gcov_func)(s_gcov_func_arg);
-            s_gcov_func = NULL;
-            /* we can not interfer with IPC calls so no need for further processing */
+        portENTER_CRITICAL(&queue->lock);
+        if (queue->count == 0) {
+            // Sleep until a caller adds a call to the empty queue. All calls queued in the
+            // meantime are run after a single wake-up.
+            queue->idle = true;
+            portEXIT_CRITICAL(&queue->lock);
+            xSemaphoreTake(s_ipc_wake[cpuid], portMAX_DELAY);
             continue;
         }
+        ipc_call_t call = queue->calls[queue->head];
+        queue->head = (queue->head + 1) % CONFIG_ESP_IPC_QUEUE_LENGTH;
+        queue->count--;
+        bool give_space = (queue->space_waiters > 0);
+        if (give_space) {
+            queue->space_waiters--;
+        }
+#ifdef CONFIG_ESP_IPC_USES_CALLERS_PRIORITY
+        UBaseType_t priority = ipc_queue_max_priority(queue, call.priority);
 #endif
-        if (s_func[cpuid]) {
-            esp_ipc_func_t func = s_func[cpuid];
-            void* arg = s_func_arg[cpuid];
+        portEXIT_CRITICAL(&queue->lock);
 
-            if (s_ipc_wait[cpuid] == IPC_WAIT_FOR_START) {
-                xSemaphoreGive(s_ipc_ack[cpuid]);
-            }
-            (*func)(arg);
-            if (s_ipc_wait[cpuid] == IPC_WAIT_FOR_END) {
-                xSemaphoreGive(s_ipc_ack[cpuid]);
-            }
+        if (give_space) {
+            xSemaphoreGive(s_ipc_space[cpuid]);
+        }
+#ifdef CONFIG_ESP_IPC_USES_CALLERS_PRIORITY
+        /* Run at the highest priority of all the calls waiting for this task, so that a caller queued behind
+           this call isn't delayed by lower priority tasks. Callers only ever raise the priority of the task;
+           if one queued a call after the priority was computed above, the check is repeated so that the
+           boost it applied is not undone. */
+        while (uxTaskPriorityGet(NULL) != priority) {
+            vTaskPrioritySet(NULL, priority);
+            portENTER_CRITICAL(&queue->lock);
+            priority = ipc_queue_max_priority(queue, call.priority);
+            portEXIT_CRITICAL(&queue->lock);
+        }
+#endif
+        if (call.wait_for == IPC_WAIT_FOR_START) {
+            xSemaphoreGive(call.ack);
+        }
+        (*call.func)(call.arg);
+        if (call.wait_for == IPC_WAIT_FOR_END) {
+            xSemaphoreGive(call.ack);
         }
-
     }
     // TODO: currently this is unreachable code. Introduce esp_ipc_uninit
     // function which will signal to both tasks that they can shut down.
@@ -108,9 +150,9 @@ static void esp_ipc_init(void)
 
     for (int i = 0; i < portNUM_PROCESSORS; ++i) {
         snprintf(task_name, sizeof(task_name), "ipc%d", i);
-        s_ipc_mutex[i] = xSemaphoreCreateMutexStatic(&s_ipc_mutex_buffer[i]);
-        s_ipc_ack[i] = xSemaphoreCreateBinaryStatic(&s_ipc_ack_buffer[i]);
-        s_ipc_sem[i] = xSemaphoreCreateBinaryStatic(&s_ipc_sem_buffer[i]);
+        portMUX_INITIALIZE(&s_ipc_queue[i].lock);
+        s_ipc_space[i] = xSemaphoreCreateCountingStatic(UINT32_MAX, 0, &s_ipc_space_buffer[i]);
+        s_ipc_wake[i] = xSemaphoreCreateBinaryStatic(&s_ipc_wake_buffer[i]);
         portBASE_TYPE res = xTaskCreatePinnedToCore(ipc_task, task_name, CONFIG_ESP_IPC_TASK_STACK_SIZE, (void*) i,
                                                     configMAX_PRIORITIES - 1, &s_ipc_task_handle[i], i);
         assert(res == pdTRUE);
@@ -118,6 +160,52 @@ static void esp_ipc_init(void)
     }
 }
 
+/* Add a call to the queue of a CPU and wake up its IPC task if needed. If the queue is full, either wait
+   for a free slot (only from a task) or return ESP_ERR_INVALID_STATE. */
+static esp_err_t ipc_queue_call(uint32_t cpu_id, const ipc_call_t *call, bool wait_for_space)
+{
+    ipc_queue_t *queue = &s_ipc_queue[cpu_id];
+
+    portENTER_CRITICAL_SAFE(&queue->lock);
+    while (queue->count == CONFIG_ESP_IPC_QUEUE_LENGTH) {
+        if (!wait_for_space) {
+            portEXIT_CRITICAL_SAFE(&queue->lock);
+            return ESP_ERR_INVALID_STATE;
+        }
+        queue->space_waiters++;
+        portEXIT_CRITICAL_SAFE(&queue->lock);
+        xSemaphoreTake(s_ipc_space[cpu_id], portMAX_DELAY);
+        portENTER_CRITICAL_SAFE(&queue->lock);
+    }
+    queue->calls[(queue->head + queue->count) % CONFIG_ESP_IPC_QUEUE_LENGTH] = *call;
+    queue->count++;
+    bool wake_up = queue->idle;
+    queue->idle = false;
+    portEXIT_CRITICAL_SAFE(&queue->lock);
+
+    if (xPortInIsrContext()) {
+        if (wake_up) {
+            BaseType_t task_woken = pdFALSE;
+            xSemaphoreGiveFromISR(s_ipc_wake[cpu_id], &task_woken);
+            if (task_woken == pdTRUE) {
+                portYIELD_FROM_ISR();
+            }
+        }
+        return ESP_OK;
+    }
+#ifdef CONFIG_ESP_IPC_USES_CALLERS_PRIORITY
+    /* Only raise the priority of the IPC task, so that it doesn't run the calls still in front of this one
+       at a lower priority. The IPC task lowers it itself once no call with a higher priority is pending. */
+    if (uxTaskPriorityGet(s_ipc_task_handle[cpu_id]) < call->priority) {
+        vTaskPrioritySet(s_ipc_task_handle[cpu_id], call->priority);
+    }
+#endif
+    if (wake_up) {
+        xSemaphoreGive(s_ipc_wake[cpu_id]);
+    }
+    return ESP_OK;
+}
+
 static esp_err_t esp_ipc_call_and_wait(uint32_t cpu_id, esp_ipc_func_t func, void* arg, esp_ipc_wait_t wait_for)
 {
     if (cpu_id >= portNUM_PROCESSORS) {
@@ -127,31 +215,19 @@ static esp_err_t esp_ipc_call_and_wait(uint32_t cpu_id, esp_ipc_func_t func, voi
         return ESP_ERR_INVALID_STATE;
     }
 
+    StaticSemaphore_t ack_buffer;
+    ipc_call_t call = {
+        .func = func,
+        .arg = arg,
+        .wait_for = wait_for,
+        .ack = xSemaphoreCreateBinaryStatic(&ack_buffer),
 #ifdef CONFIG_ESP_IPC_USES_CALLERS_PRIORITY
-    TaskHandle_t task_handler = xTaskGetCurrentTaskHandle();
-    UBaseType_t priority_of_current_task = uxTaskPriorityGet(task_handler);
-    UBaseType_t priority_of_running_ipc_task = uxTaskPriorityGet(s_ipc_task_handle[cpu_id]);
-    if (priority_of_running_ipc_task < priority_of_current_task) {
-        vTaskPrioritySet(s_ipc_task_handle[cpu_id], priority_of_current_task);
-    }
-
-    xSemaphoreTake(s_ipc_mutex[cpu_id], portMAX_DELAY);
-    vTaskPrioritySet(s_ipc_task_handle[cpu_id], priority_of_current_task);
-#else
-    xSemaphoreTake(s_ipc_mutex[0], portMAX_DELAY);
-#endif
-
-    s_func[cpu_id] = func;
-    s_func_arg[cpu_id] = arg;
-    s_ipc_wait[cpu_id] = wait_for;
-    xSemaphoreGive(s_ipc_sem[cpu_id]);
-    xSemaphoreTake(s_ipc_ack[cpu_id], portMAX_DELAY);
-    s_func[cpu_id] = NULL;
-#ifdef CONFIG_ESP_IPC_USES_CALLERS_PRIORITY
-    xSemaphoreGive(s_ipc_mutex[cpu_id]);
-#else
-    xSemaphoreGive(s_ipc_mutex[0]);
+        .priority = uxTaskPriorityGet(NULL),
 #endif
+    };
+    ipc_queue_call(cpu_id, &call, true);
+    xSemaphoreTake(call.ack, portMAX_DELAY);
+    vSemaphoreDelete(call.ack);
     return ESP_OK;
 }
 
@@ -165,39 +241,35 @@ esp_err_t esp_ipc_call_blocking(uint32_t cpu_id, esp_ipc_func_t func, void* arg)
     return esp_ipc_call_and_wait(cpu_id, func, arg, IPC_WAIT_FOR_END);
 }
 
-// currently this is only called from gcov component
-#if CONFIG_APPTRACE_GCOV_ENABLE
-esp_err_t esp_ipc_start_gcov_from_isr(uint32_t cpu_id, esp_ipc_func_t func, void* arg)
+esp_err_t esp_ipc_call_nonblocking(uint32_t cpu_id, esp_ipc_func_t func, void* arg)
 {
-    portBASE_TYPE ret = pdFALSE;
-
+    if (cpu_id >= portNUM_PROCESSORS) {
+        return ESP_ERR_INVALID_ARG;
+    }
     if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    /* Lock IPC to avoid interferring with normal IPC calls, e.g.
-       avoid situation when esp_ipc_start_gcov_from_isr() is called from IRQ
-       in the middle of IPC call between `s_func` and `s_func_arg` modification. See esp_ipc_call_and_wait() */
+    ipc_call_t call = {
+        .func = func,
+        .arg = arg,
+        .wait_for = IPC_NO_WAIT,
+        .ack = NULL,
 #ifdef CONFIG_ESP_IPC_USES_CALLERS_PRIORITY
-    ret = xSemaphoreTakeFromISR(s_ipc_mutex[cpu_id], NULL);
-#else
-    ret = xSemaphoreTakeFromISR(s_ipc_mutex[0], NULL);
-#endif
-    if (ret != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
-    }
-
-    s_gcov_func = func;
-    s_gcov_func_arg = arg;
-    ret = xSemaphoreGiveFromISR(s_ipc_sem[cpu_id], NULL);
-
-#ifdef CONFIG_ESP_IPC_USES_CALLERS_PRIORITY
-    xSemaphoreGiveFromISR(s_ipc_mutex[cpu_id], NULL);
-#else
-    xSemaphoreGiveFromISR(s_ipc_mutex[0], NULL);
+        // Calls from an ISR can't adjust the priority of the IPC task beforehand, so they run at the highest one
+        .priority = xPortInIsrContext() ? configMAX_PRIORITIES - 1 : uxTaskPriorityGet(NULL),
 #endif
+    };
+    return ipc_queue_call(cpu_id, &call, false);
+}
 
-    return ret == pdTRUE ? ESP_OK : ESP_FAIL;
+// currently this is only called from gcov component
+#if CONFIG_APPTRACE_GCOV_ENABLE
+esp_err_t esp_ipc_start_gcov_from_isr(uint32_t cpu_id, esp_ipc_func_t func, void* arg)
+{
+    /* The gcov dump starter is queued like any other call, so it can't interfere
+       with the IPC calls which are already pending or running. */
+    return esp_ipc_call_nonblocking(cpu_id, func, arg);
 }
 #endif // CONFIG_APPTRACE_GCOV_ENABLE
 
@@ -25,7 +25,8 @@ extern "C" {
 /**
  * @brief IPC Callback
  *
- * A callback of this type should be provided as an argument when calling esp_ipc_call() or esp_ipc_call_blocking().
+ * A callback of this type should be provided as an argument when calling esp_ipc_call(), esp_ipc_call_blocking() or
+ * esp_ipc_call_nonblocking().
  */
 typedef void (*esp_ipc_func_t)(void* arg);
 
@@ -36,7 +37,8 @@ typedef void (*esp_ipc_func_t)(void* arg);
  * the context of the target CPU's IPC task.
  *
  * - This function will block the target CPU's IPC task has begun execution of the callback
- * - If another IPC call is ongoing, this function will block until the ongoing IPC call completes
+ * - If other IPC calls to the same CPU are pending, the callback is run after them. Up to
+ *   CONFIG_ESP_IPC_QUEUE_LENGTH calls can be pending per CPU, this function blocks while that queue is full
  * - The stack size of the IPC task can be configured via the CONFIG_ESP_IPC_TASK_STACK_SIZE option
  *
  * @note In single-core mode, returns ESP_ERR_INVALID_ARG for cpu_id 1.
@@ -72,6 +74,26 @@ esp_err_t esp_ipc_call(uint32_t cpu_id, esp_ipc_func_t func, void* arg);
  */
 esp_err_t esp_ipc_call_blocking(uint32_t cpu_id, esp_ipc_func_t func, void* arg);
 
+/**
+ * @brief Execute a callback on a given CPU without waiting for it
+ *
+ * The callback is added to the queue of pending calls of the target CPU's IPC task and this function returns
+ * immediately, without waiting for the callback to start or complete. The caller must make sure that the memory
+ * pointed to by arg remains valid until the callback runs. This function can also be called from an ISR.
+ *
+ * @note    In single-core mode, returns ESP_ERR_INVALID_ARG for cpu_id 1.
+ *
+ * @param[in]   cpu_id  CPU where the given function should be executed (0 or 1)
+ * @param[in]   func    Pointer to a function of type void func(void* arg) to be executed
+ * @param[in]   arg     Arbitrary argument of type void* to be passed into the function
+ *
+ * @return
+ *      - ESP_ERR_INVALID_ARG if cpu_id is invalid
+ *      - ESP_ERR_INVALID_STATE if the FreeRTOS scheduler is not running or the queue of pending calls is full
+ *      - ESP_OK otherwise
+ */
+esp_err_t esp_ipc_call_nonblocking(uint32_t cpu_id, esp_ipc_func_t func, void* arg);
+
 #endif // !defined(CONFIG_FREERTOS_UNICORE) || defined(CONFIG_APPTRACE_GCOV_ENABLE)
 
 #ifdef __cplusplus
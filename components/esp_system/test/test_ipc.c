@@ -15,6 +15,8 @@
 #endif
 #include "esp_log.h"
 #include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "test_utils.h"
 
 #if !CONFIG_FREERTOS_UNICORE
 static void test_func_ipc_cb(void *arg)
@@ -31,6 +33,91 @@ TEST_CASE("Test blocking IPC function call", "[ipc]")
     TEST_ASSERT_EQUAL_HEX(val, 0xa5a5);
 }
 
+static void test_func_ipc_count_cb(void *arg)
+{
+    (*(int *)arg)++;
+}
+
+TEST_CASE("Test non-blocking IPC function call", "[ipc]")
+{
+    int val = 0x5a5a;
+    int count = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_ipc_call(!xPortGetCoreID(), test_func_ipc_cb, &val));
+
+    // The other CPU's IPC task is busy, calls are queued until the queue is full
+    int queued = 0;
+    while (esp_ipc_call_nonblocking(!xPortGetCoreID(), test_func_ipc_count_cb, &count) == ESP_OK) {
+        queued++;
+    }
+    TEST_ASSERT_EQUAL(CONFIG_ESP_IPC_QUEUE_LENGTH, queued);
+
+    // Calls are run in order, so all queued ones are done when a blocking one returns
+    esp_ipc_call_blocking(!xPortGetCoreID(), test_func_ipc_count_cb, &count);
+    TEST_ASSERT_EQUAL_HEX(val, 0xa5a5);
+    TEST_ASSERT_EQUAL(queued + 1, count);
+}
+
+static TaskHandle_t s_ipc_notified_task;
+
+static void test_func_ipc_notify_cb(void *arg)
+{
+    s_ipc_notified_task = xTaskGetCurrentTaskHandle();
+    *(uint32_t *)arg = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+}
+
+TEST_CASE("Test IPC function waiting for a task notification", "[ipc]")
+{
+    volatile uint32_t notified = 0;
+    int count = 0;
+    s_ipc_notified_task = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_ipc_call(!xPortGetCoreID(), test_func_ipc_notify_cb, (void *)&notified));
+    while (s_ipc_notified_task == NULL) {
+        vTaskDelay(1);
+    }
+    // Queueing a call must not wake up the IPC function, and the notification must not be taken by the IPC task
+    TEST_ASSERT_EQUAL(ESP_OK, esp_ipc_call_nonblocking(!xPortGetCoreID(), test_func_ipc_count_cb, &count));
+    vTaskDelay(10);
+    TEST_ASSERT_EQUAL(0, notified);
+    xTaskNotifyGive(s_ipc_notified_task);
+
+    esp_ipc_call_blocking(!xPortGetCoreID(), test_func_ipc_count_cb, &count);
+    TEST_ASSERT_EQUAL(1, notified);
+    TEST_ASSERT_EQUAL(2, count);
+}
+
+#define IPC_CALLS_PER_TASK 2000
+
+static void test_func_ipc_nop_cb(void *arg)
+{
+}
+
+static void ipc_caller_task(void *arg)
+{
+    for (int i = 0; i < IPC_CALLS_PER_TASK; i++) {
+        esp_ipc_call_blocking(!xPortGetCoreID(), test_func_ipc_nop_cb, NULL);
+    }
+    xSemaphoreGive((SemaphoreHandle_t)arg);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("Test concurrent IPC function calls", "[ipc]")
+{
+    const int num_tasks = 4;
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(num_tasks, 0);
+    TEST_ASSERT_NOT_NULL(done);
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < num_tasks; i++) {
+        xTaskCreatePinnedToCore(ipc_caller_task, "caller", 2048, done, UNITY_FREERTOS_PRIORITY - 1, NULL, i % portNUM_PROCESSORS);
+    }
+    for (int i = 0; i < num_tasks; i++) {
+        TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(done, pdMS_TO_TICKS(10000)));
+    }
+    int64_t elapsed_us = esp_timer_get_time() - start;
+    IDF_LOG_PERFORMANCE("IPC calls per second", "%lld, tasks: %d", (long long)num_tasks * IPC_CALLS_PER_TASK * 1000000 / elapsed_us, num_tasks);
+    vSemaphoreDelete(done);
+}
+
 #ifdef CONFIG_ESP_IPC_USES_CALLERS_PRIORITY
 static volatile bool exit_flag;
 
@@ -81,6 +168,41 @@ TEST_CASE("Test ipc_task works with the priority of the caller's task", "[ipc]")
     TEST_ASSERT_EQUAL(priority, func_ipc_priority);
 }
 
+static volatile bool s_ipc_release;
+
+static void test_func_ipc_wait_cb(void *arg)
+{
+    while (!s_ipc_release) {
+        esp_rom_delay_us(100);
+    }
+}
+
+static void test_func_ipc_priority_cb(void *arg)
+{
+    *(UBaseType_t *)arg = uxTaskPriorityGet(NULL);
+}
+
+TEST_CASE("Test ipc_task keeps the priority of a higher priority caller queued behind", "[ipc]")
+{
+    UBaseType_t priority = uxTaskPriorityGet(NULL);
+    UBaseType_t low_call_priority = 0;
+    UBaseType_t high_call_priority = 0;
+
+    s_ipc_release = false;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_ipc_call(!xPortGetCoreID(), test_func_ipc_wait_cb, NULL));
+    vTaskPrioritySet(NULL, 2);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_ipc_call_nonblocking(!xPortGetCoreID(), test_func_ipc_priority_cb, &low_call_priority));
+    vTaskPrioritySet(NULL, 18);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_ipc_call_nonblocking(!xPortGetCoreID(), test_func_ipc_priority_cb, &high_call_priority));
+    s_ipc_release = true;
+    esp_ipc_call_blocking(!xPortGetCoreID(), test_func_ipc_nop_cb, NULL);
+    vTaskPrioritySet(NULL, priority);
+
+    // The low priority call is run while the high priority one is waiting, so it is run at the higher priority
+    TEST_ASSERT_EQUAL(18, low_call_priority);
+    TEST_ASSERT_EQUAL(18, high_call_priority);
+}
+
 static void test_func2_ipc(void *arg)
 {
     int callers_priority = *(int *)arg;
@@ -1,10 +1,12 @@
 /*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
 #include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
 #include "diskio_impl.h"
 #include "ffconf.h"
 #include "ff.h"
@@ -29,11 +31,9 @@ DSTATUS ff_wl_status (BYTE pdrv)
     return 0;
 }
 
-DRESULT ff_wl_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+static DRESULT wl_read_sectors(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
 {
-    ESP_LOGV(TAG, "ff_wl_read - pdrv=%i, sector=%i, count=%i\n", (unsigned int)pdrv, (unsigned int)sector, (unsigned int)count);
     wl_handle_t wl_handle = ff_wl_handles[pdrv];
-    assert(wl_handle + 1);
     esp_err_t err = wl_read(wl_handle, sector * wl_sector_size(wl_handle), buff, count * wl_sector_size(wl_handle));
     if (unlikely(err != ESP_OK)) {
         ESP_LOGE(TAG, "wl_read failed (%d)", err);
@@ -42,11 +42,9 @@ DRESULT ff_wl_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
     return RES_OK;
 }
 
-DRESULT ff_wl_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+static DRESULT wl_write_sectors(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
 {
-    ESP_LOGV(TAG, "ff_wl_write - pdrv=%i, sector=%i, count=%i\n", (unsigned int)pdrv, (unsigned int)sector, (unsigned int)count);
     wl_handle_t wl_handle = ff_wl_handles[pdrv];
-    assert(wl_handle + 1);
     esp_err_t err = wl_erase_range(wl_handle, sector * wl_sector_size(wl_handle), count * wl_sector_size(wl_handle));
     if (unlikely(err != ESP_OK)) {
         ESP_LOGE(TAG, "wl_erase_range failed (%d)", err);
@@ -60,6 +58,225 @@ DRESULT ff_wl_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
     return RES_OK;
 }
 
+#if CONFIG_FATFS_WL_SECTOR_CACHE_SIZE > 0
+
+#define SECTOR_INVALID  ((DWORD) -1)
+
+/* Sectors of one volume, shared by all of its files. No locking is needed:
+ * FATFS serializes all disk accesses to a volume.
+ */
+typedef struct {
+    DWORD sector;           // sector held by this entry, or SECTOR_INVALID
+    uint32_t last_use;      // value of use_counter when the entry was last used
+    bool dirty;             // written by FATFS, not yet written to flash
+} wl_cache_entry_t;
+
+typedef struct {
+    size_t sector_size;
+    uint32_t use_counter;
+    wl_cache_entry_t entries[CONFIG_FATFS_WL_SECTOR_CACHE_SIZE];
+    uint8_t data[];         // CONFIG_FATFS_WL_SECTOR_CACHE_SIZE * sector_size bytes
+} wl_sector_cache_t;
+
+static wl_sector_cache_t *s_sector_caches[FF_VOLUMES];
+
+static inline uint8_t *cache_data(wl_sector_cache_t *cache, int entry)
+{
+    return cache->data + entry * cache->sector_size;
+}
+
+static int cache_find(wl_sector_cache_t *cache, DWORD sector)
+{
+    for (int i = 0; i < CONFIG_FATFS_WL_SECTOR_CACHE_SIZE; i++) {
+        if (cache->entries[i].sector == sector) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static DRESULT cache_write_back(BYTE pdrv, wl_sector_cache_t *cache, int entry)
+{
+    wl_cache_entry_t *e = &cache->entries[entry];
+    if (e->sector == SECTOR_INVALID || !e->dirty) {
+        return RES_OK;
+    }
+    DRESULT res = wl_write_sectors(pdrv, cache_data(cache, entry), e->sector, 1);
+    if (res == RES_OK) {
+        e->dirty = false;
+    }
+    return res;
+}
+
+/* Return the entry holding the given sector, evicting the least recently used one if not cached.
+ * The contents of an evicted entry are not loaded, the caller either reads or overwrites them.
+ */
+static int cache_get_entry(BYTE pdrv, wl_sector_cache_t *cache, DWORD sector, bool *out_hit)
+{
+    int entry = cache_find(cache, sector);
+    *out_hit = (entry >= 0);
+    if (entry < 0) {
+        entry = 0;
+        for (int i = 0; i < CONFIG_FATFS_WL_SECTOR_CACHE_SIZE; i++) {
+            if (cache->entries[i].sector == SECTOR_INVALID) {
+                entry = i;
+                break;
+            }
+            if (cache->entries[i].last_use < cache->entries[entry].last_use) {
+                entry = i;
+            }
+        }
+        if (cache_write_back(pdrv, cache, entry) != RES_OK) {
+            return -1;
+        }
+        cache->entries[entry].sector = SECTOR_INVALID;
+    }
+    cache->entries[entry].last_use = ++cache->use_counter;
+    return entry;
+}
+
+static DRESULT cache_flush(BYTE pdrv, wl_sector_cache_t *cache)
+{
+    DRESULT res = RES_OK;
+    for (int i = 0; i < CONFIG_FATFS_WL_SECTOR_CACHE_SIZE; i++) {
+        if (cache_write_back(pdrv, cache, i) != RES_OK) {
+            res = RES_ERROR;
+        }
+    }
+    return res;
+}
+
+/* Write back the dirty sectors and release the cache. Must be called while the WL handle of pdrv is still mounted. */
+static void cache_free(BYTE pdrv)
+{
+    wl_sector_cache_t *cache = s_sector_caches[pdrv];
+    if (cache == NULL) {
+        return;
+    }
+    if (cache_flush(pdrv, cache) != RES_OK) {
+        ESP_LOGE(TAG, "failed to write cached sectors of pdrv %d", pdrv);
+    }
+    free(cache);
+    s_sector_caches[pdrv] = NULL;
+}
+
+/* Release a cache left over by a drive which was not cleared with ff_diskio_clear_pdrv_wl.
+ * Its WL handle may be unmounted already, so the dirty sectors can't be written back.
+ */
+static void cache_discard(BYTE pdrv)
+{
+    wl_sector_cache_t *cache = s_sector_caches[pdrv];
+    if (cache == NULL) {
+        return;
+    }
+    int dirty = 0;
+    for (int i = 0; i < CONFIG_FATFS_WL_SECTOR_CACHE_SIZE; i++) {
+        if (cache->entries[i].sector != SECTOR_INVALID && cache->entries[i].dirty) {
+            dirty++;
+        }
+    }
+    if (dirty > 0) {
+        ESP_LOGE(TAG, "pdrv %d re-registered without ff_diskio_clear_pdrv_wl, %d cached sectors lost", pdrv, dirty);
+    }
+    free(cache);
+    s_sector_caches[pdrv] = NULL;
+}
+
+static esp_err_t cache_alloc(BYTE pdrv, wl_handle_t wl_handle)
+{
+    const size_t sector_size = wl_sector_size(wl_handle);
+    wl_sector_cache_t *cache = calloc(1, sizeof(wl_sector_cache_t) + CONFIG_FATFS_WL_SECTOR_CACHE_SIZE * sector_size);
+    if (cache == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    cache->sector_size = sector_size;
+    for (int i = 0; i < CONFIG_FATFS_WL_SECTOR_CACHE_SIZE; i++) {
+        cache->entries[i].sector = SECTOR_INVALID;
+    }
+    s_sector_caches[pdrv] = cache;
+    return ESP_OK;
+}
+
+#endif // CONFIG_FATFS_WL_SECTOR_CACHE_SIZE > 0
+
+DRESULT ff_wl_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+    ESP_LOGV(TAG, "ff_wl_read - pdrv=%i, sector=%i, count=%i\n", (unsigned int)pdrv, (unsigned int)sector, (unsigned int)count);
+    assert(ff_wl_handles[pdrv] + 1);
+#if CONFIG_FATFS_WL_SECTOR_CACHE_SIZE > 0
+    wl_sector_cache_t *cache = s_sector_caches[pdrv];
+    if (cache != NULL) {
+        if (count == 1) {
+            bool hit;
+            int entry = cache_get_entry(pdrv, cache, sector, &hit);
+            if (entry < 0) {
+                return RES_ERROR;
+            }
+            if (!hit) {
+                DRESULT res = wl_read_sectors(pdrv, cache_data(cache, entry), sector, 1);
+                if (res != RES_OK) {
+                    return res;
+                }
+                cache->entries[entry].sector = sector;
+                cache->entries[entry].dirty = false;
+            }
+            memcpy(buff, cache_data(cache, entry), cache->sector_size);
+            return RES_OK;
+        }
+        // read the whole range at once, then patch in the cached sectors not written to flash yet
+        DRESULT res = wl_read_sectors(pdrv, buff, sector, count);
+        if (res != RES_OK) {
+            return res;
+        }
+        for (int i = 0; i < CONFIG_FATFS_WL_SECTOR_CACHE_SIZE; i++) {
+            const wl_cache_entry_t *e = &cache->entries[i];
+            if (e->dirty && e->sector >= sector && e->sector < sector + count) {
+                memcpy(buff + (e->sector - sector) * cache->sector_size, cache_data(cache, i), cache->sector_size);
+            }
+        }
+        return RES_OK;
+    }
+#endif
+    return wl_read_sectors(pdrv, buff, sector, count);
+}
+
+DRESULT ff_wl_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+    ESP_LOGV(TAG, "ff_wl_write - pdrv=%i, sector=%i, count=%i\n", (unsigned int)pdrv, (unsigned int)sector, (unsigned int)count);
+    assert(ff_wl_handles[pdrv] + 1);
+#if CONFIG_FATFS_WL_SECTOR_CACHE_SIZE > 0
+    wl_sector_cache_t *cache = s_sector_caches[pdrv];
+    if (cache != NULL) {
+        if (count == 1) {
+            // the whole sector is overwritten, no need to read it first
+            bool hit;
+            int entry = cache_get_entry(pdrv, cache, sector, &hit);
+            if (entry < 0) {
+                return RES_ERROR;
+            }
+            memcpy(cache_data(cache, entry), buff, cache->sector_size);
+            cache->entries[entry].sector = sector;
+            cache->entries[entry].dirty = true;
+            return RES_OK;
+        }
+        DRESULT res = wl_write_sectors(pdrv, buff, sector, count);
+        if (res != RES_OK) {
+            return res;
+        }
+        // cached copies of the written sectors are stale now, and must not be written back
+        for (int i = 0; i < CONFIG_FATFS_WL_SECTOR_CACHE_SIZE; i++) {
+            wl_cache_entry_t *e = &cache->entries[i];
+            if (e->sector != SECTOR_INVALID && e->sector >= sector && e->sector < sector + count) {
+                e->sector = SECTOR_INVALID;
+                e->dirty = false;
+            }
+        }
+        return RES_OK;
+    }
+#endif
+    return wl_write_sectors(pdrv, buff, sector, count);
+}
+
 DRESULT ff_wl_ioctl (BYTE pdrv, BYTE cmd, void *buff)
 {
     wl_handle_t wl_handle = ff_wl_handles[pdrv];
@@ -67,6 +284,11 @@ DRESULT ff_wl_ioctl (BYTE pdrv, BYTE cmd, void *buff)
     assert(wl_handle + 1);
     switch (cmd) {
     case CTRL_SYNC:
+#if CONFIG_FATFS_WL_SECTOR_CACHE_SIZE > 0
+        if (s_sector_caches[pdrv] != NULL) {
+            return cache_flush(pdrv, s_sector_caches[pdrv]);
+        }
+#endif
         return RES_OK;
     case GET_SECTOR_COUNT:
         *((DWORD *) buff) = wl_size(wl_handle) / wl_sector_size(wl_handle);
@@ -93,6 +315,13 @@ esp_err_t ff_diskio_register_wl_partition(BYTE pdrv, wl_handle_t flash_handle)
         .write = &ff_wl_write,
         .ioctl = &ff_wl_ioctl
     };
+#if CONFIG_FATFS_WL_SECTOR_CACHE_SIZE > 0
+    cache_discard(pdrv);
+    esp_err_t err = cache_alloc(pdrv, flash_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+#endif
     ff_wl_handles[pdrv] = flash_handle;
     ff_diskio_register(pdrv, &wl_impl);
     return ESP_OK;
@@ -112,6 +341,10 @@ void ff_diskio_clear_pdrv_wl(wl_handle_t flash_handle)
 {
     for (int i = 0; i < FF_VOLUMES; i++) {
         if (flash_handle == ff_wl_handles[i]) {
+#if CONFIG_FATFS_WL_SECTOR_CACHE_SIZE > 0
+            // called before wl_unmount, so the cached sectors can still be written back
+            cache_free(i);
+#endif
             ff_wl_handles[i] = WL_INVALID_HANDLE;
         }
     }
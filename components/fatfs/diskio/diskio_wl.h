@@ -30,6 +30,15 @@ extern "C" {
  */
 esp_err_t ff_diskio_register_wl_partition(unsigned char pdrv, wl_handle_t flash_handle);
 unsigned char ff_diskio_get_pdrv_wl(wl_handle_t flash_handle);
+
+/**
+ * Clear the drive using a wear levelling partition
+ *
+ * Sectors still held by the sector cache (CONFIG_FATFS_WL_SECTOR_CACHE_SIZE) are written to the partition,
+ * so this must be called before wl_unmount.
+ *
+ * @param flash_handle  handle of the wear levelling partition.
+ */
 void ff_diskio_clear_pdrv_wl(wl_handle_t flash_handle);
 
 #ifdef __cplusplus
@@ -13,3 +13,4 @@
 #define CONFIG_SPI_FLASH_USE_LEGACY_IMPL 1
 
 #define CONFIG_FATFS_VOLUME_COUNT 2
+#define CONFIG_FATFS_WL_SECTOR_CACHE_SIZE 4
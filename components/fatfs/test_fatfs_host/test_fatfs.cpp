@@ -10,6 +10,7 @@
 #include "catch.hpp"
 
 extern "C" void _spi_flash_init(const char* chip_size, size_t block_size, size_t sector_size, size_t page_size, const char* partition_bin);
+extern "C" int spi_flash_get_total_erase_cycles(void);
 
 TEST_CASE("create volume, open file, write and read back data", "[fatfs]")
 {
@@ -92,3 +93,125 @@ TEST_CASE("create volume, open file, write and read back data", "[fatfs]")
     free(read);
     free(data);
 }
+
+TEST_CASE("write and read back two files alternately through the shared sector cache", "[fatfs]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    FRESULT fr_result;
+    BYTE pdrv;
+    FATFS fs;
+    FIL files[2];
+    char names[2][16];
+    UINT bw;
+
+    esp_err_t esp_result;
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, "storage");
+
+    wl_handle_t wl_handle;
+    esp_result = wl_mount(partition, &wl_handle);
+    REQUIRE(esp_result == ESP_OK);
+
+    esp_result = ff_diskio_get_drive(&pdrv);
+    REQUIRE(esp_result == ESP_OK);
+
+    esp_result = ff_diskio_register_wl_partition(pdrv, wl_handle);
+    REQUIRE(esp_result == ESP_OK);
+
+    char drv[3] = {(char)('0' + pdrv), ':', 0};
+    snprintf(names[0], sizeof(names[0]), "%s/a.txt", drv);
+    snprintf(names[1], sizeof(names[1]), "%s/b.txt", drv);
+    BYTE work_area[FF_MAX_SS];
+    const MKFS_PARM opt = {(BYTE)FM_ANY, 0, 0, 0, 0};
+    fr_result = f_mkfs(drv, &opt, work_area, sizeof(work_area));
+    REQUIRE(fr_result == FR_OK);
+
+    fr_result = f_mount(&fs, drv, 0);
+    REQUIRE(fr_result == FR_OK);
+
+    for (int f = 0; f < 2; f++) {
+        fr_result = f_open(&files[f], names[f], FA_CREATE_ALWAYS | FA_READ | FA_WRITE);
+        REQUIRE(fr_result == FR_OK);
+    }
+
+    // Small writes, alternating between the files, which share the volume's sector buffer.
+    // Without the sector cache, every switch between the files writes a sector back to the simulated flash.
+    const int erases_before = spi_flash_get_total_erase_cycles();
+    const int chunk_count = 2000;
+    char chunk[37];
+    for (int i = 0; i < chunk_count; i++) {
+        for (int f = 0; f < 2; f++) {
+            memset(chunk, (f ? 'A' : 'a') + i % 26, sizeof(chunk));
+            fr_result = f_write(&files[f], chunk, sizeof(chunk), &bw);
+            REQUIRE(fr_result == FR_OK);
+            REQUIRE(bw == sizeof(chunk));
+        }
+    }
+
+    // A write spanning several sectors goes around the cache
+    const uint32_t big_size = CONFIG_WL_SECTOR_SIZE * 5 + 17;
+    char *big = (char*) malloc(big_size);
+    char *read = (char*) malloc(big_size);
+    for (uint32_t i = 0; i < big_size; i++) {
+        big[i] = (char) (i * 13);
+    }
+    fr_result = f_write(&files[0], big, big_size, &bw);
+    REQUIRE(fr_result == FR_OK);
+    REQUIRE(bw == big_size);
+
+    for (int f = 0; f < 2; f++) {
+        fr_result = f_close(&files[f]);
+        REQUIRE(fr_result == FR_OK);
+    }
+    // including the sectors written back when closing the files
+    const int erases = spi_flash_get_total_erase_cycles() - erases_before;
+#if CONFIG_FATFS_WL_SECTOR_CACHE_SIZE > 0
+    REQUIRE(erases < chunk_count / 10);
+#else
+    REQUIRE(erases >= chunk_count);
+#endif
+
+    // Remount, so that everything is read back from flash
+    fr_result = f_mount(0, drv, 0);
+    REQUIRE(fr_result == FR_OK);
+    ff_diskio_unregister(pdrv);
+    ff_diskio_clear_pdrv_wl(wl_handle);
+    esp_result = ff_diskio_register_wl_partition(pdrv, wl_handle);
+    REQUIRE(esp_result == ESP_OK);
+    fr_result = f_mount(&fs, drv, 1);
+    REQUIRE(fr_result == FR_OK);
+
+    for (int f = 0; f < 2; f++) {
+        fr_result = f_open(&files[f], names[f], FA_READ);
+        REQUIRE(fr_result == FR_OK);
+    }
+    char expected[sizeof(chunk)];
+    for (int i = 0; i < chunk_count; i++) {
+        for (int f = 0; f < 2; f++) {
+            memset(expected, (f ? 'A' : 'a') + i % 26, sizeof(expected));
+            fr_result = f_read(&files[f], chunk, sizeof(chunk), &bw);
+            REQUIRE(fr_result == FR_OK);
+            REQUIRE(bw == sizeof(chunk));
+            REQUIRE(memcmp(chunk, expected, sizeof(chunk)) == 0);
+        }
+    }
+    fr_result = f_read(&files[0], read, big_size, &bw);
+    REQUIRE(fr_result == FR_OK);
+    REQUIRE(bw == big_size);
+    REQUIRE(memcmp(big, read, big_size) == 0);
+
+    for (int f = 0; f < 2; f++) {
+        fr_result = f_close(&files[f]);
+        REQUIRE(fr_result == FR_OK);
+    }
+
+    fr_result = f_mount(0, drv, 0);
+    REQUIRE(fr_result == FR_OK);
+    ff_diskio_unregister(pdrv);
+    ff_diskio_clear_pdrv_wl(wl_handle);
+    REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+
+    free(read);
+    free(big);
+}
@@ -105,6 +105,7 @@ fail:
     free(workbuf);
     esp_vfs_fat_unregister_path(base_path);
     ff_diskio_unregister(pdrv);
+    ff_diskio_clear_pdrv_wl(*wl_handle);
     return result;
 }
 
@@ -3228,6 +3228,16 @@ eSleepModeStatus eTaskConfirmSleepModeStatus( void ) PRIVILEGED_FUNCTION;
  */
 TaskHandle_t pvTaskIncrementMutexHeldCount( void ) PRIVILEGED_FUNCTION;
 
+#ifdef ESP_PLATFORM
+/*
+ * For internal use only.  Increment the mutex held count of a task that
+ * already holds a lock the kernel does not know about, before another task
+ * calls xTaskPriorityInherit() on it.  The count is decremented again when the
+ * holder calls xTaskPriorityDisinherit() on releasing the lock.
+ */
+void vTaskIncrementMutexHeldCountOfTask( TaskHandle_t xTask ) PRIVILEGED_FUNCTION;
+#endif // ESP_PLATFORM
+
 /*
  * For internal use only.  Same as vTaskSetTimeOutState(), but without a critical
  * section.
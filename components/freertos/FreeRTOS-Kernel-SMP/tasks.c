@@ -5691,6 +5691,22 @@ TickType_t uxTaskResetEventItemValue( void )
 #endif /* configUSE_MUTEXES */
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_MUTEXES == 1 ) && defined( ESP_PLATFORM )
+
+    void vTaskIncrementMutexHeldCountOfTask( TaskHandle_t xTask )
+    {
+        TCB_t * const pxTCB = xTask;
+
+        /* Must be called from a critical section, like xTaskPriorityInherit(). */
+        if( pxTCB != NULL )
+        {
+            ( pxTCB->uxMutexesHeld )++;
+        }
+    }
+
+#endif /* ( configUSE_MUTEXES == 1 ) && defined( ESP_PLATFORM ) */
+/*-----------------------------------------------------------*/
+
 #if ( configUSE_TASK_NOTIFICATIONS == 1 )
 
     uint32_t ulTaskGenericNotifyTake( UBaseType_t uxIndexToWait,
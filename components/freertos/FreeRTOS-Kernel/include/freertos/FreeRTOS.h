@@ -305,6 +305,14 @@
         #error If configUSE_TIMERS is set to 1 then configTIMER_TASK_STACK_DEPTH must also be defined.
     #endif /* configTIMER_TASK_STACK_DEPTH */
 
+    #ifndef configUSE_TIMER_WHEEL
+        #define configUSE_TIMER_WHEEL    0
+    #endif
+
+    #if ( configUSE_TIMER_WHEEL == 1 ) && !defined( configTIMER_WHEEL_SLOTS )
+        #error If configUSE_TIMER_WHEEL is set to 1 then configTIMER_WHEEL_SLOTS must also be defined.
+    #endif
+
 #endif /* configUSE_TIMERS */
 
 #ifndef portSET_INTERRUPT_MASK_FROM_ISR
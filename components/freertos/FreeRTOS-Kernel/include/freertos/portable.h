@@ -204,8 +204,14 @@ size_t xPortGetMinimumEverFreeHeapSize( void ) PRIVILEGED_FUNCTION;
  * non-FreeRTOS-specific code, and behave the same as
  * pvPortMalloc()/vPortFree().
  */
+#if CONFIG_IDF_TARGET_LINUX
+/* The Linux port wraps the libc allocator, see portable/linux/port.c */
+void * pvPortMalloc( size_t xSize );
+void vPortFree( void * pv );
+#else
 #define pvPortMalloc malloc
 #define vPortFree free
+#endif
 #define xPortGetFreeHeapSize esp_get_free_heap_size
 #define xPortGetMinimumEverFreeHeapSize esp_get_minimum_free_heap_size
 
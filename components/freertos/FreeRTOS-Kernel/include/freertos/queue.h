@@ -933,6 +933,104 @@ BaseType_t xQueueReceive( QueueHandle_t xQueue,
                           void * const pvBuffer,
                           TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
 
+/**
+ * @cond !DOC_EXCLUDE_HEADER_SECTION
+ * queue. h
+ * @code{c}
+ * size_t xQueueSendMultiple(
+ *                              QueueHandle_t xQueue,
+ *                              const void *pvItemsToQueue,
+ *                              size_t xItemCount,
+ *                              TickType_t xTicksToWait
+ *                          );
+ * @endcode
+ * @endcond
+ *
+ * Post several items to the back of a queue.  This has the same effect as
+ * calling xQueueSendToBack() for each item, but the items are copied and the
+ * tasks waiting for them are woken up in one critical section for as many
+ * items as the queue has room for, instead of one critical section per item.
+ *
+ * Items are copied in order.  If the queue can't hold all of them, the task
+ * blocks until space becomes available and then posts the remaining items.
+ *
+ * This function must not be used in an interrupt service routine.  See
+ * xQueueSendMultipleFromISR() for an alternative which may be used in an ISR.
+ * It can't be used with semaphores and mutexes.
+ *
+ * @param xQueue The handle to the queue on which the items are to be posted.
+ *
+ * @param pvItemsToQueue A pointer to an array of xItemCount items.  The size of
+ * the items was defined when the queue was created.
+ *
+ * @param xItemCount The number of items to post.
+ *
+ * @param xTicksToWait The maximum total amount of time the task should block
+ * waiting for space to become available on the queue.  The call will return
+ * immediately if the queue is full and xTicksToWait is set to 0.
+ *
+ * @return The number of items that were posted.  This is less than xItemCount
+ * only if the block time expired.
+ *
+ * @cond !DOC_SINGLE_GROUP
+ * \defgroup xQueueSendMultiple xQueueSendMultiple
+ * @endcond
+ * \ingroup QueueManagement
+ */
+size_t xQueueSendMultiple( QueueHandle_t xQueue,
+                           const void * const pvItemsToQueue,
+                           size_t xItemCount,
+                           TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/**
+ * @cond !DOC_EXCLUDE_HEADER_SECTION
+ * queue. h
+ * @code{c}
+ * size_t xQueueReceiveMultiple(
+ *                              QueueHandle_t xQueue,
+ *                              void *pvBuffer,
+ *                              size_t xMaxItemCount,
+ *                              TickType_t xTicksToWait
+ *                          );
+ * @endcode
+ * @endcond
+ *
+ * Receive up to xMaxItemCount items from a queue in one critical section.
+ * The items are received by copy, in the order they were posted, and removed
+ * from the queue.  Up to one task waiting to post to the queue is woken up for
+ * each item received.
+ *
+ * The task only blocks while the queue is empty: as soon as at least one item
+ * is available, the call returns with the items available at that time.
+ *
+ * This function must not be used in an interrupt service routine.  It can't be
+ * used with semaphores and mutexes.
+ *
+ * @param xQueue The handle to the queue from which the items are to be
+ * received.
+ *
+ * @param pvBuffer Pointer to a buffer with room for xMaxItemCount items.
+ *
+ * @param xMaxItemCount The maximum number of items to receive.
+ *
+ * @param xTicksToWait The maximum amount of time the task should block
+ * waiting for an item to receive should the queue be empty at the time
+ * of the call.  The call will return immediately if xTicksToWait is zero and
+ * the queue is empty.
+ *
+ * @return The number of items copied into pvBuffer, 0 if the block time
+ * expired before an item became available.
+ *
+ * @cond !DOC_SINGLE_GROUP
+ * \defgroup xQueueReceiveMultiple xQueueReceiveMultiple
+ * @endcond
+ * \ingroup QueueManagement
+ */
+size_t xQueueReceiveMultiple( QueueHandle_t xQueue,
+                              void * const pvBuffer,
+                              size_t xMaxItemCount,
+                              TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
 /**
  * @cond !DOC_EXCLUDE_HEADER_SECTION
  * queue. h
@@ -1319,6 +1417,47 @@ void vQueueDelete( QueueHandle_t xQueue ) PRIVILEGED_FUNCTION;
 #define xQueueSendFromISR( xQueue, pvItemToQueue, pxHigherPriorityTaskWoken ) \
     xQueueGenericSendFromISR( ( xQueue ), ( pvItemToQueue ), ( pxHigherPriorityTaskWoken ), queueSEND_TO_BACK )
 
+/**
+ * @cond !DOC_EXCLUDE_HEADER_SECTION
+ * queue. h
+ * @code{c}
+ * size_t xQueueSendMultipleFromISR(
+ *                                      QueueHandle_t xQueue,
+ *                                      const void *pvItemsToQueue,
+ *                                      size_t xItemCount,
+ *                                      BaseType_t *pxHigherPriorityTaskWoken
+ *                                  );
+ * @endcode
+ * @endcond
+ *
+ * Version of xQueueSendMultiple() that can be called from an ISR, for example
+ * to post all the data read out of a peripheral's FIFO at once.  As many items
+ * as the queue has room for are posted, the rest are dropped.
+ *
+ * @param xQueue The handle to the queue on which the items are to be posted.
+ *
+ * @param pvItemsToQueue A pointer to an array of xItemCount items.
+ *
+ * @param xItemCount The number of items to post.
+ *
+ * @param[out] pxHigherPriorityTaskWoken xQueueSendMultipleFromISR() will set
+ * *pxHigherPriorityTaskWoken to pdTRUE if posting the items caused a task to
+ * unblock, and the unblocked task has a priority higher than the currently
+ * running task.  In that case a context switch should be requested before the
+ * interrupt is exited.
+ *
+ * @return The number of items that were posted.
+ *
+ * @cond !DOC_SINGLE_GROUP
+ * \defgroup xQueueSendMultipleFromISR xQueueSendMultipleFromISR
+ * @endcond
+ * \ingroup QueueManagement
+ */
+size_t xQueueSendMultipleFromISR( QueueHandle_t xQueue,
+                                  const void * const pvItemsToQueue,
+                                  size_t xItemCount,
+                                  BaseType_t * const pxHigherPriorityTaskWoken ) PRIVILEGED_FUNCTION;
+
 /** @cond !DOC_EXCLUDE_HEADER_SECTION */
 /**@{*/
 /**
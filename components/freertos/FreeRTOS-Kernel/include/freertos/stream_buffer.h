@@ -624,6 +624,246 @@ size_t xStreamBufferReceiveFromISR( StreamBufferHandle_t xStreamBuffer,
                                     size_t xBufferLengthBytes,
                                     BaseType_t * const pxHigherPriorityTaskWoken ) PRIVILEGED_FUNCTION;
 
+/**
+ * A contiguous region of a stream buffer's storage area, as returned by
+ * xStreamBufferReserve() and xStreamBufferPeekSpans().  The data in a stream
+ * buffer can wrap around the end of the storage area, so these functions
+ * return up to two spans.  An unused span has xLength set to 0.
+ */
+typedef struct StreamBufferSpan
+{
+    uint8_t * pucData; /**< Start of the span within the storage area. */
+    size_t xLength;    /**< Length of the span in bytes. */
+} StreamBufferSpan_t;
+
+/**
+ * @cond !DOC_EXCLUDE_HEADER_SECTION
+ * stream_buffer.h
+ *
+ * @code{c}
+ * size_t xStreamBufferReserve( StreamBufferHandle_t xStreamBuffer,
+ *                              size_t xMaxLengthBytes,
+ *                              StreamBufferSpan_t pxSpans[ 2 ],
+ *                              TickType_t xTicksToWait );
+ * @endcode
+ * @endcond
+ *
+ * Reserves free space in a stream buffer so the data can be written directly
+ * into the buffer's storage area, for example by a DMA engine, instead of
+ * being copied in by xStreamBufferSend().  The reserved space is returned as
+ * up to two spans, the second one starting at the beginning of the storage
+ * area if the free space wraps around its end.  Once the data is written,
+ * xStreamBufferCommit() makes it available to the reader.
+ *
+ * Reserving space doesn't change the stream buffer, calling
+ * xStreamBufferReserve() again returns the same space, extended by any space
+ * freed by the reader in the meantime.
+ *
+ * Like xStreamBufferSend(), this function assumes there is a single writer.
+ * It can't be used with message buffers.  With xTicksToWait set to 0 it
+ * never blocks and may be used from an interrupt service routine.
+ *
+ * @param xStreamBuffer The handle of the stream buffer to write to.
+ *
+ * @param xMaxLengthBytes The maximum number of bytes to reserve.
+ *
+ * @param pxSpans An array of two spans which is set to the reserved space.
+ *
+ * @param xTicksToWait The maximum amount of time the task should remain in
+ * the Blocked state to wait for xMaxLengthBytes of free space (or for the
+ * whole buffer to be free, if xMaxLengthBytes is larger than the buffer).
+ *
+ * @return The number of bytes reserved, which is the total length of the
+ * spans.  This is less than xMaxLengthBytes if the block time expired before
+ * enough space became free.
+ *
+ * @cond !DOC_SINGLE_GROUP
+ * \defgroup xStreamBufferReserve xStreamBufferReserve
+ * @endcond
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferReserve( StreamBufferHandle_t xStreamBuffer,
+                             size_t xMaxLengthBytes,
+                             StreamBufferSpan_t pxSpans[ 2 ],
+                             TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/**
+ * @cond !DOC_EXCLUDE_HEADER_SECTION
+ * stream_buffer.h
+ *
+ * @code{c}
+ * size_t xStreamBufferCommit( StreamBufferHandle_t xStreamBuffer,
+ *                             size_t xLengthBytes );
+ * @endcode
+ * @endcond
+ *
+ * Adds the first xLengthBytes bytes of the space returned by
+ * xStreamBufferReserve() to the data in the stream buffer, as if they had
+ * been sent with xStreamBufferSend().  A task waiting to receive is unblocked
+ * if the trigger level is reached.
+ *
+ * Use xStreamBufferCommitFromISR() to commit from an interrupt service
+ * routine.
+ *
+ * @param xStreamBuffer The handle of the stream buffer written to.
+ *
+ * @param xLengthBytes The number of bytes written into the reserved space.
+ *
+ * @return The number of bytes added to the stream buffer.  This is
+ * xLengthBytes, unless xLengthBytes is larger than the free space in the
+ * buffer.
+ *
+ * @cond !DOC_SINGLE_GROUP
+ * \defgroup xStreamBufferCommit xStreamBufferCommit
+ * @endcond
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferCommit( StreamBufferHandle_t xStreamBuffer,
+                            size_t xLengthBytes ) PRIVILEGED_FUNCTION;
+
+/**
+ * @cond !DOC_EXCLUDE_HEADER_SECTION
+ * stream_buffer.h
+ *
+ * @code{c}
+ * size_t xStreamBufferCommitFromISR( StreamBufferHandle_t xStreamBuffer,
+ *                                    size_t xLengthBytes,
+ *                                    BaseType_t *pxHigherPriorityTaskWoken );
+ * @endcode
+ * @endcond
+ *
+ * A version of xStreamBufferCommit() that can be called from an interrupt
+ * service routine.
+ *
+ * @param xStreamBuffer The handle of the stream buffer written to.
+ *
+ * @param xLengthBytes The number of bytes written into the reserved space.
+ *
+ * @param pxHigherPriorityTaskWoken Set to pdTRUE if committing the data
+ * unblocked a task with a priority above the priority of the currently
+ * running task, in which case a context switch should be requested before the
+ * interrupt is exited.  It should be initialised to pdFALSE.
+ *
+ * @return The number of bytes added to the stream buffer.
+ *
+ * @cond !DOC_SINGLE_GROUP
+ * \defgroup xStreamBufferCommitFromISR xStreamBufferCommitFromISR
+ * @endcond
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferCommitFromISR( StreamBufferHandle_t xStreamBuffer,
+                                   size_t xLengthBytes,
+                                   BaseType_t * const pxHigherPriorityTaskWoken ) PRIVILEGED_FUNCTION;
+
+/**
+ * @cond !DOC_EXCLUDE_HEADER_SECTION
+ * stream_buffer.h
+ *
+ * @code{c}
+ * size_t xStreamBufferPeekSpans( StreamBufferHandle_t xStreamBuffer,
+ *                                StreamBufferSpan_t pxSpans[ 2 ],
+ *                                TickType_t xTicksToWait );
+ * @endcode
+ * @endcond
+ *
+ * Returns the data in a stream buffer without copying or removing it, so it
+ * can be parsed in place.  The data is returned as up to two spans of the
+ * storage area, the second one starting at the beginning of the storage area
+ * if the data wraps around its end.  xStreamBufferConsume() then removes the
+ * data that was processed.
+ *
+ * The spans remain valid until the data is consumed.  Like
+ * xStreamBufferReceive(), this function assumes there is a single reader.  It
+ * can't be used with message buffers.  With xTicksToWait set to 0 it never
+ * blocks and may be used from an interrupt service routine.
+ *
+ * @param xStreamBuffer The handle of the stream buffer to read from.
+ *
+ * @param pxSpans An array of two spans which is set to the data in the
+ * buffer.
+ *
+ * @param xTicksToWait The maximum amount of time the task should remain in
+ * the Blocked state to wait for data if the buffer is empty.
+ *
+ * @return The number of bytes available, which is the total length of the
+ * spans.  0 is returned if the block time expired before data became
+ * available.
+ *
+ * @cond !DOC_SINGLE_GROUP
+ * \defgroup xStreamBufferPeekSpans xStreamBufferPeekSpans
+ * @endcond
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferPeekSpans( StreamBufferHandle_t xStreamBuffer,
+                               StreamBufferSpan_t pxSpans[ 2 ],
+                               TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/**
+ * @cond !DOC_EXCLUDE_HEADER_SECTION
+ * stream_buffer.h
+ *
+ * @code{c}
+ * size_t xStreamBufferConsume( StreamBufferHandle_t xStreamBuffer,
+ *                              size_t xLengthBytes );
+ * @endcode
+ * @endcond
+ *
+ * Removes the first xLengthBytes bytes of the data returned by
+ * xStreamBufferPeekSpans() from the stream buffer, as if they had been
+ * received with xStreamBufferReceive().  A task waiting to send is unblocked.
+ *
+ * Use xStreamBufferConsumeFromISR() to consume from an interrupt service
+ * routine.
+ *
+ * @param xStreamBuffer The handle of the stream buffer read from.
+ *
+ * @param xLengthBytes The number of bytes to remove.
+ *
+ * @return The number of bytes removed from the stream buffer.  This is
+ * xLengthBytes, unless xLengthBytes is larger than the data in the buffer.
+ *
+ * @cond !DOC_SINGLE_GROUP
+ * \defgroup xStreamBufferConsume xStreamBufferConsume
+ * @endcond
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferConsume( StreamBufferHandle_t xStreamBuffer,
+                             size_t xLengthBytes ) PRIVILEGED_FUNCTION;
+
+/**
+ * @cond !DOC_EXCLUDE_HEADER_SECTION
+ * stream_buffer.h
+ *
+ * @code{c}
+ * size_t xStreamBufferConsumeFromISR( StreamBufferHandle_t xStreamBuffer,
+ *                                     size_t xLengthBytes,
+ *                                     BaseType_t *pxHigherPriorityTaskWoken );
+ * @endcode
+ * @endcond
+ *
+ * A version of xStreamBufferConsume() that can be called from an interrupt
+ * service routine.
+ *
+ * @param xStreamBuffer The handle of the stream buffer read from.
+ *
+ * @param xLengthBytes The number of bytes to remove.
+ *
+ * @param pxHigherPriorityTaskWoken Set to pdTRUE if consuming the data
+ * unblocked a task with a priority above the priority of the currently
+ * running task, in which case a context switch should be requested before the
+ * interrupt is exited.  It should be initialised to pdFALSE.
+ *
+ * @return The number of bytes removed from the stream buffer.
+ *
+ * @cond !DOC_SINGLE_GROUP
+ * \defgroup xStreamBufferConsumeFromISR xStreamBufferConsumeFromISR
+ * @endcond
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferConsumeFromISR( StreamBufferHandle_t xStreamBuffer,
+                                    size_t xLengthBytes,
+                                    BaseType_t * const pxHigherPriorityTaskWoken ) PRIVILEGED_FUNCTION;
+
 /**
  * @cond !DOC_EXCLUDE_HEADER_SECTION
  * stream_buffer.h
@@ -7,6 +7,21 @@
 #ifndef FREERTOS_CONFIG_LINUX_H
 #define FREERTOS_CONFIG_LINUX_H
 
-// This file is included in the common FreeRTOSConfig.h.
+// Linux (POSIX simulator) specific configuration. This file is included in the common FreeRTOSConfig.h.
+
+#include "sdkconfig.h"
+
+/* ------------------------------------------------- FreeRTOS Config ---------------------------------------------------
+ * - All Vanilla FreeRTOS configuration goes into this section
+ * ------------------------------------------------------------------------------------------------------------------ */
+
+// ------------------ Scheduler Related --------------------
+
+#ifdef CONFIG_FREERTOS_OPTIMIZED_SCHEDULER
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION             1
+#else
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION             0
+#endif
+#define configMAX_API_CALL_INTERRUPT_PRIORITY               0
 
 #endif // FREERTOS_CONFIG_LINUX_H
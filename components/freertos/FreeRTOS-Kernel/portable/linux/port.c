@@ -0,0 +1,607 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * POSIX simulator port of the FreeRTOS kernel, used on the Linux target.
+ *
+ * Every task runs in its own pthread. At any time, only the threads of the tasks selected by the scheduler as the
+ * current tasks (one per simulated core) are allowed to run, the threads of all other tasks wait on their run event.
+ * A context switch is done by the thread of the task being switched out: it hands the core over to the thread of the
+ * newly selected task and then waits until a core is handed back to it.
+ *
+ * Interrupts are simulated with a signal (PORT_INTERRUPT_SIGNAL) sent to the thread currently running on a core. The
+ * signal handler plays the role of the ISR: it processes the pending ticks and yield requests of the core and switches
+ * context if needed. Disabling interrupts only sets a thread local flag, a signal arriving while the flag is set is
+ * handled when interrupts are enabled again.
+ *
+ * Limitations:
+ * - A task may be preempted while it holds a lock internal to the C library (e.g. in stdio). Another task waiting for
+ *   such a lock blocks its whole simulated core. The port protects the allocator calls made by the kernel itself (see
+ *   pvPortMalloc()), tasks of different priorities should avoid sharing other C library locks.
+ * - Only tasks may call FreeRTOS functions once the scheduler is started, other threads (e.g. created with
+ *   pthread_create() directly) must not.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include "sdkconfig.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define PORT_INTERRUPT_SIGNAL   SIGUSR1
+#define NSEC_PER_SEC            1000000000L
+
+/* Data of a task's thread, placed at the top of the task's stack (see pxPortInitialiseStack()) */
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t run_event;
+    bool running;               /* A core has been handed over to the thread */
+    bool deleted;               /* The task was deleted, its thread must exit */
+    BaseType_t core_id;         /* Core handed over to the thread */
+    TaskFunction_t code;
+    void *params;
+} port_thread_t;
+
+/* State of a simulated core */
+typedef struct {
+    port_thread_t *thread;      /* Thread currently running on the core */
+    uint32_t pending_ticks;     /* Ticks not processed yet by the core */
+    bool yield_pending;         /* Yield requested by the other core */
+} port_core_t;
+
+static port_core_t s_cores[portNUM_PROCESSORS];
+/* Protects s_cores[].thread, so that an interrupt is never sent to the thread of a task which was deleted */
+static pthread_mutex_t s_cores_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t s_tick_thread;
+static volatile bool s_scheduler_running;
+static pthread_mutex_t s_scheduler_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_scheduler_end = PTHREAD_COND_INITIALIZER;
+
+static struct timespec s_start_time;
+
+/* Thread of the calling task, NULL if the calling thread isn't a task */
+static __thread port_thread_t *t_thread;
+/* Core the calling task runs on. Threads which are not tasks are considered to run on core 0 */
+static __thread BaseType_t t_core_id;
+/* Simulated interrupt state of the calling thread */
+static __thread volatile sig_atomic_t t_irq_disabled;
+static __thread volatile sig_atomic_t t_irq_pending;
+static __thread volatile sig_atomic_t t_in_isr;
+static __thread volatile sig_atomic_t t_yield_from_isr;
+static __thread bool t_yield_pending;
+/* Critical section nesting of the calling task, and the interrupt state to restore when leaving the outermost one */
+static __thread UBaseType_t t_critical_nesting;
+static __thread UBaseType_t t_critical_prev_level;
+
+static inline void port_barrier(void)
+{
+    /* Orders the accesses to the interrupt state with respect to the signal handler */
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline port_thread_t *port_thread_of(TaskHandle_t task)
+{
+    /* pxTopOfStack, the first member of the TCB, points to the thread data */
+    return *(port_thread_t **)task;
+}
+
+// ----------------------- Threads -------------------------
+
+static void port_thread_resume(port_thread_t *thread, BaseType_t core_id)
+{
+    pthread_mutex_lock(&thread->lock);
+    thread->core_id = core_id;
+    thread->running = true;
+    pthread_cond_signal(&thread->run_event);
+    pthread_mutex_unlock(&thread->lock);
+}
+
+/* Wait until a core is handed over to the calling thread, or exit it if its task was deleted meanwhile */
+static void port_thread_wait(port_thread_t *self)
+{
+    pthread_mutex_lock(&self->lock);
+    while (!self->running && !self->deleted) {
+        pthread_cond_wait(&self->run_event, &self->lock);
+    }
+    if (self->deleted) {
+        pthread_mutex_unlock(&self->lock);
+        pthread_exit(NULL);
+    }
+    t_core_id = self->core_id;
+    pthread_mutex_unlock(&self->lock);
+
+    /* Ticks or a yield request may have arrived for the core while it was switching threads */
+    if (__atomic_load_n(&s_cores[t_core_id].pending_ticks, __ATOMIC_ACQUIRE) != 0 ||
+        __atomic_load_n(&s_cores[t_core_id].yield_pending, __ATOMIC_ACQUIRE)) {
+        t_irq_pending = 1;
+    }
+}
+
+static void port_interrupt_core(BaseType_t core_id)
+{
+    pthread_mutex_lock(&s_cores_lock);
+    port_thread_t *thread = s_cores[core_id].thread;
+    if (thread != NULL) {
+        pthread_kill(thread->thread, PORT_INTERRUPT_SIGNAL);
+    }
+    pthread_mutex_unlock(&s_cores_lock);
+}
+
+/*
+ * Switch to the task selected by the scheduler for the current core.
+ * Must be called with interrupts disabled and outside of any critical section.
+ */
+static void port_switch_context(void)
+{
+    port_thread_t *self = t_thread;
+    BaseType_t core_id = t_core_id;
+
+    /* Give up the running state before the scheduler can select this task on the other core */
+    pthread_mutex_lock(&self->lock);
+    self->running = false;
+    pthread_mutex_unlock(&self->lock);
+
+    t_in_isr = 1;
+    vTaskSwitchContext();
+    t_in_isr = 0;
+
+    port_thread_t *next = port_thread_of(xTaskGetCurrentTaskHandleForCPU(core_id));
+    if (next == self) {
+        pthread_mutex_lock(&self->lock);
+        self->running = true;
+        pthread_mutex_unlock(&self->lock);
+        return;
+    }
+
+    pthread_mutex_lock(&s_cores_lock);
+    s_cores[core_id].thread = next;
+    pthread_mutex_unlock(&s_cores_lock);
+    port_thread_resume(next, core_id);
+
+    port_thread_wait(self);
+}
+
+// --------------------- Interrupts ------------------------
+
+/* Body of the simulated ISR. Called with interrupts disabled */
+static void port_handle_interrupt(void)
+{
+    port_core_t *core = &s_cores[t_core_id];
+
+    if (__atomic_load_n(&core->thread, __ATOMIC_ACQUIRE) != t_thread) {
+        /* The interrupt was sent before this thread was switched out, the thread now on the core handles it */
+        return;
+    }
+
+    bool switch_required = false;
+    t_in_isr = 1;
+    for (uint32_t ticks = __atomic_exchange_n(&core->pending_ticks, 0, __ATOMIC_ACQ_REL); ticks > 0; ticks--) {
+        if (xTaskIncrementTick() != pdFALSE) {
+            switch_required = true;
+        }
+    }
+    if (__atomic_exchange_n(&core->yield_pending, false, __ATOMIC_ACQ_REL)) {
+        switch_required = true;
+    }
+    if (t_yield_from_isr) {
+        t_yield_from_isr = 0;
+        switch_required = true;
+    }
+    t_in_isr = 0;
+
+    if (switch_required) {
+        port_switch_context();
+    }
+}
+
+static void port_interrupt_handler(int sig)
+{
+    (void) sig;
+    int saved_errno = errno;
+
+    if (t_thread != NULL) {
+        if (t_irq_disabled) {
+            t_irq_pending = 1;
+        } else {
+            t_irq_disabled = 1;
+            port_barrier();
+            port_handle_interrupt();
+            port_barrier();
+            t_irq_disabled = 0;
+        }
+    }
+    errno = saved_errno;
+}
+
+/* Enable interrupts, handling the interrupts and yields which arrived while they were disabled */
+static void port_enable_interrupts(void)
+{
+    while (true) {
+        t_irq_disabled = 0;
+        port_barrier();
+        if (!t_irq_pending && !t_yield_pending) {
+            return;
+        }
+        t_irq_disabled = 1;
+        port_barrier();
+        if (t_irq_pending) {
+            t_irq_pending = 0;
+            port_handle_interrupt();
+        }
+        if (t_yield_pending) {
+            t_yield_pending = false;
+            port_switch_context();
+        }
+    }
+}
+
+BaseType_t xPortInIsrContext(void)
+{
+    return t_in_isr ? pdTRUE : pdFALSE;
+}
+
+void vPortAssertIfInISR(void)
+{
+    configASSERT(xPortInIsrContext() == pdFALSE);
+}
+
+BaseType_t xPortInterruptedFromISRContext(void)
+{
+    return xPortInIsrContext();
+}
+
+UBaseType_t xPortSetInterruptMaskFromISR(void)
+{
+    UBaseType_t prev_level = t_irq_disabled;
+    t_irq_disabled = 1;
+    port_barrier();
+    return prev_level;
+}
+
+void vPortClearInterruptMaskFromISR(UBaseType_t prev_level)
+{
+    if (prev_level == 0) {
+        if (t_thread != NULL) {
+            port_enable_interrupts();
+        } else {
+            t_irq_disabled = 0;
+        }
+    }
+}
+
+// ------------------ Critical Sections --------------------
+
+BaseType_t xPortEnterCriticalTimeout(portMUX_TYPE *mux, BaseType_t timeout)
+{
+    UBaseType_t prev_level = xPortSetInterruptMaskFromISR();
+    const uint32_t owner = portMUX_OWNER(t_core_id);
+
+    while (true) {
+        uint32_t expected = portMUX_FREE_VAL;
+        if (__atomic_compare_exchange_n(&mux->owner, &expected, owner, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            mux->count = 1;
+            break;
+        }
+        if (expected == owner) {
+            // Spinlocks are recursive for the core holding them
+            mux->count++;
+            break;
+        }
+        configASSERT(expected == portMUX_OWNER(0) || expected == portMUX_OWNER(1));
+        if (timeout != portMUX_NO_TIMEOUT && timeout-- <= 0) {
+            vPortClearInterruptMaskFromISR(prev_level);
+            return pdFAIL;
+        }
+        // The other core holds the spinlock, let its thread run in case the host has fewer CPUs than simulated cores
+        sched_yield();
+    }
+
+    if (t_critical_nesting++ == 0) {
+        t_critical_prev_level = prev_level;
+    }
+    return pdPASS;
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+    configASSERT(mux->owner == portMUX_OWNER(t_core_id));
+    configASSERT(mux->count > 0);
+    if (--mux->count == 0) {
+        __atomic_store_n(&mux->owner, portMUX_FREE_VAL, __ATOMIC_RELEASE);
+    }
+
+    configASSERT(t_critical_nesting > 0);
+    if (--t_critical_nesting == 0) {
+        vPortClearInterruptMaskFromISR(t_critical_prev_level);
+    }
+}
+
+// ---------------------- Yielding -------------------------
+
+void vPortYield(void)
+{
+    if (t_thread == NULL) {
+        return;
+    }
+    if (t_irq_disabled) {
+        // Delayed until interrupts are enabled again, see port_enable_interrupts()
+        t_yield_pending = true;
+        return;
+    }
+    (void) xPortSetInterruptMaskFromISR();
+    port_switch_context();
+    port_enable_interrupts();
+}
+
+void vPortYieldFromISR(void)
+{
+    if (t_in_isr) {
+        t_yield_from_isr = 1;
+    } else {
+        vPortYield();
+    }
+}
+
+void vPortYieldOtherCore(BaseType_t coreid)
+{
+    __atomic_store_n(&s_cores[coreid].yield_pending, true, __ATOMIC_RELEASE);
+    UBaseType_t prev_level = xPortSetInterruptMaskFromISR();
+    port_interrupt_core(coreid);
+    vPortClearInterruptMaskFromISR(prev_level);
+}
+
+bool xPortCanYield(void)
+{
+    return !t_irq_disabled && !t_in_isr;
+}
+
+// ----------------------- System --------------------------
+
+uint32_t xPortGetTickRateHz(void)
+{
+    return (uint32_t) configTICK_RATE_HZ;
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return t_core_id;
+}
+
+uint32_t ulPortGetRunTimeCounterValue(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t) ((now.tv_sec - s_start_time.tv_sec) * 1000000LL + (now.tv_nsec - s_start_time.tv_nsec) / 1000);
+}
+
+// ----------------------- Memory --------------------------
+
+/*
+ * The kernel allocates and frees memory from tasks which may be preempted at any time. Simulated interrupts are
+ * disabled around the calls to the allocator, so that no task is ever switched out while holding its lock.
+ */
+void *pvPortMalloc(size_t xSize)
+{
+    UBaseType_t prev_level = xPortSetInterruptMaskFromISR();
+    void *ptr = malloc(xSize);
+    vPortClearInterruptMaskFromISR(prev_level);
+    return ptr;
+}
+
+void vPortFree(void *pv)
+{
+    UBaseType_t prev_level = xPortSetInterruptMaskFromISR();
+    free(pv);
+    vPortClearInterruptMaskFromISR(prev_level);
+}
+
+// -------------------- Tick Handler -----------------------
+
+static void *port_tick_thread(void *arg)
+{
+    (void) arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (s_scheduler_running) {
+        next.tv_nsec += NSEC_PER_SEC / configTICK_RATE_HZ;
+        if (next.tv_nsec >= NSEC_PER_SEC) {
+            next.tv_sec++;
+            next.tv_nsec -= NSEC_PER_SEC;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {
+        }
+
+        // Ticks are counted per core, none is lost if a core keeps interrupts disabled for more than a tick period
+        for (BaseType_t core_id = 0; core_id < portNUM_PROCESSORS; core_id++) {
+            __atomic_fetch_add(&s_cores[core_id].pending_ticks, 1, __ATOMIC_ACQ_REL);
+            port_interrupt_core(core_id);
+        }
+    }
+    return NULL;
+}
+
+// ------------------ Scheduler Start/End ------------------
+
+static void *port_thread_main(void *arg)
+{
+    port_thread_t *self = (port_thread_t *) arg;
+    sigset_t set;
+
+    t_thread = self;
+    t_irq_disabled = 1;
+    sigemptyset(&set);
+    sigaddset(&set, PORT_INTERRUPT_SIGNAL);
+    pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+
+    // Wait for the first time the task is scheduled
+    port_thread_wait(self);
+    port_enable_interrupts();
+
+    self->code(self->params);
+
+    // Tasks must not return, they have to delete themselves
+    fprintf(stderr, "ERROR: FreeRTOS task %s returned\n", pcTaskGetName(NULL));
+    abort();
+    return NULL;
+}
+
+StackType_t *pxPortInitialiseStack(StackType_t *pxTopOfStack, TaskFunction_t pxCode, void *pvParameters)
+{
+    /* The stack is not used to run the task, only to hold the data of its thread */
+    uintptr_t top = (uintptr_t) (pxTopOfStack + 1) - sizeof(port_thread_t);
+    port_thread_t *thread = (port_thread_t *) (top & ~((uintptr_t) portBYTE_ALIGNMENT_MASK));
+
+    memset(thread, 0, sizeof(port_thread_t));
+    thread->code = pxCode;
+    thread->params = pvParameters;
+    pthread_mutex_init(&thread->lock, NULL);
+    pthread_cond_init(&thread->run_event, NULL);
+
+    // The thread waits until the task is scheduled, interrupts are never sent to it before
+    UBaseType_t prev_level = xPortSetInterruptMaskFromISR();
+    int ret = pthread_create(&thread->thread, NULL, port_thread_main, thread);
+    vPortClearInterruptMaskFromISR(prev_level);
+    if (ret != 0) {
+        fprintf(stderr, "ERROR: Failed to create the thread of a FreeRTOS task: %s\n", strerror(ret));
+        abort();
+    }
+    return (StackType_t *) thread;
+}
+
+void vPortCleanUpThread(void *pxTCB)
+{
+    port_thread_t *thread = port_thread_of((TaskHandle_t) pxTCB);
+    UBaseType_t prev_level = xPortSetInterruptMaskFromISR();
+
+    pthread_mutex_lock(&thread->lock);
+    thread->deleted = true;
+    pthread_cond_signal(&thread->run_event);
+    pthread_mutex_unlock(&thread->lock);
+
+    // Don't let the stack holding the thread data be freed before the thread is gone
+    pthread_join(thread->thread, NULL);
+    pthread_cond_destroy(&thread->run_event);
+    pthread_mutex_destroy(&thread->lock);
+    vPortClearInterruptMaskFromISR(prev_level);
+}
+
+BaseType_t xPortStartScheduler(void)
+{
+    struct sigaction sa;
+    sigset_t set;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = port_interrupt_handler;
+    sa.sa_flags = SA_RESTART;
+    sigfillset(&sa.sa_mask);
+    sigaction(PORT_INTERRUPT_SIGNAL, &sa, NULL);
+
+    // Interrupts are only ever handled by the threads of tasks
+    sigemptyset(&set);
+    sigaddset(&set, PORT_INTERRUPT_SIGNAL);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &s_start_time);
+    s_scheduler_running = true;
+
+    pthread_mutex_lock(&s_cores_lock);
+    for (BaseType_t core_id = 0; core_id < portNUM_PROCESSORS; core_id++) {
+        s_cores[core_id].thread = port_thread_of(xTaskGetCurrentTaskHandleForCPU(core_id));
+    }
+    pthread_mutex_unlock(&s_cores_lock);
+    for (BaseType_t core_id = 0; core_id < portNUM_PROCESSORS; core_id++) {
+        port_thread_resume(s_cores[core_id].thread, core_id);
+    }
+
+    // The tick thread inherits the blocked interrupt signal
+    int ret = pthread_create(&s_tick_thread, NULL, port_tick_thread, NULL);
+    if (ret != 0) {
+        fprintf(stderr, "ERROR: Failed to create the FreeRTOS tick thread: %s\n", strerror(ret));
+        abort();
+    }
+
+    // The calling thread is not a task, it only waits until the scheduler is ended
+    pthread_mutex_lock(&s_scheduler_lock);
+    while (s_scheduler_running) {
+        pthread_cond_wait(&s_scheduler_end, &s_scheduler_lock);
+    }
+    pthread_mutex_unlock(&s_scheduler_lock);
+    pthread_join(s_tick_thread, NULL);
+    return pdTRUE;
+}
+
+void vPortEndScheduler(void)
+{
+    /* Stops the tick and lets vTaskStartScheduler() return. The threads of the tasks are left as they are, the
+     * application is expected to exit. */
+    pthread_mutex_lock(&s_scheduler_lock);
+    s_scheduler_running = false;
+    pthread_cond_signal(&s_scheduler_end);
+    pthread_mutex_unlock(&s_scheduler_lock);
+}
+
+// ------------------- Hook Functions ----------------------
+
+void __attribute__((weak)) vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName)
+{
+    fprintf(stderr, "***ERROR*** A stack overflow in task %s has been detected.\n", pcTaskName);
+    abort();
+}
+
+/* The ESP-IDF hooks are provided by esp_system on the chip targets, which isn't available on Linux */
+void esp_vApplicationTickHook(void)
+{
+}
+
+void esp_vApplicationIdleHook(void)
+{
+    /* Give the host CPU up until the next interrupt, like the idle hook of the chip targets waits for an interrupt.
+     * Otherwise the idle tasks would compete with the other simulated core for the host's CPUs. */
+    pause();
+}
+
+// ------------- FreeRTOS Static Allocation ----------------
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint32_t *pulIdleTaskStackSize )
+{
+    StaticTask_t *pxTCBBufferTemp;
+    StackType_t *pxStackBufferTemp;
+    pxTCBBufferTemp = pvPortMallocTcbMem(sizeof(StaticTask_t));
+    pxStackBufferTemp = pvPortMallocStackMem(configIDLE_TASK_STACK_SIZE);
+    assert(pxTCBBufferTemp != NULL);
+    assert(pxStackBufferTemp != NULL);
+    //Write back pointers
+    *ppxIdleTaskTCBBuffer = pxTCBBufferTemp;
+    *ppxIdleTaskStackBuffer = pxStackBufferTemp;
+    *pulIdleTaskStackSize = configIDLE_TASK_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer,
+                                    StackType_t **ppxTimerTaskStackBuffer,
+                                    uint32_t *pulTimerTaskStackSize )
+{
+    StaticTask_t *pxTCBBufferTemp;
+    StackType_t *pxStackBufferTemp;
+    pxTCBBufferTemp = pvPortMallocTcbMem(sizeof(StaticTask_t));
+    pxStackBufferTemp = pvPortMallocStackMem(configTIMER_TASK_STACK_DEPTH);
+    assert(pxTCBBufferTemp != NULL);
+    assert(pxStackBufferTemp != NULL);
+    //Write back pointers
+    *ppxTimerTaskTCBBuffer = pxTCBBufferTemp;
+    *ppxTimerTaskStackBuffer = pxStackBufferTemp;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
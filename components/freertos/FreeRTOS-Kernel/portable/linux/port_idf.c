@@ -0,0 +1,43 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Application startup on the Linux target: like the startup code of the chip targets, main() creates the main task
+ * which calls app_main(), then starts the scheduler.
+ *
+ * This file only holds main(), so that applications defining their own main() (e.g. tests which start the scheduler
+ * themselves) don't pull it in.
+ */
+
+#include <assert.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Same priority and core as the main task on the chip targets. The stack only holds the data of the task's thread,
+ * the task itself runs on its thread's stack. */
+#define LINUX_MAIN_TASK_PRIO    (tskIDLE_PRIORITY + 1)
+#define LINUX_MAIN_TASK_STACK   configMINIMAL_STACK_SIZE
+#define LINUX_MAIN_TASK_CORE    0
+
+extern void app_main(void);
+
+static void main_task(void *args)
+{
+    app_main();
+    vTaskDelete(NULL);
+}
+
+int main(int argc, char **argv)
+{
+    BaseType_t res = xTaskCreatePinnedToCore(&main_task, "main",
+                                             LINUX_MAIN_TASK_STACK, NULL,
+                                             LINUX_MAIN_TASK_PRIO, NULL, LINUX_MAIN_TASK_CORE);
+    assert(res == pdTRUE);
+    (void)res;
+
+    vTaskStartScheduler();
+    return 0;
+}
@@ -226,6 +226,32 @@ static BaseType_t prvCopyDataToQueue( Queue_t * const pxQueue,
 static void prvCopyDataFromQueue( Queue_t * const pxQueue,
                                   void * const pvBuffer ) PRIVILEGED_FUNCTION;
 
+/*
+ * Copies as many of xItemCount items to the back of the queue as it has room
+ * for, and returns the number of items copied.  Not for semaphores.
+ */
+static size_t prvCopyItemsToQueue( Queue_t * const pxQueue,
+                                   const uint8_t * pucItems,
+                                   size_t xItemCount ) PRIVILEGED_FUNCTION;
+
+/*
+ * Copies up to xMaxItemCount items out of a queue, and returns the number of
+ * items copied.
+ */
+static size_t prvCopyItemsFromQueue( Queue_t * const pxQueue,
+                                     uint8_t * pucBuffer,
+                                     size_t xMaxItemCount ) PRIVILEGED_FUNCTION;
+
+/*
+ * Unblocks up to xItemCount tasks waiting to receive from the queue (or
+ * notifies the queue set of each item) after xItemCount items were posted.
+ *
+ * @return pdTRUE if a task with a higher priority than the calling task was
+ * unblocked.
+ */
+static BaseType_t prvNotifyItemsPosted( Queue_t * const pxQueue,
+                                        size_t xItemCount ) PRIVILEGED_FUNCTION;
+
 #if ( configUSE_QUEUE_SETS == 1 )
 
 /*
@@ -1050,6 +1076,137 @@ BaseType_t xQueueGenericSend( QueueHandle_t xQueue,
 }
 /*-----------------------------------------------------------*/
 
+size_t xQueueSendMultiple( QueueHandle_t xQueue,
+                           const void * const pvItemsToQueue,
+                           size_t xItemCount,
+                           TickType_t xTicksToWait )
+{
+    BaseType_t xEntryTimeSet = pdFALSE;
+    TimeOut_t xTimeOut;
+    Queue_t * const pxQueue = xQueue;
+    const uint8_t * const pucItems = ( const uint8_t * ) pvItemsToQueue;
+    size_t xItemsSent = 0;
+
+    configASSERT( pxQueue );
+    configASSERT( !( ( pvItemsToQueue == NULL ) && ( xItemCount != ( size_t ) 0U ) ) );
+    /* Semaphores and mutexes have no items to copy. */
+    configASSERT( pxQueue->uxItemSize != ( UBaseType_t ) 0U );
+    #if ( ( INCLUDE_xTaskGetSchedulerState == 1 ) || ( configUSE_TIMERS == 1 ) )
+        {
+            configASSERT( !( ( xTaskGetSchedulerState() == taskSCHEDULER_SUSPENDED ) && ( xTicksToWait != 0 ) ) );
+        }
+    #endif
+
+    /*lint -save -e904 This function relaxes the coding standard somewhat to
+     * allow return statements within the function itself.  This is done in the
+     * interest of execution time efficiency. */
+    for( ; ; )
+    {
+        taskENTER_CRITICAL();
+        {
+            /* Post as many items as the queue has room for, then wake up the
+             * tasks waiting for them in the same critical section. */
+            const size_t xItemsCopied = prvCopyItemsToQueue( pxQueue, pucItems + ( xItemsSent * pxQueue->uxItemSize ), xItemCount - xItemsSent );
+
+            if( xItemsCopied > ( size_t ) 0U )
+            {
+                traceQUEUE_SEND( pxQueue );
+                xItemsSent += xItemsCopied;
+
+                if( prvNotifyItemsPosted( pxQueue, xItemsCopied ) != pdFALSE )
+                {
+                    /* The yield happens once the critical section is exited. */
+                    queueYIELD_IF_USING_PREEMPTION();
+                }
+                else
+                {
+                    mtCOVERAGE_TEST_MARKER();
+                }
+            }
+
+            if( xItemsSent == xItemCount )
+            {
+                taskEXIT_CRITICAL();
+                return xItemsSent;
+            }
+            else if( xTicksToWait == ( TickType_t ) 0 )
+            {
+                /* The queue is full and no block time is specified (or the
+                 * block time has expired) so leave now. */
+                taskEXIT_CRITICAL();
+                traceQUEUE_SEND_FAILED( pxQueue );
+                return xItemsSent;
+            }
+            else if( xEntryTimeSet == pdFALSE )
+            {
+                /* The queue is full and a block time was specified so
+                 * configure the timeout structure. */
+                vTaskInternalSetTimeOutState( &xTimeOut );
+                xEntryTimeSet = pdTRUE;
+            }
+            else
+            {
+                /* Entry time was already set. */
+                mtCOVERAGE_TEST_MARKER();
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        /* Interrupts and other tasks can send to and receive from the queue
+         * now the critical section has been exited. */
+
+#ifdef ESP_PLATFORM // IDF-3755
+        taskENTER_CRITICAL();
+#else
+        vTaskSuspendAll();
+#endif // ESP_PLATFORM
+        prvLockQueue( pxQueue );
+
+        /* Update the timeout state to see if it has expired yet. */
+        if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE )
+        {
+            if( prvIsQueueFull( pxQueue ) != pdFALSE )
+            {
+                traceBLOCKING_ON_QUEUE_SEND( pxQueue );
+                vTaskPlaceOnEventList( &( pxQueue->xTasksWaitingToSend ), xTicksToWait );
+                prvUnlockQueue( pxQueue );
+#ifdef ESP_PLATFORM // IDF-3755
+                taskEXIT_CRITICAL();
+#else
+                if( xTaskResumeAll() == pdFALSE )
+#endif // ESP_PLATFORM
+                {
+                    portYIELD_WITHIN_API();
+                }
+            }
+            else
+            {
+                /* Try again. */
+                prvUnlockQueue( pxQueue );
+#ifdef ESP_PLATFORM // IDF-3755
+                taskEXIT_CRITICAL();
+#else
+                ( void ) xTaskResumeAll();
+#endif // ESP_PLATFORM
+            }
+        }
+        else
+        {
+            /* The timeout has expired. */
+            prvUnlockQueue( pxQueue );
+#ifdef ESP_PLATFORM // IDF-3755
+            taskEXIT_CRITICAL();
+#else
+            ( void ) xTaskResumeAll();
+#endif // ESP_PLATFORM
+
+            traceQUEUE_SEND_FAILED( pxQueue );
+            return xItemsSent;
+        }
+    } /*lint -restore */
+}
+/*-----------------------------------------------------------*/
+
 BaseType_t xQueueGenericSendFromISR( QueueHandle_t xQueue,
                                      const void * const pvItemToQueue,
                                      BaseType_t * const pxHigherPriorityTaskWoken,
@@ -1208,6 +1365,72 @@ BaseType_t xQueueGenericSendFromISR( QueueHandle_t xQueue,
 }
 /*-----------------------------------------------------------*/
 
+size_t xQueueSendMultipleFromISR( QueueHandle_t xQueue,
+                                  const void * const pvItemsToQueue,
+                                  size_t xItemCount,
+                                  BaseType_t * const pxHigherPriorityTaskWoken )
+{
+    size_t xItemsCopied;
+    UBaseType_t uxSavedInterruptStatus;
+    Queue_t * const pxQueue = xQueue;
+
+    configASSERT( pxQueue );
+    configASSERT( !( ( pvItemsToQueue == NULL ) && ( xItemCount != ( size_t ) 0U ) ) );
+    configASSERT( pxQueue->uxItemSize != ( UBaseType_t ) 0U );
+
+    portASSERT_IF_INTERRUPT_PRIORITY_INVALID();
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    {
+        taskENTER_CRITICAL_ISR();
+
+        xItemsCopied = prvCopyItemsToQueue( pxQueue, ( const uint8_t * ) pvItemsToQueue, xItemCount );
+
+        if( xItemsCopied > ( size_t ) 0U )
+        {
+            const int8_t cTxLock = pxQueue->cTxLock;
+
+            traceQUEUE_SEND_FROM_ISR( pxQueue );
+
+            /* The event list is not altered if the queue is locked.  This will
+             * be done when the queue is unlocked later. */
+            if( cTxLock == queueUNLOCKED )
+            {
+                if( ( prvNotifyItemsPosted( pxQueue, xItemsCopied ) != pdFALSE ) && ( pxHigherPriorityTaskWoken != NULL ) )
+                {
+                    *pxHigherPriorityTaskWoken = pdTRUE;
+                }
+                else
+                {
+                    mtCOVERAGE_TEST_MARKER();
+                }
+            }
+            else
+            {
+                /* Increment the lock count so the task that unlocks the queue
+                 * knows that data was posted while it was locked. */
+                configASSERT( ( size_t ) ( queueINT8_MAX - cTxLock ) >= xItemsCopied );
+                pxQueue->cTxLock = ( int8_t ) ( cTxLock + ( int8_t ) xItemsCopied );
+            }
+        }
+
+        if( xItemsCopied < xItemCount )
+        {
+            traceQUEUE_SEND_FROM_ISR_FAILED( pxQueue );
+        }
+        else
+        {
+            mtCOVERAGE_TEST_MARKER();
+        }
+
+        taskEXIT_CRITICAL_ISR();
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+    return xItemsCopied;
+}
+/*-----------------------------------------------------------*/
+
 BaseType_t xQueueGiveFromISR( QueueHandle_t xQueue,
                               BaseType_t * const pxHigherPriorityTaskWoken )
 {
@@ -1537,6 +1760,155 @@ BaseType_t xQueueReceive( QueueHandle_t xQueue,
 }
 /*-----------------------------------------------------------*/
 
+size_t xQueueReceiveMultiple( QueueHandle_t xQueue,
+                              void * const pvBuffer,
+                              size_t xMaxItemCount,
+                              TickType_t xTicksToWait )
+{
+    BaseType_t xEntryTimeSet = pdFALSE;
+    TimeOut_t xTimeOut;
+    Queue_t * const pxQueue = xQueue;
+
+    configASSERT( ( pxQueue ) );
+    configASSERT( !( ( pvBuffer == NULL ) && ( xMaxItemCount != ( size_t ) 0U ) ) );
+    /* Semaphores and mutexes have no items to copy. */
+    configASSERT( pxQueue->uxItemSize != ( UBaseType_t ) 0U );
+    #if ( ( INCLUDE_xTaskGetSchedulerState == 1 ) || ( configUSE_TIMERS == 1 ) )
+        {
+            configASSERT( !( ( xTaskGetSchedulerState() == taskSCHEDULER_SUSPENDED ) && ( xTicksToWait != 0 ) ) );
+        }
+    #endif
+
+    if( xMaxItemCount == ( size_t ) 0U )
+    {
+        return 0;
+    }
+
+    /*lint -save -e904  This function relaxes the coding standard somewhat to
+     * allow return statements within the function itself.  This is done in the
+     * interest of execution time efficiency. */
+    for( ; ; )
+    {
+        taskENTER_CRITICAL();
+        {
+            if( pxQueue->uxMessagesWaiting > ( UBaseType_t ) 0 )
+            {
+                size_t xItemsReceived = prvCopyItemsFromQueue( pxQueue, ( uint8_t * ) pvBuffer, xMaxItemCount );
+                size_t xSpaceToSignal = xItemsReceived;
+
+                traceQUEUE_RECEIVE( pxQueue );
+
+                /* There is now space in the queue, unblock a waiting sender for
+                 * each item removed. */
+                while( ( xSpaceToSignal > ( size_t ) 0U ) && ( listLIST_IS_EMPTY( &( pxQueue->xTasksWaitingToSend ) ) == pdFALSE ) )
+                {
+                    if( xTaskRemoveFromEventList( &( pxQueue->xTasksWaitingToSend ) ) != pdFALSE )
+                    {
+                        queueYIELD_IF_USING_PREEMPTION();
+                    }
+                    else
+                    {
+                        mtCOVERAGE_TEST_MARKER();
+                    }
+
+                    xSpaceToSignal--;
+                }
+
+                taskEXIT_CRITICAL();
+                return xItemsReceived;
+            }
+            else
+            {
+                if( xTicksToWait == ( TickType_t ) 0 )
+                {
+                    /* The queue was empty and no block time is specified (or
+                     * the block time has expired) so leave now. */
+                    taskEXIT_CRITICAL();
+                    traceQUEUE_RECEIVE_FAILED( pxQueue );
+                    return 0;
+                }
+                else if( xEntryTimeSet == pdFALSE )
+                {
+                    /* The queue was empty and a block time was specified so
+                     * configure the timeout structure. */
+                    vTaskInternalSetTimeOutState( &xTimeOut );
+                    xEntryTimeSet = pdTRUE;
+                }
+                else
+                {
+                    /* Entry time was already set. */
+                    mtCOVERAGE_TEST_MARKER();
+                }
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        /* Interrupts and other tasks can send to and receive from the queue
+         * now the critical section has been exited. */
+
+#ifdef ESP_PLATFORM // IDF-3755
+        taskENTER_CRITICAL();
+#else
+        vTaskSuspendAll();
+#endif // ESP_PLATFORM
+        prvLockQueue( pxQueue );
+
+        /* Update the timeout state to see if it has expired yet. */
+        if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE )
+        {
+            /* The timeout has not expired.  If the queue is still empty place
+             * the task on the list of tasks waiting to receive from the queue. */
+            if( prvIsQueueEmpty( pxQueue ) != pdFALSE )
+            {
+                traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue );
+                vTaskPlaceOnEventList( &( pxQueue->xTasksWaitingToReceive ), xTicksToWait );
+                prvUnlockQueue( pxQueue );
+#ifdef ESP_PLATFORM // IDF-3755
+                taskEXIT_CRITICAL();
+#else
+                if( xTaskResumeAll() == pdFALSE )
+#endif // ESP_PLATFORM
+                {
+                    portYIELD_WITHIN_API();
+                }
+            }
+            else
+            {
+                /* The queue contains data again.  Loop back to try and read the
+                 * data. */
+                prvUnlockQueue( pxQueue );
+#ifdef ESP_PLATFORM // IDF-3755
+                taskEXIT_CRITICAL();
+#else
+                ( void ) xTaskResumeAll();
+#endif // ESP_PLATFORM
+            }
+        }
+        else
+        {
+            /* Timed out.  If there is no data in the queue exit, otherwise loop
+             * back and attempt to read the data. */
+            prvUnlockQueue( pxQueue );
+#ifdef ESP_PLATFORM // IDF-3755
+            taskEXIT_CRITICAL();
+#else
+            ( void ) xTaskResumeAll();
+#endif // ESP_PLATFORM
+
+            if( prvIsQueueEmpty( pxQueue ) != pdFALSE )
+            {
+                traceQUEUE_RECEIVE_FAILED( pxQueue );
+                return 0;
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+        }
+    } /*lint -restore */
+}
+/*-----------------------------------------------------------*/
+
 BaseType_t xQueueSemaphoreTake( QueueHandle_t xQueue,
                                 TickType_t xTicksToWait )
 {
@@ -2344,6 +2716,150 @@ static void prvCopyDataFromQueue( Queue_t * const pxQueue,
 }
 /*-----------------------------------------------------------*/
 
+static size_t prvCopyItemsToQueue( Queue_t * const pxQueue,
+                                   const uint8_t * pucItems,
+                                   size_t xItemCount )
+{
+    const size_t xItemSize = ( size_t ) pxQueue->uxItemSize;
+    const size_t xSpace = ( size_t ) ( pxQueue->uxLength - pxQueue->uxMessagesWaiting );
+    size_t xItemsCopied = 0;
+
+    /* This function is called from a critical section. */
+
+    if( xItemCount > xSpace )
+    {
+        xItemCount = xSpace;
+    }
+
+    /* At most two copies: up to the end of the storage area, then from its
+     * start. */
+    while( xItemsCopied < xItemCount )
+    {
+        size_t xChunk = ( size_t ) ( pxQueue->u.xQueue.pcTail - pxQueue->pcWriteTo ) / xItemSize;
+
+        if( xChunk > ( xItemCount - xItemsCopied ) )
+        {
+            xChunk = xItemCount - xItemsCopied;
+        }
+
+        ( void ) memcpy( ( void * ) pxQueue->pcWriteTo, ( const void * ) ( pucItems + ( xItemsCopied * xItemSize ) ), xChunk * xItemSize );
+        pxQueue->pcWriteTo += xChunk * xItemSize;
+
+        if( pxQueue->pcWriteTo >= pxQueue->u.xQueue.pcTail )
+        {
+            pxQueue->pcWriteTo = pxQueue->pcHead;
+        }
+        else
+        {
+            mtCOVERAGE_TEST_MARKER();
+        }
+
+        xItemsCopied += xChunk;
+    }
+
+    pxQueue->uxMessagesWaiting += ( UBaseType_t ) xItemCount;
+
+    return xItemCount;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvCopyItemsFromQueue( Queue_t * const pxQueue,
+                                     uint8_t * pucBuffer,
+                                     size_t xMaxItemCount )
+{
+    const size_t xItemSize = ( size_t ) pxQueue->uxItemSize;
+    size_t xItemCount = ( size_t ) pxQueue->uxMessagesWaiting;
+    size_t xItemsCopied = 0;
+
+    /* This function is called from a critical section. */
+
+    if( xItemCount > xMaxItemCount )
+    {
+        xItemCount = xMaxItemCount;
+    }
+
+    while( xItemsCopied < xItemCount )
+    {
+        /* pcReadFrom points to the last item read, so the next one follows
+         * it. */
+        int8_t * pcNext = pxQueue->u.xQueue.pcReadFrom + xItemSize;
+        size_t xChunk;
+
+        if( pcNext >= pxQueue->u.xQueue.pcTail )
+        {
+            pcNext = pxQueue->pcHead;
+        }
+        else
+        {
+            mtCOVERAGE_TEST_MARKER();
+        }
+
+        xChunk = ( size_t ) ( pxQueue->u.xQueue.pcTail - pcNext ) / xItemSize;
+
+        if( xChunk > ( xItemCount - xItemsCopied ) )
+        {
+            xChunk = xItemCount - xItemsCopied;
+        }
+
+        ( void ) memcpy( ( void * ) ( pucBuffer + ( xItemsCopied * xItemSize ) ), ( const void * ) pcNext, xChunk * xItemSize );
+        pxQueue->u.xQueue.pcReadFrom = pcNext + ( ( xChunk - 1 ) * xItemSize );
+        xItemsCopied += xChunk;
+    }
+
+    pxQueue->uxMessagesWaiting -= ( UBaseType_t ) xItemCount;
+
+    return xItemCount;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvNotifyItemsPosted( Queue_t * const pxQueue,
+                                        size_t xItemCount )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    /* This function is called from a critical section. */
+
+    #if ( configUSE_QUEUE_SETS == 1 )
+        if( pxQueue->pxQueueSetContainer != NULL )
+        {
+            /* The queue set holds one entry per item available in its member
+             * queues. */
+            while( xItemCount > ( size_t ) 0U )
+            {
+                if( prvNotifyQueueSetContainer( pxQueue, queueSEND_TO_BACK ) != pdFALSE )
+                {
+                    xHigherPriorityTaskWoken = pdTRUE;
+                }
+                else
+                {
+                    mtCOVERAGE_TEST_MARKER();
+                }
+
+                xItemCount--;
+            }
+        }
+        else
+    #endif /* configUSE_QUEUE_SETS */
+    {
+        while( ( xItemCount > ( size_t ) 0U ) && ( listLIST_IS_EMPTY( &( pxQueue->xTasksWaitingToReceive ) ) == pdFALSE ) )
+        {
+            if( xTaskRemoveFromEventList( &( pxQueue->xTasksWaitingToReceive ) ) != pdFALSE )
+            {
+                xHigherPriorityTaskWoken = pdTRUE;
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+
+            xItemCount--;
+        }
+    }
+
+    return xHigherPriorityTaskWoken;
+}
+/*-----------------------------------------------------------*/
+
 static void prvUnlockQueue( Queue_t * const pxQueue )
 {
     /* THIS FUNCTION MUST BE CALLED WITH THE SCHEDULER SUSPENDED. */
@@ -257,6 +257,29 @@ static size_t prvReadBytesFromBuffer( StreamBuffer_t * pxStreamBuffer,
                                       size_t xMaxCount,
                                       size_t xBytesAvailable ) PRIVILEGED_FUNCTION;
 
+/*
+ * Set pxSpans to the xCount bytes of the storage area starting at index
+ * xStart, which wrap around the end of the storage area if needed.
+ */
+static void prvGetSpans( const StreamBuffer_t * const pxStreamBuffer,
+                         size_t xStart,
+                         size_t xCount,
+                         StreamBufferSpan_t pxSpans[ 2 ] ) PRIVILEGED_FUNCTION;
+
+/*
+ * Move the head of the stream buffer xCount bytes forward, or as far as the
+ * free space allows.  Returns the number of bytes the head moved.
+ */
+static size_t prvCommitBytes( StreamBuffer_t * const pxStreamBuffer,
+                              size_t xCount ) PRIVILEGED_FUNCTION;
+
+/*
+ * Move the tail of the stream buffer xCount bytes forward, or as far as the
+ * data in the buffer allows.  Returns the number of bytes the tail moved.
+ */
+static size_t prvConsumeBytes( StreamBuffer_t * const pxStreamBuffer,
+                               size_t xCount ) PRIVILEGED_FUNCTION;
+
 /*
  * Called by both pxStreamBufferCreate() and pxStreamBufferCreateStatic() to
  * initialise the members of the newly created stream buffer structure.
@@ -1084,6 +1107,255 @@ static size_t prvReadMessageFromBuffer( StreamBuffer_t * pxStreamBuffer,
 }
 /*-----------------------------------------------------------*/
 
+size_t xStreamBufferReserve( StreamBufferHandle_t xStreamBuffer,
+                             size_t xMaxLengthBytes,
+                             StreamBufferSpan_t pxSpans[ 2 ],
+                             TickType_t xTicksToWait )
+{
+    StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+    size_t xReturn, xSpace, xRequiredSpace;
+    TimeOut_t xTimeOut;
+
+    configASSERT( pxSpans );
+    configASSERT( pxStreamBuffer );
+
+    /* The data of a message buffer is interleaved with the message lengths,
+     * so it can't be written in place. */
+    configASSERT( ( pxStreamBuffer->ucFlags & sbFLAGS_IS_MESSAGE_BUFFER ) == ( uint8_t ) 0 );
+
+    /* Wait for no more than the space the stream buffer can ever report. */
+    xRequiredSpace = configMIN( xMaxLengthBytes, pxStreamBuffer->xLength - ( size_t ) 1 );
+
+    if( xTicksToWait != ( TickType_t ) 0 )
+    {
+        vTaskSetTimeOutState( &xTimeOut );
+
+        do
+        {
+            /* Wait until the required number of bytes are free, as in
+             * xStreamBufferSend(). */
+            taskENTER_CRITICAL();
+            {
+                xSpace = xStreamBufferSpacesAvailable( pxStreamBuffer );
+
+                if( xSpace < xRequiredSpace )
+                {
+                    /* Clear notification state as going to wait for space. */
+                    ( void ) xTaskNotifyStateClear( NULL );
+
+                    /* Should only be one writer. */
+                    configASSERT( pxStreamBuffer->xTaskWaitingToSend == NULL );
+                    pxStreamBuffer->xTaskWaitingToSend = xTaskGetCurrentTaskHandle();
+                }
+                else
+                {
+                    taskEXIT_CRITICAL();
+                    break;
+                }
+            }
+            taskEXIT_CRITICAL();
+
+            traceBLOCKING_ON_STREAM_BUFFER_SEND( xStreamBuffer );
+            ( void ) xTaskNotifyWait( ( uint32_t ) 0, ( uint32_t ) 0, NULL, xTicksToWait );
+            pxStreamBuffer->xTaskWaitingToSend = NULL;
+        } while( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE );
+    }
+    else
+    {
+        mtCOVERAGE_TEST_MARKER();
+    }
+
+    /* The space returned starts at the head, which only the writer moves. */
+    xReturn = configMIN( xStreamBufferSpacesAvailable( pxStreamBuffer ), xMaxLengthBytes );
+    prvGetSpans( pxStreamBuffer, pxStreamBuffer->xHead, xReturn, pxSpans );
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+size_t xStreamBufferCommit( StreamBufferHandle_t xStreamBuffer,
+                            size_t xLengthBytes )
+{
+    StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+    size_t xReturn;
+
+    configASSERT( pxStreamBuffer );
+    configASSERT( ( pxStreamBuffer->ucFlags & sbFLAGS_IS_MESSAGE_BUFFER ) == ( uint8_t ) 0 );
+
+    xReturn = prvCommitBytes( pxStreamBuffer, xLengthBytes );
+
+    if( xReturn > ( size_t ) 0 )
+    {
+        traceSTREAM_BUFFER_SEND( xStreamBuffer, xReturn );
+
+        /* Was a task waiting for the data? */
+        if( prvBytesInBuffer( pxStreamBuffer ) >= pxStreamBuffer->xTriggerLevelBytes )
+        {
+            sbSEND_COMPLETED( pxStreamBuffer );
+        }
+        else
+        {
+            mtCOVERAGE_TEST_MARKER();
+        }
+    }
+    else
+    {
+        mtCOVERAGE_TEST_MARKER();
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+size_t xStreamBufferCommitFromISR( StreamBufferHandle_t xStreamBuffer,
+                                   size_t xLengthBytes,
+                                   BaseType_t * const pxHigherPriorityTaskWoken )
+{
+    StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+    size_t xReturn;
+
+    configASSERT( pxStreamBuffer );
+    configASSERT( ( pxStreamBuffer->ucFlags & sbFLAGS_IS_MESSAGE_BUFFER ) == ( uint8_t ) 0 );
+
+    xReturn = prvCommitBytes( pxStreamBuffer, xLengthBytes );
+
+    if( xReturn > ( size_t ) 0 )
+    {
+        /* Was a task waiting for the data? */
+        if( prvBytesInBuffer( pxStreamBuffer ) >= pxStreamBuffer->xTriggerLevelBytes )
+        {
+            sbSEND_COMPLETE_FROM_ISR( pxStreamBuffer, pxHigherPriorityTaskWoken );
+        }
+        else
+        {
+            mtCOVERAGE_TEST_MARKER();
+        }
+    }
+    else
+    {
+        mtCOVERAGE_TEST_MARKER();
+    }
+
+    traceSTREAM_BUFFER_SEND_FROM_ISR( xStreamBuffer, xReturn );
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+size_t xStreamBufferPeekSpans( StreamBufferHandle_t xStreamBuffer,
+                               StreamBufferSpan_t pxSpans[ 2 ],
+                               TickType_t xTicksToWait )
+{
+    StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+    size_t xBytesAvailable;
+
+    configASSERT( pxSpans );
+    configASSERT( pxStreamBuffer );
+    configASSERT( ( pxStreamBuffer->ucFlags & sbFLAGS_IS_MESSAGE_BUFFER ) == ( uint8_t ) 0 );
+
+    if( xTicksToWait != ( TickType_t ) 0 )
+    {
+        /* Checking if there is data and clearing the notification state must be
+         * performed atomically. */
+        taskENTER_CRITICAL();
+        {
+            xBytesAvailable = prvBytesInBuffer( pxStreamBuffer );
+
+            if( xBytesAvailable == ( size_t ) 0 )
+            {
+                /* Clear notification state as going to wait for data. */
+                ( void ) xTaskNotifyStateClear( NULL );
+
+                /* Should only be one reader. */
+                configASSERT( pxStreamBuffer->xTaskWaitingToReceive == NULL );
+                pxStreamBuffer->xTaskWaitingToReceive = xTaskGetCurrentTaskHandle();
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        if( xBytesAvailable == ( size_t ) 0 )
+        {
+            /* Wait for data to be available. */
+            traceBLOCKING_ON_STREAM_BUFFER_RECEIVE( xStreamBuffer );
+            ( void ) xTaskNotifyWait( ( uint32_t ) 0, ( uint32_t ) 0, NULL, xTicksToWait );
+            pxStreamBuffer->xTaskWaitingToReceive = NULL;
+        }
+        else
+        {
+            mtCOVERAGE_TEST_MARKER();
+        }
+    }
+    else
+    {
+        mtCOVERAGE_TEST_MARKER();
+    }
+
+    /* The data returned starts at the tail, which only the reader moves. */
+    xBytesAvailable = prvBytesInBuffer( pxStreamBuffer );
+    prvGetSpans( pxStreamBuffer, pxStreamBuffer->xTail, xBytesAvailable, pxSpans );
+
+    return xBytesAvailable;
+}
+/*-----------------------------------------------------------*/
+
+size_t xStreamBufferConsume( StreamBufferHandle_t xStreamBuffer,
+                             size_t xLengthBytes )
+{
+    StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+    size_t xReturn;
+
+    configASSERT( pxStreamBuffer );
+    configASSERT( ( pxStreamBuffer->ucFlags & sbFLAGS_IS_MESSAGE_BUFFER ) == ( uint8_t ) 0 );
+
+    xReturn = prvConsumeBytes( pxStreamBuffer, xLengthBytes );
+
+    /* Was a task waiting for space in the buffer? */
+    if( xReturn > ( size_t ) 0 )
+    {
+        traceSTREAM_BUFFER_RECEIVE( xStreamBuffer, xReturn );
+        sbRECEIVE_COMPLETED( pxStreamBuffer );
+    }
+    else
+    {
+        mtCOVERAGE_TEST_MARKER();
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+size_t xStreamBufferConsumeFromISR( StreamBufferHandle_t xStreamBuffer,
+                                    size_t xLengthBytes,
+                                    BaseType_t * const pxHigherPriorityTaskWoken )
+{
+    StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+    size_t xReturn;
+
+    configASSERT( pxStreamBuffer );
+    configASSERT( ( pxStreamBuffer->ucFlags & sbFLAGS_IS_MESSAGE_BUFFER ) == ( uint8_t ) 0 );
+
+    xReturn = prvConsumeBytes( pxStreamBuffer, xLengthBytes );
+
+    /* Was a task waiting for space in the buffer? */
+    if( xReturn > ( size_t ) 0 )
+    {
+        sbRECEIVE_COMPLETED_FROM_ISR( pxStreamBuffer, pxHigherPriorityTaskWoken );
+    }
+    else
+    {
+        mtCOVERAGE_TEST_MARKER();
+    }
+
+    traceSTREAM_BUFFER_RECEIVE_FROM_ISR( xStreamBuffer, xReturn );
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
 BaseType_t xStreamBufferIsEmpty( StreamBufferHandle_t xStreamBuffer )
 {
     const StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
@@ -1312,6 +1584,72 @@ static size_t prvReadBytesFromBuffer( StreamBuffer_t * pxStreamBuffer,
 }
 /*-----------------------------------------------------------*/
 
+static void prvGetSpans( const StreamBuffer_t * const pxStreamBuffer,
+                         size_t xStart,
+                         size_t xCount,
+                         StreamBufferSpan_t pxSpans[ 2 ] )
+{
+    size_t xFirstLength;
+
+    /* The first span ends at the end of the storage area at the latest, the
+     * rest of the bytes are at its start. */
+    xFirstLength = configMIN( pxStreamBuffer->xLength - xStart, xCount );
+
+    pxSpans[ 0 ].pucData = &( pxStreamBuffer->pucBuffer[ xStart ] );
+    pxSpans[ 0 ].xLength = xFirstLength;
+    pxSpans[ 1 ].pucData = pxStreamBuffer->pucBuffer;
+    pxSpans[ 1 ].xLength = xCount - xFirstLength;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvCommitBytes( StreamBuffer_t * const pxStreamBuffer,
+                              size_t xCount )
+{
+    size_t xNextHead;
+
+    xCount = configMIN( xCount, xStreamBufferSpacesAvailable( pxStreamBuffer ) );
+
+    xNextHead = pxStreamBuffer->xHead + xCount;
+
+    if( xNextHead >= pxStreamBuffer->xLength )
+    {
+        xNextHead -= pxStreamBuffer->xLength;
+    }
+    else
+    {
+        mtCOVERAGE_TEST_MARKER();
+    }
+
+    pxStreamBuffer->xHead = xNextHead;
+
+    return xCount;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvConsumeBytes( StreamBuffer_t * const pxStreamBuffer,
+                               size_t xCount )
+{
+    size_t xNextTail;
+
+    xCount = configMIN( xCount, prvBytesInBuffer( pxStreamBuffer ) );
+
+    xNextTail = pxStreamBuffer->xTail + xCount;
+
+    if( xNextTail >= pxStreamBuffer->xLength )
+    {
+        xNextTail -= pxStreamBuffer->xLength;
+    }
+    else
+    {
+        mtCOVERAGE_TEST_MARKER();
+    }
+
+    pxStreamBuffer->xTail = xNextTail;
+
+    return xCount;
+}
+/*-----------------------------------------------------------*/
+
 static size_t prvBytesInBuffer( const StreamBuffer_t * const pxStreamBuffer )
 {
 /* Returns the distance between xTail and xHead. */
@@ -1385,10 +1723,11 @@ static void prvInitialiseNewStreamBuffer( StreamBuffer_t * const pxStreamBuffer,
         #endif
 
         /* Do not include the spinlock in the part to reset!
-         * Thus, make sure the spinlock is the last field of the structure. */
-        _Static_assert( offsetof(StreamBuffer_t, xStreamBufferMux) == sizeof( StreamBuffer_t ) - sizeof(portMUX_TYPE),
+         * Thus, make sure the spinlock is the last field of the structure. It may be followed by tail padding
+         * (e.g. on 64-bit hosts), so the part to reset ends where the spinlock starts. */
+        _Static_assert( sizeof( StreamBuffer_t ) - offsetof(StreamBuffer_t, xStreamBufferMux) - sizeof(portMUX_TYPE) < _Alignof( StreamBuffer_t ),
                         "xStreamBufferMux must be the last field of structure StreamBuffer_t" );
-        const size_t erasable = sizeof( StreamBuffer_t ) - sizeof(portMUX_TYPE);
+        const size_t erasable = offsetof(StreamBuffer_t, xStreamBufferMux);
         ( void ) memset( ( void * ) pxStreamBuffer, 0x00, erasable ); /*lint !e9087 memset() requires void *. */
         pxStreamBuffer->pucBuffer = pucBuffer;
         pxStreamBuffer->xLength = xBufferSizeBytes;
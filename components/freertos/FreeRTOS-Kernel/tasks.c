@@ -5340,6 +5340,26 @@ TickType_t uxTaskResetEventItemValue( void )
 #endif /* configUSE_MUTEXES */
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_MUTEXES == 1 ) && defined( ESP_PLATFORM )
+
+    void vTaskIncrementMutexHeldCountOfTask( TaskHandle_t xTask )
+    {
+        TCB_t * const pxTCB = xTask;
+
+        /* Used by locks that take their fast path without the kernel and only
+         * tell the kernel who holds them once a task has to wait, so that the
+         * holder keeps an inherited priority until it releases the lock. */
+        taskENTER_CRITICAL();
+        if( pxTCB != NULL )
+        {
+            ( pxTCB->uxMutexesHeld )++;
+        }
+        taskEXIT_CRITICAL();
+    }
+
+#endif /* ( configUSE_MUTEXES == 1 ) && defined( ESP_PLATFORM ) */
+/*-----------------------------------------------------------*/
+
 #if ( configUSE_TASK_NOTIFICATIONS == 1 )
 
 #ifdef ESP_PLATFORM // IDF-3851
@@ -144,16 +144,48 @@
 /*lint -save -e956 A manual analysis and inspection has been used to determine
  * which static variables must be declared volatile. */
 
+/* The number of commands the timer service task takes off the timer queue at
+ * a time.  Commands are taken in one queue operation to save entering and
+ * leaving the queue critical section for each command when several timers are
+ * started or stopped together. */
+    #define tmrCOMMANDS_PER_RECEIVE    ( ( size_t ) 8U )
+
+    #if ( configUSE_TIMER_WHEEL == 1 )
+
+        #if ( ( configTIMER_WHEEL_SLOTS & ( configTIMER_WHEEL_SLOTS - 1 ) ) != 0 )
+            #error configTIMER_WHEEL_SLOTS must be a power of two.
+        #endif
+
+/* A timer wheel holds the same timers as a sorted timer list would, but hashes
+ * them by the low bits of their expire time into configTIMER_WHEEL_SLOTS
+ * unsorted lists so that a timer is inserted in constant time however many
+ * timers are active.  Timers with the same expire time are in the same slot,
+ * in the order they were inserted.  The timer that expires first is cached and
+ * is found again by walking the slots from xFirstExpireTime, which is never
+ * later than the expire time of any timer in the wheel. */
+        typedef struct tmrTimerWheel
+        {
+            List_t xSlots[ configTIMER_WHEEL_SLOTS ]; /*<< Timers hashed by their expire time, unsorted within a slot. */
+            UBaseType_t uxNumberOfTimers;             /*<< The number of timers in all slots. */
+            TickType_t xFirstExpireTime;              /*<< The expire time of pxFirstTimer, or a lower bound if pxFirstTimer is NULL. */
+            Timer_t * pxFirstTimer;                   /*<< The timer that expires first, NULL if not known. */
+        } TimerWheel_t;
+
+        typedef TimerWheel_t   TimerList_t;
+    #else
+        typedef List_t         TimerList_t;
+    #endif /* configUSE_TIMER_WHEEL */
+
 /* The list in which active timers are stored.  Timers are referenced in expire
  * time order, with the nearest expiry time at the front of the list.  Only the
  * timer service task is allowed to access these lists.
  * xActiveTimerList1 and xActiveTimerList2 could be at function scope but that
  * breaks some kernel aware debuggers, and debuggers that reply on removing the
  * static qualifier. */
-    PRIVILEGED_DATA static List_t xActiveTimerList1;
-    PRIVILEGED_DATA static List_t xActiveTimerList2;
-    PRIVILEGED_DATA static List_t * pxCurrentTimerList;
-    PRIVILEGED_DATA static List_t * pxOverflowTimerList;
+    PRIVILEGED_DATA static TimerList_t xActiveTimerList1;
+    PRIVILEGED_DATA static TimerList_t xActiveTimerList2;
+    PRIVILEGED_DATA static TimerList_t * pxCurrentTimerList;
+    PRIVILEGED_DATA static TimerList_t * pxOverflowTimerList;
 
 /* A queue that is used to send commands to the timer service task. */
     PRIVILEGED_DATA static QueueHandle_t xTimerQueue = NULL;
@@ -230,6 +262,27 @@ PRIVILEGED_DATA portMUX_TYPE xTimerMux = portMUX_INITIALIZER_UNLOCKED;
     static void prvProcessTimerOrBlockTask( const TickType_t xNextExpireTime,
                                             BaseType_t xListWasEmpty ) PRIVILEGED_FUNCTION;
 
+/*
+ * Operations on the active timer lists.  With configUSE_TIMER_WHEEL set to 1
+ * the lists are timer wheels, otherwise they are standard lists sorted by
+ * expire time.  prvTimerListGetFirst() must only be called on a list that is
+ * not empty.
+ */
+    #if ( configUSE_TIMER_WHEEL == 1 )
+        static void prvTimerListInitialise( TimerList_t * const pxList ) PRIVILEGED_FUNCTION;
+        static void prvTimerListInsert( TimerList_t * const pxList,
+                                        Timer_t * const pxTimer ) PRIVILEGED_FUNCTION;
+        static void prvTimerListRemove( Timer_t * const pxTimer ) PRIVILEGED_FUNCTION;
+        static Timer_t * prvTimerListGetFirst( TimerList_t * const pxList ) PRIVILEGED_FUNCTION;
+        #define prvTimerListIsEmpty( pxList )    ( ( ( pxList )->uxNumberOfTimers == ( UBaseType_t ) 0 ) ? pdTRUE : pdFALSE )
+    #else
+        #define prvTimerListInitialise( pxList )         vListInitialise( pxList )
+        #define prvTimerListInsert( pxList, pxTimer )    vListInsert( ( pxList ), &( ( pxTimer )->xTimerListItem ) )
+        #define prvTimerListRemove( pxTimer )            ( void ) uxListRemove( &( ( pxTimer )->xTimerListItem ) )
+        #define prvTimerListGetFirst( pxList )           ( ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxList ) ) /*lint !e9087 !e9079 void * is used as this macro is used with tasks and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
+        #define prvTimerListIsEmpty( pxList )            listLIST_IS_EMPTY( pxList )
+    #endif /* configUSE_TIMER_WHEEL */
+
 /*
  * Called after a Timer_t structure has been allocated either statically or
  * dynamically to fill in the structure's members.
@@ -534,12 +587,12 @@ PRIVILEGED_DATA portMUX_TYPE xTimerMux = portMUX_INITIALIZER_UNLOCKED;
                                         const TickType_t xTimeNow )
     {
         BaseType_t xResult;
-        Timer_t * const pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxCurrentTimerList ); /*lint !e9087 !e9079 void * is used as this macro is used with tasks and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
+        Timer_t * const pxTimer = prvTimerListGetFirst( pxCurrentTimerList );
 
         /* Remove the timer from the list of active timers.  A check has already
          * been performed to ensure the list is not empty. */
 
-        ( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
+        prvTimerListRemove( pxTimer );
         traceTIMER_EXPIRED( pxTimer );
 
         /* If the timer is an auto-reload timer then calculate the next
@@ -652,7 +705,7 @@ PRIVILEGED_DATA portMUX_TYPE xTimerMux = portMUX_INITIALIZER_UNLOCKED;
                     {
                         /* The current timer list is empty - is the overflow list
                          * also empty? */
-                        xListWasEmpty = listLIST_IS_EMPTY( pxOverflowTimerList );
+                        xListWasEmpty = prvTimerListIsEmpty( pxOverflowTimerList );
                     }
 
                     vQueueWaitForMessageRestricted( xTimerQueue, ( xNextExpireTime - xTimeNow ), xListWasEmpty );
@@ -700,11 +753,11 @@ PRIVILEGED_DATA portMUX_TYPE xTimerMux = portMUX_INITIALIZER_UNLOCKED;
          * this task to unblock when the tick count overflows, at which point the
          * timer lists will be switched and the next expiry time can be
          * re-assessed.  */
-        *pxListWasEmpty = listLIST_IS_EMPTY( pxCurrentTimerList );
+        *pxListWasEmpty = prvTimerListIsEmpty( pxCurrentTimerList );
 
         if( *pxListWasEmpty == pdFALSE )
         {
-            xNextExpireTime = listGET_ITEM_VALUE_OF_HEAD_ENTRY( pxCurrentTimerList );
+            xNextExpireTime = listGET_LIST_ITEM_VALUE( &( prvTimerListGetFirst( pxCurrentTimerList )->xTimerListItem ) );
         }
         else
         {
@@ -761,7 +814,7 @@ PRIVILEGED_DATA portMUX_TYPE xTimerMux = portMUX_INITIALIZER_UNLOCKED;
             }
             else
             {
-                vListInsert( pxOverflowTimerList, &( pxTimer->xTimerListItem ) );
+                prvTimerListInsert( pxOverflowTimerList, pxTimer );
             }
         }
         else
@@ -775,7 +828,7 @@ PRIVILEGED_DATA portMUX_TYPE xTimerMux = portMUX_INITIALIZER_UNLOCKED;
             }
             else
             {
-                vListInsert( pxCurrentTimerList, &( pxTimer->xTimerListItem ) );
+                prvTimerListInsert( pxCurrentTimerList, pxTimer );
             }
         }
 
@@ -785,148 +838,157 @@ PRIVILEGED_DATA portMUX_TYPE xTimerMux = portMUX_INITIALIZER_UNLOCKED;
 
     static void prvProcessReceivedCommands( void )
     {
+        DaemonTaskMessage_t xMessages[ tmrCOMMANDS_PER_RECEIVE ];
         DaemonTaskMessage_t xMessage;
+        size_t xReceived, xIndex;
         Timer_t * pxTimer;
         BaseType_t xTimerListsWereSwitched, xResult;
         TickType_t xTimeNow;
 
-        while( xQueueReceive( xTimerQueue, &xMessage, tmrNO_DELAY ) != pdFAIL ) /*lint !e603 xMessage does not have to be initialised as it is passed out, not in, and it is not used unless xQueueReceive() returns pdTRUE. */
+        while( ( xReceived = xQueueReceiveMultiple( xTimerQueue, xMessages, tmrCOMMANDS_PER_RECEIVE, tmrNO_DELAY ) ) != ( size_t ) 0U ) /*lint !e603 xMessages does not have to be initialised as it is passed out, not in. */
         {
-            #if ( INCLUDE_xTimerPendFunctionCall == 1 )
-                {
-                    /* Negative commands are pended function calls rather than timer
-                     * commands. */
-                    if( xMessage.xMessageID < ( BaseType_t ) 0 )
+            /* The commands are processed in the order they were sent, as if
+             * they had been received one by one. */
+            for( xIndex = ( size_t ) 0U; xIndex < xReceived; xIndex++ )
+            {
+                xMessage = xMessages[ xIndex ];
+
+                #if ( INCLUDE_xTimerPendFunctionCall == 1 )
                     {
-                        const CallbackParameters_t * const pxCallback = &( xMessage.u.xCallbackParameters );
+                        /* Negative commands are pended function calls rather than timer
+                         * commands. */
+                        if( xMessage.xMessageID < ( BaseType_t ) 0 )
+                        {
+                            const CallbackParameters_t * const pxCallback = &( xMessage.u.xCallbackParameters );
 
-                        /* The timer uses the xCallbackParameters member to request a
-                         * callback be executed.  Check the callback is not NULL. */
-                        configASSERT( pxCallback );
+                            /* The timer uses the xCallbackParameters member to request a
+                             * callback be executed.  Check the callback is not NULL. */
+                            configASSERT( pxCallback );
 
-                        /* Call the function. */
-                        pxCallback->pxCallbackFunction( pxCallback->pvParameter1, pxCallback->ulParameter2 );
+                            /* Call the function. */
+                            pxCallback->pxCallbackFunction( pxCallback->pvParameter1, pxCallback->ulParameter2 );
+                        }
+                        else
+                        {
+                            mtCOVERAGE_TEST_MARKER();
+                        }
+                    }
+                #endif /* INCLUDE_xTimerPendFunctionCall */
+
+                /* Commands that are positive are timer commands rather than pended
+                 * function calls. */
+                if( xMessage.xMessageID >= ( BaseType_t ) 0 )
+                {
+                    /* The messages uses the xTimerParameters member to work on a
+                     * software timer. */
+                    pxTimer = xMessage.u.xTimerParameters.pxTimer;
+
+                    if( listIS_CONTAINED_WITHIN( NULL, &( pxTimer->xTimerListItem ) ) == pdFALSE ) /*lint !e961. The cast is only redundant when NULL is passed into the macro. */
+                    {
+                        /* The timer is in a list, remove it. */
+                        prvTimerListRemove( pxTimer );
                     }
                     else
                     {
                         mtCOVERAGE_TEST_MARKER();
                     }
-                }
-            #endif /* INCLUDE_xTimerPendFunctionCall */
-
-            /* Commands that are positive are timer commands rather than pended
-             * function calls. */
-            if( xMessage.xMessageID >= ( BaseType_t ) 0 )
-            {
-                /* The messages uses the xTimerParameters member to work on a
-                 * software timer. */
-                pxTimer = xMessage.u.xTimerParameters.pxTimer;
-
-                if( listIS_CONTAINED_WITHIN( NULL, &( pxTimer->xTimerListItem ) ) == pdFALSE ) /*lint !e961. The cast is only redundant when NULL is passed into the macro. */
-                {
-                    /* The timer is in a list, remove it. */
-                    ( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
-                }
-                else
-                {
-                    mtCOVERAGE_TEST_MARKER();
-                }
 
-                traceTIMER_COMMAND_RECEIVED( pxTimer, xMessage.xMessageID, xMessage.u.xTimerParameters.xMessageValue );
+                    traceTIMER_COMMAND_RECEIVED( pxTimer, xMessage.xMessageID, xMessage.u.xTimerParameters.xMessageValue );
 
-                /* In this case the xTimerListsWereSwitched parameter is not used, but
-                 *  it must be present in the function call.  prvSampleTimeNow() must be
-                 *  called after the message is received from xTimerQueue so there is no
-                 *  possibility of a higher priority task adding a message to the message
-                 *  queue with a time that is ahead of the timer daemon task (because it
-                 *  pre-empted the timer daemon task after the xTimeNow value was set). */
-                xTimeNow = prvSampleTimeNow( &xTimerListsWereSwitched );
+                    /* In this case the xTimerListsWereSwitched parameter is not used, but
+                     *  it must be present in the function call.  prvSampleTimeNow() must be
+                     *  called after the message is received from xTimerQueue so there is no
+                     *  possibility of a higher priority task adding a message to the message
+                     *  queue with a time that is ahead of the timer daemon task (because it
+                     *  pre-empted the timer daemon task after the xTimeNow value was set). */
+                    xTimeNow = prvSampleTimeNow( &xTimerListsWereSwitched );
 
-                switch( xMessage.xMessageID )
-                {
-                    case tmrCOMMAND_START:
-                    case tmrCOMMAND_START_FROM_ISR:
-                    case tmrCOMMAND_RESET:
-                    case tmrCOMMAND_RESET_FROM_ISR:
-                    case tmrCOMMAND_START_DONT_TRACE:
-                        /* Start or restart a timer. */
-                        pxTimer->ucStatus |= tmrSTATUS_IS_ACTIVE;
-
-                        if( prvInsertTimerInActiveList( pxTimer, xMessage.u.xTimerParameters.xMessageValue + pxTimer->xTimerPeriodInTicks, xTimeNow, xMessage.u.xTimerParameters.xMessageValue ) != pdFALSE )
-                        {
-                            /* The timer expired before it was added to the active
-                             * timer list.  Process it now. */
-                            pxTimer->pxCallbackFunction( ( TimerHandle_t ) pxTimer );
-                            traceTIMER_EXPIRED( pxTimer );
-
-                            if( ( pxTimer->ucStatus & tmrSTATUS_IS_AUTORELOAD ) != 0 )
+                    switch( xMessage.xMessageID )
+                    {
+                        case tmrCOMMAND_START:
+                        case tmrCOMMAND_START_FROM_ISR:
+                        case tmrCOMMAND_RESET:
+                        case tmrCOMMAND_RESET_FROM_ISR:
+                        case tmrCOMMAND_START_DONT_TRACE:
+                            /* Start or restart a timer. */
+                            pxTimer->ucStatus |= tmrSTATUS_IS_ACTIVE;
+
+                            if( prvInsertTimerInActiveList( pxTimer, xMessage.u.xTimerParameters.xMessageValue + pxTimer->xTimerPeriodInTicks, xTimeNow, xMessage.u.xTimerParameters.xMessageValue ) != pdFALSE )
                             {
-                                xResult = xTimerGenericCommand( pxTimer, tmrCOMMAND_START_DONT_TRACE, xMessage.u.xTimerParameters.xMessageValue + pxTimer->xTimerPeriodInTicks, NULL, tmrNO_DELAY );
-                                configASSERT( xResult );
-                                ( void ) xResult;
+                                /* The timer expired before it was added to the active
+                                 * timer list.  Process it now. */
+                                pxTimer->pxCallbackFunction( ( TimerHandle_t ) pxTimer );
+                                traceTIMER_EXPIRED( pxTimer );
+
+                                if( ( pxTimer->ucStatus & tmrSTATUS_IS_AUTORELOAD ) != 0 )
+                                {
+                                    xResult = xTimerGenericCommand( pxTimer, tmrCOMMAND_START_DONT_TRACE, xMessage.u.xTimerParameters.xMessageValue + pxTimer->xTimerPeriodInTicks, NULL, tmrNO_DELAY );
+                                    configASSERT( xResult );
+                                    ( void ) xResult;
+                                }
+                                else
+                                {
+                                    mtCOVERAGE_TEST_MARKER();
+                                }
                             }
                             else
                             {
                                 mtCOVERAGE_TEST_MARKER();
                             }
-                        }
-                        else
-                        {
-                            mtCOVERAGE_TEST_MARKER();
-                        }
-
-                        break;
 
-                    case tmrCOMMAND_STOP:
-                    case tmrCOMMAND_STOP_FROM_ISR:
-                        /* The timer has already been removed from the active list. */
-                        pxTimer->ucStatus &= ~tmrSTATUS_IS_ACTIVE;
-                        break;
-
-                    case tmrCOMMAND_CHANGE_PERIOD:
-                    case tmrCOMMAND_CHANGE_PERIOD_FROM_ISR:
-                        pxTimer->ucStatus |= tmrSTATUS_IS_ACTIVE;
-                        pxTimer->xTimerPeriodInTicks = xMessage.u.xTimerParameters.xMessageValue;
-                        configASSERT( ( pxTimer->xTimerPeriodInTicks > 0 ) );
-
-                        /* The new period does not really have a reference, and can
-                         * be longer or shorter than the old one.  The command time is
-                         * therefore set to the current time, and as the period cannot
-                         * be zero the next expiry time can only be in the future,
-                         * meaning (unlike for the xTimerStart() case above) there is
-                         * no fail case that needs to be handled here. */
-                        ( void ) prvInsertTimerInActiveList( pxTimer, ( xTimeNow + pxTimer->xTimerPeriodInTicks ), xTimeNow, xTimeNow );
-                        break;
-
-                    case tmrCOMMAND_DELETE:
-                        #if ( configSUPPORT_DYNAMIC_ALLOCATION == 1 )
-                            {
-                                /* The timer has already been removed from the active list,
-                                 * just free up the memory if the memory was dynamically
-                                 * allocated. */
-                                if( ( pxTimer->ucStatus & tmrSTATUS_IS_STATICALLY_ALLOCATED ) == ( uint8_t ) 0 )
+                            break;
+
+                        case tmrCOMMAND_STOP:
+                        case tmrCOMMAND_STOP_FROM_ISR:
+                            /* The timer has already been removed from the active list. */
+                            pxTimer->ucStatus &= ~tmrSTATUS_IS_ACTIVE;
+                            break;
+
+                        case tmrCOMMAND_CHANGE_PERIOD:
+                        case tmrCOMMAND_CHANGE_PERIOD_FROM_ISR:
+                            pxTimer->ucStatus |= tmrSTATUS_IS_ACTIVE;
+                            pxTimer->xTimerPeriodInTicks = xMessage.u.xTimerParameters.xMessageValue;
+                            configASSERT( ( pxTimer->xTimerPeriodInTicks > 0 ) );
+
+                            /* The new period does not really have a reference, and can
+                             * be longer or shorter than the old one.  The command time is
+                             * therefore set to the current time, and as the period cannot
+                             * be zero the next expiry time can only be in the future,
+                             * meaning (unlike for the xTimerStart() case above) there is
+                             * no fail case that needs to be handled here. */
+                            ( void ) prvInsertTimerInActiveList( pxTimer, ( xTimeNow + pxTimer->xTimerPeriodInTicks ), xTimeNow, xTimeNow );
+                            break;
+
+                        case tmrCOMMAND_DELETE:
+                            #if ( configSUPPORT_DYNAMIC_ALLOCATION == 1 )
                                 {
-                                    vPortFree( pxTimer );
+                                    /* The timer has already been removed from the active list,
+                                     * just free up the memory if the memory was dynamically
+                                     * allocated. */
+                                    if( ( pxTimer->ucStatus & tmrSTATUS_IS_STATICALLY_ALLOCATED ) == ( uint8_t ) 0 )
+                                    {
+                                        vPortFree( pxTimer );
+                                    }
+                                    else
+                                    {
+                                        pxTimer->ucStatus &= ~tmrSTATUS_IS_ACTIVE;
+                                    }
                                 }
-                                else
+                            #else /* if ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) */
                                 {
+                                    /* If dynamic allocation is not enabled, the memory
+                                     * could not have been dynamically allocated. So there is
+                                     * no need to free the memory - just mark the timer as
+                                     * "not active". */
                                     pxTimer->ucStatus &= ~tmrSTATUS_IS_ACTIVE;
                                 }
-                            }
-                        #else /* if ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) */
-                            {
-                                /* If dynamic allocation is not enabled, the memory
-                                 * could not have been dynamically allocated. So there is
-                                 * no need to free the memory - just mark the timer as
-                                 * "not active". */
-                                pxTimer->ucStatus &= ~tmrSTATUS_IS_ACTIVE;
-                            }
-                        #endif /* configSUPPORT_DYNAMIC_ALLOCATION */
-                        break;
+                            #endif /* configSUPPORT_DYNAMIC_ALLOCATION */
+                            break;
 
-                    default:
-                        /* Don't expect to get here. */
-                        break;
+                        default:
+                            /* Don't expect to get here. */
+                            break;
+                    }
                 }
             }
         }
@@ -936,7 +998,7 @@ PRIVILEGED_DATA portMUX_TYPE xTimerMux = portMUX_INITIALIZER_UNLOCKED;
     static void prvSwitchTimerLists( void )
     {
         TickType_t xNextExpireTime, xReloadTime;
-        List_t * pxTemp;
+        TimerList_t * pxTemp;
         Timer_t * pxTimer;
         BaseType_t xResult;
 
@@ -944,13 +1006,13 @@ PRIVILEGED_DATA portMUX_TYPE xTimerMux = portMUX_INITIALIZER_UNLOCKED;
          * If there are any timers still referenced from the current timer list
          * then they must have expired and should be processed before the lists
          * are switched. */
-        while( listLIST_IS_EMPTY( pxCurrentTimerList ) == pdFALSE )
+        while( prvTimerListIsEmpty( pxCurrentTimerList ) == pdFALSE )
         {
-            xNextExpireTime = listGET_ITEM_VALUE_OF_HEAD_ENTRY( pxCurrentTimerList );
+            pxTimer = prvTimerListGetFirst( pxCurrentTimerList );
+            xNextExpireTime = listGET_LIST_ITEM_VALUE( &( pxTimer->xTimerListItem ) );
 
             /* Remove the timer from the list. */
-            pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxCurrentTimerList ); /*lint !e9087 !e9079 void * is used as this macro is used with tasks and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
-            ( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
+            prvTimerListRemove( pxTimer );
             traceTIMER_EXPIRED( pxTimer );
 
             /* Execute its callback, then send a command to restart the timer if
@@ -972,7 +1034,7 @@ PRIVILEGED_DATA portMUX_TYPE xTimerMux = portMUX_INITIALIZER_UNLOCKED;
                 {
                     listSET_LIST_ITEM_VALUE( &( pxTimer->xTimerListItem ), xReloadTime );
                     listSET_LIST_ITEM_OWNER( &( pxTimer->xTimerListItem ), pxTimer );
-                    vListInsert( pxCurrentTimerList, &( pxTimer->xTimerListItem ) );
+                    prvTimerListInsert( pxCurrentTimerList, pxTimer );
                 }
                 else
                 {
@@ -993,6 +1055,143 @@ PRIVILEGED_DATA portMUX_TYPE xTimerMux = portMUX_INITIALIZER_UNLOCKED;
     }
 /*-----------------------------------------------------------*/
 
+    #if ( configUSE_TIMER_WHEEL == 1 )
+
+        static void prvTimerListInitialise( TimerList_t * const pxList )
+        {
+            UBaseType_t uxSlot;
+
+            for( uxSlot = ( UBaseType_t ) 0U; uxSlot < ( UBaseType_t ) configTIMER_WHEEL_SLOTS; uxSlot++ )
+            {
+                vListInitialise( &( pxList->xSlots[ uxSlot ] ) );
+            }
+
+            pxList->uxNumberOfTimers = ( UBaseType_t ) 0U;
+            pxList->xFirstExpireTime = ( TickType_t ) 0U;
+            pxList->pxFirstTimer = NULL;
+        }
+/*-----------------------------------------------------------*/
+
+        static void prvTimerListInsert( TimerList_t * const pxList,
+                                        Timer_t * const pxTimer )
+        {
+            const TickType_t xExpireTime = listGET_LIST_ITEM_VALUE( &( pxTimer->xTimerListItem ) );
+
+            vListInsertEnd( &( pxList->xSlots[ xExpireTime & ( TickType_t ) ( configTIMER_WHEEL_SLOTS - 1 ) ] ), &( pxTimer->xTimerListItem ) );
+
+            /* A timer expiring at the same time as the first timer goes after
+             * it, so only a timer that expires strictly earlier becomes the
+             * first timer. */
+            if( ( pxList->uxNumberOfTimers == ( UBaseType_t ) 0U ) || ( xExpireTime < pxList->xFirstExpireTime ) )
+            {
+                pxList->xFirstExpireTime = xExpireTime;
+                pxList->pxFirstTimer = pxTimer;
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+
+            ( pxList->uxNumberOfTimers )++;
+        }
+/*-----------------------------------------------------------*/
+
+        static void prvTimerListRemove( Timer_t * const pxTimer )
+        {
+            const List_t * const pxSlot = listLIST_ITEM_CONTAINER( &( pxTimer->xTimerListItem ) );
+            TimerList_t * pxList;
+
+            /* Find the wheel from the slot the timer is in. */
+            if( ( pxSlot >= &( xActiveTimerList1.xSlots[ 0 ] ) ) && ( pxSlot < &( xActiveTimerList1.xSlots[ configTIMER_WHEEL_SLOTS ] ) ) )
+            {
+                pxList = &xActiveTimerList1;
+            }
+            else
+            {
+                pxList = &xActiveTimerList2;
+            }
+
+            ( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
+            ( pxList->uxNumberOfTimers )--;
+
+            /* The expire time of the removed timer is still a lower bound for the
+             * remaining timers, the next call to prvTimerListGetFirst() walks
+             * the wheel forward from it. */
+            if( pxList->pxFirstTimer == pxTimer )
+            {
+                pxList->pxFirstTimer = NULL;
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+        }
+/*-----------------------------------------------------------*/
+
+        static Timer_t * prvTimerListGetFirst( TimerList_t * const pxList )
+        {
+            TickType_t xExpireTime = pxList->xFirstExpireTime;
+            TickType_t xItemValue;
+            UBaseType_t uxSlot;
+            const List_t * pxSlot;
+            const ListItem_t * pxItem;
+            const ListItem_t * pxFirstItem = NULL;
+
+            configASSERT( pxList->uxNumberOfTimers != ( UBaseType_t ) 0U );
+
+            if( pxList->pxFirstTimer == NULL )
+            {
+                /* Walk one turn of the wheel, one tick per slot, from the lower
+                 * bound.  The first timer found expiring exactly at the tick of
+                 * its slot is the first timer.  If the first timer is more than a
+                 * turn away, every slot has been visited once and the earliest
+                 * timer seen is the first timer.  Timers are visited in insertion
+                 * order within a slot, so ties go to the timer inserted first. */
+                for( uxSlot = ( UBaseType_t ) 0U; uxSlot < ( UBaseType_t ) configTIMER_WHEEL_SLOTS; uxSlot++ )
+                {
+                    pxSlot = &( pxList->xSlots[ xExpireTime & ( TickType_t ) ( configTIMER_WHEEL_SLOTS - 1 ) ] );
+
+                    for( pxItem = listGET_HEAD_ENTRY( pxSlot ); pxItem != listGET_END_MARKER( pxSlot ); pxItem = listGET_NEXT( pxItem ) )
+                    {
+                        xItemValue = listGET_LIST_ITEM_VALUE( pxItem );
+
+                        if( xItemValue == xExpireTime )
+                        {
+                            pxFirstItem = pxItem;
+                            break;
+                        }
+                        else if( ( pxFirstItem == NULL ) || ( xItemValue < listGET_LIST_ITEM_VALUE( pxFirstItem ) ) )
+                        {
+                            pxFirstItem = pxItem;
+                        }
+                        else
+                        {
+                            mtCOVERAGE_TEST_MARKER();
+                        }
+                    }
+
+                    if( ( pxFirstItem != NULL ) && ( listGET_LIST_ITEM_VALUE( pxFirstItem ) == xExpireTime ) )
+                    {
+                        break;
+                    }
+
+                    xExpireTime++;
+                }
+
+                pxList->pxFirstTimer = ( Timer_t * ) listGET_LIST_ITEM_OWNER( pxFirstItem ); /*lint !e9087 !e9079 void * is used as this macro is used with tasks and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
+                pxList->xFirstExpireTime = listGET_LIST_ITEM_VALUE( pxFirstItem );
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+
+            return pxList->pxFirstTimer;
+        }
+/*-----------------------------------------------------------*/
+
+    #endif /* configUSE_TIMER_WHEEL */
+
     static void prvCheckForValidListAndQueue( void )
     {
         /* Check that the list from which active timers are referenced, and the
@@ -1002,8 +1201,8 @@ PRIVILEGED_DATA portMUX_TYPE xTimerMux = portMUX_INITIALIZER_UNLOCKED;
         {
             if( xTimerQueue == NULL )
             {
-                vListInitialise( &xActiveTimerList1 );
-                vListInitialise( &xActiveTimerList2 );
+                prvTimerListInitialise( &xActiveTimerList1 );
+                prvTimerListInitialise( &xActiveTimerList2 );
                 pxCurrentTimerList = &xActiveTimerList1;
                 pxOverflowTimerList = &xActiveTimerList2;
 
@@ -181,6 +181,10 @@ This file get's pulled into assembly sources. Therefore, some includes need to b
 #define configTIMER_TASK_PRIORITY                       CONFIG_FREERTOS_TIMER_TASK_PRIORITY
 #define configTIMER_QUEUE_LENGTH                        CONFIG_FREERTOS_TIMER_QUEUE_LENGTH
 #define configTIMER_TASK_STACK_DEPTH                    CONFIG_FREERTOS_TIMER_TASK_STACK_DEPTH
+#if CONFIG_FREERTOS_TIMER_WHEEL
+#define configUSE_TIMER_WHEEL                           1
+#define configTIMER_WHEEL_SLOTS                         CONFIG_FREERTOS_TIMER_WHEEL_SLOTS
+#endif
 
 // -------------------- API Includes -----------------------
 
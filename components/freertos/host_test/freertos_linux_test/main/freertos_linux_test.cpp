@@ -0,0 +1,544 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define CATCH_CONFIG_RUNNER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "freertos/stream_buffer.h"
+
+#include "catch.hpp"
+
+using namespace std::chrono;
+
+/* Tasks created by the tests don't use the C library (see the limitations in portable/linux/port.c) */
+static const uint32_t TEST_STACK_SIZE = 2048;
+static const UBaseType_t TEST_PRIO = 5;
+
+static SemaphoreHandle_t s_done;
+
+static void wait_done(int count)
+{
+    for (int i = 0; i < count; i++) {
+        REQUIRE(xSemaphoreTake(s_done, pdMS_TO_TICKS(10000)) == pdTRUE);
+    }
+}
+
+static double seconds_since(steady_clock::time_point start)
+{
+    return duration<double>(steady_clock::now() - start).count();
+}
+
+// ---------------------------------------- Scheduling ----------------------------------------
+
+static void core_id_task(void *arg)
+{
+    *(BaseType_t *) arg = xPortGetCoreID();
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("tasks run on the core they are pinned to")
+{
+    BaseType_t core_ids[portNUM_PROCESSORS];
+
+    for (BaseType_t i = 0; i < portNUM_PROCESSORS; i++) {
+        core_ids[i] = -1;
+        REQUIRE(xTaskCreatePinnedToCore(core_id_task, "core_id", TEST_STACK_SIZE, &core_ids[i], TEST_PRIO, NULL, i) == pdTRUE);
+    }
+    wait_done(portNUM_PROCESSORS);
+    for (BaseType_t i = 0; i < portNUM_PROCESSORS; i++) {
+        CHECK(core_ids[i] == i);
+    }
+}
+
+static volatile bool s_stop;
+
+static void spin_task(void *arg)
+{
+    volatile uint64_t *count = (volatile uint64_t *) arg;
+    while (!s_stop) {
+        (*count)++;
+    }
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("tasks of equal priority share their core")
+{
+    static volatile uint64_t counts[3];
+
+    s_stop = false;
+    for (int i = 0; i < 3; i++) {
+        counts[i] = 0;
+        REQUIRE(xTaskCreatePinnedToCore(spin_task, "spin", TEST_STACK_SIZE, (void *) &counts[i], TEST_PRIO, NULL, 1) == pdTRUE);
+    }
+    vTaskDelay(pdMS_TO_TICKS(100));
+    s_stop = true;
+    wait_done(3);
+    for (int i = 0; i < 3; i++) {
+        CHECK(counts[i] > 0);
+    }
+}
+
+static void periodic_task(void *arg)
+{
+    volatile int *count = (volatile int *) arg;
+    for (int i = 0; i < 10; i++) {
+        vTaskDelay(2);
+        (*count)++;
+    }
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("tick wakes up a higher priority task while the core is busy")
+{
+    static volatile uint64_t spin_count;
+    static volatile int periodic_count;
+
+    s_stop = false;
+    spin_count = 0;
+    periodic_count = 0;
+    REQUIRE(xTaskCreatePinnedToCore(spin_task, "spin", TEST_STACK_SIZE, (void *) &spin_count, TEST_PRIO, NULL, 1) == pdTRUE);
+    REQUIRE(xTaskCreatePinnedToCore(periodic_task, "periodic", TEST_STACK_SIZE, (void *) &periodic_count, TEST_PRIO + 1, NULL, 1) == pdTRUE);
+    REQUIRE(xSemaphoreTake(s_done, pdMS_TO_TICKS(1000)) == pdTRUE);
+    CHECK(periodic_count == 10);
+    s_stop = true;
+    wait_done(1);
+    CHECK(spin_count > 0);
+}
+
+static void block_forever_task(void *arg)
+{
+    uint32_t item;
+    xQueueReceive((QueueHandle_t) arg, &item, portMAX_DELAY);
+    abort();
+}
+
+TEST_CASE("tasks blocked on either core can be deleted")
+{
+    QueueHandle_t queue = xQueueCreate(1, sizeof(uint32_t));
+    REQUIRE(queue != NULL);
+    UBaseType_t tasks_before = uxTaskGetNumberOfTasks();
+
+    for (int i = 0; i < 20; i++) {
+        TaskHandle_t task;
+        REQUIRE(xTaskCreatePinnedToCore(block_forever_task, "blocked", TEST_STACK_SIZE, queue, TEST_PRIO, &task, i % 2) == pdTRUE);
+        vTaskDelay(i % 3);
+        vTaskDelete(task);
+    }
+    // Tasks deleted while pinned to the other core are freed by its idle task. Self-deleted tasks of the previous
+    // tests may still be counted in tasks_before, so the count can also end up lower.
+    for (int i = 0; i < 100 && uxTaskGetNumberOfTasks() > tasks_before; i++) {
+        vTaskDelay(1);
+    }
+    CHECK(uxTaskGetNumberOfTasks() <= tasks_before);
+    vQueueDelete(queue);
+}
+
+static SemaphoreHandle_t s_mutex;
+static volatile int s_shared_counter;
+
+static void increment_task(void *arg)
+{
+    for (int i = 0; i < 1000; i++) {
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        int value = s_shared_counter;
+        for (volatile int j = 0; j < 10; j++) {
+        }
+        s_shared_counter = value + 1;
+        xSemaphoreGive(s_mutex);
+        if (i % 100 == 0) {
+            vTaskDelay(1);
+        }
+    }
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("mutex protects data shared by tasks on both cores")
+{
+    s_mutex = xSemaphoreCreateMutex();
+    REQUIRE(s_mutex != NULL);
+    s_shared_counter = 0;
+
+    for (int i = 0; i < 4; i++) {
+        BaseType_t core = (i == 3) ? tskNO_AFFINITY : (i % 2);
+        REQUIRE(xTaskCreatePinnedToCore(increment_task, "increment", TEST_STACK_SIZE, NULL, TEST_PRIO + i % 2, NULL, core) == pdTRUE);
+    }
+    wait_done(4);
+    CHECK(s_shared_counter == 4000);
+    vSemaphoreDelete(s_mutex);
+}
+
+static void timer_callback(TimerHandle_t timer)
+{
+    volatile int *count = (volatile int *) pvTimerGetTimerID(timer);
+    (*count)++;
+}
+
+TEST_CASE("software timer expires periodically")
+{
+    static volatile int count;
+
+    count = 0;
+    TimerHandle_t timer = xTimerCreate("timer", pdMS_TO_TICKS(10), pdTRUE, (void *) &count, timer_callback);
+    REQUIRE(timer != NULL);
+    REQUIRE(xTimerStart(timer, portMAX_DELAY) == pdPASS);
+    vTaskDelay(pdMS_TO_TICKS(105));
+    REQUIRE(xTimerStop(timer, portMAX_DELAY) == pdPASS);
+    // A tick of margin, the host may delay the timer task a bit
+    CHECK(count >= 9);
+    CHECK(count <= 10);
+    REQUIRE(xTimerDelete(timer, portMAX_DELAY) == pdPASS);
+}
+
+static int s_expired[8];
+static volatile int s_expired_count;
+
+static void order_callback(TimerHandle_t timer)
+{
+    s_expired[s_expired_count++] = (int) (intptr_t) pvTimerGetTimerID(timer);
+}
+
+TEST_CASE("software timers expire in order of their expiry time")
+{
+    TimerHandle_t timers[8];
+
+    s_expired_count = 0;
+    // Started out of order, timer i expires after (i + 1) * 5 ticks
+    for (int i = 0; i < 8; i++) {
+        int n = (i * 3) % 8;
+        timers[n] = xTimerCreate("order", (n + 1) * 5, pdFALSE, (void *) (intptr_t) n, order_callback);
+        REQUIRE(timers[n] != NULL);
+        REQUIRE(xTimerStart(timers[n], portMAX_DELAY) == pdPASS);
+    }
+    vTaskDelay(50);
+    REQUIRE(s_expired_count == 8);
+    for (int i = 0; i < 8; i++) {
+        CHECK(s_expired[i] == i);
+        REQUIRE(xTimerDelete(timers[i], portMAX_DELAY) == pdPASS);
+    }
+}
+
+TEST_CASE("queue items are sent and received in batches")
+{
+    QueueHandle_t queue = xQueueCreate(5, sizeof(uint32_t));
+    REQUIRE(queue != NULL);
+    uint32_t items[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    uint32_t received[8];
+
+    // Only as many items as the queue has room for are sent without blocking
+    CHECK(xQueueSendMultiple(queue, items, 8, 0) == 5);
+    CHECK(xQueueReceiveMultiple(queue, received, 3, 0) == 3);
+    CHECK(received[0] == 0);
+    CHECK(received[2] == 2);
+    // The storage area wraps around
+    CHECK(xQueueSendMultiple(queue, &items[5], 3, 0) == 3);
+    CHECK(uxQueueMessagesWaiting(queue) == 5);
+    CHECK(xQueueReceiveMultiple(queue, received, 8, 0) == 5);
+    for (int i = 0; i < 5; i++) {
+        CHECK(received[i] == (uint32_t) (i + 3));
+    }
+    CHECK(xQueueReceiveMultiple(queue, received, 8, 1) == 0);
+    vQueueDelete(queue);
+}
+
+static void batch_receive_task(void *arg)
+{
+    QueueHandle_t queue = (QueueHandle_t) arg;
+    uint32_t expected = 0;
+    uint32_t items[4];
+    bool in_order = true;
+    while (expected < 1000) {
+        size_t count = xQueueReceiveMultiple(queue, items, 4, portMAX_DELAY);
+        for (size_t i = 0; i < count; i++) {
+            in_order = in_order && items[i] == expected++;
+        }
+    }
+    if (in_order) {
+        xSemaphoreGive(s_done);
+    }
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("batch send blocks until all items are sent")
+{
+    QueueHandle_t queue = xQueueCreate(5, sizeof(uint32_t));
+    REQUIRE(queue != NULL);
+    REQUIRE(xTaskCreatePinnedToCore(batch_receive_task, "receive", TEST_STACK_SIZE, queue, TEST_PRIO, NULL, 1) == pdTRUE);
+
+    uint32_t items[100];
+    for (uint32_t batch = 0; batch < 10; batch++) {
+        for (uint32_t i = 0; i < 100; i++) {
+            items[i] = batch * 100 + i;
+        }
+        REQUIRE(xQueueSendMultiple(queue, items, 100, portMAX_DELAY) == 100);
+    }
+    wait_done(1);
+    vQueueDelete(queue);
+}
+
+TEST_CASE("stream buffer space is reserved and data is peeked across the wrap")
+{
+    // A stream buffer of 10 bytes has an 11 byte storage area
+    StreamBufferHandle_t sb = xStreamBufferCreate(10, 1);
+    REQUIRE(sb != NULL);
+    StreamBufferSpan_t spans[2];
+    uint8_t received[5];
+
+    CHECK(xStreamBufferReserve(sb, 20, spans, 0) == 10);
+    CHECK(spans[1].xLength == 0);
+    memcpy(spans[0].pucData, "abcdefg", 7);
+    CHECK(xStreamBufferCommit(sb, 7) == 7);
+    CHECK(xStreamBufferReceive(sb, received, 5, 0) == 5);
+
+    // The free space wraps around the end of the storage area
+    CHECK(xStreamBufferReserve(sb, 20, spans, 0) == 8);
+    CHECK(spans[0].xLength == 4);
+    CHECK(spans[1].xLength == 4);
+    memcpy(spans[0].pucData, "hijk", 4);
+    spans[1].pucData[0] = 'l';
+    CHECK(xStreamBufferCommit(sb, 5) == 5);
+
+    // So does the data, which is only removed when it is consumed
+    CHECK(xStreamBufferPeekSpans(sb, spans, 0) == 7);
+    CHECK(memcmp(spans[0].pucData, "fghijk", 6) == 0);
+    CHECK(spans[1].xLength == 1);
+    CHECK(spans[1].pucData[0] == 'l');
+    CHECK(xStreamBufferBytesAvailable(sb) == 7);
+    CHECK(xStreamBufferConsume(sb, 7) == 7);
+    CHECK(xStreamBufferIsEmpty(sb) == pdTRUE);
+    CHECK(xStreamBufferPeekSpans(sb, spans, 1) == 0);
+    vStreamBufferDelete(sb);
+}
+
+// ---------------------------------------- Benchmarks ----------------------------------------
+
+static const uint32_t BENCH_QUEUE_ITEMS = 100000;
+static const int BENCH_ROUND_TRIPS = 10000;
+
+static QueueHandle_t s_queue;
+
+static void queue_send_task(void *arg)
+{
+    for (uint32_t i = 0; i < BENCH_QUEUE_ITEMS; i++) {
+        xQueueSend(s_queue, &i, portMAX_DELAY);
+    }
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+static void queue_receive_task(void *arg)
+{
+    volatile bool *in_order = (volatile bool *) arg;
+    uint32_t item;
+    for (uint32_t i = 0; i < BENCH_QUEUE_ITEMS; i++) {
+        xQueueReceive(s_queue, &item, portMAX_DELAY);
+        if (item != i) {
+            *in_order = false;
+        }
+    }
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("queue throughput", "[bench]")
+{
+    s_queue = xQueueCreate(8, sizeof(uint32_t));
+    REQUIRE(s_queue != NULL);
+
+    for (BaseType_t sender_core = 0; sender_core < portNUM_PROCESSORS; sender_core++) {
+        for (BaseType_t receiver_core = 0; receiver_core < portNUM_PROCESSORS; receiver_core++) {
+            static volatile bool in_order;
+            in_order = true;
+            auto start = steady_clock::now();
+            REQUIRE(xTaskCreatePinnedToCore(queue_receive_task, "receive", TEST_STACK_SIZE, (void *) &in_order, TEST_PRIO, NULL, receiver_core) == pdTRUE);
+            REQUIRE(xTaskCreatePinnedToCore(queue_send_task, "send", TEST_STACK_SIZE, NULL, TEST_PRIO, NULL, sender_core) == pdTRUE);
+            wait_done(2);
+            double elapsed = seconds_since(start);
+            CHECK(in_order);
+            printf("queue throughput, sender on core %d, receiver on core %d: %.0f items/s\n",
+                   sender_core, receiver_core, BENCH_QUEUE_ITEMS / elapsed);
+        }
+    }
+    vQueueDelete(s_queue);
+}
+
+static const uint32_t BENCH_BATCH_SIZES[] = {1, 8, 32};
+
+static void batch_send_task(void *arg)
+{
+    size_t batch = *(size_t *) arg;
+    uint32_t items[32];
+    for (uint32_t i = 0; i < BENCH_QUEUE_ITEMS; i += batch) {
+        for (size_t j = 0; j < batch; j++) {
+            items[j] = i + j;
+        }
+        xQueueSendMultiple(s_queue, items, batch, portMAX_DELAY);
+    }
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+static void batch_bench_receive_task(void *arg)
+{
+    size_t batch = *(size_t *) arg;
+    uint32_t items[32];
+    for (uint32_t received = 0; received < BENCH_QUEUE_ITEMS; ) {
+        received += xQueueReceiveMultiple(s_queue, items, batch, portMAX_DELAY);
+    }
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("batched queue throughput", "[bench]")
+{
+    s_queue = xQueueCreate(64, sizeof(uint32_t));
+    REQUIRE(s_queue != NULL);
+
+    for (BaseType_t receiver_core = 0; receiver_core < portNUM_PROCESSORS; receiver_core++) {
+        for (size_t b = 0; b < sizeof(BENCH_BATCH_SIZES) / sizeof(BENCH_BATCH_SIZES[0]); b++) {
+            static size_t batch;
+            batch = BENCH_BATCH_SIZES[b];
+            auto start = steady_clock::now();
+            REQUIRE(xTaskCreatePinnedToCore(batch_bench_receive_task, "receive", TEST_STACK_SIZE, &batch, TEST_PRIO, NULL, receiver_core) == pdTRUE);
+            REQUIRE(xTaskCreatePinnedToCore(batch_send_task, "send", TEST_STACK_SIZE, &batch, TEST_PRIO, NULL, 0) == pdTRUE);
+            wait_done(2);
+            double elapsed = seconds_since(start);
+            printf("batched queue throughput, batches of %u, receiver on %s core: %.0f items/s\n",
+                   (unsigned) batch, receiver_core == 0 ? "same" : "other", BENCH_QUEUE_ITEMS / elapsed);
+        }
+    }
+    vQueueDelete(s_queue);
+}
+
+static SemaphoreHandle_t s_ping;
+static SemaphoreHandle_t s_pong;
+
+static void pong_task(void *arg)
+{
+    for (int i = 0; i < BENCH_ROUND_TRIPS; i++) {
+        xSemaphoreTake(s_ping, portMAX_DELAY);
+        xSemaphoreGive(s_pong);
+    }
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+static void ping_task(void *arg)
+{
+    for (int i = 0; i < BENCH_ROUND_TRIPS; i++) {
+        xSemaphoreGive(s_ping);
+        xSemaphoreTake(s_pong, portMAX_DELAY);
+    }
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("semaphore round trip time", "[bench]")
+{
+    s_ping = xSemaphoreCreateBinary();
+    s_pong = xSemaphoreCreateBinary();
+    REQUIRE(s_ping != NULL);
+    REQUIRE(s_pong != NULL);
+
+    for (BaseType_t pong_core = 0; pong_core < portNUM_PROCESSORS; pong_core++) {
+        auto start = steady_clock::now();
+        REQUIRE(xTaskCreatePinnedToCore(pong_task, "pong", TEST_STACK_SIZE, NULL, TEST_PRIO, NULL, pong_core) == pdTRUE);
+        REQUIRE(xTaskCreatePinnedToCore(ping_task, "ping", TEST_STACK_SIZE, NULL, TEST_PRIO, NULL, 0) == pdTRUE);
+        wait_done(2);
+        double elapsed = seconds_since(start);
+        printf("semaphore round trip, %s core: %.1f us\n", pong_core == 0 ? "same" : "other",
+               elapsed * 1e6 / BENCH_ROUND_TRIPS);
+    }
+    vSemaphoreDelete(s_ping);
+    vSemaphoreDelete(s_pong);
+}
+
+static const int BENCH_TIMER_COMMANDS = 20000;
+
+static void give_done(void *arg, uint32_t unused)
+{
+    xSemaphoreGive(s_done);
+}
+
+TEST_CASE("timer command throughput", "[bench]")
+{
+    const int ACTIVE_TIMERS[] = {10, 100, 1000};
+
+    for (int active : ACTIVE_TIMERS) {
+        TimerHandle_t *timers = (TimerHandle_t *) calloc(active, sizeof(TimerHandle_t));
+        REQUIRE(timers != NULL);
+        // Long and different periods, no timer expires and each restart moves the timer
+        for (int i = 0; i < active; i++) {
+            timers[i] = xTimerCreate("bench", 100000 + rand() % 50000, pdFALSE, NULL, timer_callback);
+            REQUIRE(timers[i] != NULL);
+            REQUIRE(xTimerStart(timers[i], portMAX_DELAY) == pdPASS);
+        }
+        REQUIRE(xTimerPendFunctionCall(give_done, NULL, 0, portMAX_DELAY) == pdPASS);
+        wait_done(1);
+
+        auto start = steady_clock::now();
+        for (int i = 0; i < BENCH_TIMER_COMMANDS; i++) {
+            xTimerChangePeriod(timers[rand() % active], 100000 + rand() % 50000, portMAX_DELAY);
+        }
+        REQUIRE(xTimerPendFunctionCall(give_done, NULL, 0, portMAX_DELAY) == pdPASS);
+        wait_done(1);
+        double elapsed = seconds_since(start);
+        printf("%d active timers: %.0f timer commands/s\n", active, BENCH_TIMER_COMMANDS / elapsed);
+
+        for (int i = 0; i < active; i++) {
+            REQUIRE(xTimerDelete(timers[i], portMAX_DELAY) == pdPASS);
+        }
+        free(timers);
+    }
+}
+
+static void delay_task(void *arg)
+{
+    double *max_late = (double *) arg;
+    TickType_t last_wake = xTaskGetTickCount();
+    auto expected = steady_clock::now();
+    for (int i = 0; i < 200; i++) {
+        vTaskDelayUntil(&last_wake, 1);
+        expected += milliseconds(portTICK_PERIOD_MS);
+        double late = duration<double>(steady_clock::now() - expected).count();
+        if (late > *max_late) {
+            *max_late = late;
+        }
+    }
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("tick wake up latency", "[bench]")
+{
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++) {
+        static double max_late;
+        max_late = 0;
+        REQUIRE(xTaskCreatePinnedToCore(delay_task, "delay", TEST_STACK_SIZE, &max_late, TEST_PRIO, NULL, core) == pdTRUE);
+        wait_done(1);
+        printf("periodic wake up on core %d, max lateness: %.1f us\n", core, max_late * 1e6);
+    }
+}
+
+extern "C" void app_main(void)
+{
+    s_done = xSemaphoreCreateCounting(16, 0);
+    assert(s_done != NULL);
+
+    int result = Catch::Session().run();
+    exit(result);
+}
@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+ Unit tests & benchmarks for the batched queue functions xQueueSendMultiple() / xQueueReceiveMultiple()
+*/
+
+#include <stdio.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "unity.h"
+#include "esp_timer.h"
+#include "test_utils.h"
+
+#ifndef CONFIG_FREERTOS_SMP
+
+#define QUEUE_LEN               5
+#define BENCH_QUEUE_LEN         64
+#define BENCH_ITEMS             20000
+#define MAX_BATCH               32
+
+TEST_CASE("Queue batched send and receive", "[freertos]")
+{
+    QueueHandle_t queue = xQueueCreate(QUEUE_LEN, sizeof(uint32_t));
+    TEST_ASSERT_NOT_NULL(queue);
+    uint32_t items[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    uint32_t received[8];
+
+    //Only as many items as the queue has room for are sent without blocking
+    TEST_ASSERT_EQUAL(QUEUE_LEN, xQueueSendMultiple(queue, items, 8, 0));
+    TEST_ASSERT_EQUAL(3, xQueueReceiveMultiple(queue, received, 3, 0));
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(items, received, 3);
+
+    //Items wrap around the end of the queue storage area
+    TEST_ASSERT_EQUAL(3, xQueueSendMultiple(queue, &items[5], 3, 0));
+    TEST_ASSERT_EQUAL(QUEUE_LEN, uxQueueMessagesWaiting(queue));
+    TEST_ASSERT_EQUAL(QUEUE_LEN, xQueueReceiveMultiple(queue, received, 8, 0));
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(&items[3], received, QUEUE_LEN);
+
+    //Receiving from an empty queue times out without items
+    TEST_ASSERT_EQUAL(0, xQueueReceiveMultiple(queue, received, 8, 1));
+    vQueueDelete(queue);
+}
+
+TEST_CASE("Queue batched send notifies queue set once per item", "[freertos]")
+{
+    QueueSetHandle_t set = xQueueCreateSet(QUEUE_LEN);
+    QueueHandle_t queue = xQueueCreate(QUEUE_LEN, sizeof(uint32_t));
+    TEST_ASSERT_NOT_NULL(set);
+    TEST_ASSERT_NOT_NULL(queue);
+    TEST_ASSERT_EQUAL(pdPASS, xQueueAddToSet(queue, set));
+
+    uint32_t items[3] = {10, 11, 12};
+    TEST_ASSERT_EQUAL(3, xQueueSendMultiple(queue, items, 3, 0));
+    for (int i = 0; i < 3; i++) {
+        uint32_t item;
+        TEST_ASSERT_EQUAL(queue, xQueueSelectFromSet(set, 0));
+        TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(queue, &item, 0));
+        TEST_ASSERT_EQUAL(items[i], item);
+    }
+    TEST_ASSERT_NULL(xQueueSelectFromSet(set, 0));
+
+    TEST_ASSERT_EQUAL(pdPASS, xQueueRemoveFromSet(queue, set));
+    vQueueDelete(queue);
+    vQueueDelete(set);
+}
+
+static QueueHandle_t bench_queue;
+static SemaphoreHandle_t done_sem;
+static size_t batch_size;
+static volatile bool in_order;
+
+static void task_batch_send(void *arg)
+{
+    uint32_t items[MAX_BATCH];
+    for (uint32_t i = 0; i < BENCH_ITEMS; i += batch_size) {
+        for (size_t j = 0; j < batch_size; j++) {
+            items[j] = i + j;
+        }
+        xQueueSendMultiple(bench_queue, items, batch_size, portMAX_DELAY);
+    }
+    xSemaphoreGive(done_sem);
+    vTaskDelete(NULL);
+}
+
+static void task_batch_receive(void *arg)
+{
+    uint32_t items[MAX_BATCH];
+    uint32_t expected = 0;
+    while (expected < BENCH_ITEMS) {
+        size_t count = xQueueReceiveMultiple(bench_queue, items, batch_size, portMAX_DELAY);
+        for (size_t j = 0; j < count; j++) {
+            if (items[j] != expected++) {
+                in_order = false;
+            }
+        }
+    }
+    xSemaphoreGive(done_sem);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("Queue batched send and receive throughput", "[freertos]")
+{
+    const size_t batch_sizes[] = {1, 8, MAX_BATCH};
+    bench_queue = xQueueCreate(BENCH_QUEUE_LEN, sizeof(uint32_t));
+    done_sem = xSemaphoreCreateCounting(2, 0);
+    TEST_ASSERT_NOT_NULL(bench_queue);
+    TEST_ASSERT_NOT_NULL(done_sem);
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        for (size_t i = 0; i < sizeof(batch_sizes) / sizeof(batch_sizes[0]); i++) {
+            batch_size = batch_sizes[i];
+            in_order = true;
+            int64_t start = esp_timer_get_time();
+            xTaskCreatePinnedToCore(task_batch_receive, "receive", 2048, NULL, UNITY_FREERTOS_PRIORITY + 1, NULL, core);
+            xTaskCreatePinnedToCore(task_batch_send, "send", 2048, NULL, UNITY_FREERTOS_PRIORITY + 1, NULL, 0);
+            for (int j = 0; j < 2; j++) {
+                TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(done_sem, pdMS_TO_TICKS(10000)));
+            }
+            int64_t elapsed_us = esp_timer_get_time() - start;
+            TEST_ASSERT_TRUE(in_order);
+            IDF_LOG_PERFORMANCE("Batched queue items per second", "%lld, batches of %u, receiver on core %d",
+                                (long long)BENCH_ITEMS * 1000000 / elapsed_us, (unsigned)batch_size, core);
+        }
+    }
+
+    vSemaphoreDelete(done_sem);
+    vQueueDelete(bench_queue);
+}
+
+#endif // CONFIG_FREERTOS_SMP
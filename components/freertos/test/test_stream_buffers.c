@@ -101,3 +101,58 @@ TEST_CASE("Send-receive stream buffer test", "[freertos]")
     vStreamBufferDelete(tc.sb);
     vSemaphoreDelete(tc.end_test);
 }
+
+#define SPANS_TEST_BYTES    4000
+
+static void reserve_commit_task(void *arg)
+{
+    test_context *tc = arg;
+    StreamBufferSpan_t spans[2];
+    uint32_t written = 0;
+
+    while (written < SPANS_TEST_BYTES) {
+        size_t reserved = xStreamBufferReserve(tc->sb, 37, spans, portMAX_DELAY);
+        for (int i = 0; i < 2; i++) {
+            for (size_t j = 0; j < spans[i].xLength; j++) {
+                spans[i].pucData[j] = (uint8_t)written++;
+            }
+        }
+        if (xStreamBufferCommit(tc->sb, reserved) != reserved) {
+            tc->send_fail = true;
+        }
+    }
+    xSemaphoreGive(tc->end_test);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("Stream buffer data is written and parsed in place", "[freertos]")
+{
+    test_context tc = { 0 };
+    StreamBufferSpan_t spans[2];
+    uint32_t parsed = 0;
+
+    tc.sb = xStreamBufferCreate(100, 1);
+    tc.end_test = xSemaphoreCreateBinary();
+    TEST_ASSERT(tc.sb);
+    TEST_ASSERT(tc.end_test);
+    TEST_ASSERT(xTaskCreatePinnedToCore(reserve_commit_task, "writer", 4096, &tc, UNITY_FREERTOS_PRIORITY + 1, NULL, !xPortGetCoreID()) == pdTRUE);
+
+    while (parsed < SPANS_TEST_BYTES) {
+        size_t available = xStreamBufferPeekSpans(tc.sb, spans, pdMS_TO_TICKS(1000));
+        TEST_ASSERT_NOT_EQUAL(0, available);
+        TEST_ASSERT_EQUAL(available, spans[0].xLength + spans[1].xLength);
+        for (int i = 0; i < 2; i++) {
+            for (size_t j = 0; j < spans[i].xLength; j++) {
+                TEST_ASSERT_EQUAL_HEX8((uint8_t)parsed++, spans[i].pucData[j]);
+            }
+        }
+        TEST_ASSERT_EQUAL(available, xStreamBufferConsume(tc.sb, available));
+    }
+
+    TEST_ASSERT(xSemaphoreTake(tc.end_test, pdMS_TO_TICKS(1000)) == pdTRUE);
+    TEST_ASSERT(tc.send_fail == false);
+    TEST_ASSERT(xStreamBufferIsEmpty(tc.sb));
+
+    vStreamBufferDelete(tc.sb);
+    vSemaphoreDelete(tc.end_test);
+}
@@ -1,10 +1,14 @@
 /* FreeRTOS timer tests
 */
 #include <stdio.h>
+#include <stdlib.h>
 #include "unity.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "test_utils.h"
 
 static void timer_callback(TimerHandle_t timer)
 {
@@ -83,3 +87,90 @@ TEST_CASE("Static timer creation", "[freertos]")
 
     TEST_ASSERT_NOT_NULL(created_timer);
 }
+
+#define ORDER_TIMERS 16
+
+static int expired_order[ORDER_TIMERS];
+static volatile int expired_count;
+
+static void order_callback(TimerHandle_t timer)
+{
+    expired_order[expired_count++] = (int)pvTimerGetTimerID(timer);
+}
+
+TEST_CASE("FreeRTOS timers expire in order of expiry time", "[freertos]")
+{
+    TimerHandle_t timers[ORDER_TIMERS];
+    expired_count = 0;
+
+    // Periods spread over more than one turn of a timer wheel, started out of order.
+    // Timer i expires after (i + 1) * 5 ticks, timer 0 is restarted with the longest period.
+    for (int i = 0; i < ORDER_TIMERS; i++) {
+        int n = (i * 7) % ORDER_TIMERS;
+        timers[n] = xTimerCreate("order", (n + 1) * 5, pdFALSE, (void *)n, order_callback);
+        TEST_ASSERT_NOT_NULL(timers[n]);
+    }
+    for (int i = ORDER_TIMERS - 1; i >= 0; i--) {
+        TEST_ASSERT( xTimerStart(timers[(i * 7) % ORDER_TIMERS], 1) );
+    }
+    TEST_ASSERT( xTimerChangePeriod(timers[0], (ORDER_TIMERS + 1) * 5, 1) );
+
+    vTaskDelay((ORDER_TIMERS + 3) * 5);
+
+    TEST_ASSERT_EQUAL(ORDER_TIMERS, expired_count);
+    for (int i = 0; i < ORDER_TIMERS - 1; i++) {
+        TEST_ASSERT_EQUAL(i + 1, expired_order[i]);
+    }
+    TEST_ASSERT_EQUAL(0, expired_order[ORDER_TIMERS - 1]);
+
+    for (int i = 0; i < ORDER_TIMERS; i++) {
+        TEST_ASSERT( xTimerDelete(timers[i], 1) );
+    }
+}
+
+#define BENCH_COMMANDS 10000
+
+static void bench_callback(TimerHandle_t timer)
+{
+}
+
+static void give_from_timer_task(void *sem, uint32_t unused)
+{
+    xSemaphoreGive((SemaphoreHandle_t)sem);
+}
+
+TEST_CASE("FreeRTOS timer commands with many active timers", "[freertos]")
+{
+    const int active_timers[] = {10, 100, 1000};
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(done);
+
+    for (size_t a = 0; a < sizeof(active_timers) / sizeof(active_timers[0]); a++) {
+        const int num = active_timers[a];
+        TimerHandle_t *timers = calloc(num, sizeof(TimerHandle_t));
+        TEST_ASSERT_NOT_NULL(timers);
+        // Long and different periods, so that no timer expires and each restart moves the timer
+        for (int i = 0; i < num; i++) {
+            timers[i] = xTimerCreate("bench", 100000 + rand() % 50000, pdFALSE, NULL, bench_callback);
+            TEST_ASSERT_NOT_NULL(timers[i]);
+            TEST_ASSERT( xTimerStart(timers[i], portMAX_DELAY) );
+        }
+        TEST_ASSERT( xTimerPendFunctionCall(give_from_timer_task, done, 0, portMAX_DELAY) );
+        TEST_ASSERT( xSemaphoreTake(done, portMAX_DELAY) );
+
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < BENCH_COMMANDS; i++) {
+            xTimerChangePeriod(timers[rand() % num], 100000 + rand() % 50000, portMAX_DELAY);
+        }
+        TEST_ASSERT( xTimerPendFunctionCall(give_from_timer_task, done, 0, portMAX_DELAY) );
+        TEST_ASSERT( xSemaphoreTake(done, portMAX_DELAY) );
+        int64_t elapsed_us = esp_timer_get_time() - start;
+        IDF_LOG_PERFORMANCE("Timer commands per second", "%lld, active timers: %d", (long long)BENCH_COMMANDS * 1000000 / elapsed_us, num);
+
+        for (int i = 0; i < num; i++) {
+            TEST_ASSERT( xTimerDelete(timers[i], portMAX_DELAY) );
+        }
+        free(timers);
+    }
+    vSemaphoreDelete(done);
+}
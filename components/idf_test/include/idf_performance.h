@@ -28,6 +28,12 @@
 #ifndef IDF_PERFORMANCE_MAX_VFS_OPEN_WRITE_CLOSE_TIME_PSRAM
 #define IDF_PERFORMANCE_MAX_VFS_OPEN_WRITE_CLOSE_TIME_PSRAM                     25000
 #endif
+#ifndef IDF_PERFORMANCE_MAX_VFS_OPEN_CLOSE_MANY_VFS_TIME
+#define IDF_PERFORMANCE_MAX_VFS_OPEN_CLOSE_MANY_VFS_TIME                        20000
+#endif
+#ifndef IDF_PERFORMANCE_MAX_VFS_OPEN_CLOSE_MANY_VFS_TIME_PSRAM
+#define IDF_PERFORMANCE_MAX_VFS_OPEN_CLOSE_MANY_VFS_TIME_PSRAM                  25000
+#endif
 
 // throughput performance by iperf
 #ifndef IDF_PERFORMANCE_MIN_TCP_RX_THROUGHPUT
@@ -57,6 +63,15 @@
 #define IDF_PERFORMANCE_MIN_UDP_TX_ETH_THROUGHPUT                                   70
 #endif
 
+// increase of HTTP server request latency when all other sessions are open but idle
+#ifndef IDF_PERFORMANCE_MAX_HTTPD_IDLE_SESSIONS_LATENCY_INCREASE_PERCENT
+#define IDF_PERFORMANCE_MAX_HTTPD_IDLE_SESSIONS_LATENCY_INCREASE_PERCENT        20
+#endif
+// time to send a WebSocket frame to all clients with one broadcast, relative to a send per client
+#ifndef IDF_PERFORMANCE_MAX_HTTPD_WS_BROADCAST_TIME_PERCENT_OF_ASYNC_SENDS
+#define IDF_PERFORMANCE_MAX_HTTPD_WS_BROADCAST_TIME_PERCENT_OF_ASYNC_SENDS     100
+#endif
+
 // events dispatched per second by event loop library
 #ifndef IDF_PERFORMANCE_MIN_EVENT_DISPATCH
 #define IDF_PERFORMANCE_MIN_EVENT_DISPATCH                                      25000
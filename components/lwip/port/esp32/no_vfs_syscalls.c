@@ -49,6 +49,16 @@ ssize_t _read_r(struct _reent *r, int fd, void * dst, size_t size)
     return lwip_read(fd, dst, size);
 }
 
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    return lwip_writev(fd, iov, iovcnt);
+}
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    return lwip_readv(fd, iov, iovcnt);
+}
+
 int _close_r(struct _reent *r, int fd)
 {
     if (fd < LWIP_SOCKET_OFFSET) {
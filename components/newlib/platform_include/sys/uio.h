@@ -13,9 +13,16 @@
 extern "C" {
 #endif
 
-struct iovec;
+/* lwip/sockets.h defines the same structure unless iovec is defined as a macro */
+#if !defined(iovec) && !defined(LWIP_HDR_SOCKETS_H)
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
+#define iovec iovec
+#endif
 
-int writev(int s, const struct iovec *iov, int iovcnt);
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
 
 ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
 
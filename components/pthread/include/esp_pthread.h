@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <limits.h>
 #include <stdbool.h>
 #include "esp_err.h"
 #include "freertos/FreeRTOSConfig.h"
@@ -18,6 +19,14 @@ extern "C" {
 #define PTHREAD_STACK_MIN    CONFIG_PTHREAD_STACK_MIN
 #endif
 
+#ifndef PTHREAD_DESTRUCTOR_ITERATIONS
+#define PTHREAD_DESTRUCTOR_ITERATIONS    4
+#endif
+
+#ifndef PTHREAD_KEYS_MAX
+#define PTHREAD_KEYS_MAX    128
+#endif
+
 /** pthread configuration structure that influences pthread creation */
 typedef struct {
     size_t stack_size;  ///< The stack size of the pthread
@@ -44,19 +44,44 @@ typedef struct {
     void *(*func)(void *);  ///< user task entry
     void *arg;              ///< user task argument
     esp_pthread_cfg_t cfg;  ///< pthread configuration
+    esp_pthread_t *pthread; ///< pthread descriptor
 } esp_pthread_task_arg_t;
 
-/** pthread mutex FreeRTOS wrapper */
+/** pthread mutex
+ *
+ * The mutex is taken and given with a compare-and-set on the owner word while nobody waits for it.
+ * A task that finds the mutex taken spins for a while, then sets MUTEX_HAS_WAITERS in the owner word
+ * under the mutex spinlock, makes the kernel aware of the owner so that the owner inherits its priority,
+ * and blocks on the wait semaphore. MUTEX_HAS_WAITERS sends the owner through the slow path on unlock.
+ */
 typedef struct {
-    SemaphoreHandle_t   sem;        ///< Handle of the task waiting to join
-    int                 type;       ///< Mutex type. Currently supported PTHREAD_MUTEX_NORMAL and PTHREAD_MUTEX_RECURSIVE
+    volatile uint32_t   owner;      ///< Handle of the owning task ORed with MUTEX_HAS_WAITERS, or 0 if the mutex is free
+    int                 type;       ///< Mutex type. Currently supported PTHREAD_MUTEX_NORMAL, PTHREAD_MUTEX_RECURSIVE and PTHREAD_MUTEX_ERRORCHECK
+    uint32_t            count;      ///< Recursion count, only accessed by the owner
+    uint32_t            waiters;    ///< Number of tasks waiting on wait_sem, protected by lock
+    bool                inherited;  ///< The owner is counted as a kernel mutex holder, protected by lock
+    portMUX_TYPE        lock;       ///< Protects the slow path
+    SemaphoreHandle_t   wait_sem;   ///< Binary semaphore the waiting tasks block on
 } esp_pthread_mutex_t;
 
+#define MUTEX_HAS_WAITERS   1U
+#define MUTEX_NO_TASK       2U  ///< Owner of a mutex locked before the scheduler has started, e.g. by a global constructor
+
+#if CONFIG_FREERTOS_SMP
+// The SMP kernel expects the priority inheritance functions to be called from a critical section
+#define MUTEX_KERNEL_ENTER_CRITICAL()   taskENTER_CRITICAL()
+#define MUTEX_KERNEL_EXIT_CRITICAL()    taskEXIT_CRITICAL()
+#else
+#define MUTEX_KERNEL_ENTER_CRITICAL()
+#define MUTEX_KERNEL_EXIT_CRITICAL()
+#endif
+
 static SemaphoreHandle_t s_threads_mux  = NULL;
 portMUX_TYPE pthread_lazy_init_lock  = portMUX_INITIALIZER_UNLOCKED; // Used for mutexes and cond vars and rwlocks
 static SLIST_HEAD(esp_thread_list_head, esp_pthread_entry) s_threads_list
                                         = SLIST_HEAD_INITIALIZER(s_threads_list);
 static pthread_key_t s_pthread_cfg_key;
+static pthread_key_t s_pthread_self_key;   // Descriptor of the current pthread
 
 
 static int IRAM_ATTR pthread_mutex_lock_internal(esp_pthread_mutex_t *mux, TickType_t tmo);
@@ -71,8 +96,19 @@ esp_err_t esp_pthread_init(void)
     if (pthread_key_create(&s_pthread_cfg_key, esp_pthread_cfg_key_destructor) != 0) {
         return ESP_ERR_NO_MEM;
     }
+    if (pthread_key_create(&s_pthread_self_key, NULL) != 0) {
+        pthread_key_delete(s_pthread_cfg_key);
+        return ESP_ERR_NO_MEM;
+    }
     s_threads_mux = xSemaphoreCreateMutex();
     if (s_threads_mux == NULL) {
+        pthread_key_delete(s_pthread_self_key);
+        pthread_key_delete(s_pthread_cfg_key);
+        return ESP_ERR_NO_MEM;
+    }
+    if (pthread_internal_cond_var_init() != ESP_OK) {
+        vSemaphoreDelete(s_threads_mux);
+        pthread_key_delete(s_pthread_self_key);
         pthread_key_delete(s_pthread_cfg_key);
         return ESP_ERR_NO_MEM;
     }
@@ -99,22 +135,14 @@ static void *pthread_get_handle_by_desc(esp_pthread_t *item, void *desc)
     return NULL;
 }
 
-static void *pthread_get_desc_by_handle(esp_pthread_t *item, void *hnd)
-{
-    if (hnd == item->handle) {
-        return item;
-    }
-    return NULL;
-}
-
 static inline TaskHandle_t pthread_find_handle(pthread_t thread)
 {
     return pthread_list_find_item(pthread_get_handle_by_desc, (void *)thread);
 }
 
-static esp_pthread_t *pthread_find(TaskHandle_t task_handle)
+static inline esp_pthread_t *pthread_find_self(void)
 {
-    return pthread_list_find_item(pthread_get_desc_by_handle, task_handle);
+    return pthread_getspecific(s_pthread_self_key);
 }
 
 static void pthread_delete(esp_pthread_t *pthread)
@@ -182,6 +210,10 @@ static void pthread_task_func(void *arg)
     // wait for start
     xTaskNotifyWait(0, 0, NULL, portMAX_DELAY);
 
+    if (pthread_setspecific(s_pthread_self_key, task_arg->pthread) != 0) {
+        assert(false && "Failed to set current thread ID!");
+    }
+
     if (task_arg->cfg.inherit_cfg) {
         /* If inherit option is set, then do a set_cfg() ourselves for future forks,
         but first set thread_name to NULL to enable inheritance of the name too.
@@ -270,6 +302,7 @@ int pthread_create(pthread_t *thread, const pthread_attr_t *attr,
 
     task_arg->func = start_routine;
     task_arg->arg = arg;
+    task_arg->pthread = pthread;
     pthread->task_arg = task_arg;
     BaseType_t res = xTaskCreatePinnedToCore(&pthread_task_func,
                                              task_name,
@@ -338,7 +371,7 @@ int pthread_join(pthread_t thread, void **retval)
         // join to self not allowed
         ret = EDEADLK;
     } else {
-        esp_pthread_t *cur_pthread = pthread_find(xTaskGetCurrentTaskHandle());
+        esp_pthread_t *cur_pthread = pthread_find_self();
         if (cur_pthread && cur_pthread->join_task == handle) {
             // join to each other not allowed
             ret = EDEADLK;
@@ -408,6 +441,10 @@ int pthread_detach(pthread_t thread)
 void pthread_exit(void *value_ptr)
 {
     bool detached = false;
+    esp_pthread_t *pthread = pthread_find_self();
+    if (!pthread) {
+        assert(false && "Failed to find pthread for current task!");
+    }
     /* preemptively clean up thread local storage, rather than
        waiting for the idle task to clean up the thread */
     pthread_internal_local_storage_destructor_callback();
@@ -415,10 +452,6 @@ void pthread_exit(void *value_ptr)
     if (xSemaphoreTake(s_threads_mux, portMAX_DELAY) != pdTRUE) {
         assert(false && "Failed to lock threads list!");
     }
-    esp_pthread_t *pthread = pthread_find(xTaskGetCurrentTaskHandle());
-    if (!pthread) {
-        assert(false && "Failed to find pthread for current task!");
-    }
     if (pthread->task_arg) {
         free(pthread->task_arg);
     }
@@ -469,14 +502,10 @@ int sched_yield( void )
 
 pthread_t pthread_self(void)
 {
-    if (xSemaphoreTake(s_threads_mux, portMAX_DELAY) != pdTRUE) {
-        assert(false && "Failed to lock threads list!");
-    }
-    esp_pthread_t *pthread = pthread_find(xTaskGetCurrentTaskHandle());
+    esp_pthread_t *pthread = pthread_find_self();
     if (!pthread) {
         assert(false && "Failed to find current thread ID!");
     }
-    xSemaphoreGive(s_threads_mux);
     return (pthread_t)pthread;
 }
 
@@ -513,6 +542,30 @@ int pthread_once(pthread_once_t *once_control, void (*init_routine)(void))
 }
 
 /***************** MUTEX ******************/
+static inline uint32_t __attribute__((always_inline)) mutex_compare_set(esp_pthread_mutex_t *mux, uint32_t compare, uint32_t set)
+{
+#if defined(CONFIG_SPIRAM)
+    if (esp_ptr_external_ram(mux)) {
+        uxPortCompareSetExtram(&mux->owner, compare, &set);
+        return set;
+    }
+#endif
+    uxPortCompareSet(&mux->owner, compare, &set);
+    return set;
+}
+
+static inline uint32_t __attribute__((always_inline)) mutex_self(void)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    return task ? (uint32_t)task : MUTEX_NO_TASK;
+}
+
+static inline TaskHandle_t __attribute__((always_inline)) mutex_holder(uint32_t owner)
+{
+    owner &= ~MUTEX_HAS_WAITERS;
+    return owner == MUTEX_NO_TASK ? NULL : (TaskHandle_t)owner;
+}
+
 static int mutexattr_check(const pthread_mutexattr_t *attr)
 {
     if (attr->type != PTHREAD_MUTEX_NORMAL &&
@@ -542,18 +595,15 @@ int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr)
         type = attr->type;
     }
 
-    esp_pthread_mutex_t *mux = (esp_pthread_mutex_t *)malloc(sizeof(esp_pthread_mutex_t));
+    esp_pthread_mutex_t *mux = (esp_pthread_mutex_t *)calloc(1, sizeof(esp_pthread_mutex_t));
     if (!mux) {
         return ENOMEM;
     }
     mux->type = type;
+    portMUX_INITIALIZE(&mux->lock);
 
-    if (mux->type == PTHREAD_MUTEX_RECURSIVE) {
-        mux->sem = xSemaphoreCreateRecursiveMutex();
-    } else {
-        mux->sem = xSemaphoreCreateMutex();
-    }
-    if (!mux->sem) {
+    mux->wait_sem = xSemaphoreCreateBinary();
+    if (!mux->wait_sem) {
         free(mux);
         return EAGAIN;
     }
@@ -582,20 +632,11 @@ int pthread_mutex_destroy(pthread_mutex_t *mutex)
     }
 
     // check if mux is busy
-    int res = pthread_mutex_lock_internal(mux, 0);
-    if (res == EBUSY) {
+    if (mutex_compare_set(mux, 0, mutex_self()) != 0) {
         return EBUSY;
     }
 
-    if (mux->type == PTHREAD_MUTEX_RECURSIVE) {
-        res = xSemaphoreGiveRecursive(mux->sem);
-    } else {
-        res = xSemaphoreGive(mux->sem);
-    }
-    if (res != pdTRUE) {
-        assert(false && "Failed to release mutex!");
-    }
-    vSemaphoreDelete(mux->sem);
+    vSemaphoreDelete(mux->wait_sem);
     free(mux);
 
     return 0;
@@ -607,22 +648,90 @@ static int IRAM_ATTR pthread_mutex_lock_internal(esp_pthread_mutex_t *mux, TickT
         return EINVAL;
     }
 
-    if ((mux->type == PTHREAD_MUTEX_ERRORCHECK) &&
-        (xSemaphoreGetMutexHolder(mux->sem) == xTaskGetCurrentTaskHandle())) {
-        return EDEADLK;
+    const uint32_t self = mutex_self();
+    uint32_t owner = mutex_compare_set(mux, 0, self);
+    if (owner == 0) {
+        mux->count = 1;
+        return 0;
     }
 
-    if (mux->type == PTHREAD_MUTEX_RECURSIVE) {
-        if (xSemaphoreTakeRecursive(mux->sem, tmo) != pdTRUE) {
-            return EBUSY;
+    if ((owner & ~MUTEX_HAS_WAITERS) == self) {
+        if (mux->type == PTHREAD_MUTEX_RECURSIVE) {
+            mux->count++;
+            return 0;
         }
-    } else {
-        if (xSemaphoreTake(mux->sem, tmo) != pdTRUE) {
-            return EBUSY;
+        if (mux->type == PTHREAD_MUTEX_ERRORCHECK) {
+            return EDEADLK;
         }
     }
 
-    return 0;
+    if (tmo == 0) {
+        return EBUSY;
+    }
+
+#if CONFIG_PTHREAD_MUTEX_SPIN_COUNT > 0
+    // The owner may be running on the other core and about to release the mutex
+    for (int i = 0; i < CONFIG_PTHREAD_MUTEX_SPIN_COUNT; i++) {
+        if (mux->owner == 0 && mutex_compare_set(mux, 0, self) == 0) {
+            mux->count = 1;
+            return 0;
+        }
+    }
+#endif
+
+    TimeOut_t timeout;
+    vTaskSetTimeOutState(&timeout);
+    while (true) {
+        portENTER_CRITICAL(&mux->lock);
+        owner = mux->owner;
+        if (owner == 0) {
+            // Released in the meantime. Keep the slow path for the next owner if others are still waiting.
+            owner = mutex_compare_set(mux, 0, self | (mux->waiters ? MUTEX_HAS_WAITERS : 0));
+            portEXIT_CRITICAL(&mux->lock);
+            if (owner == 0) {
+                mux->count = 1;
+                return 0;
+            }
+            continue;
+        }
+        if (!(owner & MUTEX_HAS_WAITERS)) {
+            // The owner may have released the mutex without taking the lock, try again if it did
+            if (mutex_compare_set(mux, owner, owner | MUTEX_HAS_WAITERS) != owner) {
+                portEXIT_CRITICAL(&mux->lock);
+                continue;
+            }
+        }
+
+        // The owner can't release the mutex while we hold the lock, so it's safe to touch its TCB
+        TaskHandle_t holder = mutex_holder(owner);
+        MUTEX_KERNEL_ENTER_CRITICAL();
+        if (!mux->inherited) {
+            vTaskIncrementMutexHeldCountOfTask(holder);
+            mux->inherited = true;
+        }
+        xTaskPriorityInherit(holder);
+        MUTEX_KERNEL_EXIT_CRITICAL();
+        mux->waiters++;
+        portEXIT_CRITICAL(&mux->lock);
+
+        bool woken = xTaskCheckForTimeOut(&timeout, &tmo) == pdFALSE &&
+                     xSemaphoreTake(mux->wait_sem, tmo) == pdTRUE;
+
+        portENTER_CRITICAL(&mux->lock);
+        mux->waiters--;
+        if (!woken) {
+            owner = mux->owner;
+            if (mux->waiters == 0 && owner != 0 && mux->inherited) {
+                // Nobody else waits for the mutex, the owner doesn't need our priority anymore
+                MUTEX_KERNEL_ENTER_CRITICAL();
+                vTaskPriorityDisinheritAfterTimeout(mutex_holder(owner), tskIDLE_PRIORITY);
+                MUTEX_KERNEL_EXIT_CRITICAL();
+            }
+            portEXIT_CRITICAL(&mux->lock);
+            return EBUSY;
+        }
+        portEXIT_CRITICAL(&mux->lock);
+    }
 }
 
 static int pthread_mutex_init_if_static(pthread_mutex_t *mutex)
@@ -696,20 +805,37 @@ int IRAM_ATTR pthread_mutex_unlock(pthread_mutex_t *mutex)
         return EINVAL;
     }
 
-    if (((mux->type == PTHREAD_MUTEX_RECURSIVE) ||
-        (mux->type == PTHREAD_MUTEX_ERRORCHECK)) &&
-        (xSemaphoreGetMutexHolder(mux->sem) != xTaskGetCurrentTaskHandle())) {
+    const uint32_t self = mutex_self();
+    if ((mux->owner & ~MUTEX_HAS_WAITERS) != self) {
         return EPERM;
     }
 
-    int ret;
-    if (mux->type == PTHREAD_MUTEX_RECURSIVE) {
-        ret = xSemaphoreGiveRecursive(mux->sem);
-    } else {
-        ret = xSemaphoreGive(mux->sem);
+    if (mux->type == PTHREAD_MUTEX_RECURSIVE && --mux->count > 0) {
+        return 0;
+    }
+
+    if (mutex_compare_set(mux, self, 0) == self) {
+        return 0;
     }
-    if (ret != pdTRUE) {
-        assert(false && "Failed to unlock mutex!");
+
+    // There are waiters, wake one of them up and give back the priority inherited from them
+    portENTER_CRITICAL(&mux->lock);
+    bool inherited = mux->inherited;
+    bool wake = mux->waiters > 0;
+    mux->inherited = false;
+    mux->owner = 0;
+    portEXIT_CRITICAL(&mux->lock);
+
+    if (wake) {
+        xSemaphoreGive(mux->wait_sem);
+    }
+    if (inherited) {
+        MUTEX_KERNEL_ENTER_CRITICAL();
+        BaseType_t yield = xTaskPriorityDisinherit(mutex_holder(self));
+        MUTEX_KERNEL_EXIT_CRITICAL();
+        if (yield) {
+            portYIELD();
+        }
     }
     return 0;
 }
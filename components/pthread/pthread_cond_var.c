@@ -13,9 +13,11 @@
 // limitations under the License.
 
 // This is a simple implementation of pthread condition variables. In essence,
-// the waiter creates its own semaphore to wait on and pushes it in the cond var
-// specific list. Upon notify and broadcast, all the waiters for the given cond
-// var are woken up.
+// the waiter pushes an entry with its own semaphore to wait on in the cond var
+// specific list. Upon notify and broadcast, one or all of the waiters for the
+// given cond var are taken off the list and woken up. The semaphore is created
+// on the first wait of a thread and kept in a thread specific key, so waiting
+// doesn't allocate memory afterwards.
 
 #include <errno.h>
 #include <pthread.h>
@@ -36,6 +38,7 @@ const static char *TAG = "esp_pthread";
 
 typedef struct esp_pthread_cond_waiter {
     SemaphoreHandle_t   wait_sem;           ///< task specific semaphore to wait on
+    bool                queued;             ///< still on the list, i.e. not woken up by notify or broadcast
     TAILQ_ENTRY(esp_pthread_cond_waiter) link;  ///< stash on the list of semaphores to be notified
 } esp_pthread_cond_waiter_t;
 
@@ -44,6 +47,37 @@ typedef struct esp_pthread_cond {
     TAILQ_HEAD(, esp_pthread_cond_waiter) waiter_list;  ///< head of the list of semaphores
 } esp_pthread_cond_t;
 
+static pthread_key_t s_wait_sem_key;
+
+static void s_wait_sem_destructor(void *wait_sem)
+{
+    vSemaphoreDelete((SemaphoreHandle_t) wait_sem);
+}
+
+esp_err_t pthread_internal_cond_var_init(void)
+{
+    if (pthread_key_create(&s_wait_sem_key, s_wait_sem_destructor) != 0) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static SemaphoreHandle_t s_get_wait_sem(void)
+{
+    SemaphoreHandle_t wait_sem = (SemaphoreHandle_t) pthread_getspecific(s_wait_sem_key);
+    if (wait_sem == NULL) {
+        wait_sem = xSemaphoreCreateBinary();
+        if (wait_sem == NULL) {
+            return NULL;
+        }
+        if (pthread_setspecific(s_wait_sem_key, wait_sem) != 0) {
+            vSemaphoreDelete(wait_sem);
+            return NULL;
+        }
+    }
+    return wait_sem;
+}
+
 static int s_check_and_init_if_static(pthread_cond_t *cv)
 {
     int res = 0;
@@ -76,6 +110,8 @@ int pthread_cond_signal(pthread_cond_t *cv)
     esp_pthread_cond_waiter_t *entry;
     entry = TAILQ_FIRST(&cond->waiter_list);
     if (entry) {
+        TAILQ_REMOVE(&cond->waiter_list, entry, link);
+        entry->queued = false;
         xSemaphoreGive(entry->wait_sem);
     }
     _lock_release_recursive(&cond->lock);
@@ -94,7 +130,9 @@ int pthread_cond_broadcast(pthread_cond_t *cv)
 
     _lock_acquire_recursive(&cond->lock);
     esp_pthread_cond_waiter_t *entry;
-    TAILQ_FOREACH(entry, &cond->waiter_list, link) {
+    while ((entry = TAILQ_FIRST(&cond->waiter_list)) != NULL) {
+        TAILQ_REMOVE(&cond->waiter_list, entry, link);
+        entry->queued = false;
         xSemaphoreGive(entry->wait_sem);
     }
     _lock_release_recursive(&cond->lock);
@@ -162,7 +200,11 @@ int pthread_cond_timedwait(pthread_cond_t *cv, pthread_mutex_t *mut, const struc
     }
 
     esp_pthread_cond_waiter_t w;
-    w.wait_sem = xSemaphoreCreateCounting(1, 0); /* First get will block */
+    w.wait_sem = s_get_wait_sem();
+    if (w.wait_sem == NULL) {
+        return ENOMEM;
+    }
+    w.queued = true;
 
     _lock_acquire_recursive(&cond->lock);
     TAILQ_INSERT_TAIL(&cond->waiter_list, &w, link);
@@ -176,9 +218,14 @@ int pthread_cond_timedwait(pthread_cond_t *cv, pthread_mutex_t *mut, const struc
     }
 
     _lock_acquire_recursive(&cond->lock);
-    TAILQ_REMOVE(&cond->waiter_list, &w, link);
+    if (w.queued) {
+        TAILQ_REMOVE(&cond->waiter_list, &w, link);
+    } else if (ret == ETIMEDOUT) {
+        // Woken up after the timeout expired, take the semaphore so the next wait doesn't return early
+        xSemaphoreTake(w.wait_sem, 0);
+        ret = 0;
+    }
     _lock_release_recursive(&cond->lock);
-    vSemaphoreDelete(w.wait_sem);
 
     pthread_mutex_lock(mut);
     return ret;
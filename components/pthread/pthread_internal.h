@@ -15,4 +15,6 @@
 
 void pthread_internal_local_storage_destructor_callback(void);
 
+esp_err_t pthread_internal_cond_var_init(void);
+
 extern portMUX_TYPE pthread_lazy_init_lock;
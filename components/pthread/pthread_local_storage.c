@@ -13,96 +13,156 @@
 // limitations under the License.
 #include <errno.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include "esp_err.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "sys/lock.h"
-#include "sys/queue.h"
 
+#include "esp_pthread.h"
 #include "pthread_internal.h"
 
 #define PTHREAD_TLS_INDEX 0
 
 typedef void (*pthread_destructor_t)(void*);
 
-/* This is a very naive implementation of key-indexed thread local storage, using two linked lists
-   (one is a global list of registered keys, one per thread for thread local storage values).
+/* Keys are allocated from a global table of key entries, the entry of a deleted key is reused by the next
+   pthread_key_create(). A key combines the index of its entry with the generation of the entry, which is incremented
+   when the key is deleted, so a deleted key never matches the key reusing its entry.
 
-   It won't work well if lots of keys & thread-local values are stored (O(n) lookup for both),
-   but it should work for small amounts of data.
+   Each thread stores its values in an array indexed by entry, which is saved as a FreeRTOS thread local storage
+   pointer. Every value is stored with the key it was set for, so pthread_getspecific() is a plain array lookup, and
+   the values left over by a deleted key are ignored, without pthread_key_delete() having to clear them in all
+   threads.
+
+   The table is made of blocks which are never moved or freed, and the key using an entry is read atomically, so
+   pthread_getspecific() and pthread_setspecific() can check that a key wasn't deleted without taking the keys lock.
 */
-typedef struct key_entry_t_ {
-    pthread_key_t key;
+typedef struct {
+    _Atomic pthread_key_t key;          ///< Key using this entry, or 0 if the entry is free
+    pthread_key_t generation;           ///< Generation of the next key using this entry
     pthread_destructor_t destructor;
-    SLIST_ENTRY(key_entry_t_) next;
 } key_entry_t;
 
-// List of all keys created with pthread_key_create()
-SLIST_HEAD(key_list_t, key_entry_t_) s_keys = SLIST_HEAD_INITIALIZER(s_keys);
+#define KEYS_PER_BLOCK  8
+#define KEY_BLOCKS      (PTHREAD_KEYS_MAX / KEYS_PER_BLOCK)
+#define KEY_INDEX_BITS  8
+#define KEY_INDEX_MASK  ((1 << KEY_INDEX_BITS) - 1)
+#define KEY_GENERATION_MASK (((pthread_key_t) -1) >> KEY_INDEX_BITS)
 
-static portMUX_TYPE s_keys_lock = portMUX_INITIALIZER_UNLOCKED;
+_Static_assert(PTHREAD_KEYS_MAX % KEYS_PER_BLOCK == 0, "PTHREAD_KEYS_MAX must be a multiple of KEYS_PER_BLOCK");
+_Static_assert(PTHREAD_KEYS_MAX < (1 << KEY_INDEX_BITS), "PTHREAD_KEYS_MAX doesn't fit in the key index");
 
-// List of all value entries associated with a thread via pthread_setspecific()
-typedef struct value_entry_t_ {
-    pthread_key_t key;
+// Blocks of the table of all keys, allocated when needed
+static key_entry_t *_Atomic s_key_blocks[KEY_BLOCKS];
+static size_t s_keys_count;
+
+// Values associated with a thread via pthread_setspecific(), saved as a FreeRTOS thread local storage pointer.
+// Only accessed by the thread itself, or after the thread was deleted.
+typedef struct {
+    pthread_key_t key;  ///< Key the value was set for
     void *value;
-    SLIST_ENTRY(value_entry_t_) next;
 } value_entry_t;
 
-// Type for the head of the list, as saved as a FreeRTOS thread local storage pointer
-SLIST_HEAD(values_list_t_, value_entry_t_);
-typedef struct values_list_t_ values_list_t;
+typedef struct {
+    size_t count;               ///< Number of entries in values
+    value_entry_t *values;      ///< Value of the key using entry N of the keys table is values[N]
+} thread_values_t;
 
-int pthread_key_create(pthread_key_t *key, pthread_destructor_t destructor)
-{
-    key_entry_t *new_key = malloc(sizeof(key_entry_t));
-    if (new_key == NULL) {
-        return ENOMEM;
-    }
+// Protects the keys table against concurrent key creation and deletion
+static portMUX_TYPE s_keys_lock = portMUX_INITIALIZER_UNLOCKED;
 
-    portENTER_CRITICAL(&s_keys_lock);
+static inline pthread_key_t make_key(size_t index, pthread_key_t generation)
+{
+    // index + 1, so that no key is 0
+    return (generation << KEY_INDEX_BITS) | (index + 1);
+}
 
-    const key_entry_t *head = SLIST_FIRST(&s_keys);
-    new_key->key = (head == NULL) ? 1 : (head->key + 1);
-    new_key->destructor = destructor;
-    *key = new_key->key;
+// Index of the entry of a key, PTHREAD_KEYS_MAX or larger if the key is invalid
+static inline size_t key_index(pthread_key_t key)
+{
+    return (size_t) (key & KEY_INDEX_MASK) - 1;
+}
 
-    SLIST_INSERT_HEAD(&s_keys, new_key, next);
+static inline key_entry_t *key_entry(size_t index)
+{
+    key_entry_t *block = atomic_load_explicit(&s_key_blocks[index / KEYS_PER_BLOCK], memory_order_acquire);
+    return (block != NULL) ? &block[index % KEYS_PER_BLOCK] : NULL;
+}
 
-    portEXIT_CRITICAL(&s_keys_lock);
-    return 0;
+// Can be called without the keys lock, see above
+static bool key_is_used(pthread_key_t key)
+{
+    const size_t index = key_index(key);
+    if (index >= PTHREAD_KEYS_MAX) {
+        return false;
+    }
+    const key_entry_t *entry = key_entry(index);
+    return entry != NULL && atomic_load_explicit(&entry->key, memory_order_acquire) == key;
 }
 
-static key_entry_t *find_key(pthread_key_t key)
+int pthread_key_create(pthread_key_t *key, pthread_destructor_t destructor)
 {
-    portENTER_CRITICAL(&s_keys_lock);
-    key_entry_t *result = NULL;;
-    SLIST_FOREACH(result, &s_keys, next) {
-        if(result->key == key) {
-            break;
+    while (true) {
+        portENTER_CRITICAL(&s_keys_lock);
+        for (size_t i = 0; i < s_keys_count; i++) {
+            key_entry_t *entry = key_entry(i);
+            if (entry->key == 0) {
+                const pthread_key_t new_key = make_key(i, entry->generation);
+                entry->destructor = destructor;
+                entry->key = new_key;
+                portEXIT_CRITICAL(&s_keys_lock);
+                *key = new_key;
+                return 0;
+            }
+        }
+        size_t count = s_keys_count;
+        portEXIT_CRITICAL(&s_keys_lock);
+
+        if (count == PTHREAD_KEYS_MAX) {
+            return EAGAIN;
+        }
+        // All keys are in use, add a block to the table. Can't allocate memory in the critical section.
+        key_entry_t *block = calloc(KEYS_PER_BLOCK, sizeof(key_entry_t));
+        if (block == NULL) {
+            return ENOMEM;
         }
+
+        portENTER_CRITICAL(&s_keys_lock);
+        if (s_keys_count != count) {
+            // Another task has grown the table in the meantime
+            portEXIT_CRITICAL(&s_keys_lock);
+            free(block);
+            continue;
+        }
+        const pthread_key_t new_key = make_key(count, 0);
+        block[0].destructor = destructor;
+        block[0].key = new_key;
+        s_key_blocks[count / KEYS_PER_BLOCK] = block;
+        s_keys_count = count + KEYS_PER_BLOCK;
+        portEXIT_CRITICAL(&s_keys_lock);
+
+        *key = new_key;
+        return 0;
     }
-    portEXIT_CRITICAL(&s_keys_lock);
-    return result;
 }
 
 int pthread_key_delete(pthread_key_t key)
 {
-
-    portENTER_CRITICAL(&s_keys_lock);
-
-    /* Ideally, we would also walk all tasks' thread local storage value_list here
-       and delete any values associated with this key. We do not do this...
+    /* The destructor isn't called for the values still associated with the key, as specified by POSIX. These values
+       are ignored from now on, as they are stored with the deleted key.
     */
-
-    key_entry_t *entry = find_key(key);
-    if (entry != NULL) {
-        SLIST_REMOVE(&s_keys, entry, key_entry_t_, next);
-        free(entry);
+    portENTER_CRITICAL(&s_keys_lock);
+    if (key_is_used(key)) {
+        key_entry_t *entry = key_entry(key_index(key));
+        entry->key = 0;
+        entry->destructor = NULL;
+        entry->generation = (entry->generation + 1) & KEY_GENERATION_MASK;
     }
-
     portEXIT_CRITICAL(&s_keys_lock);
 
     return 0;
@@ -127,26 +187,38 @@ int pthread_key_delete(pthread_key_t key)
 */
 static void pthread_local_storage_thread_deleted_callback(int index, void *v_tls)
 {
-    values_list_t *tls = (values_list_t *)v_tls;
+    thread_values_t *tls = (thread_values_t *)v_tls;
     assert(tls != NULL);
 
-    /* Walk the list, freeing all entries and calling destructors if they are registered */
-    while (1) {
-        value_entry_t *entry = SLIST_FIRST(tls);
-        if (entry == NULL) {
-            break;
-        }
-        SLIST_REMOVE_HEAD(tls, next);
-
-        // This is a little slow, walking the linked list of keys once per value,
-        // but assumes that the thread's value list will have less entries
-        // than the keys list
-        key_entry_t *key = find_key(entry->key);
-        if (key != NULL && key->destructor != NULL) {
-            key->destructor(entry->value);
+    /* Clear the values that have a destructor registered and call the destructor. A destructor may set a value
+       again, so keep going over the values until no destructor has been called, at most PTHREAD_DESTRUCTOR_ITERATIONS
+       times as allowed by POSIX. Values without a destructor, like the descriptor returned by pthread_self(), stay
+       available to the destructors.
+    */
+    bool called;
+    int iterations = 0;
+    do {
+        called = false;
+        // a destructor may grow tls->values, so it's indexed again for every value
+        for (size_t i = 0; i < tls->count; i++) {
+            const pthread_key_t key = tls->values[i].key;
+            void *value = tls->values[i].value;
+            if (value == NULL) {
+                continue;
+            }
+
+            portENTER_CRITICAL(&s_keys_lock);
+            pthread_destructor_t destructor = key_is_used(key) ? key_entry(i)->destructor : NULL;
+            portEXIT_CRITICAL(&s_keys_lock);
+            if (destructor != NULL) {
+                tls->values[i].value = NULL;
+                destructor(value);
+                called = true;
+            }
         }
-        free(entry);
-    }
+    } while (called && ++iterations < PTHREAD_DESTRUCTOR_ITERATIONS);
+
+    free(tls->values);
     free(tls);
 }
 
@@ -193,89 +265,64 @@ void pthread_internal_local_storage_destructor_callback(void)
     }
 }
 
-static value_entry_t *find_value(const values_list_t *list, pthread_key_t key)
-{
-    value_entry_t *result = NULL;;
-    SLIST_FOREACH(result, list, next) {
-        if(result->key == key) {
-            break;
-        }
-    }
-    return result;
-}
-
 void *pthread_getspecific(pthread_key_t key)
 {
-    values_list_t *tls = (values_list_t *) pvTaskGetThreadLocalStoragePointer(NULL, PTHREAD_TLS_INDEX);
-    if (tls == NULL) {
+    thread_values_t *tls = (thread_values_t *) pvTaskGetThreadLocalStoragePointer(NULL, PTHREAD_TLS_INDEX);
+    const size_t index = key_index(key);
+    if (tls == NULL || index >= tls->count || tls->values[index].key != key || !key_is_used(key)) {
         return NULL;
     }
-
-    value_entry_t *entry = find_value(tls, key);
-    if(entry != NULL) {
-        return entry->value;
-    }
-    return NULL;
+    return tls->values[index].value;
 }
 
 int pthread_setspecific(pthread_key_t key, const void *value)
 {
-    key_entry_t *key_entry = find_key(key);
-    if (key_entry == NULL) {
+    /* Checked without the keys lock. If the key is deleted concurrently, the value is stored with the deleted key,
+       and is ignored like the other values of the deleted key.
+    */
+    if (!key_is_used(key)) {
         return ENOENT; // this situation is undefined by pthreads standard
     }
+    const size_t index = key_index(key);
+    thread_values_t *tls = pvTaskGetThreadLocalStoragePointer(NULL, PTHREAD_TLS_INDEX);
+    if (tls == NULL || index >= tls->count) {
+        if (value == NULL) {
+            return 0; // no value has been set for this key in this thread
+        }
 
-    values_list_t *tls = pvTaskGetThreadLocalStoragePointer(NULL, PTHREAD_TLS_INDEX);
-    if (tls == NULL) {
-        tls = calloc(1, sizeof(values_list_t));
         if (tls == NULL) {
-            return ENOMEM;
-        }
+            tls = calloc(1, sizeof(thread_values_t));
+            if (tls == NULL) {
+                return ENOMEM;
+            }
 #if defined(CONFIG_FREERTOS_ENABLE_STATIC_TASK_CLEAN_UP)
-        vTaskSetThreadLocalStoragePointer(NULL, PTHREAD_TLS_INDEX, tls);
+            vTaskSetThreadLocalStoragePointer(NULL, PTHREAD_TLS_INDEX, tls);
 #else
-        vTaskSetThreadLocalStoragePointerAndDelCallback(NULL,
-                                                        PTHREAD_TLS_INDEX,
-                                                        tls,
-                                                        pthread_local_storage_thread_deleted_callback);
+            vTaskSetThreadLocalStoragePointerAndDelCallback(NULL,
+                                                            PTHREAD_TLS_INDEX,
+                                                            tls,
+                                                            pthread_local_storage_thread_deleted_callback);
 #endif
-    }
-
-    value_entry_t *entry = find_value(tls, key);
-    if (entry != NULL) {
-        if (value != NULL) {
-            // cast on next line is necessary as pthreads API uses
-            // 'const void *' here but elsewhere uses 'void *'
-            entry->value = (void *) value;
-        } else { // value == NULL, remove the entry
-            SLIST_REMOVE(tls, entry, value_entry_t_, next);
-            free(entry);
         }
-    } else if (value != NULL) {
-        entry = malloc(sizeof(value_entry_t));
-        if (entry == NULL) {
+
+        // Make room for all keys that currently exist, so the next keys set by this thread take the fast path as well
+        portENTER_CRITICAL(&s_keys_lock);
+        const size_t count = s_keys_count;
+        portEXIT_CRITICAL(&s_keys_lock);
+        value_entry_t *values = calloc(count, sizeof(value_entry_t));
+        if (values == NULL) {
             return ENOMEM;
         }
-        entry->key = key;
-        entry->value = (void *) value; // see note above about cast
-
-        // insert the new entry at the end of the list. this is important because
-        // a destructor may call pthread_setspecific() to add a new non-NULL value
-        // to the list, and this should be processed after all other entries.
-        //
-        // See pthread_local_storage_thread_deleted_callback()
-        value_entry_t *last_entry = NULL;
-        value_entry_t *it;
-        SLIST_FOREACH(it, tls, next) {
-            last_entry = it;
-        }
-        if (last_entry == NULL) {
-            SLIST_INSERT_HEAD(tls, entry, next);
-        } else {
-            SLIST_INSERT_AFTER(last_entry, entry, next);
-        }
+        memcpy(values, tls->values, tls->count * sizeof(value_entry_t));
+        free(tls->values);
+        tls->values = values;
+        tls->count = count;
     }
 
+    tls->values[index].key = key;
+    // cast on next line is necessary as pthreads API uses
+    // 'const void *' here but elsewhere uses 'void *'
+    tls->values[index].value = (void *) value;
     return 0;
 }
 
@@ -1,12 +1,16 @@
 #include <errno.h>
+#include <stdio.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
 
 #include "esp_pthread.h"
 #include <pthread.h>
 
 #include "unity.h"
+#include "test_utils.h"
 
 static void *compute_square(void *arg)
 {
@@ -293,3 +297,80 @@ TEST_CASE("pthread mutex trylock timedlock", "[pthread]")
         pthread_mutex_destroy(&mutex);
     }
 }
+
+static UBaseType_t s_priority_locked;
+static UBaseType_t s_priority_unlocked;
+
+static void *hold_mutex(void *arg)
+{
+    pthread_mutex_t *mutex = (pthread_mutex_t *) arg;
+    pthread_mutex_lock(mutex);
+    vTaskDelay(10); // the test task blocks on the mutex in the meantime
+    s_priority_locked = uxTaskPriorityGet(NULL);
+    pthread_mutex_unlock(mutex);
+    s_priority_unlocked = uxTaskPriorityGet(NULL);
+    return NULL;
+}
+
+TEST_CASE("pthread mutex priority inheritance", "[pthread]")
+{
+    pthread_mutex_t mutex;
+    pthread_t holder;
+    UBaseType_t priority = uxTaskPriorityGet(NULL);
+
+    TEST_ASSERT_EQUAL_INT(0, pthread_mutex_init(&mutex, NULL));
+
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.prio = priority - 1;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_pthread_set_cfg(&cfg));
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&holder, NULL, hold_mutex, &mutex));
+    vTaskDelay(2);
+
+    TEST_ASSERT_EQUAL_INT(0, pthread_mutex_lock(&mutex));
+    TEST_ASSERT_EQUAL_INT(0, pthread_mutex_unlock(&mutex));
+    TEST_ASSERT_EQUAL_INT(0, pthread_join(holder, NULL));
+    TEST_ASSERT_EQUAL(priority, s_priority_locked);
+    TEST_ASSERT_EQUAL(priority - 1, s_priority_unlocked);
+
+    cfg = esp_pthread_get_default_config();
+    esp_pthread_set_cfg(&cfg);
+    pthread_mutex_destroy(&mutex);
+}
+
+#define MUTEX_BENCH_OPS 100000
+
+static SemaphoreHandle_t s_bench_done;
+
+static void mutex_bench_task(void *arg)
+{
+    pthread_mutex_t *mutex = (pthread_mutex_t *) arg;
+    for (int i = 0; i < MUTEX_BENCH_OPS; i++) {
+        pthread_mutex_lock(mutex);
+        pthread_mutex_unlock(mutex);
+    }
+    xSemaphoreGive(s_bench_done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("pthread mutex lock unlock throughput", "[pthread]")
+{
+    pthread_mutex_t mutex;
+    TEST_ASSERT_EQUAL_INT(0, pthread_mutex_init(&mutex, NULL));
+    s_bench_done = xSemaphoreCreateCounting(portNUM_PROCESSORS, 0);
+    TEST_ASSERT_NOT_NULL(s_bench_done);
+
+    for (int tasks = 1; tasks <= portNUM_PROCESSORS; tasks++) {
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < tasks; i++) {
+            xTaskCreatePinnedToCore(mutex_bench_task, "bench", 2048, &mutex, uxTaskPriorityGet(NULL), NULL, i);
+        }
+        for (int i = 0; i < tasks; i++) {
+            TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(s_bench_done, pdMS_TO_TICKS(10000)));
+        }
+        int64_t elapsed_us = esp_timer_get_time() - start;
+        IDF_LOG_PERFORMANCE("pthread mutex lock/unlock pairs per second", "%lld, tasks: %d", (long long) tasks * MUTEX_BENCH_OPS * 1000000 / elapsed_us, tasks);
+    }
+
+    vSemaphoreDelete(s_bench_done);
+    pthread_mutex_destroy(&mutex);
+}
@@ -1,5 +1,9 @@
+#include <stdio.h>
 #include <pthread.h>
 #include "unity.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "test_utils.h"
 
 typedef struct {
     pthread_cond_t *cond;
@@ -113,3 +117,55 @@ TEST_CASE("pthread cond wait", "[pthread]")
     pthread_mutex_destroy(&cond);
     pthread_mutex_destroy(&mutex);
 }
+
+#define PING_PONG_ROUNDS 10000
+
+typedef struct {
+    pthread_cond_t cond;
+    pthread_mutex_t mutex;
+    int turn;
+} ping_pong_t;
+
+static void ping_pong(ping_pong_t *pp, int me, int rounds)
+{
+    pthread_mutex_lock(&pp->mutex);
+    for (int i = 0; i < rounds; i++) {
+        while (pp->turn != me) {
+            pthread_cond_wait(&pp->cond, &pp->mutex);
+        }
+        pp->turn = !me;
+        pthread_cond_signal(&pp->cond);
+    }
+    pthread_mutex_unlock(&pp->mutex);
+}
+
+static void *thread_pong(void *arg)
+{
+    ping_pong((ping_pong_t *)arg, 1, PING_PONG_ROUNDS + 1);
+    return NULL;
+}
+
+TEST_CASE("pthread cond var ping-pong", "[pthread]")
+{
+    ping_pong_t pp = { .turn = 0 };
+    pthread_t thread;
+
+    TEST_ASSERT_EQUAL_INT(0, pthread_cond_init(&pp.cond, NULL));
+    TEST_ASSERT_EQUAL_INT(0, pthread_mutex_init(&pp.mutex, NULL));
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&thread, NULL, thread_pong, &pp));
+
+    // The wait semaphores are created on the first wait of each thread
+    ping_pong(&pp, 0, 1);
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+
+    int64_t start = esp_timer_get_time();
+    ping_pong(&pp, 0, PING_PONG_ROUNDS);
+    int64_t elapsed_us = esp_timer_get_time() - start;
+
+    TEST_ASSERT_GREATER_OR_EQUAL(free_before, heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+    TEST_ASSERT_EQUAL_INT(0, pthread_join(thread, NULL));
+    IDF_LOG_PERFORMANCE("pthread cond var ping-pong round trips per second", "%lld", (long long) PING_PONG_ROUNDS * 1000000 / elapsed_us);
+
+    pthread_cond_destroy(&pp.cond);
+    pthread_mutex_destroy(&pp.mutex);
+}
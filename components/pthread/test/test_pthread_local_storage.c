@@ -1,5 +1,7 @@
 // Test pthread_create_key, pthread_delete_key, pthread_setspecific, pthread_getspecific
 #include <pthread.h>
+#include <errno.h>
+#include "esp_pthread.h"
 #include "unity.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -52,6 +54,60 @@ TEST_CASE("pthread local storage unique keys", "[pthread]")
     }
 }
 
+TEST_CASE("pthread local storage deleted key is not carried over", "[pthread]")
+{
+    pthread_key_t key;
+    int val = 3;
+
+    TEST_ASSERT_EQUAL(0, pthread_key_create(&key, NULL));
+    TEST_ASSERT_EQUAL(0, pthread_setspecific(key, &val));
+    TEST_ASSERT_EQUAL(0, pthread_key_delete(key));
+
+    // Key numbers are reused, a new key must not see the value of the deleted one
+    TEST_ASSERT_EQUAL(0, pthread_key_create(&key, NULL));
+    TEST_ASSERT_NULL(pthread_getspecific(key));
+    TEST_ASSERT_EQUAL(0, pthread_key_delete(key));
+}
+
+TEST_CASE("pthread local storage deleted key can't be set", "[pthread]")
+{
+    pthread_key_t key;
+    int val = 3;
+
+    TEST_ASSERT_EQUAL(0, pthread_key_create(&key, NULL));
+    TEST_ASSERT_EQUAL(0, pthread_setspecific(key, &val));
+    TEST_ASSERT_EQUAL(0, pthread_key_delete(key));
+
+    // This thread already has room for the key's value, the key still has to be rejected
+    TEST_ASSERT_EQUAL(ENOENT, pthread_setspecific(key, &val));
+    TEST_ASSERT_NULL(pthread_getspecific(key));
+}
+
+TEST_CASE("pthread local storage key limit", "[pthread]")
+{
+    static pthread_key_t keys[PTHREAD_KEYS_MAX];
+    int count = 0;
+    int r;
+
+    // some keys may be in use by other components already
+    while ((r = pthread_key_create(&keys[count], NULL)) == 0) {
+        count++;
+        TEST_ASSERT_LESS_OR_EQUAL(PTHREAD_KEYS_MAX, count);
+    }
+    TEST_ASSERT_EQUAL(EAGAIN, r);
+    TEST_ASSERT_GREATER_THAN(0, count);
+
+    // a deleted key makes room for a new one, which is a different key
+    pthread_key_t deleted = keys[count - 1];
+    TEST_ASSERT_EQUAL(0, pthread_key_delete(deleted));
+    TEST_ASSERT_EQUAL(0, pthread_key_create(&keys[count - 1], NULL));
+    TEST_ASSERT_NOT_EQUAL(deleted, keys[count - 1]);
+
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_key_delete(keys[i]));
+    }
+}
+
 static void test_pthread_destructor(void *);
 static void *expected_destructor_ptr;
 static void *actual_destructor_ptr;
@@ -165,7 +221,11 @@ TEST_CASE("pthread local storage stress test", "[pthread]")
 
 
 #define NUM_KEYS 4 // number of keys used in repeat destructor test
-#define NUM_REPEATS 17 // number of times we re-set a key to a non-NULL value to re-trigger destructor
+// number of times we re-set a key to a non-NULL value to re-trigger destructor. Destructors run for at most
+// PTHREAD_DESTRUCTOR_ITERATIONS passes over all keys and a value re-set in the last pass is discarded, so only
+// (PTHREAD_DESTRUCTOR_ITERATIONS - 1) * NUM_KEYS re-sets can still be destroyed. The test used 17 when the passes
+// were unbounded.
+#define NUM_REPEATS ((PTHREAD_DESTRUCTOR_ITERATIONS - 1) * NUM_KEYS)
 
 typedef struct {
     pthread_key_t keys[NUM_KEYS]; // pthread local storage keys used in test
@@ -249,3 +309,34 @@ static void *s_test_repeat_destructor_thread(void *vp_state)
     }
     pthread_exit(NULL);
 }
+
+static void s_test_endless_destructor(void *vp_key);
+static void *s_test_endless_destructor_thread(void *vp_key);
+static volatile unsigned endless_destructor_count;
+
+// A destructor which always sets its value again is called PTHREAD_DESTRUCTOR_ITERATIONS times, then the value is dropped
+TEST_CASE("pthread local storage destructor iterations are limited", "[pthread]")
+{
+    pthread_key_t key;
+    pthread_t thread;
+
+    endless_destructor_count = 0;
+    TEST_ASSERT_EQUAL(0, pthread_key_create(&key, s_test_endless_destructor));
+    TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL, s_test_endless_destructor_thread, (void *)key));
+    TEST_ASSERT_EQUAL(0, pthread_join(thread, NULL));
+
+    TEST_ASSERT_EQUAL(PTHREAD_DESTRUCTOR_ITERATIONS, endless_destructor_count);
+    TEST_ASSERT_EQUAL(0, pthread_key_delete(key));
+}
+
+static void s_test_endless_destructor(void *vp_key)
+{
+    endless_destructor_count++;
+    pthread_setspecific((pthread_key_t)vp_key, vp_key);
+}
+
+static void *s_test_endless_destructor_thread(void *vp_key)
+{
+    pthread_setspecific((pthread_key_t)vp_key, vp_key);
+    return NULL;
+}
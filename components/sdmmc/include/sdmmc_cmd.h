@@ -80,6 +80,27 @@ esp_err_t sdmmc_write_sectors(sdmmc_card_t* card, const void* src,
 esp_err_t sdmmc_read_sectors(sdmmc_card_t* card, void* dst,
         size_t start_sector, size_t sector_count);
 
+/**
+ * Statistics of the card status polling done after data transfers
+ */
+typedef struct {
+    uint32_t transfers;     /*!< Number of read/write transfers which waited for the card to become ready */
+    uint32_t polls;         /*!< Total number of SEND_STATUS commands sent while waiting */
+    uint32_t max_polls;     /*!< Largest number of SEND_STATUS commands sent after a single transfer */
+    uint32_t timeouts;      /*!< Number of transfers after which the card did not become ready in time */
+} sdmmc_ready_wait_stats_t;
+
+/**
+ * Get the statistics of the card status polling done after data transfers
+ *
+ * The statistics are collected for all the cards since startup or the last reset.
+ * The number of polls per transfer can be computed as polls / transfers.
+ *
+ * @param out_stats  output, statistics; can be NULL if only resetting
+ * @param reset  if true, the statistics are reset after reading them
+ */
+void sdmmc_get_ready_wait_stats(sdmmc_ready_wait_stats_t* out_stats, bool reset);
+
 /**
  * Erase given number of sectors from the SD/MMC card
  *
@@ -8,6 +8,9 @@
 
 static const char* TAG = "sdmmc_cmd";
 
+static sdmmc_ready_wait_stats_t s_ready_wait_stats;
+static portMUX_TYPE s_ready_wait_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
 
 esp_err_t sdmmc_send_cmd(sdmmc_card_t* card, sdmmc_command_t* cmd)
 {
@@ -352,6 +355,81 @@ esp_err_t sdmmc_send_cmd_send_status(sdmmc_card_t* card, uint32_t* out_status)
     return ESP_OK;
 }
 
+/* Wait until the card is ready for the next data command after a transfer.
+ * The card is polled with SEND_STATUS, with increasing delays in between.
+ */
+static esp_err_t sdmmc_wait_ready_for_data(sdmmc_card_t* card, uint32_t timeout_ms)
+{
+    if (host_is_spi(card)) {
+        return ESP_OK;
+    }
+    const TickType_t start = xTaskGetTickCount();
+    const TickType_t timeout_ticks = MAX(1, pdMS_TO_TICKS(timeout_ms));
+    uint32_t delay_us = SDMMC_READY_POLL_MIN_DELAY_US;
+    uint32_t spin_us = 0;
+    uint32_t status = 0;
+    uint32_t count = 0;
+    esp_err_t err;
+    while (true) {
+        err = sdmmc_send_cmd_send_status(card, &status);
+        ++count;
+        if (err != ESP_OK || (status & MMC_R1_READY_FOR_DATA)) {
+            break;
+        }
+        if (xTaskGetTickCount() - start >= timeout_ticks) {
+            ESP_LOGE(TAG, "%s: card not ready for data after %d ms (status 0x%x)", __func__, timeout_ms, status);
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        if (spin_us + delay_us <= SDMMC_READY_POLL_MAX_SPIN_US) {
+            esp_rom_delay_us(delay_us);
+            spin_us += delay_us;
+            delay_us *= 2;
+        } else {
+            vTaskDelay(1);
+        }
+        if (count % 10 == 0) {
+            ESP_LOGV(TAG, "waiting for card to become ready (%d)", count);
+        }
+    }
+    portENTER_CRITICAL(&s_ready_wait_stats_lock);
+    s_ready_wait_stats.transfers++;
+    s_ready_wait_stats.polls += count;
+    s_ready_wait_stats.max_polls = MAX(s_ready_wait_stats.max_polls, count);
+    if (err == ESP_ERR_TIMEOUT) {
+        s_ready_wait_stats.timeouts++;
+    }
+    portEXIT_CRITICAL(&s_ready_wait_stats_lock);
+    return err;
+}
+
+void sdmmc_get_ready_wait_stats(sdmmc_ready_wait_stats_t* out_stats, bool reset)
+{
+    portENTER_CRITICAL(&s_ready_wait_stats_lock);
+    if (out_stats) {
+        *out_stats = s_ready_wait_stats;
+    }
+    if (reset) {
+        memset(&s_ready_wait_stats, 0, sizeof(s_ready_wait_stats));
+    }
+    portEXIT_CRITICAL(&s_ready_wait_stats_lock);
+}
+
+/* Allocate a DMA-capable bounce buffer for up to block_count blocks, smaller if memory is short */
+static void* sdmmc_alloc_bounce_buffer(sdmmc_card_t* card, size_t block_count, size_t* out_block_count)
+{
+    size_t block_size = card->csd.sector_size;
+    size_t count = MIN(block_count, MAX(1, CONFIG_SDMMC_BOUNCE_BUFFER_SIZE / block_size));
+    while (true) {
+        void* buf = heap_caps_malloc(count * block_size, MALLOC_CAP_DMA);
+        if (buf != NULL || count == 1) {
+            *out_block_count = count;
+            return buf;
+        }
+        count /= 2;
+    }
+}
+
 esp_err_t sdmmc_write_sectors(sdmmc_card_t* card, const void* src,
         size_t start_block, size_t block_count)
 {
@@ -360,18 +438,20 @@ esp_err_t sdmmc_write_sectors(sdmmc_card_t* card, const void* src,
     if (esp_ptr_dma_capable(src) && (intptr_t)src % 4 == 0) {
         err = sdmmc_write_sectors_dma(card, src, start_block, block_count);
     } else {
-        // SDMMC peripheral needs DMA-capable buffers. Split the write into
-        // separate single block writes, if needed, and allocate a temporary
-        // DMA-capable buffer.
-        void* tmp_buf = heap_caps_malloc(block_size, MALLOC_CAP_DMA);
+        // SDMMC peripheral needs DMA-capable buffers. Allocate a temporary
+        // DMA-capable buffer and split the write into multiple block writes
+        // of the buffer size, if needed.
+        size_t chunk_blocks;
+        void* tmp_buf = sdmmc_alloc_bounce_buffer(card, block_count, &chunk_blocks);
         if (tmp_buf == NULL) {
             return ESP_ERR_NO_MEM;
         }
         const uint8_t* cur_src = (const uint8_t*) src;
-        for (size_t i = 0; i < block_count; ++i) {
-            memcpy(tmp_buf, cur_src, block_size);
-            cur_src += block_size;
-            err = sdmmc_write_sectors_dma(card, tmp_buf, start_block + i, 1);
+        for (size_t i = 0; i < block_count; i += chunk_blocks) {
+            size_t count = MIN(chunk_blocks, block_count - i);
+            memcpy(tmp_buf, cur_src, count * block_size);
+            cur_src += count * block_size;
+            err = sdmmc_write_sectors_dma(card, tmp_buf, start_block + i, count);
             if (err != ESP_OK) {
                 ESP_LOGD(TAG, "%s: error 0x%x writing block %d+%d",
                         __func__, err, start_block, i);
@@ -397,6 +477,11 @@ esp_err_t sdmmc_write_sectors_dma(sdmmc_card_t* card, const void* src,
             .datalen = block_count * block_size,
             .timeout_ms = SDMMC_WRITE_CMD_TIMEOUT_MS
     };
+    if (!host_is_spi(card)) {
+        // Let the host wait for the card to release DAT0 while it is programming
+        // the data, so that it is usually ready at the first SEND_STATUS below
+        cmd.flags |= SCF_WAIT_BUSY;
+    }
     if (block_count == 1) {
         cmd.opcode = MMC_WRITE_BLOCK_SINGLE;
     } else {
@@ -412,19 +497,7 @@ esp_err_t sdmmc_write_sectors_dma(sdmmc_card_t* card, const void* src,
         ESP_LOGE(TAG, "%s: sdmmc_send_cmd returned 0x%x", __func__, err);
         return err;
     }
-    uint32_t status = 0;
-    size_t count = 0;
-    while (!host_is_spi(card) && !(status & MMC_R1_READY_FOR_DATA)) {
-        // TODO: add some timeout here
-        err = sdmmc_send_cmd_send_status(card, &status);
-        if (err != ESP_OK) {
-            return err;
-        }
-        if (++count % 10 == 0) {
-            ESP_LOGV(TAG, "waiting for card to become ready (%d)", count);
-        }
-    }
-    return ESP_OK;
+    return sdmmc_wait_ready_for_data(card, SDMMC_WRITE_CMD_TIMEOUT_MS);
 }
 
 esp_err_t sdmmc_read_sectors(sdmmc_card_t* card, void* dst,
@@ -435,23 +508,25 @@ esp_err_t sdmmc_read_sectors(sdmmc_card_t* card, void* dst,
     if (esp_ptr_dma_capable(dst) && (intptr_t)dst % 4 == 0) {
         err = sdmmc_read_sectors_dma(card, dst, start_block, block_count);
     } else {
-        // SDMMC peripheral needs DMA-capable buffers. Split the read into
-        // separate single block reads, if needed, and allocate a temporary
-        // DMA-capable buffer.
-        void* tmp_buf = heap_caps_malloc(block_size, MALLOC_CAP_DMA);
+        // SDMMC peripheral needs DMA-capable buffers. Allocate a temporary
+        // DMA-capable buffer and split the read into multiple block reads
+        // of the buffer size, if needed.
+        size_t chunk_blocks;
+        void* tmp_buf = sdmmc_alloc_bounce_buffer(card, block_count, &chunk_blocks);
         if (tmp_buf == NULL) {
             return ESP_ERR_NO_MEM;
         }
         uint8_t* cur_dst = (uint8_t*) dst;
-        for (size_t i = 0; i < block_count; ++i) {
-            err = sdmmc_read_sectors_dma(card, tmp_buf, start_block + i, 1);
+        for (size_t i = 0; i < block_count; i += chunk_blocks) {
+            size_t count = MIN(chunk_blocks, block_count - i);
+            err = sdmmc_read_sectors_dma(card, tmp_buf, start_block + i, count);
             if (err != ESP_OK) {
-                ESP_LOGD(TAG, "%s: error 0x%x writing block %d+%d",
+                ESP_LOGD(TAG, "%s: error 0x%x reading block %d+%d",
                         __func__, err, start_block, i);
                 break;
             }
-            memcpy(cur_dst, tmp_buf, block_size);
-            cur_dst += block_size;
+            memcpy(cur_dst, tmp_buf, count * block_size);
+            cur_dst += count * block_size;
         }
         free(tmp_buf);
     }
@@ -486,19 +561,7 @@ esp_err_t sdmmc_read_sectors_dma(sdmmc_card_t* card, void* dst,
         ESP_LOGE(TAG, "%s: sdmmc_send_cmd returned 0x%x", __func__, err);
         return err;
     }
-    uint32_t status = 0;
-    size_t count = 0;
-    while (!host_is_spi(card) && !(status & MMC_R1_READY_FOR_DATA)) {
-        // TODO: add some timeout here
-        err = sdmmc_send_cmd_send_status(card, &status);
-        if (err != ESP_OK) {
-            return err;
-        }
-        if (++count % 10 == 0) {
-            ESP_LOGV(TAG, "waiting for card to become ready (%d)", count);
-        }
-    }
-    return ESP_OK;
+    return sdmmc_wait_ready_for_data(card, SDMMC_DEFAULT_CMD_TIMEOUT_MS);
 }
 
 esp_err_t sdmmc_erase_sectors(sdmmc_card_t* card, size_t start_sector,
@@ -26,6 +26,7 @@
 #include "sdmmc_cmd.h"
 #include "sys/param.h"
 #include "soc/soc_memory_layout.h"
+#include "esp_rom_sys.h"
 
 #define SDMMC_GO_IDLE_DELAY_MS              20
 #define SDMMC_IO_SEND_OP_COND_DELAY_MS      10
@@ -39,6 +40,13 @@
 #define SDMMC_WRITE_CMD_TIMEOUT_MS    5000   // Max timeout of write commands
 #define SDMMC_ERASE_BLOCK_TIMEOUT_MS  500    // Max timeout of erase per block
 
+/* Card status polling after data transfers starts with a short busy-wait delay
+ * which doubles after every poll, for at most SDMMC_READY_POLL_MAX_SPIN_US in
+ * total. From then on the task sleeps one tick between polls.
+ */
+#define SDMMC_READY_POLL_MIN_DELAY_US   10
+#define SDMMC_READY_POLL_MAX_SPIN_US    80
+
 /* Maximum retry/error count for SEND_OP_COND (CMD1).
  * These are somewhat arbitrary, values originate from OpenBSD driver.
  */
@@ -359,6 +359,7 @@ static void test_read_write_performance(sdmmc_card_t* card)
     printf("  sector  | count | align | size(kB)  | wr_time(ms) | wr_speed(MB/s)  |  rd_time(ms)  | rd_speed(MB/s)\n");
     const int offset = 0;
     const bool do_log = true;
+    sdmmc_get_ready_wait_stats(NULL, true);
     //aligned
     do_single_write_read_test(card, offset, 1, 4, do_log);
     do_single_write_read_test(card, offset, 4, 4, do_log);
@@ -371,6 +372,12 @@ static void test_read_write_performance(sdmmc_card_t* card)
     do_single_write_read_test(card, offset, 1, 1, do_log);
     do_single_write_read_test(card, offset, 8, 1, do_log);
     do_single_write_read_test(card, offset, 128, 1, do_log);
+
+    sdmmc_ready_wait_stats_t stats;
+    sdmmc_get_ready_wait_stats(&stats, false);
+    IDF_LOG_PERFORMANCE("SD ready wait polls per transfer", "%d, max %d, transfers: %d",
+                        stats.transfers ? stats.polls / stats.transfers : 0, stats.max_polls, stats.transfers);
+    TEST_ASSERT_EQUAL(0, stats.timeouts);
 }
 
 static void test_read_write_with_offset(sdmmc_card_t* card)
@@ -397,6 +404,8 @@ static void test_read_write_with_offset(sdmmc_card_t* card)
     do_single_write_read_test(card, card->csd.capacity/2, 1, 1, no_log);
     do_single_write_read_test(card, card->csd.capacity/2, 8, 1, no_log);
     do_single_write_read_test(card, card->csd.capacity/2, 128, 1, no_log);
+    // not a multiple of the bounce buffer size
+    do_single_write_read_test(card, card->csd.capacity/2, 45, 1, no_log);
 }
 #endif //WITH_SD_TEST || WITH_SDSPI_TEST || WITH_EMMC_TEST
 
@@ -0,0 +1,243 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/lock.h>
+#include <sys/param.h>
+#include <sys/queue.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_spi_flash.h"
+#include "esp_flash_async.h"
+#include "sdkconfig.h"
+
+static const char TAG[] = "spi_flash_async";
+
+#define ASYNC_ERASE_BLOCK_SIZE  0x10000
+
+typedef enum {
+    ASYNC_OP_READ,
+    ASYNC_OP_WRITE,
+    ASYNC_OP_ERASE,
+} async_op_type_t;
+
+struct esp_flash_async_op_t {
+    TAILQ_ENTRY(esp_flash_async_op_t) next;
+    esp_flash_t *chip;
+    async_op_type_t type;
+    uint8_t *buffer;
+    uint32_t address;
+    uint32_t length;
+    uint32_t done;                  // bytes already processed
+    esp_flash_async_cb_t cb;
+    void *arg;
+    bool auto_release;              // no handle was returned, release after the callback
+    bool cancelled;
+    bool completed;
+    esp_err_t result;
+    SemaphoreHandle_t done_sem;
+    StaticSemaphore_t done_sem_buf;
+};
+
+static TAILQ_HEAD(, esp_flash_async_op_t) s_pending = TAILQ_HEAD_INITIALIZER(s_pending);
+static portMUX_TYPE s_pending_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_worker;
+static _lock_t s_worker_init_lock;
+
+static void async_op_complete(struct esp_flash_async_op_t *op, esp_err_t result)
+{
+    portENTER_CRITICAL(&s_pending_lock);
+    op->result = result;
+    op->completed = true;
+    portEXIT_CRITICAL(&s_pending_lock);
+
+    if (op->cb) {
+        op->cb(op->auto_release ? NULL : op, result, op->arg);
+    }
+    if (op->auto_release) {
+        vSemaphoreDelete(op->done_sem);
+        free(op);
+    } else {
+        // the submitter may release the operation as soon as this is given
+        xSemaphoreGive(op->done_sem);
+    }
+}
+
+/* Run the next chunk of the operation. Returns true once the whole operation is done. */
+static bool async_op_run_chunk(struct esp_flash_async_op_t *op, esp_err_t *out_err)
+{
+    const uint32_t address = op->address + op->done;
+    const uint32_t remaining = op->length - op->done;
+    uint32_t chunk;
+
+    switch (op->type) {
+    case ASYNC_OP_READ:
+        chunk = MIN(remaining, CONFIG_SPI_FLASH_ASYNC_CHUNK_SIZE);
+        *out_err = esp_flash_read(op->chip, op->buffer + op->done, address, chunk);
+        break;
+    case ASYNC_OP_WRITE:
+        chunk = MIN(remaining, CONFIG_SPI_FLASH_ASYNC_CHUNK_SIZE);
+        *out_err = esp_flash_write(op->chip, op->buffer + op->done, address, chunk);
+        break;
+    default:
+        // one block erase where possible, as it takes about as long as a sector erase
+        if (address % ASYNC_ERASE_BLOCK_SIZE == 0 && remaining >= ASYNC_ERASE_BLOCK_SIZE) {
+            chunk = ASYNC_ERASE_BLOCK_SIZE;
+        } else {
+            chunk = SPI_FLASH_SEC_SIZE;
+        }
+        *out_err = esp_flash_erase_region(op->chip, address, chunk);
+        break;
+    }
+    op->done += chunk;
+    return *out_err != ESP_OK || op->done >= op->length;
+}
+
+static void async_worker_task(void *arg)
+{
+    while (true) {
+        portENTER_CRITICAL(&s_pending_lock);
+        struct esp_flash_async_op_t *op = TAILQ_FIRST(&s_pending);
+        if (op) {
+            TAILQ_REMOVE(&s_pending, op, next);
+        }
+        const bool cancelled = op && op->cancelled;
+        portEXIT_CRITICAL(&s_pending_lock);
+
+        if (op == NULL) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        if (cancelled) {
+            ESP_LOGD(TAG, "op %p cancelled after 0x%x of 0x%x bytes", op, op->done, op->length);
+            async_op_complete(op, ESP_ERR_INVALID_STATE);
+            continue;
+        }
+
+        esp_err_t err = ESP_OK;
+        if (op->length == 0 || async_op_run_chunk(op, &err)) {
+            if (err != ESP_OK) {
+                ESP_LOGD(TAG, "op %p failed at 0x%x (0x%x)", op, op->address + op->done, err);
+            }
+            async_op_complete(op, err);
+        } else {
+            // let the other pending operations run their next chunk first
+            portENTER_CRITICAL(&s_pending_lock);
+            TAILQ_INSERT_TAIL(&s_pending, op, next);
+            portEXIT_CRITICAL(&s_pending_lock);
+        }
+    }
+}
+
+static esp_err_t async_worker_start(void)
+{
+    esp_err_t err = ESP_OK;
+    _lock_acquire(&s_worker_init_lock);
+    if (s_worker == NULL) {
+        if (xTaskCreate(async_worker_task, "flash_async", CONFIG_SPI_FLASH_ASYNC_TASK_STACK_SIZE, NULL,
+                        CONFIG_SPI_FLASH_ASYNC_TASK_PRIORITY, &s_worker) != pdPASS) {
+            ESP_LOGE(TAG, "failed to create worker task");
+            s_worker = NULL;
+            err = ESP_ERR_NO_MEM;
+        }
+    }
+    _lock_release(&s_worker_init_lock);
+    return err;
+}
+
+static esp_err_t async_op_submit(esp_flash_t *chip, async_op_type_t type, void *buffer, uint32_t address, uint32_t length,
+                                 esp_flash_async_cb_t cb, void *arg, esp_flash_async_handle_t *out_handle)
+{
+    esp_err_t err = async_worker_start();
+    if (err != ESP_OK) {
+        return err;
+    }
+    struct esp_flash_async_op_t *op = calloc(1, sizeof(struct esp_flash_async_op_t));
+    if (op == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    op->chip = chip;
+    op->type = type;
+    op->buffer = buffer;
+    op->address = address;
+    op->length = length;
+    op->cb = cb;
+    op->arg = arg;
+    op->auto_release = (out_handle == NULL);
+    op->done_sem = xSemaphoreCreateBinaryStatic(&op->done_sem_buf);
+
+    if (out_handle) {
+        *out_handle = op;
+    }
+    portENTER_CRITICAL(&s_pending_lock);
+    TAILQ_INSERT_TAIL(&s_pending, op, next);
+    portEXIT_CRITICAL(&s_pending_lock);
+    xTaskNotifyGive(s_worker);
+    return ESP_OK;
+}
+
+esp_err_t esp_flash_read_async(esp_flash_t *chip, void *buffer, uint32_t address, uint32_t length,
+                               esp_flash_async_cb_t cb, void *arg, esp_flash_async_handle_t *out_handle)
+{
+    if (buffer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return async_op_submit(chip, ASYNC_OP_READ, buffer, address, length, cb, arg, out_handle);
+}
+
+esp_err_t esp_flash_write_async(esp_flash_t *chip, const void *buffer, uint32_t address, uint32_t length,
+                                esp_flash_async_cb_t cb, void *arg, esp_flash_async_handle_t *out_handle)
+{
+    if (buffer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return async_op_submit(chip, ASYNC_OP_WRITE, (void *)buffer, address, length, cb, arg, out_handle);
+}
+
+esp_err_t esp_flash_erase_region_async(esp_flash_t *chip, uint32_t start, uint32_t len,
+                                       esp_flash_async_cb_t cb, void *arg, esp_flash_async_handle_t *out_handle)
+{
+    if (start % SPI_FLASH_SEC_SIZE != 0 || len % SPI_FLASH_SEC_SIZE != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return async_op_submit(chip, ASYNC_OP_ERASE, NULL, start, len, cb, arg, out_handle);
+}
+
+esp_err_t esp_flash_async_wait(esp_flash_async_handle_t op, TickType_t ticks_to_wait, esp_err_t *out_result)
+{
+    if (op == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (xSemaphoreTake(op->done_sem, ticks_to_wait) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (out_result) {
+        *out_result = op->result;
+    }
+    vSemaphoreDelete(op->done_sem);
+    free(op);
+    return ESP_OK;
+}
+
+esp_err_t esp_flash_async_cancel(esp_flash_async_handle_t op)
+{
+    if (op == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    portENTER_CRITICAL(&s_pending_lock);
+    if (op->completed) {
+        err = ESP_ERR_INVALID_STATE;
+    } else {
+        // completed by the worker when the operation gets its next turn
+        op->cancelled = true;
+    }
+    portEXIT_CRITICAL(&s_pending_lock);
+    return err;
+}
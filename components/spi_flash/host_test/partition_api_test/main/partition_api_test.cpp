@@ -7,6 +7,7 @@
  */
 
 #include <string.h>
+#include <time.h>
 #include "esp_err.h"
 #include "esp_partition.h"
 #include "esp_private/partition_linux.h"
@@ -66,6 +67,45 @@ int main(int argc, char **argv)
     const esp_partition_t *partition_data = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
     assert(partition_data);
 
+    //7a. esp_partition_find_first must return the same partitions as the iterator API
+    iter = esp_partition_find(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_PHY, NULL);
+    assert(iter);
+    assert(esp_partition_get(iter) == esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_PHY, NULL));
+    esp_partition_iterator_release(iter);
+    // the index is sorted by subtype, but the first partition in table order must be returned
+    iter = esp_partition_find(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, NULL);
+    assert(iter);
+    assert(esp_partition_get(iter) == esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, NULL));
+    assert(esp_partition_get(iter)->subtype == ESP_PARTITION_SUBTYPE_DATA_NVS);
+    esp_partition_iterator_release(iter);
+    iter = esp_partition_find(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, NULL);
+    assert(iter);
+    assert(esp_partition_get(iter) == esp_partition_find_first(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, NULL));
+    esp_partition_iterator_release(iter);
+    assert(esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_FACTORY, "factory") != NULL);
+    assert(esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_FACTORY, "storage") == NULL);
+    assert(esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "no_such_label") == NULL);
+    assert(esp_partition_find_first(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_DATA_NVS, NULL) == NULL);
+
+    //7b. lookup benchmark: esp_partition_find_first vs. esp_partition_find/get/release
+    const int lookup_count = 100000;
+    struct timespec t_start, t_end;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    for (int i = 0; i < lookup_count; i++) {
+        assert(esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage") == partition_data);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    double find_first_ns = ((t_end.tv_sec - t_start.tv_sec) * 1e9 + (t_end.tv_nsec - t_start.tv_nsec)) / lookup_count;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    for (int i = 0; i < lookup_count; i++) {
+        iter = esp_partition_find(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+        assert(esp_partition_get(iter) == partition_data);
+        esp_partition_iterator_release(iter);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    double find_ns = ((t_end.tv_sec - t_start.tv_sec) * 1e9 + (t_end.tv_nsec - t_start.tv_nsec)) / lookup_count;
+    printf("(lookup: find_first %.0f ns, find/get/release %.0f ns) ", find_first_ns, find_ns);
+
     /////////////////////////////////////
     //OPERATIONS
 
@@ -96,7 +136,51 @@ int main(int argc, char **argv)
     const esp_partition_t *verified_partition = esp_partition_verify(partition_data);
     assert(verified_partition != NULL);
 
-    //12. release SPI FLASH emulation block from memory
+    //12. read cache: repeated and sequential reads, invalidation by write and erase
+    esp_partition_read_cache_config_t cache_config = {
+        .block_size = 256,
+        .block_count = 4,
+        .readahead_blocks = 1,
+    };
+    err = esp_partition_read_cache_enable(partition_data, &cache_config);
+    assert(err == ESP_OK);
+    assert(esp_partition_read_cache_enable(partition_data, &cache_config) == ESP_ERR_INVALID_STATE);
+
+    err = esp_partition_write(partition_data, off, (const void *)buff, bufsize);
+    assert(err == ESP_OK);
+    for (int i = 0; i < 10; i++) {
+        memset(buffout, 0, sizeof(buffout));
+        assert(esp_partition_read(partition_data, off, (void *)buffout, bufsize) == ESP_OK);
+        assert(memcmp(buffout, buff, bufsize) == 0);
+    }
+    esp_partition_read_cache_stats_t stats;
+    assert(esp_partition_read_cache_get_stats(partition_data, &stats) == ESP_OK);
+    assert(stats.misses == 1 && stats.hits == 9);
+
+    //sequential reads crossing into the next block trigger read-ahead
+    uint8_t bufseq[0x100];
+    assert(esp_partition_read(partition_data, off + bufsize, (void *)bufseq, sizeof(bufseq)) == ESP_OK);
+    assert(esp_partition_read_cache_get_stats(partition_data, &stats) == ESP_OK);
+    assert(stats.misses == 2 && stats.readaheads == 1);
+    assert(esp_partition_read(partition_data, 0x300, (void *)buffout, sizeof(buffout)) == ESP_OK);
+    assert(esp_partition_read_cache_get_stats(partition_data, &stats) == ESP_OK);
+    assert(stats.misses == 2);
+
+    //writes and erases drop the cached blocks
+    uint8_t zeros[4] = {0};
+    assert(esp_partition_write(partition_data, off, (const void *)zeros, sizeof(zeros)) == ESP_OK);
+    assert(esp_partition_read(partition_data, off, (void *)buffout, bufsize) == ESP_OK);
+    assert(memcmp(buffout, zeros, sizeof(zeros)) == 0 && memcmp(buffout + 4, buff + 4, bufsize - 4) == 0);
+    assert(esp_partition_erase_range(partition_data, sector_off, SPI_FLASH_SEC_SIZE) == ESP_OK);
+    assert(esp_partition_read(partition_data, off, (void *)buffout, bufsize) == ESP_OK);
+    assert(memcmp(buffout, buferase, bufsize) == 0);
+    assert(esp_partition_read_cache_get_stats(partition_data, &stats) == ESP_OK);
+    assert(stats.invalidations >= 2);
+
+    assert(esp_partition_read_cache_disable(partition_data) == ESP_OK);
+    assert(esp_partition_read_cache_disable(partition_data) == ESP_ERR_NOT_FOUND);
+
+    //13. release SPI FLASH emulation block from memory
     err = esp_partition_file_munmap();
     assert(err == ESP_OK);
 
@@ -0,0 +1,125 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_flash.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Asynchronous flash operations
+ *
+ * Operations submitted with the functions below are queued and executed by a flash worker task.
+ * The worker splits every operation into chunks (see CONFIG_SPI_FLASH_ASYNC_CHUNK_SIZE for reads
+ * and writes; erases are done one sector or one 64 KB block at a time) and serves the pending
+ * operations round-robin, one chunk at a time. Between two chunks the flash cache is enabled,
+ * so the submitting task and other tasks can keep running code from flash while a long erase
+ * or write is in progress.
+ *
+ * Each chunk is executed with the regular blocking esp_flash_read(), esp_flash_write() or
+ * esp_flash_erase_region() function, so all their checks and chip specific behaviour
+ * (e.g. erase suspend with CONFIG_SPI_FLASH_AUTO_SUSPEND) also apply here.
+ */
+
+/** Handle of an asynchronous flash operation */
+typedef struct esp_flash_async_op_t *esp_flash_async_handle_t;
+
+/**
+ * @brief Completion callback of an asynchronous flash operation
+ *
+ * Called from the flash worker task once the operation is finished, failed or was cancelled.
+ * The callback must not block, as it delays the other pending operations.
+ *
+ * @param op Handle of the operation, or NULL if no handle was returned to the submitter.
+ * @param result ESP_OK on success, ESP_ERR_INVALID_STATE if the operation was cancelled, or
+ *               the error returned by the failing flash function.
+ * @param arg User argument given when the operation was submitted.
+ */
+typedef void (*esp_flash_async_cb_t)(esp_flash_async_handle_t op, esp_err_t result, void *arg);
+
+/**
+ * @brief Queue a read from the SPI flash chip
+ *
+ * The buffer must stay valid until the operation is completed.
+ *
+ * @param chip Pointer to identify flash chip, see esp_flash_read(). If NULL, esp_flash_default_chip is used.
+ * @param buffer Pointer to a buffer where the data will be read.
+ * @param address Address on flash to read from.
+ * @param length Length (in bytes) of data to read.
+ * @param cb Callback to call on completion, can be NULL.
+ * @param arg User argument passed to the callback.
+ * @param[out] out_handle If not NULL, receives the handle of the operation. The operation must then
+ *                        be released with esp_flash_async_wait(). If NULL, the operation is released
+ *                        automatically after the callback returns.
+ *
+ * @return
+ *      - ESP_OK: the operation is queued
+ *      - ESP_ERR_INVALID_ARG: buffer is NULL
+ *      - ESP_ERR_NO_MEM: the operation or the worker task could not be allocated
+ */
+esp_err_t esp_flash_read_async(esp_flash_t *chip, void *buffer, uint32_t address, uint32_t length,
+                               esp_flash_async_cb_t cb, void *arg, esp_flash_async_handle_t *out_handle);
+
+/**
+ * @brief Queue a write to the SPI flash chip
+ *
+ * The buffer must stay valid and unchanged until the operation is completed.
+ * Parameters and return values are the same as for esp_flash_read_async().
+ */
+esp_err_t esp_flash_write_async(esp_flash_t *chip, const void *buffer, uint32_t address, uint32_t length,
+                                esp_flash_async_cb_t cb, void *arg, esp_flash_async_handle_t *out_handle);
+
+/**
+ * @brief Queue the erase of a region of the SPI flash chip
+ *
+ * @param start Address to start erasing flash. Must be sector aligned.
+ * @param len Length of region to erase. Must also be sector aligned.
+ *
+ * Other parameters and the return values are the same as for esp_flash_read_async().
+ * ESP_ERR_INVALID_ARG is also returned if start or len is not sector aligned.
+ */
+esp_err_t esp_flash_erase_region_async(esp_flash_t *chip, uint32_t start, uint32_t len,
+                                       esp_flash_async_cb_t cb, void *arg, esp_flash_async_handle_t *out_handle);
+
+/**
+ * @brief Wait for an asynchronous operation to complete, and release it
+ *
+ * @param op Handle returned when the operation was submitted
+ * @param ticks_to_wait Maximum time to wait
+ * @param[out] out_result If not NULL, receives the result of the operation
+ *
+ * @return
+ *      - ESP_OK: the operation is completed and the handle is released
+ *      - ESP_ERR_TIMEOUT: the operation is still pending, the handle stays valid
+ *      - ESP_ERR_INVALID_ARG: op is NULL
+ */
+esp_err_t esp_flash_async_wait(esp_flash_async_handle_t op, TickType_t ticks_to_wait, esp_err_t *out_result);
+
+/**
+ * @brief Cancel an asynchronous operation
+ *
+ * If the operation has not started yet, none of it is executed. If it is in progress, it is stopped
+ * after the current chunk, so part of the region may already be read, written or erased.
+ * A cancelled operation completes with ESP_ERR_INVALID_STATE; it must still be released
+ * with esp_flash_async_wait().
+ *
+ * @param op Handle returned when the operation was submitted
+ *
+ * @return
+ *      - ESP_OK: the operation will be cancelled
+ *      - ESP_ERR_INVALID_STATE: the operation is already completed
+ *      - ESP_ERR_INVALID_ARG: op is NULL
+ */
+esp_err_t esp_flash_async_cancel(esp_flash_async_handle_t op);
+
+#ifdef __cplusplus
+}
+#endif
@@ -424,6 +424,70 @@ esp_err_t esp_partition_register_external(esp_flash_t* flash_chip, size_t offset
  */
 esp_err_t esp_partition_deregister_external(const esp_partition_t* partition);
 
+/**
+ * @brief Configuration of a partition read cache
+ */
+typedef struct {
+    size_t block_size;          /*!< Size of one cache block in bytes, must be a power of two */
+    size_t block_count;         /*!< Number of cache blocks, at least 2 */
+    size_t readahead_blocks;    /*!< Number of following blocks loaded when a sequential read misses the cache, 0 to disable. Must be less than block_count */
+} esp_partition_read_cache_config_t;
+
+/**
+ * @brief Statistics of a partition read cache
+ */
+typedef struct {
+    uint32_t hits;              /*!< Number of blocks served from the cache */
+    uint32_t misses;            /*!< Number of blocks loaded from flash because they were not cached */
+    uint32_t readaheads;        /*!< Number of blocks loaded from flash by read-ahead */
+    uint32_t invalidations;     /*!< Number of cached blocks dropped by writes and erases */
+} esp_partition_read_cache_stats_t;
+
+/**
+ * @brief Enable a read cache for a partition
+ *
+ * Reads done with esp_partition_read and esp_partition_read_raw are then served from a cache of
+ * block_count blocks of block_size bytes, which are replaced in least recently used order.
+ * This is useful for partitions which can't be memory mapped, e.g. partitions on external flash chips,
+ * and from which the same small records are read many times.
+ *
+ * Cached blocks are invalidated by esp_partition_write, esp_partition_write_raw and esp_partition_erase_range.
+ * Writes done to the same flash region by other means (e.g. esp_flash_write) are not detected.
+ *
+ * Only available if CONFIG_SPI_FLASH_PARTITION_READ_CACHE is enabled.
+ *
+ * @param partition  Pointer to partition structure obtained using esp_partition_find_first or esp_partition_get.
+ * @param config  Cache configuration
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the configuration is invalid
+ *      - ESP_ERR_INVALID_STATE if the partition already has a read cache
+ *      - ESP_ERR_NOT_SUPPORTED if the partition is encrypted
+ *      - ESP_ERR_NO_MEM if memory allocation has failed
+ */
+esp_err_t esp_partition_read_cache_enable(const esp_partition_t* partition, const esp_partition_read_cache_config_t* config);
+
+/**
+ * @brief Disable the read cache of a partition and free its memory
+ *
+ * @param partition  Pointer to partition structure
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND if the partition has no read cache
+ */
+esp_err_t esp_partition_read_cache_disable(const esp_partition_t* partition);
+
+/**
+ * @brief Get the statistics of the read cache of a partition
+ *
+ * @param partition  Pointer to partition structure
+ * @param[out] out_stats  Output, receives the statistics
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND if the partition has no read cache
+ */
+esp_err_t esp_partition_read_cache_get_stats(const esp_partition_t* partition, esp_partition_read_cache_stats_t* out_stats);
+
 #ifdef __cplusplus
 }
 #endif
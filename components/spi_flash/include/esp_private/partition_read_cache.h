@@ -0,0 +1,56 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file partition_read_cache.h
+ *
+ * @brief Private API of the partition read cache, used by the esp_partition read/write implementations
+ */
+
+/**
+ * @brief Function reading data from the partition, bypassing the cache
+ *
+ * Arguments are already validated against the partition size.
+ */
+typedef esp_err_t (*esp_partition_read_uncached_t)(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+
+/**
+ * @brief Read data through the read cache of the partition
+ *
+ * @param partition  Partition to read from
+ * @param src_offset  Offset within the partition, validated by the caller
+ * @param dst  Output buffer
+ * @param size  Number of bytes to read, validated by the caller
+ * @param read_uncached  Function used to load cache blocks from the partition
+ * @return
+ *      - ESP_ERR_NOT_FOUND if the partition has no read cache; nothing was read
+ *      - ESP_OK on success
+ *      - or the error returned by read_uncached
+ */
+esp_err_t esp_partition_read_cache_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size,
+                                        esp_partition_read_uncached_t read_uncached);
+
+/**
+ * @brief Drop the cached blocks overlapping a region of the partition, after the region was written or erased
+ *
+ * Must be called once the write or erase operation has completed (also when it failed). Dropping the blocks
+ * earlier would let a concurrent read cache the old contents again.
+ */
+void esp_partition_read_cache_invalidate(const esp_partition_t *partition, size_t offset, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
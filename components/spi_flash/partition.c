@@ -30,6 +30,10 @@
 #include "esp_private/partition_linux.h"
 #endif
 
+#if CONFIG_SPI_FLASH_PARTITION_READ_CACHE
+#include "esp_private/partition_read_cache.h"
+#endif
+
 #ifndef NDEBUG
 // Enable built-in checks in queue.h in debug builds
 #define INVARIANTS
@@ -50,8 +54,22 @@ typedef struct esp_partition_iterator_opaque_ {
     esp_partition_t *info;                          // pointer to info (it is redundant, but makes code more readable)
 } esp_partition_iterator_opaque_t;
 
+/* Index of s_partition_list sorted by (type, subtype), so that esp_partition_find_first
+ * can binary search it without allocating an iterator. Entries with the same type and
+ * subtype keep the table order, given by 'order'. Labels are compared by hash first.
+ */
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t label_hash;
+    size_t order;                                   // position in s_partition_list
+    const esp_partition_t *info;
+} partition_index_entry_t;
+
 static SLIST_HEAD(partition_list_head_, partition_list_item_) s_partition_list = SLIST_HEAD_INITIALIZER(s_partition_list);
 static _lock_t s_partition_list_lock;
+static partition_index_entry_t *s_partition_index;     // NULL if it couldn't be allocated
+static size_t s_partition_index_len;
 
 static const char *TAG = "partition";
 
@@ -211,6 +229,115 @@ static esp_err_t load_partitions(void)
     return err;
 }
 
+// FNV-1a
+static uint32_t partition_label_hash(const char *label)
+{
+    uint32_t hash = 2166136261;
+    for (; *label != '\0'; label++) {
+        hash = (hash ^ (uint8_t) *label) * 16777619;
+    }
+    return hash;
+}
+
+static int partition_index_compare(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                   const partition_index_entry_t *entry)
+{
+    if (type != entry->type) {
+        return (type < entry->type) ? -1 : 1;
+    }
+    if (subtype != entry->subtype) {
+        return (subtype < entry->subtype) ? -1 : 1;
+    }
+    return 0;
+}
+
+static int partition_index_entry_compare(const void *a, const void *b)
+{
+    const partition_index_entry_t *ea = (const partition_index_entry_t *) a;
+    const partition_index_entry_t *eb = (const partition_index_entry_t *) b;
+    int res = partition_index_compare(ea->type, ea->subtype, eb);
+    if (res == 0) {
+        res = (ea->order < eb->order) ? -1 : 1;
+    }
+    return res;
+}
+
+// Rebuild s_partition_index after s_partition_list has changed.
+// Called with s_partition_list_lock taken.
+static void rebuild_partition_index(void)
+{
+    size_t count = 0;
+    partition_list_item_t *it;
+    SLIST_FOREACH(it, &s_partition_list, next) {
+        count++;
+    }
+    free(s_partition_index);
+    s_partition_index_len = 0;
+    s_partition_index = (partition_index_entry_t *) calloc(count, sizeof(partition_index_entry_t));
+    if (s_partition_index == NULL) {
+        // lookups fall back to iterating over the list
+        return;
+    }
+    SLIST_FOREACH(it, &s_partition_list, next) {
+        partition_index_entry_t *entry = &s_partition_index[s_partition_index_len];
+        entry->type = it->info.type;
+        entry->subtype = it->info.subtype;
+        entry->label_hash = partition_label_hash(it->info.label);
+        entry->order = s_partition_index_len++;
+        entry->info = &it->info;
+    }
+    qsort(s_partition_index, s_partition_index_len, sizeof(partition_index_entry_t), partition_index_entry_compare);
+}
+
+// Index of the first entry not ordered before (type, subtype)
+static size_t partition_index_lower_bound(esp_partition_type_t type, esp_partition_subtype_t subtype)
+{
+    size_t lo = 0;
+    size_t hi = s_partition_index_len;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (partition_index_compare(type, subtype, &s_partition_index[mid]) > 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Called with s_partition_list_lock taken, and s_partition_index allocated
+static const esp_partition_t *partition_index_find_first(esp_partition_type_t type,
+        esp_partition_subtype_t subtype, const char *label)
+{
+    const uint32_t label_hash = (label != NULL) ? partition_label_hash(label) : 0;
+    size_t i = 0;
+    if (type != ESP_PARTITION_TYPE_ANY) {
+        // with ESP_PARTITION_SUBTYPE_ANY, start at the first subtype of the type
+        i = partition_index_lower_bound(type, (subtype != ESP_PARTITION_SUBTYPE_ANY) ? subtype : 0);
+    }
+    const partition_index_entry_t *res = NULL;
+    for (; i < s_partition_index_len; i++) {
+        const partition_index_entry_t *entry = &s_partition_index[i];
+        if (type != ESP_PARTITION_TYPE_ANY && type != entry->type) {
+            break;
+        }
+        if (subtype != ESP_PARTITION_SUBTYPE_ANY && subtype != entry->subtype) {
+            break;
+        }
+        if (label != NULL && (label_hash != entry->label_hash || strcmp(label, entry->info->label) != 0)) {
+            continue;
+        }
+        if (res == NULL || entry->order < res->order) {
+            res = entry;
+        }
+        if (subtype != ESP_PARTITION_SUBTYPE_ANY) {
+            // the range is in table order
+            break;
+        }
+    }
+    return (res != NULL) ? res->info : NULL;
+}
+
 static esp_err_t ensure_partitions_loaded(void)
 {
     esp_err_t err = ESP_OK;
@@ -222,6 +349,8 @@ static esp_err_t ensure_partitions_loaded(void)
             err = load_partitions();
             if (err != ESP_OK) {
                 ESP_LOGE(TAG, "load_partitions returned 0x%x", err);
+            } else {
+                rebuild_partition_index();
             }
         }
         _lock_release(&s_partition_list_lock);
@@ -304,11 +433,28 @@ esp_partition_iterator_t esp_partition_next(esp_partition_iterator_t it)
 const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
         esp_partition_subtype_t subtype, const char *label)
 {
+    if (ensure_partitions_loaded() != ESP_OK) {
+        return NULL;
+    }
+    if (type == ESP_PARTITION_TYPE_ANY && subtype != ESP_PARTITION_SUBTYPE_ANY) {
+        return NULL;
+    }
+    const esp_partition_t *res = NULL;
+    _lock_acquire(&s_partition_list_lock);
+    const bool indexed = (s_partition_index != NULL);
+    if (indexed) {
+        res = partition_index_find_first(type, subtype, label);
+    }
+    _lock_release(&s_partition_list_lock);
+    if (indexed) {
+        return res;
+    }
+
     esp_partition_iterator_t it = esp_partition_find(type, subtype, label);
     if (it == NULL) {
         return NULL;
     }
-    const esp_partition_t *res = esp_partition_get(it);
+    res = esp_partition_get(it);
     esp_partition_iterator_release(it);
     return res;
 }
@@ -400,6 +546,7 @@ esp_err_t esp_partition_register_external(esp_flash_t *flash_chip, size_t offset
     } else {
         SLIST_INSERT_AFTER(last, item, next);
     }
+    rebuild_partition_index();
     _lock_release(&s_partition_list_lock);
     if (out_partition != NULL) {
         *out_partition = &item->info;
@@ -419,7 +566,11 @@ esp_err_t esp_partition_deregister_external(const esp_partition_t *partition)
                 break;
             }
             SLIST_REMOVE(&s_partition_list, it, partition_list_item_, next);
+#if CONFIG_SPI_FLASH_PARTITION_READ_CACHE
+            esp_partition_read_cache_disable(&it->info);
+#endif
             free(it);
+            rebuild_partition_index();
             result = ESP_OK;
             break;
         }
@@ -16,6 +16,9 @@
 #include "esp_partition.h"
 #include "esp_flash_partitions.h"
 #include "esp_private/partition_linux.h"
+#if CONFIG_SPI_FLASH_PARTITION_READ_CACHE
+#include "esp_private/partition_read_cache.h"
+#endif
 #include "esp_log.h"
 
 static const char *TAG = "linux_spiflash";
@@ -196,6 +199,22 @@ esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offse
     memcpy(dst_addr, write_buf, size);
     free(write_buf);
 
+#if CONFIG_SPI_FLASH_PARTITION_READ_CACHE
+    // only once the flash holds the new data, so a concurrent read can't cache the old data again
+    esp_partition_read_cache_invalidate(partition, dst_offset, size);
+#endif
+
+    return ESP_OK;
+}
+
+static esp_err_t partition_read_uncached(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    void *src_addr = s_spiflash_mem_file_buf + partition->address + src_offset;
+
+    ESP_LOGV(TAG, "esp_partition_read(): partition=%s src_offset=%zu dst=%p size=%zu (real src address: %p)", partition->label, src_offset, dst, size, src_addr);
+
+    memcpy(dst, src_addr, size);
+
     return ESP_OK;
 }
 
@@ -213,13 +232,13 @@ esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset
         return ESP_ERR_INVALID_SIZE;
     }
 
-    void *src_addr = s_spiflash_mem_file_buf + partition->address + src_offset;
-
-    ESP_LOGV(TAG, "esp_partition_read(): partition=%s src_offset=%zu dst=%p size=%zu (real src address: %p)", partition->label, src_offset, dst, size, src_addr);
-
-    memcpy(dst, src_addr, size);
-
-    return ESP_OK;
+#if CONFIG_SPI_FLASH_PARTITION_READ_CACHE
+    esp_err_t err = esp_partition_read_cache_read(partition, src_offset, dst, size, partition_read_uncached);
+    if (err != ESP_ERR_NOT_FOUND) {
+        return err;
+    }
+#endif
+    return partition_read_uncached(partition, src_offset, dst, size);
 }
 
 esp_err_t esp_partition_read_raw(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
@@ -251,5 +270,9 @@ esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t off
     //set all bits to 1 (NOR FLASH default)
     memset(target_addr, 0xFF, size);
 
+#if CONFIG_SPI_FLASH_PARTITION_READ_CACHE
+    esp_partition_read_cache_invalidate(partition, offset, size);
+#endif
+
     return ESP_OK;
 }
@@ -0,0 +1,306 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/lock.h>
+#include <sys/param.h>
+#include "sys/queue.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_private/partition_read_cache.h"
+
+#define BLOCK_INVALID   SIZE_MAX
+#define BLOCK_LOADING   (SIZE_MAX - 1)      // slot reserved by a read which is loading it from flash
+
+typedef struct partition_read_cache_ {
+    const esp_partition_t *partition;
+    size_t block_size;
+    size_t block_count;
+    size_t readahead_blocks;
+    uint8_t *data;                      // block_count * block_size bytes
+    size_t *block_offset;               // offset of the block held by each slot, BLOCK_INVALID or BLOCK_LOADING
+    uint32_t *block_last_use;           // value of use_counter when each slot was last used
+    uint32_t use_counter;
+    uint32_t generation;                // incremented by every invalidation
+    size_t next_seq_offset;             // end of the previous read, to detect sequential reads
+    int users;                          // reads in progress, which may access data without the lock
+    bool disabled;                      // removed from s_read_caches, freed by the last user
+    esp_partition_read_cache_stats_t stats;
+    SLIST_ENTRY(partition_read_cache_) next;
+} partition_read_cache_t;
+
+static SLIST_HEAD(, partition_read_cache_) s_read_caches = SLIST_HEAD_INITIALIZER(s_read_caches);
+static _lock_t s_read_cache_lock;
+
+static const char *TAG = "partition_cache";
+
+static void free_cache(partition_read_cache_t *cache);
+
+// Called with s_read_cache_lock taken
+static partition_read_cache_t *find_cache(const esp_partition_t *partition)
+{
+    partition_read_cache_t *cache;
+    SLIST_FOREACH(cache, &s_read_caches, next) {
+        if (cache->partition == partition) {
+            return cache;
+        }
+    }
+    return NULL;
+}
+
+static int find_block(partition_read_cache_t *cache, size_t block_offset)
+{
+    for (int i = 0; i < cache->block_count; i++) {
+        if (cache->block_offset[i] == block_offset) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Load the block at block_offset into the least recently used slot.
+ *
+ * Called with s_read_cache_lock taken. The lock is released while reading the flash, so that reads
+ * hitting the cache (and reads of other partitions) don't wait for the flash. The slot is reserved
+ * meanwhile, and the block is only published if no invalidation happened during the read.
+ * The slot data can be used until s_read_cache_lock is released again.
+ *
+ * Sets *out_slot to -1 if all the slots are being loaded by other reads; nothing was read then.
+ */
+static esp_err_t load_block(partition_read_cache_t *cache, size_t block_offset,
+                            esp_partition_read_uncached_t read_uncached, int *out_slot)
+{
+    int slot = -1;
+    for (int i = 0; i < cache->block_count; i++) {
+        if (cache->block_offset[i] == BLOCK_LOADING) {
+            continue;
+        }
+        if (cache->block_offset[i] == BLOCK_INVALID) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 || cache->block_last_use[i] < cache->block_last_use[slot]) {
+            slot = i;
+        }
+    }
+    *out_slot = slot;
+    if (slot < 0) {
+        return ESP_OK;
+    }
+    cache->block_offset[slot] = BLOCK_LOADING;
+    const uint32_t generation = cache->generation;
+    // the last block may be cut short by the end of the partition
+    size_t len = MIN(cache->block_size, cache->partition->size - block_offset);
+
+    _lock_release(&s_read_cache_lock);
+    esp_err_t err = read_uncached(cache->partition, block_offset, cache->data + slot * cache->block_size, len);
+    _lock_acquire(&s_read_cache_lock);
+
+    if (err != ESP_OK) {
+        cache->block_offset[slot] = BLOCK_INVALID;
+        return err;
+    }
+    if (generation != cache->generation || find_block(cache, block_offset) >= 0) {
+        // The data may predate a write which completed meanwhile, or another read has cached the block
+        // first. The data is still a valid result for this read, which ran concurrently with the write.
+        cache->block_offset[slot] = BLOCK_INVALID;
+        return ESP_OK;
+    }
+    cache->block_offset[slot] = block_offset;
+    cache->block_last_use[slot] = ++cache->use_counter;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_read_cache_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size,
+                                        esp_partition_read_uncached_t read_uncached)
+{
+    esp_err_t err = ESP_OK;
+    _lock_acquire(&s_read_cache_lock);
+    partition_read_cache_t *cache = find_cache(partition);
+    if (cache == NULL) {
+        _lock_release(&s_read_cache_lock);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const bool sequential = (src_offset == cache->next_seq_offset);
+    cache->next_seq_offset = src_offset + size;
+    if (size >= cache->block_size * cache->block_count) {
+        // too large to be worth caching, and would only evict the small records
+        _lock_release(&s_read_cache_lock);
+        return read_uncached(partition, src_offset, dst, size);
+    }
+    // keeps the cache allocated while the lock is released to read the flash
+    cache->users++;
+    uint8_t *out = (uint8_t *) dst;
+    while (size > 0) {
+        if (cache->disabled) {
+            // no longer invalidated by writes, so the cached blocks can't be trusted
+            _lock_release(&s_read_cache_lock);
+            err = read_uncached(partition, src_offset, out, size);
+            _lock_acquire(&s_read_cache_lock);
+            break;
+        }
+        const size_t block_offset = src_offset & ~(cache->block_size - 1);
+        const size_t in_block = src_offset - block_offset;
+        const size_t len = MIN(size, cache->block_size - in_block);
+
+        bool miss = false;
+        int slot = find_block(cache, block_offset);
+        if (slot >= 0) {
+            cache->stats.hits++;
+            cache->block_last_use[slot] = ++cache->use_counter;
+        } else {
+            cache->stats.misses++;
+            miss = true;
+            err = load_block(cache, block_offset, read_uncached, &slot);
+            if (err != ESP_OK) {
+                break;
+            }
+        }
+        if (slot >= 0) {
+            memcpy(out, cache->data + slot * cache->block_size + in_block, len);
+        } else {
+            _lock_release(&s_read_cache_lock);
+            err = read_uncached(partition, src_offset, out, len);
+            _lock_acquire(&s_read_cache_lock);
+            if (err != ESP_OK) {
+                break;
+            }
+        }
+        out += len;
+        src_offset += len;
+        size -= len;
+
+        if (miss && sequential) {
+            // the current block was used last, so read-ahead can't evict it
+            size_t ahead = block_offset + cache->block_size;
+            for (int i = 0; i < cache->readahead_blocks && ahead < partition->size; i++, ahead += cache->block_size) {
+                int ahead_slot;
+                if (find_block(cache, ahead) >= 0 || ahead < src_offset + size) {
+                    // cached already, or about to be loaded by this read anyway
+                    continue;
+                }
+                if (load_block(cache, ahead, read_uncached, &ahead_slot) != ESP_OK || ahead_slot < 0) {
+                    break;
+                }
+                cache->stats.readaheads++;
+            }
+        }
+    }
+    const bool release = (--cache->users == 0 && cache->disabled);
+    _lock_release(&s_read_cache_lock);
+    if (release) {
+        free_cache(cache);
+    }
+    return err;
+}
+
+void esp_partition_read_cache_invalidate(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    _lock_acquire(&s_read_cache_lock);
+    partition_read_cache_t *cache = find_cache(partition);
+    if (cache != NULL) {
+        // blocks being loaded by concurrent reads are dropped when they complete
+        cache->generation++;
+        for (int i = 0; i < cache->block_count; i++) {
+            const size_t block_offset = cache->block_offset[i];
+            if (block_offset != BLOCK_INVALID && block_offset != BLOCK_LOADING
+                    && block_offset < offset + size && offset < block_offset + cache->block_size) {
+                cache->block_offset[i] = BLOCK_INVALID;
+                cache->stats.invalidations++;
+            }
+        }
+    }
+    _lock_release(&s_read_cache_lock);
+}
+
+static void free_cache(partition_read_cache_t *cache)
+{
+    free(cache->data);
+    free(cache->block_offset);
+    free(cache->block_last_use);
+    free(cache);
+}
+
+esp_err_t esp_partition_read_cache_enable(const esp_partition_t *partition, const esp_partition_read_cache_config_t *config)
+{
+    if (partition == NULL || config == NULL || config->block_size == 0
+            || (config->block_size & (config->block_size - 1)) != 0
+            || config->block_count < 2 || config->readahead_blocks >= config->block_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (partition->encrypted) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    partition_read_cache_t *cache = calloc(1, sizeof(partition_read_cache_t));
+    if (cache == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    cache->partition = partition;
+    cache->block_size = config->block_size;
+    cache->block_count = config->block_count;
+    cache->readahead_blocks = config->readahead_blocks;
+    cache->next_seq_offset = BLOCK_INVALID;
+    cache->data = malloc(config->block_size * config->block_count);
+    cache->block_offset = malloc(config->block_count * sizeof(size_t));
+    cache->block_last_use = calloc(config->block_count, sizeof(uint32_t));
+    if (cache->data == NULL || cache->block_offset == NULL || cache->block_last_use == NULL) {
+        free_cache(cache);
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < cache->block_count; i++) {
+        cache->block_offset[i] = BLOCK_INVALID;
+    }
+
+    _lock_acquire(&s_read_cache_lock);
+    if (find_cache(partition) != NULL) {
+        _lock_release(&s_read_cache_lock);
+        free_cache(cache);
+        return ESP_ERR_INVALID_STATE;
+    }
+    SLIST_INSERT_HEAD(&s_read_caches, cache, next);
+    _lock_release(&s_read_cache_lock);
+    ESP_LOGD(TAG, "enabled for %s: %d blocks of %d bytes", partition->label, config->block_count, config->block_size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_read_cache_disable(const esp_partition_t *partition)
+{
+    _lock_acquire(&s_read_cache_lock);
+    partition_read_cache_t *cache = find_cache(partition);
+    bool release = false;
+    if (cache != NULL) {
+        SLIST_REMOVE(&s_read_caches, cache, partition_read_cache_, next);
+        // reads in progress may still access the cache, the last one frees it
+        cache->disabled = true;
+        release = (cache->users == 0);
+    }
+    _lock_release(&s_read_cache_lock);
+    if (cache == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (release) {
+        free_cache(cache);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_read_cache_get_stats(const esp_partition_t *partition, esp_partition_read_cache_stats_t *out_stats)
+{
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    _lock_acquire(&s_read_cache_lock);
+    partition_read_cache_t *cache = find_cache(partition);
+    if (cache != NULL) {
+        *out_stats = cache->stats;
+        err = ESP_OK;
+    }
+    _lock_release(&s_read_cache_lock);
+    return err;
+}
@@ -20,9 +20,22 @@
 #include "esp_spi_flash.h"
 #include "bootloader_common.h"
 #include "esp_ota_ops.h"
+#if CONFIG_SPI_FLASH_PARTITION_READ_CACHE
+#include "esp_private/partition_read_cache.h"
+#endif
 
 #define HASH_LEN 32 /* SHA-256 digest length */
 
+static esp_err_t partition_read_uncached(const esp_partition_t *partition,
+                                         size_t src_offset, void *dst, size_t size)
+{
+#ifndef CONFIG_SPI_FLASH_USE_LEGACY_IMPL
+    return esp_flash_read(partition->flash_chip, dst, partition->address + src_offset, size);
+#else
+    return spi_flash_read(partition->address + src_offset, dst, size);
+#endif // CONFIG_SPI_FLASH_USE_LEGACY_IMPL
+}
+
 esp_err_t esp_partition_read(const esp_partition_t *partition,
                              size_t src_offset, void *dst, size_t size)
 {
@@ -35,11 +48,13 @@ esp_err_t esp_partition_read(const esp_partition_t *partition,
     }
 
     if (!partition->encrypted) {
-#ifndef CONFIG_SPI_FLASH_USE_LEGACY_IMPL
-        return esp_flash_read(partition->flash_chip, dst, partition->address + src_offset, size);
-#else
-        return spi_flash_read(partition->address + src_offset, dst, size);
-#endif // CONFIG_SPI_FLASH_USE_LEGACY_IMPL
+#if CONFIG_SPI_FLASH_PARTITION_READ_CACHE
+        esp_err_t err = esp_partition_read_cache_read(partition, src_offset, dst, size, partition_read_uncached);
+        if (err != ESP_ERR_NOT_FOUND) {
+            return err;
+        }
+#endif
+        return partition_read_uncached(partition, src_offset, dst, size);
     }
 
 #if CONFIG_SPI_FLASH_ENABLE_ENCRYPTED_READ_WRITE
@@ -64,16 +79,9 @@ esp_err_t esp_partition_read(const esp_partition_t *partition,
 #endif // CONFIG_SPI_FLASH_ENABLE_ENCRYPTED_READ_WRITE
 }
 
-esp_err_t esp_partition_write(const esp_partition_t *partition,
-                              size_t dst_offset, const void *src, size_t size)
+static esp_err_t partition_write_uncached(const esp_partition_t *partition,
+                                          size_t dst_offset, const void *src, size_t size)
 {
-    assert(partition != NULL);
-    if (dst_offset > partition->size) {
-        return ESP_ERR_INVALID_ARG;
-    }
-    if (dst_offset + size > partition->size) {
-        return ESP_ERR_INVALID_SIZE;
-    }
     dst_offset = partition->address + dst_offset;
     if (!partition->encrypted) {
 #ifndef CONFIG_SPI_FLASH_USE_LEGACY_IMPL
@@ -98,6 +106,24 @@ esp_err_t esp_partition_write(const esp_partition_t *partition,
 #endif // CONFIG_SPI_FLASH_ENABLE_ENCRYPTED_READ_WRITE
 }
 
+esp_err_t esp_partition_write(const esp_partition_t *partition,
+                              size_t dst_offset, const void *src, size_t size)
+{
+    assert(partition != NULL);
+    if (dst_offset > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (dst_offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t err = partition_write_uncached(partition, dst_offset, src, size);
+#if CONFIG_SPI_FLASH_PARTITION_READ_CACHE
+    // only once the flash holds the new data, so a concurrent read can't cache the old data again
+    esp_partition_read_cache_invalidate(partition, dst_offset, size);
+#endif
+    return err;
+}
+
 esp_err_t esp_partition_read_raw(const esp_partition_t *partition,
                                  size_t src_offset, void *dst, size_t size)
 {
@@ -109,11 +135,13 @@ esp_err_t esp_partition_read_raw(const esp_partition_t *partition,
         return ESP_ERR_INVALID_SIZE;
     }
 
-#ifndef CONFIG_SPI_FLASH_USE_LEGACY_IMPL
-    return esp_flash_read(partition->flash_chip, dst, partition->address + src_offset, size);
-#else
-    return spi_flash_read(partition->address + src_offset, dst, size);
-#endif // CONFIG_SPI_FLASH_USE_LEGACY_IMPL
+#if CONFIG_SPI_FLASH_PARTITION_READ_CACHE
+    esp_err_t err = esp_partition_read_cache_read(partition, src_offset, dst, size, partition_read_uncached);
+    if (err != ESP_ERR_NOT_FOUND) {
+        return err;
+    }
+#endif
+    return partition_read_uncached(partition, src_offset, dst, size);
 }
 
 esp_err_t esp_partition_write_raw(const esp_partition_t *partition,
@@ -126,13 +154,16 @@ esp_err_t esp_partition_write_raw(const esp_partition_t *partition,
     if (dst_offset + size > partition->size) {
         return ESP_ERR_INVALID_SIZE;
     }
-    dst_offset = partition->address + dst_offset;
 
 #ifndef CONFIG_SPI_FLASH_USE_LEGACY_IMPL
-    return esp_flash_write(partition->flash_chip, src, dst_offset, size);
+    esp_err_t err = esp_flash_write(partition->flash_chip, src, partition->address + dst_offset, size);
 #else
-    return spi_flash_write(dst_offset, src, size);
+    esp_err_t err = spi_flash_write(partition->address + dst_offset, src, size);
 #endif // CONFIG_SPI_FLASH_USE_LEGACY_IMPL
+#if CONFIG_SPI_FLASH_PARTITION_READ_CACHE
+    esp_partition_read_cache_invalidate(partition, dst_offset, size);
+#endif
+    return err;
 }
 
 esp_err_t esp_partition_erase_range(const esp_partition_t *partition,
@@ -152,10 +183,14 @@ esp_err_t esp_partition_erase_range(const esp_partition_t *partition,
         return ESP_ERR_INVALID_ARG;
     }
 #ifndef CONFIG_SPI_FLASH_USE_LEGACY_IMPL
-    return esp_flash_erase_region(partition->flash_chip, partition->address + offset, size);
+    esp_err_t err = esp_flash_erase_region(partition->flash_chip, partition->address + offset, size);
 #else
-    return spi_flash_erase_range(partition->address + offset, size);
+    esp_err_t err = spi_flash_erase_range(partition->address + offset, size);
 #endif // CONFIG_SPI_FLASH_USE_LEGACY_IMPL
+#if CONFIG_SPI_FLASH_PARTITION_READ_CACHE
+    esp_partition_read_cache_invalidate(partition, offset, size);
+#endif
+    return err;
 }
 
 /*
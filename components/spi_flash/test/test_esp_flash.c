@@ -6,6 +6,7 @@
 
 #include <unity.h>
 #include "esp_flash.h"
+#include "esp_flash_async.h"
 #include "driver/spi_common_internal.h"
 #include "esp_flash_spi_init.h"
 #include "memspi_host_driver.h"
@@ -1233,4 +1234,70 @@ FLASH_TEST_CASE("esp_flash_read large PSRAM buffer low memory", test_flash_read_
 
 #endif
 
+#if CONFIG_SPI_FLASH_ASYNC
+static volatile bool s_async_cb_op_null;
+static volatile esp_err_t s_async_cb_result;
+
+/* Runs in the flash worker task, the results are checked by the test task */
+static void async_done_cb(esp_flash_async_handle_t op, esp_err_t result, void *arg)
+{
+    s_async_cb_op_null = (op == NULL);
+    s_async_cb_result = result;
+    xSemaphoreGive((SemaphoreHandle_t)arg);
+}
+
+static void test_async_erase_write_read(const esp_partition_t *part)
+{
+    esp_flash_t* chip = part->flash_chip;
+    const uint32_t size = 8 * 4096;
+    TEST_ASSERT(size * 2 <= part->size);
+    uint8_t *wr_buf = heap_caps_malloc(size, MALLOC_CAP_DMA);
+    uint8_t *rd_buf = heap_caps_malloc(size, MALLOC_CAP_DMA);
+    TEST_ASSERT_NOT_NULL(wr_buf);
+    TEST_ASSERT_NOT_NULL(rd_buf);
+    srand(5743);
+    for (int i = 0; i < size; i++) {
+        wr_buf[i] = rand();
+    }
+
+    /* Erase both halves, the second one is cancelled and the operations are served in turn */
+    esp_flash_async_handle_t erase, erase_cancelled;
+    esp_err_t result;
+    int64_t start = esp_timer_get_time();
+    TEST_ESP_OK(esp_flash_erase_region_async(chip, part->address, size, NULL, NULL, &erase));
+    int64_t submitted = esp_timer_get_time();
+    TEST_ESP_OK(esp_flash_erase_region_async(chip, part->address + size, size, NULL, NULL, &erase_cancelled));
+    TEST_ESP_OK(esp_flash_async_cancel(erase_cancelled));
+    TEST_ESP_OK(esp_flash_async_wait(erase, portMAX_DELAY, &result));
+    int64_t completed = esp_timer_get_time();
+    TEST_ESP_OK(result);
+    /* The caller only waits for the submission, not for the erase */
+    IDF_LOG_PERFORMANCE("SPI flash async erase submission", "%d us, erase of %d bytes took %d us",
+                        (int)(submitted - start), (int)size, (int)(completed - start));
+    TEST_ESP_OK(esp_flash_async_wait(erase_cancelled, portMAX_DELAY, &result));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, result);
+
+    /* Queue a write and a read of the same region, the callback releases the write */
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    esp_flash_async_handle_t read;
+    TEST_ESP_OK(esp_flash_write_async(chip, wr_buf, part->address, size, async_done_cb, done, NULL));
+    TEST_ASSERT(xSemaphoreTake(done, portMAX_DELAY));
+    TEST_ASSERT_TRUE(s_async_cb_op_null);
+    TEST_ESP_OK(s_async_cb_result);
+    TEST_ESP_OK(esp_flash_read_async(chip, rd_buf, part->address, size, NULL, NULL, &read));
+    TEST_ESP_OK(esp_flash_async_wait(read, portMAX_DELAY, &result));
+    TEST_ESP_OK(result);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(wr_buf, rd_buf, size);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_flash_erase_region_async(chip, part->address + 1, 4096, NULL, NULL, NULL));
+
+    vSemaphoreDelete(done);
+    free(wr_buf);
+    free(rd_buf);
+}
+
+FLASH_TEST_CASE("SPI flash async erase/write/read", test_async_erase_write_read);
+FLASH_TEST_CASE_3("SPI flash async erase/write/read", test_async_erase_write_read);
+#endif // CONFIG_SPI_FLASH_ASYNC
+
 #endif //#if !TEMPORARY_DISABLED_FOR_TARGETS(ESP32C2)
@@ -26,6 +26,9 @@
 #include <esp_log.h>
 #include <esp_partition.h>
 #include <esp_attr.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
 TEST_CASE("Test erase partition", "[spi_flash][esp_flash]")
 {
@@ -145,3 +148,70 @@ TEST_CASE("Test esp_partition_get_sha256() that it can handle a big partition",
 
     spi_flash_munmap(handle);
 }
+
+#if CONFIG_SPI_FLASH_PARTITION_READ_CACHE
+typedef struct {
+    const esp_partition_t *part;
+    volatile bool stop;
+    volatile int errors;
+    volatile uint32_t reads;
+    SemaphoreHandle_t done;
+} read_cache_reader_ctx_t;
+
+static void read_cache_reader_task(void *arg)
+{
+    read_cache_reader_ctx_t *ctx = (read_cache_reader_ctx_t *)arg;
+    uint8_t buf[16];
+    while (!ctx->stop) {
+        if (esp_partition_read(ctx->part, 0, buf, sizeof(buf)) != ESP_OK) {
+            ctx->errors++;
+        }
+        ctx->reads++;
+    }
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("Test partition read cache returns written data while other tasks read", "[spi_flash][partition]")
+{
+    const esp_partition_t *part = get_test_data_partition();
+    esp_partition_read_cache_config_t config = {
+        .block_size = 256,
+        .block_count = 4,
+        .readahead_blocks = 1,
+    };
+    TEST_ESP_OK(esp_partition_read_cache_enable(part, &config));
+
+    read_cache_reader_ctx_t ctx = {
+        .part = part,
+        .done = xSemaphoreCreateBinary(),
+    };
+    TEST_ASSERT_NOT_NULL(ctx.done);
+    /* Keeps the first block of the partition cached while the test task rewrites it */
+    xTaskCreatePinnedToCore(read_cache_reader_task, "cache_reader", 2048, &ctx, UNITY_FREERTOS_PRIORITY, NULL, portNUM_PROCESSORS - 1);
+
+    uint8_t buf[16];
+    uint8_t expected[16];
+    for (int round = 0; round < 8; round++) {
+        TEST_ESP_OK(esp_partition_erase_range(part, 0, SPI_FLASH_SEC_SIZE));
+        TEST_ESP_OK(esp_partition_read(part, 0, buf, sizeof(buf)));
+        memset(expected, 0xFF, sizeof(expected));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buf, sizeof(buf));
+        /* Each write clears one more bit, so no erase is needed in between */
+        for (int bit = 0; bit < 8; bit++) {
+            memset(expected, 0xFE << bit, sizeof(expected));
+            TEST_ESP_OK(esp_partition_write(part, 0, expected, sizeof(expected)));
+            TEST_ESP_OK(esp_partition_read(part, 0, buf, sizeof(buf)));
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buf, sizeof(buf));
+        }
+    }
+
+    ctx.stop = true;
+    TEST_ASSERT_TRUE(xSemaphoreTake(ctx.done, pdMS_TO_TICKS(1000)));
+    vSemaphoreDelete(ctx.done);
+    IDF_LOG_PERFORMANCE("Partition reads while writing", "%u", ctx.reads);
+    TEST_ASSERT_EQUAL(0, ctx.errors);
+    TEST_ASSERT_GREATER_THAN(0, ctx.reads);
+    TEST_ESP_OK(esp_partition_read_cache_disable(part));
+}
+#endif // CONFIG_SPI_FLASH_PARTITION_READ_CACHE
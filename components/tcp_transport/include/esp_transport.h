@@ -17,6 +17,7 @@
 
 #include <esp_err.h>
 #include <stdbool.h>
+#include "sdkconfig.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -340,6 +341,57 @@ esp_tls_error_handle_t esp_transport_get_error_handle(esp_transport_handle_t t);
  */
 int esp_transport_get_errno(esp_transport_handle_t t);
 
+#ifdef CONFIG_ESP_TRANSPORT_POOL
+/**
+ * @brief      Parks the established connection of a transport in the process-wide connection pool
+ *
+ * The connection is detached from the transport, which is left closed, and can be
+ * picked up later by any transport of the same scheme and configuration connecting
+ * to the same host and port (see esp_transport_pool_acquire()). The caller must make
+ * sure that the connection is in a clean state, i.e. no partial request or response
+ * is pending on it.
+ *
+ * If the pool holds too many connections for this host (or in total), the least
+ * recently parked ones are closed.
+ *
+ * @note       Only tcp and ssl transports are supported.
+ *
+ * @param[in]  t     The transport handle
+ * @param[in]  host  Host the transport is connected to
+ * @param[in]  port  Port the transport is connected to
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_NOT_SUPPORTED if the transport type cannot be pooled
+ *     - ESP_ERR_INVALID_STATE if the transport is not connected
+ *     - ESP_ERR_NO_MEM
+ */
+esp_err_t esp_transport_pool_release(esp_transport_handle_t t, const char *host, int port);
+
+/**
+ * @brief      Takes a matching idle connection from the process-wide connection pool
+ *
+ * On success, the transport is connected without any TCP or TLS handshake. Pooled
+ * connections which were idle for too long or have been closed by the peer are
+ * discarded on the way.
+ *
+ * @param[in]  t     The transport handle (not connected)
+ * @param[in]  host  Host to connect to
+ * @param[in]  port  Port to connect to
+ *
+ * @return
+ *     - ESP_OK if a pooled connection was attached to the transport
+ *     - ESP_ERR_NOT_FOUND if no usable connection is pooled
+ *     - ESP_ERR_NOT_SUPPORTED if the transport type cannot be pooled
+ */
+esp_err_t esp_transport_pool_acquire(esp_transport_handle_t t, const char *host, int port);
+
+/**
+ * @brief      Closes all the connections held in the connection pool
+ */
+void esp_transport_pool_flush(void);
+#endif /* CONFIG_ESP_TRANSPORT_POOL */
+
 #ifdef __cplusplus
 }
 #endif
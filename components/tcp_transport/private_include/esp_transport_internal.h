@@ -16,6 +16,7 @@
 #define _ESP_TRANSPORT_INTERNAL_H_
 
 #include "esp_transport.h"
+#include "esp_tls.h"
 #include "sys/queue.h"
 
 typedef int (*get_socket_func)(esp_transport_handle_t t);
@@ -116,4 +117,63 @@ void esp_transport_esp_tls_destroy(struct transport_esp_tls* transport_esp_tls);
  */
 void esp_transport_set_errors(esp_transport_handle_t t, const esp_tls_error_handle_t error_handle);
 
+/**
+ * @brief Established connection of an esp-tls based transport (tcp or ssl),
+ *        detached from its transport handle
+ */
+typedef struct esp_transport_conn {
+    esp_tls_t       *tls;           /*!< esp-tls connection object, NULL if connected as plain socket */
+    int             sockfd;         /*!< Socket of the connection */
+} esp_transport_conn_t;
+
+/**
+ * @brief      Moves the established connection out of an esp-tls based transport,
+ *             leaving the transport in closed state
+ *
+ * @param[in]  t     The transport handle
+ * @param[out] conn  Detached connection
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_SUPPORTED if the transport is not esp-tls based
+ *      - ESP_ERR_INVALID_STATE if the transport is not connected
+ */
+esp_err_t esp_transport_esp_tls_detach(esp_transport_handle_t t, esp_transport_conn_t *conn);
+
+/**
+ * @brief      Makes the supplied connection the current connection of a (closed) esp-tls based transport
+ *
+ * @param[in]  t     The transport handle
+ * @param[in]  conn  Connection previously returned by esp_transport_esp_tls_detach()
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_SUPPORTED if the transport is not esp-tls based
+ *      - ESP_ERR_INVALID_STATE if the transport is already connected
+ */
+esp_err_t esp_transport_esp_tls_attach(esp_transport_handle_t t, const esp_transport_conn_t *conn);
+
+/**
+ * @brief      Gets the configuration a new connection of this transport would use
+ *
+ * Fields which don't affect the established connection (timeouts, blocking mode)
+ * are cleared. The buffers the configuration points to are owned by the user of
+ * the transport and may change, compare their contents rather than the pointers.
+ *
+ * @param[in]  t     The transport handle
+ * @param[out] cfg   Normalized configuration
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_SUPPORTED if the transport is not esp-tls based
+ */
+esp_err_t esp_transport_esp_tls_get_cfg(esp_transport_handle_t t, esp_tls_cfg_t *cfg);
+
+/**
+ * @brief      Closes a detached connection
+ *
+ * @param[in]  conn  Connection previously returned by esp_transport_esp_tls_detach()
+ */
+void esp_transport_esp_tls_conn_close(esp_transport_conn_t *conn);
+
 #endif //_ESP_TRANSPORT_INTERNAL_H_
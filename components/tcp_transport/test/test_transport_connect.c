@@ -1,3 +1,4 @@
+#include <string.h>
 #include "unity.h"
 #include "esp_transport.h"
 #include "esp_transport_tcp.h"
@@ -6,6 +7,7 @@
 #include "esp_log.h"
 #include "lwip/sockets.h"
 #include "tcp_transport_fixtures.h"
+#include "test_utils.h"
 
 
 #define TEST_TRANSPORT_BIND_IFNAME() \
@@ -176,3 +178,90 @@ TEST_CASE("ssl_transport: Check that parameters (keepalive) are set independentl
     esp_transport_close(ssl);
     esp_transport_destroy(ssl);
 }
+
+#if CONFIG_ESP_TRANSPORT_POOL
+TEST_CASE("tcp_transport: connection is reused through the pool", "[tcp_transport]")
+{
+    test_case_uses_tcpip();
+
+    // Loopback listener, the stack completes the TCP handshake on its own
+    const int port = 8081;
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    int listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, listen_sock);
+    TEST_ASSERT_EQUAL(0, bind(listen_sock, (struct sockaddr *)&addr, sizeof(addr)));
+    TEST_ASSERT_EQUAL(0, listen(listen_sock, 1));
+
+    // Two independent lists, as two separate clients would have
+    esp_transport_list_handle_t list1 = esp_transport_list_init();
+    esp_transport_handle_t tcp1 = esp_transport_tcp_init();
+    esp_transport_list_add(list1, tcp1, "tcp");
+    esp_transport_list_handle_t list2 = esp_transport_list_init();
+    esp_transport_handle_t tcp2 = esp_transport_tcp_init();
+    esp_transport_list_add(list2, tcp2, "tcp");
+
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, esp_transport_pool_acquire(tcp2, "127.0.0.1", port));
+    TEST_ASSERT_EQUAL(0, esp_transport_connect(tcp1, "127.0.0.1", port, 1000));
+    int peer = accept(listen_sock, NULL, NULL);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, peer);
+
+    // Parked connection is picked up by the other transport and still talks to the same peer
+    TEST_ASSERT_EQUAL(ESP_OK, esp_transport_pool_release(tcp1, "127.0.0.1", port));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, esp_transport_pool_acquire(tcp2, "127.0.0.1", port + 1));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_transport_pool_acquire(tcp2, "127.0.0.1", port));
+    TEST_ASSERT_EQUAL(4, esp_transport_write(tcp2, "ping", 4, 1000));
+    char buf[4];
+    TEST_ASSERT_EQUAL(4, recv(peer, buf, sizeof(buf), 0));
+    TEST_ASSERT_EQUAL_MEMORY("ping", buf, 4);
+
+    // Connection closed by the peer while parked must not be reused
+    TEST_ASSERT_EQUAL(ESP_OK, esp_transport_pool_release(tcp2, "127.0.0.1", port));
+    close(peer);
+    vTaskDelay(pdMS_TO_TICKS(100));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, esp_transport_pool_acquire(tcp1, "127.0.0.1", port));
+
+    esp_transport_pool_flush();
+    esp_transport_list_destroy(list1);
+    esp_transport_list_destroy(list2);
+    close(listen_sock);
+}
+
+TEST_CASE("tcp_transport: pooled connection is only reused with the same credentials", "[tcp_transport]")
+{
+    test_case_uses_tcpip();
+
+    const int port = 8082;
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    int listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, listen_sock);
+    TEST_ASSERT_EQUAL(0, bind(listen_sock, (struct sockaddr *)&addr, sizeof(addr)));
+    TEST_ASSERT_EQUAL(0, listen(listen_sock, 1));
+
+    // Both transports point to the same buffer, whose contents change while the connection is parked
+    static char ca_buf[] = "CA certificate 1";
+    esp_transport_list_handle_t list1 = esp_transport_list_init();
+    esp_transport_handle_t tcp1 = esp_transport_tcp_init();
+    esp_transport_list_add(list1, tcp1, "tcp");
+    esp_transport_ssl_set_cert_data(tcp1, ca_buf, strlen(ca_buf));
+    esp_transport_list_handle_t list2 = esp_transport_list_init();
+    esp_transport_handle_t tcp2 = esp_transport_tcp_init();
+    esp_transport_list_add(list2, tcp2, "tcp");
+    esp_transport_ssl_set_cert_data(tcp2, ca_buf, strlen(ca_buf));
+
+    TEST_ASSERT_EQUAL(0, esp_transport_connect(tcp1, "127.0.0.1", port, 1000));
+    int peer = accept(listen_sock, NULL, NULL);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, peer);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_transport_pool_release(tcp1, "127.0.0.1", port));
+
+    ca_buf[strlen(ca_buf) - 1] = '2';
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, esp_transport_pool_acquire(tcp2, "127.0.0.1", port));
+    ca_buf[strlen(ca_buf) - 1] = '1';
+    TEST_ASSERT_EQUAL(ESP_OK, esp_transport_pool_acquire(tcp2, "127.0.0.1", port));
+
+    close(peer);
+    esp_transport_pool_flush();
+    esp_transport_list_destroy(list1);
+    esp_transport_list_destroy(list2);
+    close(listen_sock);
+}
+#endif
@@ -0,0 +1,311 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/lock.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sys/queue.h"
+#include "esp_log.h"
+#include "mbedtls/sha256.h"
+
+#include "esp_transport.h"
+#include "esp_transport_internal.h"
+#include "esp_transport_utils.h"
+
+static const char *TAG = "TRANSPORT_POOL";
+
+#define POOL_CFG_DIGEST_LEN 32
+
+/**
+ * Idle connection held in the pool
+ */
+typedef struct transport_pool_entry {
+    esp_transport_conn_t conn;          /*!< The detached connection */
+    char                 *scheme;       /*!< Scheme of the transport which established the connection */
+    char                 *host;         /*!< Host the connection is established to */
+    int                  port;          /*!< Port the connection is established to */
+    uint8_t              cfg_digest[POOL_CFG_DIGEST_LEN]; /*!< Digest of the connection settings, see pool_cfg_digest() */
+    TickType_t           released_at;   /*!< When the connection became idle */
+    TAILQ_ENTRY(transport_pool_entry) next;
+} transport_pool_entry_t;
+
+TAILQ_HEAD(transport_pool_list, transport_pool_entry);
+
+/* Entries are kept in the order of release, oldest first */
+static struct transport_pool_list s_pool = TAILQ_HEAD_INITIALIZER(s_pool);
+static size_t s_pool_size;
+static _lock_t s_pool_lock;
+
+static void pool_entry_free(transport_pool_entry_t *entry)
+{
+    esp_transport_esp_tls_conn_close(&entry->conn);
+    free(entry->scheme);
+    free(entry->host);
+    free(entry);
+}
+
+static int pool_cfg_digest_add(mbedtls_sha256_context *ctx, uint8_t tag, const void *data, size_t len)
+{
+    /* Tag and length make the digest unambiguous when fields are absent or differ in length */
+    uint8_t hdr[5] = { tag, len & 0xFF, (len >> 8) & 0xFF, (len >> 16) & 0xFF, (len >> 24) & 0xFF };
+    int ret = mbedtls_sha256_update(ctx, hdr, sizeof(hdr));
+    if (ret == 0 && len > 0) {
+        ret = mbedtls_sha256_update(ctx, data, len);
+    }
+    return ret;
+}
+
+/*
+ * Digest of the settings of cfg which the established connection depends on. The buffers the settings point to
+ * are hashed, not the pointers, so a caller which reuses a buffer with different credentials doesn't get a
+ * connection verified against the previous ones.
+ */
+static esp_err_t pool_cfg_digest(const esp_tls_cfg_t *cfg, uint8_t digest[POOL_CFG_DIGEST_LEN])
+{
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    int ret = mbedtls_sha256_starts(&ctx, 0);
+    for (const char **proto = cfg->alpn_protos; ret == 0 && proto && *proto; proto++) {
+        ret = pool_cfg_digest_add(&ctx, 'A', *proto, strlen(*proto));
+    }
+    if (ret == 0 && cfg->crt_bundle_attach != NULL) {
+        ret = pool_cfg_digest_add(&ctx, 'B', &cfg->crt_bundle_attach, sizeof(cfg->crt_bundle_attach));
+    }
+    if (ret == 0 && cfg->use_global_ca_store) {
+        ret = pool_cfg_digest_add(&ctx, 'G', NULL, 0);
+#if CONFIG_ESP_TLS_USING_MBEDTLS
+        for (const mbedtls_x509_crt *crt = esp_tls_get_global_ca_store(); ret == 0 && crt && crt->raw.p; crt = crt->next) {
+            ret = pool_cfg_digest_add(&ctx, 'g', crt->raw.p, crt->raw.len);
+        }
+#endif
+    }
+    if (ret == 0 && cfg->cacert_buf != NULL) {
+        ret = pool_cfg_digest_add(&ctx, 'C', cfg->cacert_buf, cfg->cacert_bytes);
+    }
+    if (ret == 0 && cfg->clientcert_buf != NULL) {
+        ret = pool_cfg_digest_add(&ctx, 'c', cfg->clientcert_buf, cfg->clientcert_bytes);
+    }
+    if (ret == 0 && cfg->clientkey_buf != NULL) {
+        ret = pool_cfg_digest_add(&ctx, 'k', cfg->clientkey_buf, cfg->clientkey_bytes);
+    }
+    if (ret == 0 && cfg->clientkey_password != NULL) {
+        ret = pool_cfg_digest_add(&ctx, 'p', cfg->clientkey_password, cfg->clientkey_password_len);
+    }
+    if (ret == 0 && cfg->psk_hint_key != NULL) {
+        ret = pool_cfg_digest_add(&ctx, 'H', cfg->psk_hint_key->hint, strlen(cfg->psk_hint_key->hint));
+        if (ret == 0) {
+            ret = pool_cfg_digest_add(&ctx, 'K', cfg->psk_hint_key->key, cfg->psk_hint_key->key_size);
+        }
+    }
+    if (ret == 0 && cfg->use_secure_element) {
+        ret = pool_cfg_digest_add(&ctx, 'S', NULL, 0);
+    }
+    if (ret == 0 && cfg->ds_data != NULL) {
+        ret = pool_cfg_digest_add(&ctx, 'D', &cfg->ds_data, sizeof(cfg->ds_data));
+    }
+    if (ret == 0 && cfg->common_name != NULL) {
+        ret = pool_cfg_digest_add(&ctx, 'N', cfg->common_name, strlen(cfg->common_name));
+    }
+    if (ret == 0 && cfg->skip_common_name) {
+        ret = pool_cfg_digest_add(&ctx, 'n', NULL, 0);
+    }
+    if (ret == 0 && cfg->if_name != NULL) {
+        ret = pool_cfg_digest_add(&ctx, 'I', cfg->if_name->ifr_name, strnlen(cfg->if_name->ifr_name, sizeof(cfg->if_name->ifr_name)));
+    }
+    if (ret == 0) {
+        ret = mbedtls_sha256_finish(&ctx, digest);
+    }
+    mbedtls_sha256_free(&ctx);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Failed to compute the configuration digest, returned -0x%04X", -ret);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static bool pool_entry_match(const transport_pool_entry_t *entry, const char *scheme, const char *host, int port)
+{
+    return entry->port == port &&
+           strcasecmp(entry->host, host) == 0 &&
+           strcmp(entry->scheme, scheme) == 0;
+}
+
+static bool pool_entry_expired(const transport_pool_entry_t *entry, TickType_t now)
+{
+    return (now - entry->released_at) >= pdMS_TO_TICKS(CONFIG_ESP_TRANSPORT_POOL_IDLE_TIMEOUT_MS);
+}
+
+/* An idle connection must not be readable: that means the peer has closed it,
+ * reset it or sent data nobody asked for. Any of those makes it unusable. */
+static bool pool_entry_healthy(const transport_pool_entry_t *entry)
+{
+    if (entry->conn.tls && esp_tls_get_bytes_avail(entry->conn.tls) > 0) {
+        return false;
+    }
+    int sockfd = entry->conn.sockfd;
+    fd_set readset;
+    FD_ZERO(&readset);
+    FD_SET(sockfd, &readset);
+    struct timeval timeout = { 0 };
+    if (select(sockfd + 1, &readset, NULL, NULL, &timeout) != 0) {
+        return false;
+    }
+    int sock_errno = 0;
+    socklen_t optlen = sizeof(sock_errno);
+    if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &sock_errno, &optlen) != 0 || sock_errno != 0) {
+        return false;
+    }
+    return true;
+}
+
+esp_err_t esp_transport_pool_release(esp_transport_handle_t t, const char *host, int port)
+{
+    if (t == NULL || host == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_tls_cfg_t cfg;
+    esp_err_t err = esp_transport_esp_tls_get_cfg(t, &cfg);
+    if (err != ESP_OK) {
+        return err;
+    }
+    transport_pool_entry_t *entry = calloc(1, sizeof(transport_pool_entry_t));
+    ESP_TRANSPORT_MEM_CHECK(TAG, entry, return ESP_ERR_NO_MEM);
+    entry->scheme = strdup(t->scheme ? t->scheme : "");
+    entry->host = strdup(host);
+    if (entry->scheme == NULL || entry->host == NULL) {
+        free(entry->scheme);
+        free(entry->host);
+        free(entry);
+        return ESP_ERR_NO_MEM;
+    }
+    err = pool_cfg_digest(&cfg, entry->cfg_digest);
+    if (err == ESP_OK) {
+        err = esp_transport_esp_tls_detach(t, &entry->conn);
+    }
+    if (err != ESP_OK) {
+        free(entry->scheme);
+        free(entry->host);
+        free(entry);
+        return err;
+    }
+    entry->port = port;
+    entry->released_at = xTaskGetTickCount();
+
+    struct transport_pool_list evicted = TAILQ_HEAD_INITIALIZER(evicted);
+    transport_pool_entry_t *item, *tmp;
+    int same_host = 0;
+
+    _lock_acquire(&s_pool_lock);
+    TAILQ_INSERT_TAIL(&s_pool, entry, next);
+    s_pool_size++;
+    /* Walk from the newest, so that the oldest connections are the ones evicted */
+    TAILQ_FOREACH_REVERSE_SAFE(item, &s_pool, transport_pool_list, next, tmp) {
+        bool evict = (s_pool_size > CONFIG_ESP_TRANSPORT_POOL_MAX_SIZE);
+        if (pool_entry_match(item, entry->scheme, host, port) &&
+                ++same_host > CONFIG_ESP_TRANSPORT_POOL_MAX_PER_HOST) {
+            evict = true;
+        }
+        if (evict && item != entry) {
+            TAILQ_REMOVE(&s_pool, item, next);
+            s_pool_size--;
+            TAILQ_INSERT_TAIL(&evicted, item, next);
+        }
+    }
+    _lock_release(&s_pool_lock);
+
+    /* Close evicted connections outside of the lock, as that may block */
+    TAILQ_FOREACH_SAFE(item, &evicted, next, tmp) {
+        ESP_LOGD(TAG, "Evicting connection to %s:%d", item->host, item->port);
+        pool_entry_free(item);
+    }
+    ESP_LOGD(TAG, "Pooled connection to %s://%s:%d", entry->scheme, host, port);
+    return ESP_OK;
+}
+
+esp_err_t esp_transport_pool_acquire(esp_transport_handle_t t, const char *host, int port)
+{
+    if (t == NULL || host == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_tls_cfg_t cfg;
+    esp_err_t err = esp_transport_esp_tls_get_cfg(t, &cfg);
+    if (err != ESP_OK) {
+        return err;
+    }
+    uint8_t digest[POOL_CFG_DIGEST_LEN];
+    err = pool_cfg_digest(&cfg, digest);
+    if (err != ESP_OK) {
+        return err;
+    }
+    const char *scheme = t->scheme ? t->scheme : "";
+
+    struct transport_pool_list stale = TAILQ_HEAD_INITIALIZER(stale);
+    transport_pool_entry_t *item, *tmp, *found = NULL;
+    TickType_t now = xTaskGetTickCount();
+
+    _lock_acquire(&s_pool_lock);
+    /* Prefer the most recently used connection, it's the least likely to have been closed by the server */
+    TAILQ_FOREACH_REVERSE_SAFE(item, &s_pool, transport_pool_list, next, tmp) {
+        if (pool_entry_expired(item, now)) {
+            TAILQ_REMOVE(&s_pool, item, next);
+            s_pool_size--;
+            TAILQ_INSERT_TAIL(&stale, item, next);
+            continue;
+        }
+        if (found || !pool_entry_match(item, scheme, host, port) ||
+                memcmp(item->cfg_digest, digest, POOL_CFG_DIGEST_LEN) != 0) {
+            continue;
+        }
+        TAILQ_REMOVE(&s_pool, item, next);
+        s_pool_size--;
+        if (pool_entry_healthy(item)) {
+            found = item;
+        } else {
+            TAILQ_INSERT_TAIL(&stale, item, next);
+        }
+    }
+    _lock_release(&s_pool_lock);
+
+    TAILQ_FOREACH_SAFE(item, &stale, next, tmp) {
+        ESP_LOGD(TAG, "Dropping stale connection to %s:%d", item->host, item->port);
+        pool_entry_free(item);
+    }
+
+    if (found == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    err = esp_transport_esp_tls_attach(t, &found->conn);
+    if (err != ESP_OK) {
+        pool_entry_free(found);
+        return err;
+    }
+    ESP_LOGD(TAG, "Reusing connection to %s://%s:%d", scheme, host, port);
+    /* The connection is owned by the transport now */
+    free(found->scheme);
+    free(found->host);
+    free(found);
+    return ESP_OK;
+}
+
+void esp_transport_pool_flush(void)
+{
+    struct transport_pool_list flushed = TAILQ_HEAD_INITIALIZER(flushed);
+    transport_pool_entry_t *item, *tmp;
+
+    _lock_acquire(&s_pool_lock);
+    TAILQ_CONCAT(&flushed, &s_pool, next);
+    s_pool_size = 0;
+    _lock_release(&s_pool_lock);
+
+    TAILQ_FOREACH_SAFE(item, &flushed, next, tmp) {
+        pool_entry_free(item);
+    }
+}
@@ -462,6 +462,72 @@ esp_transport_handle_t esp_transport_tcp_init(void)
     return t;
 }
 
+static bool is_esp_tls_transport(esp_transport_handle_t t)
+{
+    return t && t->_close == base_close;
+}
+
+esp_err_t esp_transport_esp_tls_get_cfg(esp_transport_handle_t t, esp_tls_cfg_t *cfg)
+{
+    transport_esp_tls_t *ssl = is_esp_tls_transport(t) ? ssl_get_context_data(t) : NULL;
+    if (ssl == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    memcpy(cfg, &ssl->cfg, sizeof(esp_tls_cfg_t));
+    cfg->timeout_ms = 0;
+    cfg->non_block = false;
+    cfg->is_plain_tcp = false;
+    // keep-alive is owned by the user of the transport, its settings only matter while connecting
+    cfg->keep_alive_cfg = NULL;
+    return ESP_OK;
+}
+
+esp_err_t esp_transport_esp_tls_detach(esp_transport_handle_t t, esp_transport_conn_t *conn)
+{
+    transport_esp_tls_t *ssl = is_esp_tls_transport(t) ? ssl_get_context_data(t) : NULL;
+    if (ssl == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (ssl->sockfd < 0 || (ssl->ssl_initialized && ssl->tls == NULL)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    conn->tls = ssl->ssl_initialized ? ssl->tls : NULL;
+    conn->sockfd = ssl->sockfd;
+
+    ssl->tls = NULL;
+    ssl->conn_state = TRANS_SSL_INIT;
+    ssl->ssl_initialized = false;
+    ssl->sockfd = INVALID_SOCKET;
+    return ESP_OK;
+}
+
+esp_err_t esp_transport_esp_tls_attach(esp_transport_handle_t t, const esp_transport_conn_t *conn)
+{
+    transport_esp_tls_t *ssl = is_esp_tls_transport(t) ? ssl_get_context_data(t) : NULL;
+    if (ssl == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (ssl->sockfd >= 0 || ssl->ssl_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ssl->tls = conn->tls;
+    ssl->ssl_initialized = (conn->tls != NULL);
+    ssl->conn_state = TRANS_SSL_INIT;
+    ssl->sockfd = conn->sockfd;
+    return ESP_OK;
+}
+
+void esp_transport_esp_tls_conn_close(esp_transport_conn_t *conn)
+{
+    if (conn->tls) {
+        esp_tls_conn_destroy(conn->tls);
+    } else if (conn->sockfd >= 0) {
+        close(conn->sockfd);
+    }
+    conn->tls = NULL;
+    conn->sockfd = INVALID_SOCKET;
+}
+
 void esp_transport_tcp_set_keep_alive(esp_transport_handle_t t, esp_transport_keep_alive_t *keep_alive_cfg)
 {
     return esp_transport_ssl_set_keep_alive(t, keep_alive_cfg);
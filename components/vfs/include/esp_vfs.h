@@ -22,6 +22,7 @@
 #include <sys/termios.h>
 #include <sys/poll.h>
 #include <sys/dirent.h>
+#include <sys/uio.h>
 #include <string.h>
 #include "sdkconfig.h"
 
@@ -112,6 +113,14 @@ typedef struct
         ssize_t (*pwrite_p)(void *ctx, int fd, const void *src, size_t size, off_t offset);          /*!< pwrite with context pointer */
         ssize_t (*pwrite)(int fd, const void *src, size_t size, off_t offset);                       /*!< pwrite without context pointer */
     };
+    union {
+        ssize_t (*readv_p)(void *ctx, int fd, const struct iovec *iov, int iovcnt);                  /*!< readv with context pointer */
+        ssize_t (*readv)(int fd, const struct iovec *iov, int iovcnt);                               /*!< readv without context pointer; if NULL, read is called for each buffer */
+    };
+    union {
+        ssize_t (*writev_p)(void *ctx, int fd, const struct iovec *iov, int iovcnt);                 /*!< writev with context pointer */
+        ssize_t (*writev)(int fd, const struct iovec *iov, int iovcnt);                              /*!< writev without context pointer; if NULL, write is called for each buffer */
+    };
     union {
         int (*open_p)(void* ctx, const char * path, int flags, int mode);                            /*!< open with context pointer */
         int (*open)(const char * path, int flags, int mode);                                         /*!< open without context pointer */
@@ -463,6 +472,64 @@ ssize_t esp_vfs_pread(int fd, void *dst, size_t size, off_t offset);
  */
 ssize_t esp_vfs_pwrite(int fd, const void *src, size_t size, off_t offset);
 
+/**
+ *
+ * @brief Implements the VFS layer of POSIX readv()
+ *
+ * If the driver doesn't implement readv, the buffers are filled one after another with read(),
+ * stopping at the first short read.
+ *
+ * @param fd         File descriptor used for read
+ * @param iov        Array of buffers to fill
+ * @param iovcnt     Number of buffers in the array
+ *
+ * @return           A positive return value indicates the number of bytes read. -1 is return on failure and errno is
+ *                   set accordingly.
+ */
+ssize_t esp_vfs_readv(int fd, const struct iovec *iov, int iovcnt);
+
+/**
+ *
+ * @brief Implements the VFS layer of POSIX writev()
+ *
+ * If the driver doesn't implement writev, the buffers are written one after another with write(),
+ * stopping at the first short write. In this case the data may be interleaved with writes to the same
+ * file done concurrently by other tasks.
+ *
+ * @param fd         File descriptor used for write
+ * @param iov        Array of buffers to write
+ * @param iovcnt     Number of buffers in the array
+ *
+ * @return           A positive return value indicates the number of bytes written. -1 is return on failure and errno is
+ *                   set accordingly.
+ */
+ssize_t esp_vfs_writev(int fd, const struct iovec *iov, int iovcnt);
+
+/**
+ *
+ * @brief Copy data from one file descriptor to another, similar to Linux sendfile()
+ *
+ * Data is read from in_fd and written to out_fd (e.g. from a file into a socket) using a single buffer of
+ * CONFIG_VFS_SENDFILE_BUFFER_SIZE bytes, allocated for the duration of the call. The buffer is read in
+ * whole blocks, so filesystems like FAT can read full sectors into it directly.
+ *
+ * @param out_fd     File descriptor to write to
+ * @param in_fd      File descriptor to read from
+ * @param offset     If NULL, data is read from the current file position of in_fd, which is advanced
+ *                   by the number of bytes sent. In_fd must then support lseek, as data read but not sent
+ *                   is given back by moving the file position. Otherwise, data is read starting at *offset
+ *                   (with pread), the file position of in_fd is not changed, and *offset is set to the offset
+ *                   following the last byte sent.
+ * @param count      Number of bytes to copy
+ *
+ * @return           The number of bytes sent, which is less than count if the end of in_fd was reached or
+ *                   if out_fd accepted fewer bytes. -1 is return on failure and errno is set accordingly:
+ *                   EINVAL if offset is NULL and in_fd doesn't support lseek; if the file position of in_fd
+ *                   can't be moved back after a short write, -1 is returned with the error of lseek, even if
+ *                   some data was sent.
+ */
+ssize_t esp_vfs_sendfile(int out_fd, int in_fd, off_t *offset, size_t count);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
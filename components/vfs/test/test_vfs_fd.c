@@ -259,6 +259,42 @@ TEST_CASE("Open & write & close through VFS passes performance test", "[vfs]")
 
 }
 
+TEST_CASE("Open & close with many registered VFSs passes performance test", "[vfs]")
+{
+    esp_vfs_t desc = {
+        .flags = ESP_VFS_FLAG_DEFAULT,
+        .open = time_test_vfs_open,
+        .close = time_test_vfs_close,
+    };
+
+    char prefixes[10][8];
+    const int vfs_count = sizeof(prefixes) / sizeof(prefixes[0]);
+    for (int i = 0; i < vfs_count; ++i) {
+        snprintf(prefixes[i], sizeof(prefixes[i]), "/fs%d", i);
+        TEST_ESP_OK( esp_vfs_register(prefixes[i], &desc, NULL) );
+    }
+
+    ccomp_timer_start();
+    const int iter_count = 5000;
+
+    for (int i = 0; i < iter_count; ++i) {
+        const int fd = open((i % 2) ? "/fs0" FILE1 : "/fs9" FILE1, 0, 0);
+        TEST_ASSERT_NOT_EQUAL(fd, -1);
+        TEST_ASSERT_NOT_EQUAL(close(fd), -1);
+    }
+
+    const int64_t time_diff_us = ccomp_timer_stop();
+    const int ns_per_iter = (int) (time_diff_us * 1000 / iter_count);
+    for (int i = 0; i < vfs_count; ++i) {
+        TEST_ESP_OK( esp_vfs_unregister(prefixes[i]) );
+    }
+#ifdef CONFIG_SPIRAM
+    TEST_PERFORMANCE_CCOMP_LESS_THAN(VFS_OPEN_CLOSE_MANY_VFS_TIME_PSRAM, "%dns", ns_per_iter);
+#else
+    TEST_PERFORMANCE_CCOMP_LESS_THAN(VFS_OPEN_CLOSE_MANY_VFS_TIME, "%dns", ns_per_iter);
+#endif
+}
+
 static int vfs_overlap_test_open(const char * path, int flags, int mode)
 {
     return 0;
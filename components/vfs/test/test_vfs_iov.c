@@ -0,0 +1,133 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include "unity.h"
+#include "esp_vfs.h"
+#include "esp_vfs_fat.h"
+#include "esp_vfs_eventfd.h"
+#include "wear_levelling.h"
+
+#define OPEN_MODE   0
+#define MSG1        "Hello"
+#define MSG2        ", "
+#define MSG3        "world!"
+
+TEST_CASE("readv() and writev() fall back to read() and write() on FATFS", "[vfs][FATFS]")
+{
+    wl_handle_t test_wl_handle;
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+        .format_if_mount_failed = true,
+        .max_files = 2
+    };
+    TEST_ESP_OK(esp_vfs_fat_spiflash_mount("/spiflash", NULL, &mount_config, &test_wl_handle));
+
+    int fd = open("/spiflash/iov.txt", O_RDWR | O_CREAT | O_TRUNC, OPEN_MODE);
+    TEST_ASSERT_NOT_EQUAL(-1, fd);
+
+    const struct iovec out[] = {
+        { .iov_base = (void *) MSG1, .iov_len = strlen(MSG1) },
+        { .iov_base = NULL, .iov_len = 0 },
+        { .iov_base = (void *) MSG2, .iov_len = strlen(MSG2) },
+        { .iov_base = (void *) MSG3, .iov_len = strlen(MSG3) },
+    };
+    TEST_ASSERT_EQUAL(strlen(MSG1 MSG2 MSG3), writev(fd, out, 4));
+
+    // the second buffer is only partially filled, as the end of file is reached
+    char buf1[4];
+    char buf2[16] = { 0 };
+    const struct iovec in[] = {
+        { .iov_base = buf1, .iov_len = sizeof(buf1) },
+        { .iov_base = buf2, .iov_len = sizeof(buf2) },
+    };
+    TEST_ASSERT_EQUAL(0, lseek(fd, 0, SEEK_SET));
+    TEST_ASSERT_EQUAL(strlen(MSG1 MSG2 MSG3), readv(fd, in, 2));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(MSG1, buf1, sizeof(buf1));
+    TEST_ASSERT_EQUAL_STRING(&(MSG1 MSG2 MSG3)[sizeof(buf1)], buf2);
+
+    TEST_ASSERT_EQUAL(-1, readv(fd, in, -1));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+
+    TEST_ASSERT_NOT_EQUAL(-1, close(fd));
+    TEST_ASSERT_EQUAL(-1, writev(fd, out, 4));
+    TEST_ASSERT_EQUAL(EBADF, errno);
+    TEST_ASSERT_NOT_EQUAL(-1, unlink("/spiflash/iov.txt"));
+
+    TEST_ESP_OK(esp_vfs_fat_spiflash_unmount("/spiflash", test_wl_handle));
+}
+
+TEST_CASE("esp_vfs_sendfile() copies data between FATFS files", "[vfs][FATFS]")
+{
+    wl_handle_t test_wl_handle;
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+        .format_if_mount_failed = true,
+        .max_files = 2
+    };
+    TEST_ESP_OK(esp_vfs_fat_spiflash_mount("/spiflash", NULL, &mount_config, &test_wl_handle));
+
+    // larger than the sendfile buffer, and not a multiple of it
+    const size_t size = CONFIG_VFS_SENDFILE_BUFFER_SIZE * 2 + 100;
+    uint8_t *data = malloc(size);
+    uint8_t *check = malloc(size);
+    TEST_ASSERT_NOT_NULL(data);
+    TEST_ASSERT_NOT_NULL(check);
+    for (int i = 0; i < size; ++i) {
+        data[i] = i * 7;
+    }
+
+    int in_fd = open("/spiflash/in.bin", O_RDWR | O_CREAT | O_TRUNC, OPEN_MODE);
+    TEST_ASSERT_NOT_EQUAL(-1, in_fd);
+    TEST_ASSERT_EQUAL(size, write(in_fd, data, size));
+    int out_fd = open("/spiflash/out.bin", O_RDWR | O_CREAT | O_TRUNC, OPEN_MODE);
+    TEST_ASSERT_NOT_EQUAL(-1, out_fd);
+
+    // from the file position, which is advanced; stops at the end of the file
+    TEST_ASSERT_EQUAL(10, lseek(in_fd, 10, SEEK_SET));
+    TEST_ASSERT_EQUAL(size - 10, esp_vfs_sendfile(out_fd, in_fd, NULL, size));
+    TEST_ASSERT_EQUAL(size, lseek(in_fd, 0, SEEK_CUR));
+    TEST_ASSERT_EQUAL(0, esp_vfs_sendfile(out_fd, in_fd, NULL, size));
+
+    // from an explicit offset, the file position is not changed
+    off_t offset = 0;
+    TEST_ASSERT_EQUAL(10, esp_vfs_sendfile(out_fd, in_fd, &offset, 10));
+    TEST_ASSERT_EQUAL(10, offset);
+    TEST_ASSERT_EQUAL(size, lseek(in_fd, 0, SEEK_CUR));
+
+    TEST_ASSERT_EQUAL(0, lseek(out_fd, 0, SEEK_SET));
+    TEST_ASSERT_EQUAL(size, read(out_fd, check, size));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data + 10, check, size - 10);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, check + size - 10, 10);
+
+    TEST_ASSERT_NOT_EQUAL(-1, close(in_fd));
+    TEST_ASSERT_EQUAL(-1, esp_vfs_sendfile(out_fd, in_fd, NULL, size));
+    TEST_ASSERT_EQUAL(EBADF, errno);
+
+    // data read from a non-seekable in_fd couldn't be given back after a short write
+    esp_vfs_eventfd_config_t eventfd_config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_eventfd_register(&eventfd_config));
+    int event_fd = eventfd(1, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, event_fd);
+    TEST_ASSERT_EQUAL(-1, esp_vfs_sendfile(out_fd, event_fd, NULL, sizeof(uint64_t)));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+    uint64_t event_count = 0;
+    TEST_ASSERT_EQUAL(sizeof(event_count), read(event_fd, &event_count, sizeof(event_count)));
+    TEST_ASSERT_EQUAL(1, event_count);
+    TEST_ASSERT_EQUAL(0, close(event_fd));
+    TEST_ESP_OK(esp_vfs_eventfd_unregister());
+
+    TEST_ASSERT_NOT_EQUAL(-1, close(out_fd));
+    TEST_ASSERT_NOT_EQUAL(-1, unlink("/spiflash/in.bin"));
+    TEST_ASSERT_NOT_EQUAL(-1, unlink("/spiflash/out.bin"));
+    free(data);
+    free(check);
+
+    TEST_ESP_OK(esp_vfs_fat_spiflash_unmount("/spiflash", test_wl_handle));
+}
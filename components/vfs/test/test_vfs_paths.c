@@ -22,6 +22,10 @@
 #include "esp_vfs.h"
 #include "unity.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "test_utils.h"
 
 /* Dummy VFS implementation to check if VFS is called or not with expected path
  */
@@ -281,3 +285,62 @@ TEST_CASE("vfs checks mount point path", "[vfs]")
     test_register_ok("/23456789012345");
     test_register_fail("/234567890123456");
 }
+
+typedef struct {
+    dummy_vfs_t inst;
+    volatile bool stop;
+    volatile int failures;
+    volatile int opens;
+    SemaphoreHandle_t done;
+} concurrent_lookup_ctx_t;
+
+static void concurrent_lookup_task(void *arg)
+{
+    concurrent_lookup_ctx_t *ctx = (concurrent_lookup_ctx_t *) arg;
+    while (!ctx->stop) {
+        int fd = esp_vfs_open(__getreent(), "/stable/file", O_RDONLY, 0);
+        if (fd < 0) {
+            ctx->failures++;
+        } else {
+            esp_vfs_close(__getreent(), fd);
+        }
+        ctx->opens++;
+    }
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("vfs path lookup works while other VFSs are registered and unregistered", "[vfs]")
+{
+    concurrent_lookup_ctx_t ctx = {
+        .inst = { .match_path = "/file" },
+        .done = xSemaphoreCreateCounting(portNUM_PROCESSORS, 0),
+    };
+    TEST_ASSERT_NOT_NULL(ctx.done);
+    esp_vfs_t desc = DUMMY_VFS();
+    TEST_ESP_OK( esp_vfs_register("/stable", &desc, &ctx.inst) );
+    for (int i = 0; i < portNUM_PROCESSORS; ++i) {
+        xTaskCreatePinnedToCore(concurrent_lookup_task, "vfs_lookup", 2048, &ctx, UNITY_FREERTOS_PRIORITY, NULL, i);
+    }
+
+    dummy_vfs_t inst_tmp = { .match_path = "/file" };
+    const char *prefixes[] = { "/s", "/stable/sub", "/stab", "/other/path" };
+    for (int round = 0; round < 200; ++round) {
+        for (int i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); ++i) {
+            TEST_ESP_OK( esp_vfs_register(prefixes[i], &desc, &inst_tmp) );
+        }
+        for (int i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); ++i) {
+            TEST_ESP_OK( esp_vfs_unregister(prefixes[i]) );
+        }
+    }
+
+    ctx.stop = true;
+    for (int i = 0; i < portNUM_PROCESSORS; ++i) {
+        TEST_ASSERT_TRUE( xSemaphoreTake(ctx.done, pdMS_TO_TICKS(1000)) );
+    }
+    vSemaphoreDelete(ctx.done);
+    TEST_ESP_OK( esp_vfs_unregister("/stable") );
+    IDF_LOG_PERFORMANCE("VFS path lookups while registering", "%d", ctx.opens);
+    TEST_ASSERT_EQUAL(0, ctx.failures);
+    TEST_ASSERT_GREATER_THAN(0, ctx.opens);
+}
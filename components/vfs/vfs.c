@@ -5,6 +5,7 @@
  */
 
 #include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 #include <assert.h>
 #include <sys/errno.h>
@@ -17,6 +18,7 @@
 #include <dirent.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "esp_vfs.h"
 #include "esp_vfs_private.h"
 #include "sdkconfig.h"
@@ -33,7 +35,7 @@
 
 static const char *TAG = "vfs";
 
-#define VFS_MAX_COUNT   8   /* max number of VFS entries (registered filesystems) */
+#define VFS_MAX_COUNT   16  /* max number of VFS entries (registered filesystems) */
 #define LEN_PATH_PREFIX_IGNORED SIZE_MAX /* special length value for VFS which is never recognised by open() */
 #define FD_TABLE_ENTRY_UNUSED   (fd_table_t) { .permanent = false, .has_pending_close = false, .has_pending_select = false, .vfs_index = -1, .local_fd = -1 }
 
@@ -62,10 +64,83 @@ typedef struct {
 
 static vfs_entry_t* s_vfs[VFS_MAX_COUNT] = { 0 };
 static size_t s_vfs_count = 0;
+static _lock_t s_vfs_lock;  // serializes registering and unregistering
 
 static fd_table_t s_fd_table[MAX_FDS] = { [0 ... MAX_FDS-1] = FD_TABLE_ENTRY_UNUSED };
 static _lock_t s_fd_table_lock;
 
+/* VFS entries which have a path prefix, sorted by decreasing prefix length, so that
+ * get_vfs_for_path can return the first match. Two tables are kept: a new one is built
+ * into the unused table and then published by a single pointer write, so that
+ * get_vfs_for_path doesn't need to take a lock.
+ *
+ * Each table counts the readers walking it. A reader registers itself in the published
+ * table and checks that the table is still published, otherwise it backs off and retries.
+ * The writer waits for the readers of a table to leave before building a new order into it,
+ * and for the readers of the previous table to leave before an unregistered entry is freed.
+ */
+typedef struct {
+    size_t count;
+    const vfs_entry_t *entries[VFS_MAX_COUNT];
+    uint32_t readers;
+} vfs_path_order_t;
+
+static vfs_path_order_t s_path_order_tables[2];
+static vfs_path_order_t *s_path_order = &s_path_order_tables[0];
+
+static const vfs_path_order_t *path_order_acquire(void)
+{
+    while (true) {
+        vfs_path_order_t *order = __atomic_load_n(&s_path_order, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&order->readers, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&s_path_order, __ATOMIC_SEQ_CST) == order) {
+            return order;
+        }
+        // replaced in the meantime, the writer may be about to rebuild it
+        __atomic_sub_fetch(&order->readers, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+static void path_order_release(const vfs_path_order_t *order)
+{
+    __atomic_sub_fetch(&((vfs_path_order_t *) order)->readers, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Wait until no reader walks the table anymore; new readers of an unpublished table back off */
+static void path_order_wait_for_readers(vfs_path_order_t *order)
+{
+    while (__atomic_load_n(&order->readers, __ATOMIC_SEQ_CST) != 0) {
+        // readers never block while walking the table, so this takes at most a few ticks
+        vTaskDelay(1);
+    }
+}
+
+/* Called with s_vfs_lock taken, after each change of s_vfs. When this function returns,
+ * no reader can access an entry which was removed from s_vfs before the call. */
+static void update_path_order(void)
+{
+    vfs_path_order_t *current = s_path_order;
+    vfs_path_order_t *order = (current == &s_path_order_tables[0]) ? &s_path_order_tables[1] : &s_path_order_tables[0];
+    path_order_wait_for_readers(order);
+    order->count = 0;
+    for (size_t i = 0; i < s_vfs_count; ++i) {
+        const vfs_entry_t *vfs = s_vfs[i];
+        if (vfs == NULL || vfs->path_prefix_len == LEN_PATH_PREFIX_IGNORED) {
+            continue;
+        }
+        // insertion sort; entries with the same prefix length stay in the order of registration
+        size_t pos = order->count;
+        while (pos > 0 && order->entries[pos - 1]->path_prefix_len < vfs->path_prefix_len) {
+            order->entries[pos] = order->entries[pos - 1];
+            --pos;
+        }
+        order->entries[pos] = vfs;
+        ++order->count;
+    }
+    __atomic_store_n(&s_path_order, order, __ATOMIC_SEQ_CST);
+    path_order_wait_for_readers(current);
+}
+
 esp_err_t esp_vfs_register_common(const char* base_path, size_t len, const esp_vfs_t* vfs, void* ctx, int *vfs_index)
 {
     if (len != LEN_PATH_PREFIX_IGNORED) {
@@ -82,6 +157,7 @@ esp_err_t esp_vfs_register_common(const char* base_path, size_t len, const esp_v
     if (entry == NULL) {
         return ESP_ERR_NO_MEM;
     }
+    _lock_acquire(&s_vfs_lock);
     size_t index;
     for (index = 0; index < s_vfs_count; ++index) {
         if (s_vfs[index] == NULL) {
@@ -90,6 +166,7 @@ esp_err_t esp_vfs_register_common(const char* base_path, size_t len, const esp_v
     }
     if (index == s_vfs_count) {
         if (s_vfs_count >= VFS_MAX_COUNT) {
+            _lock_release(&s_vfs_lock);
             free(entry);
             return ESP_ERR_NO_MEM;
         }
@@ -105,6 +182,8 @@ esp_err_t esp_vfs_register_common(const char* base_path, size_t len, const esp_v
     entry->path_prefix_len = len;
     entry->ctx = ctx;
     entry->offset = index;
+    update_path_order();
+    _lock_release(&s_vfs_lock);
 
     if (vfs_index) {
         *vfs_index = index;
@@ -132,14 +211,9 @@ esp_err_t esp_vfs_register_fd_range(const esp_vfs_t *vfs, void *ctx, int min_fd,
         _lock_acquire(&s_fd_table_lock);
         for (int i = min_fd; i < max_fd; ++i) {
             if (s_fd_table[i].vfs_index != -1) {
-                free(s_vfs[index]);
-                s_vfs[index] = NULL;
-                for (int j = min_fd; j < i; ++j) {
-                    if (s_fd_table[j].vfs_index == index) {
-                        s_fd_table[j] = FD_TABLE_ENTRY_UNUSED;
-                    }
-                }
                 _lock_release(&s_fd_table_lock);
+                // also drops the descriptors set so far
+                esp_vfs_unregister_with_id(index);
                 ESP_LOGD(TAG, "esp_vfs_register_fd_range cannot set fd %d (used by other VFS)", i);
                 return ESP_ERR_INVALID_ARG;
             }
@@ -165,30 +239,46 @@ esp_err_t esp_vfs_register_with_id(const esp_vfs_t *vfs, void *ctx, esp_vfs_id_t
     return esp_vfs_register_common("", LEN_PATH_PREFIX_IGNORED, vfs, ctx, vfs_id);
 }
 
-esp_err_t esp_vfs_unregister_with_id(esp_vfs_id_t vfs_id)
+/* Called with s_vfs_lock taken */
+static void unregister_locked(esp_vfs_id_t vfs_id)
 {
-    if (vfs_id < 0 || vfs_id >= MAX_FDS || s_vfs[vfs_id] == NULL) {
-        return ESP_ERR_INVALID_ARG;
-    }
     vfs_entry_t* vfs = s_vfs[vfs_id];
-    free(vfs);
     s_vfs[vfs_id] = NULL;
 
     _lock_acquire(&s_fd_table_lock);
     // Delete all references from the FD lookup-table
-    for (int j = 0; j < VFS_MAX_COUNT; ++j) {
+    for (int j = 0; j < MAX_FDS; ++j) {
         if (s_fd_table[j].vfs_index == vfs_id) {
             s_fd_table[j] = FD_TABLE_ENTRY_UNUSED;
         }
     }
     _lock_release(&s_fd_table_lock);
 
+    // returns once no lookup by path can see the entry anymore
+    update_path_order();
+    free(vfs);
+}
+
+esp_err_t esp_vfs_unregister_with_id(esp_vfs_id_t vfs_id)
+{
+    if (vfs_id < 0 || vfs_id >= VFS_MAX_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    _lock_acquire(&s_vfs_lock);
+    if (s_vfs[vfs_id] == NULL) {
+        _lock_release(&s_vfs_lock);
+        return ESP_ERR_INVALID_ARG;
+    }
+    unregister_locked(vfs_id);
+    _lock_release(&s_vfs_lock);
     return ESP_OK;
 }
 
 esp_err_t esp_vfs_unregister(const char* base_path)
 {
     const size_t base_path_len = strlen(base_path);
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    _lock_acquire(&s_vfs_lock);
     for (size_t i = 0; i < s_vfs_count; ++i) {
         vfs_entry_t* vfs = s_vfs[i];
         if (vfs == NULL) {
@@ -196,10 +286,13 @@ esp_err_t esp_vfs_unregister(const char* base_path)
         }
         if (base_path_len == vfs->path_prefix_len &&
                 memcmp(base_path, vfs->path_prefix, vfs->path_prefix_len) == 0) {
-            return esp_vfs_unregister_with_id(i);
+            unregister_locked(i);
+            ret = ESP_OK;
+            break;
         }
     }
-    return ESP_ERR_INVALID_STATE;
+    _lock_release(&s_vfs_lock);
+    return ret;
 }
 
 esp_err_t esp_vfs_register_fd(esp_vfs_id_t vfs_id, int *fd)
@@ -308,42 +401,27 @@ static const char* translate_path(const vfs_entry_t* vfs, const char* src_path)
 
 const vfs_entry_t* get_vfs_for_path(const char* path)
 {
-    const vfs_entry_t* best_match = NULL;
-    ssize_t best_match_prefix_len = -1;
-    size_t len = strlen(path);
-    for (size_t i = 0; i < s_vfs_count; ++i) {
-        const vfs_entry_t* vfs = s_vfs[i];
-        if (!vfs || vfs->path_prefix_len == LEN_PATH_PREFIX_IGNORED) {
-            continue;
-        }
-        // match path prefix
-        if (len < vfs->path_prefix_len ||
-            memcmp(path, vfs->path_prefix, vfs->path_prefix_len) != 0) {
-            continue;
-        }
-        // this is the default VFS and we don't have a better match yet.
-        if (vfs->path_prefix_len == 0 && !best_match) {
-            best_match = vfs;
+    // Longer prefixes are checked first, so the first match is the longest matching prefix;
+    // i.e. if "/dev" and "/dev/uart" both match, for "/dev/uart/1" path, choose "/dev/uart".
+    // The default VFS (empty prefix) comes last.
+    const vfs_entry_t *found = NULL;
+    const vfs_path_order_t *order = path_order_acquire();
+    for (size_t i = 0; i < order->count; ++i) {
+        const vfs_entry_t* vfs = order->entries[i];
+        const size_t prefix_len = vfs->path_prefix_len;
+        // match path prefix; strncmp stops at the end of a path shorter than the prefix
+        if (strncmp(path, vfs->path_prefix, prefix_len) != 0) {
             continue;
         }
         // if path is not equal to the prefix, expect to see a path separator
         // i.e. don't match "/data" prefix for "/data1/foo.txt" path
-        if (len > vfs->path_prefix_len &&
-                path[vfs->path_prefix_len] != '/') {
-            continue;
-        }
-        // Out of all matching path prefixes, select the longest one;
-        // i.e. if "/dev" and "/dev/uart" both match, for "/dev/uart/1" path,
-        // choose "/dev/uart",
-        // This causes all s_vfs_count VFS entries to be scanned when opening
-        // a file by name. This can be optimized by introducing a table for
-        // FS search order, sorted so that longer prefixes are checked first.
-        if (best_match_prefix_len < (ssize_t) vfs->path_prefix_len) {
-            best_match_prefix_len = (ssize_t) vfs->path_prefix_len;
-            best_match = vfs;
+        if (prefix_len == 0 || path[prefix_len] == '\0' || path[prefix_len] == '/') {
+            found = vfs;
+            break;
         }
     }
-    return best_match;
+    path_order_release(order);
+    return found;
 }
 
 /*
@@ -491,6 +569,171 @@ ssize_t esp_vfs_pwrite(int fd, const void *src, size_t size, off_t offset)
     return ret;
 }
 
+static bool iov_valid(const struct iovec *iov, int iovcnt)
+{
+    if (iovcnt < 0 || (iov == NULL && iovcnt > 0)) {
+        return false;
+    }
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        // the total length must be representable in the return value
+        if (iov[i].iov_len > SSIZE_MAX - total) {
+            return false;
+        }
+        total += iov[i].iov_len;
+    }
+    return true;
+}
+
+/* readv/writev for drivers which don't implement them: one read/write per buffer, until a short transfer */
+static ssize_t iov_read_write(struct _reent *r, const vfs_entry_t *vfs, int local_fd, const struct iovec *iov, int iovcnt, bool write)
+{
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (iov[i].iov_len == 0) {
+            continue;
+        }
+        ssize_t ret;
+        if (write) {
+            CHECK_AND_CALL(ret, r, vfs, write, local_fd, iov[i].iov_base, iov[i].iov_len);
+        } else {
+            CHECK_AND_CALL(ret, r, vfs, read, local_fd, iov[i].iov_base, iov[i].iov_len);
+        }
+        if (ret < 0) {
+            // report the data already transferred, the error will occur again on the next call
+            return (total > 0) ? total : -1;
+        }
+        total += ret;
+        if ((size_t) ret < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
+ssize_t esp_vfs_readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    struct _reent *r = __getreent();
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
+    const int local_fd = get_local_fd(vfs, fd);
+    if (vfs == NULL || local_fd < 0) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (!iov_valid(iov, iovcnt)) {
+        __errno_r(r) = EINVAL;
+        return -1;
+    }
+    if (vfs->vfs.readv == NULL) {
+        return iov_read_write(r, vfs, local_fd, iov, iovcnt, false);
+    }
+    ssize_t ret;
+    CHECK_AND_CALL(ret, r, vfs, readv, local_fd, iov, iovcnt);
+    return ret;
+}
+
+ssize_t esp_vfs_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    struct _reent *r = __getreent();
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
+    const int local_fd = get_local_fd(vfs, fd);
+    if (vfs == NULL || local_fd < 0) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (!iov_valid(iov, iovcnt)) {
+        __errno_r(r) = EINVAL;
+        return -1;
+    }
+    if (vfs->vfs.writev == NULL) {
+        return iov_read_write(r, vfs, local_fd, iov, iovcnt, true);
+    }
+    ssize_t ret;
+    CHECK_AND_CALL(ret, r, vfs, writev, local_fd, iov, iovcnt);
+    return ret;
+}
+
+ssize_t esp_vfs_sendfile(int out_fd, int in_fd, off_t *offset, size_t count)
+{
+    struct _reent *r = __getreent();
+    if (get_vfs_for_fd(out_fd) == NULL || get_vfs_for_fd(in_fd) == NULL) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (count > SSIZE_MAX) {
+        count = SSIZE_MAX;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    off_t pos;
+    if (offset != NULL) {
+        pos = *offset;
+    } else {
+        // the data read but not written is given back by seeking, so in_fd must be seekable
+        pos = esp_vfs_lseek(r, in_fd, 0, SEEK_CUR);
+        if (pos < 0) {
+            __errno_r(r) = EINVAL;
+            return -1;
+        }
+    }
+    const size_t buf_size = MIN(count, CONFIG_VFS_SENDFILE_BUFFER_SIZE);
+    uint8_t *buf = malloc(buf_size);
+    if (buf == NULL) {
+        __errno_r(r) = ENOMEM;
+        return -1;
+    }
+
+    size_t sent = 0;
+    int err = 0;
+    while (sent < count) {
+        const size_t to_read = MIN(count - sent, buf_size);
+        ssize_t len;
+        if (offset != NULL) {
+            len = esp_vfs_pread(in_fd, buf, to_read, pos);
+        } else {
+            len = esp_vfs_read(r, in_fd, buf, to_read);
+        }
+        if (len <= 0) {
+            err = (len < 0) ? errno : 0;
+            break;
+        }
+        size_t written = 0;
+        while (written < (size_t) len) {
+            ssize_t ret = esp_vfs_write(r, out_fd, buf + written, len - written);
+            if (ret <= 0) {
+                err = (ret < 0) ? errno : 0;
+                break;
+            }
+            written += ret;
+        }
+        sent += written;
+        pos += written;
+        if (written < (size_t) len) {
+            if (offset == NULL) {
+                // give the data which wasn't sent back to the input, as it was already read
+                const off_t res = esp_vfs_lseek(r, in_fd, pos, SEEK_SET);
+                if (res != pos) {
+                    // in_fd is positioned past the data sent, so the rest of buf would be lost silently
+                    err = (res < 0) ? errno : EIO;
+                    sent = 0;
+                }
+            }
+            break;
+        }
+    }
+    free(buf);
+
+    if (offset != NULL) {
+        *offset = pos;
+    }
+    if (sent == 0 && err != 0) {
+        __errno_r(r) = err;
+        return -1;
+    }
+    return sent;
+}
+
 int esp_vfs_close(struct _reent *r, int fd)
 {
     const vfs_entry_t* vfs = get_vfs_for_fd(fd);
@@ -1242,6 +1485,10 @@ ssize_t pread(int fd, void *dst, size_t size, off_t offset)
     __attribute__((alias("esp_vfs_pread")));
 ssize_t pwrite(int fd, const void *src, size_t size, off_t offset)
     __attribute__((alias("esp_vfs_pwrite")));
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+    __attribute__((alias("esp_vfs_readv")));
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+    __attribute__((alias("esp_vfs_writev")));
 off_t _lseek_r(struct _reent *r, int fd, off_t size, int mode)
     __attribute__((alias("esp_vfs_lseek")));
 int _fcntl_r(struct _reent *r, int fd, int cmd, int arg)
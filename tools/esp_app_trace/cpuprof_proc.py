@@ -0,0 +1,198 @@
+#!/usr/bin/env python
+#
+# SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+#
+# This is python script to process the samples of the sampling CPU profiler (esp_cpu_prof.h).
+# Samples can be provided either as a trace file captured via application level tracing or as
+# a console log containing the output of esp_cpu_prof_dump_folded(). The script translates the
+# sampled addresses to function names and prints folded stacks which can be fed to flamegraph.pl.
+#
+
+import argparse
+import bisect
+import re
+import struct
+import sys
+
+import elftools.elf.elffile as elffile
+import espytrace.apptrace as apptrace
+
+try:
+    from typing import Dict, Optional, Tuple
+except ImportError:
+    # Only used for type annotations
+    pass
+
+CPU_PROF_REC_START = 0
+CPU_PROF_REC_TASK = 1
+CPU_PROF_REC_SAMPLE = 2
+CPU_PROF_REC_MAGIC = b'CPRF'
+CPU_PROF_REC_VERSION = 1
+
+CPU_PROF_TASK_OTHER = 0xFE
+CPU_PROF_TASK_ISR = 0xFF
+
+# "<task>;0x...;0x... <count>", samples of interrupted ISRs have no PCs
+FOLDED_LINE_RE = re.compile(r'^(?P<task>[^;]+?)(?P<pcs>(;0x[0-9a-fA-F]+)*) (?P<count>\d+)$')
+
+
+class CpuProfParseError(RuntimeError):
+    def __init__(self, message):  # type: (str) -> None
+        RuntimeError.__init__(self, message)
+
+
+def pseudo_task_name(task_idx):  # type: (int) -> Optional[str]
+    if task_idx == CPU_PROF_TASK_ISR:
+        return '(isr)'
+    if task_idx == CPU_PROF_TASK_OTHER:
+        return '(other)'
+    return None
+
+
+def is_binary_trace(fname):  # type: (str) -> bool
+    with open(fname, 'rb') as f:
+        hdr = f.read(8)
+    return len(hdr) == 8 and (struct.unpack('<L', hdr[:4])[0] & 0xFF) == CPU_PROF_REC_START and hdr[4:] == CPU_PROF_REC_MAGIC
+
+
+def parse_trace(fname, per_core):  # type: (str, bool) -> Dict[Tuple[str, Tuple[int, ...]], int]
+    """
+        Parses samples streamed via application level tracing.
+
+        Returns
+        -------
+        dict
+            number of samples for every (task, PCs from the outermost frame) key
+    """
+    stacks = {}  # type: Dict[Tuple[str, Tuple[int, ...]], int]
+    tasks = {}  # type: Dict[Tuple[int, int], str]
+    with open(fname, 'rb') as f:
+        data = f.read()
+    pos = 0
+    while pos + 4 <= len(data):
+        hdr, = struct.unpack_from('<L', data, pos)
+        pos += 4
+        rec_type = hdr & 0xFF
+        core = (hdr >> 8) & 0xFF
+        task_idx = (hdr >> 16) & 0xFF
+        length = hdr >> 24
+        if rec_type == CPU_PROF_REC_START:
+            if data[pos:pos + 4] != CPU_PROF_REC_MAGIC or length != CPU_PROF_REC_VERSION:
+                raise CpuProfParseError('Unsupported trace format at offset %d!' % (pos - 4))
+            pos += 4
+            # task indexes are announced again after every start
+            tasks = {}
+        elif rec_type == CPU_PROF_REC_TASK:
+            if pos + length > len(data):
+                break
+            tasks[(core, task_idx)] = data[pos:pos + length].decode('utf-8', errors='replace')
+            pos += length
+        elif rec_type == CPU_PROF_REC_SAMPLE:
+            if pos + 4 * length > len(data):
+                break
+            pcs = struct.unpack_from('<%dL' % length, data, pos)
+            pos += 4 * length
+            name = pseudo_task_name(task_idx) or tasks.get((core, task_idx), 'task%d' % task_idx)
+            if per_core:
+                name = 'cpu%d;%s' % (core, name)
+            key = (name, tuple(reversed(pcs)))
+            stacks[key] = stacks.get(key, 0) + 1
+        else:
+            raise CpuProfParseError('Unknown record type %d at offset %d!' % (rec_type, pos - 4))
+    if pos != len(data):
+        print('Unprocessed %d bytes at the end of the trace!' % (len(data) - pos), file=sys.stderr)
+    return stacks
+
+
+def parse_folded_log(fname):  # type: (str) -> Dict[Tuple[str, Tuple[int, ...]], int]
+    """
+        Parses the output of esp_cpu_prof_dump_folded() from a console log, other lines are ignored.
+    """
+    stacks = {}  # type: Dict[Tuple[str, Tuple[int, ...]], int]
+    with open(fname, 'r', errors='replace') as f:
+        for line in f:
+            m = FOLDED_LINE_RE.match(line.strip())
+            if m is None:
+                continue
+            pcs = tuple(int(pc, 16) for pc in m.group('pcs').split(';')[1:])
+            if len(pcs) == 0 and m.group('task') != pseudo_task_name(CPU_PROF_TASK_ISR):
+                continue
+            key = (m.group('task'), pcs)
+            stacks[key] = stacks.get(key, 0) + int(m.group('count'))
+    return stacks
+
+
+class Symbolizer(object):
+    def __init__(self, elf_path, toolchain=None):  # type: (str, Optional[str]) -> None
+        super(Symbolizer, self).__init__()
+        self.elf_path = elf_path
+        self.toolchain = toolchain
+        self.cache = {}  # type: Dict[int, str]
+        try:
+            with open(elf_path, 'rb') as f:
+                symtab = elffile.ELFFile(f).get_section_by_name('.symtab')
+                if symtab is None:
+                    raise CpuProfParseError('No symbol table in ELF file!')
+                funcs = sorted((sym['st_value'], sym['st_size'], sym.name) for sym in symtab.iter_symbols()
+                               if sym['st_info']['type'] == 'STT_FUNC' and sym['st_size'] > 0)
+        except OSError as e:
+            raise CpuProfParseError('Failed to open ELF file (%s)!' % e)
+        self.starts = [func[0] for func in funcs]
+        self.funcs = funcs
+
+    def lookup(self, addr):  # type: (int) -> str
+        if addr in self.cache:
+            return self.cache[addr]
+        name = '0x%x' % addr
+        i = bisect.bisect_right(self.starts, addr) - 1
+        if i >= 0 and addr < self.funcs[i][0] + self.funcs[i][1]:
+            name = self.funcs[i][2]
+        if self.toolchain is not None:
+            loc = apptrace.addr2line(self.toolchain, self.elf_path, addr).strip()
+            if loc and not loc.startswith('??'):
+                name = '%s [%s]' % (name, loc)
+        self.cache[addr] = name
+        return name
+
+
+def symbolize(stacks, symbolizer):  # type: (Dict[Tuple[str, Tuple[int, ...]], int], Symbolizer) -> Dict[str, int]
+    folded = {}  # type: Dict[str, int]
+    for (task, pcs), count in stacks.items():
+        key = ';'.join([task] + [symbolizer.lookup(pc) for pc in pcs])
+        folded[key] = folded.get(key, 0) + count
+    return folded
+
+
+def main():  # type: () -> None
+    parser = argparse.ArgumentParser(description='ESP32 Sampling CPU Profiler Processing Tool')
+
+    parser.add_argument('trace_file', help='Path to profiler trace file or console log with folded stacks', type=str)
+    parser.add_argument('elf_file', help='Path to program ELF file', type=str)
+    parser.add_argument('--toolchain-prefix', '-t', help='Toolchain prefix, when given source line locations are added', type=str)
+    parser.add_argument('--per-core', '-c', help='Split stacks by CPU, only for trace files', action='store_true')
+    parser.add_argument('--output', '-o', help='Output file, stdout by default', type=str)
+    args = parser.parse_args()
+
+    try:
+        if is_binary_trace(args.trace_file):
+            stacks = parse_trace(args.trace_file, args.per_core)
+        else:
+            stacks = parse_folded_log(args.trace_file)
+        folded = symbolize(stacks, Symbolizer(args.elf_file, args.toolchain_prefix))
+    except (CpuProfParseError, OSError) as e:
+        print('Failed to process profiler data (%s)!' % e, file=sys.stderr)
+        sys.exit(2)
+
+    out = open(args.output, 'w') if args.output else sys.stdout
+    for stack, count in sorted(folded.items(), key=lambda item: (-item[1], item[0])):
+        out.write('%s %d\n' % (stack, count))
+    if args.output:
+        out.close()
+    else:
+        out.flush()
+    print('%d samples in %d stacks' % (sum(folded.values()), len(folded)), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,10 @@
+#!/usr/bin/env bash
+
+{ python -m coverage debug sys \
+    && python -m coverage erase &> output \
+    && python -m coverage run -a $IDF_PATH/tools/esp_app_trace/cpuprof_proc.py cpu_prof.trc ../logtrace/test.elf &>> output \
+    && python -m coverage run -a $IDF_PATH/tools/esp_app_trace/cpuprof_proc.py -c cpu_prof.trc ../logtrace/test.elf &>> output \
+    && python -m coverage run -a $IDF_PATH/tools/esp_app_trace/cpuprof_proc.py cpu_prof.log ../logtrace/test.elf &>> output \
+    && diff output expected_output \
+    && python -m coverage report \
+; } || { echo 'The test for cpuprof_proc has failed. Please examine the artifacts.' ; exit 1; }